@@ -0,0 +1,463 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include "aot.h"
+#include "ir.h"
+#include "eval.h"    // For BinaryOperator
+#include "vm.h"      // For vm_init, run_vm, vm_cleanup
+#include "stdlib.h"  // For register_stdlib_functions
+#include "module.h"  // For module_manager_init/cleanup
+#include "intern.h"  // For intern, intern_table_free
+
+// ---- Runtime side ----
+
+static const AotProgram *aot_program = NULL;
+static ASTNode **aot_nodes = NULL; // Rebuilt node of each AotNode
+
+uint32_t aot_chunk_signature(const BytecodeChunk *chunk) {
+    // FNV-1a over the instructions and the numeric constants generated code inlines
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < chunk->count; i++) {
+        const Instruction *ins = &chunk->code[i];
+        int64_t fields[3] = { ins->op, ins->operand, 0 };
+        if (ins->op == OP_CONSTANT) {
+            Value constant = chunk->constants[ins->operand];
+            fields[2] = constant.type == VAL_INT ? constant.as.integer :
+                        constant.type == VAL_BOOL ? constant.as.boolean : (int64_t)constant.type;
+            if (constant.type == VAL_DOUBLE) memcpy(&fields[2], &constant.as.number, sizeof(fields[2]));
+        }
+        const unsigned char *bytes = (const unsigned char*)fields;
+        for (size_t j = 0; j < sizeof(fields); j++) {
+            hash ^= bytes[j];
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+void aot_attach(BytecodeChunk *chunk, ASTNode *node) {
+    if (!aot_program || !chunk) return;
+    for (int i = 0; i < aot_program->chunk_count; i++) {
+        const AotChunk *compiled = &aot_program->chunks[i];
+        if (aot_nodes[compiled->node] != node) continue;
+        if (compiled->instruction_count == chunk->count && compiled->signature == aot_chunk_signature(chunk)) {
+            chunk->compiled = compiled->function;
+        } else {
+            fprintf(stderr, "[AOT] Warning: '%s' compiled to different bytecode than at -emit-c time; interpreting it\n", chunk->name);
+        }
+        return;
+    }
+}
+
+static void copy_text(char *dest, size_t size, const char *text) {
+    strncpy(dest, text ? text : "", size - 1);
+    dest[size - 1] = '\0';
+}
+
+static ASTNode* aot_build_tree(const AotProgram *program) {
+    aot_nodes = (ASTNode**)calloc(program->node_count, sizeof(ASTNode*));
+    if (!aot_nodes) return NULL;
+    for (int i = 0; i < program->node_count; i++) {
+        const AotNode *n = &program->nodes[i];
+        ASTNode *node = create_node(n->type, n->value, n->line, n->col);
+        if (!node) return NULL;
+        copy_text(node->data_type, sizeof(node->data_type), n->data_type);
+        copy_text(node->generic_type, sizeof(node->generic_type), n->generic_type);
+        node->is_void = n->is_void;
+        node->is_array = n->is_array;
+        node->array_size = n->array_size;
+        copy_text(node->access_modifier, sizeof(node->access_modifier), n->access_modifier);
+        node->parent_class_name = n->parent_class_name ? intern(n->parent_class_name) : NULL;
+        node->var_scope = n->var_scope;
+        node->var_slot = n->var_slot;
+        node->local_count = n->local_count;
+        node->static_type = n->static_type;
+        if (n->local_names >= 0) {
+            node->local_names = (const char**)malloc(sizeof(const char*) * (n->local_count > 0 ? n->local_count : 1));
+            if (!node->local_names) return NULL;
+            for (int j = 0; j < n->local_count; j++) node->local_names[j] = intern(program->names[n->local_names + j]);
+        }
+        aot_nodes[i] = node;
+    }
+    for (int i = 0; i < program->node_count; i++) {
+        const AotNode *n = &program->nodes[i];
+        aot_nodes[i]->left = n->left >= 0 ? aot_nodes[n->left] : NULL;
+        aot_nodes[i]->right = n->right >= 0 ? aot_nodes[n->right] : NULL;
+        aot_nodes[i]->next = n->next >= 0 ? aot_nodes[n->next] : NULL;
+    }
+    return aot_nodes[0];
+}
+
+// main() of a compiled program: the execution half of main.c's pipeline
+int aot_main(const AotProgram *program, int argc, char **argv) {
+    int jit_flag = 1;
+    int gc_stats_flag = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-no-jit") == 0) jit_flag = 0;
+        else if (strcmp(argv[i], "-gc-stats") == 0) gc_stats_flag = 1;
+    }
+
+    ASTNode *root = aot_build_tree(program);
+    if (!root) {
+        fprintf(stderr, "Error: Memory allocation failed rebuilding the program\n");
+        return 1;
+    }
+    aot_program = program;
+
+    module_manager_init();
+    register_stdlib_functions();
+    vm_set_bytecode_enabled(1);
+    vm_set_jit_enabled(jit_flag); // For imported modules, and chunks that failed to attach
+    vm_set_gc_stats_enabled(gc_stats_flag);
+    vm_init();
+    run_vm(root);
+    vm_cleanup();
+    module_manager_cleanup();
+
+    aot_program = NULL;
+    free_ast(root);
+    free(aot_nodes);
+    aot_nodes = NULL;
+    intern_table_free();
+    return 0;
+}
+
+// ---- Compiler side ----
+
+typedef struct Emitter {
+    ASTNode **nodes;   // Preorder; a node's index is its position
+    int *links;        // left, right, next index of each node
+    int node_count;
+    int node_capacity;
+    int failed;
+} Emitter;
+
+static int number_nodes(Emitter *e, ASTNode *node) {
+    if (!node || e->failed) return -1;
+    if (e->node_count == e->node_capacity) {
+        int capacity = e->node_capacity ? e->node_capacity * 2 : 256;
+        ASTNode **nodes = (ASTNode**)realloc(e->nodes, sizeof(ASTNode*) * capacity);
+        if (nodes) e->nodes = nodes;
+        int *links = (int*)realloc(e->links, sizeof(int) * 3 * capacity);
+        if (links) e->links = links;
+        if (!nodes || !links) { e->failed = 1; return -1; }
+        e->node_capacity = capacity;
+    }
+    int index = e->node_count++;
+    e->nodes[index] = node;
+    int left = number_nodes(e, node->left);
+    int right = number_nodes(e, node->right);
+    int next = number_nodes(e, node->next);
+    e->links[3 * index] = left;
+    e->links[3 * index + 1] = right;
+    e->links[3 * index + 2] = next;
+    return index;
+}
+
+// C string literal for text, or NULL
+static void emit_string(FILE *out, const char *text) {
+    if (!text) { fputs("NULL", out); return; }
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char*)text; *p; p++) {
+        if (*p == '"' || *p == '\\') fprintf(out, "\\%c", *p);
+        else if (*p == '\n') fputs("\\n", out);
+        else if (*p == '\t') fputs("\\t", out);
+        else if (*p < 0x20 || *p >= 0x7F || *p == '?') fprintf(out, "\\%03o", *p); // '?' avoids trigraphs
+        else fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+static void emit_int64(FILE *out, int64_t n) {
+    if (n == INT64_MIN) fputs("INT64_MIN", out);
+    else fprintf(out, "INT64_C(%" PRId64 ")", n);
+}
+
+static void emit_double(FILE *out, double d) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.17g", d);
+    fputs(text, out);
+    if (!strpbrk(text, ".e")) fputs(".0", out); // Keeps -0.0 negative
+}
+
+static int is_function_node(const ASTNode *node) {
+    return node->type == AST_FUNCTION || node->type == AST_TYPED_FUNCTION || node->type == AST_CLASS_METHOD;
+}
+
+static const char *comparisons[] = { "==", "!=", "<", ">", "<=", ">=" }; // C's, on doubles, leave NaN unordered
+
+// The statements computing op on two ints l and r
+static void emit_int_operation(FILE *out, BinaryOperator op, int index) {
+    fprintf(out, "        int64_t l = sp[-2].as.integer, r = sp[-1].as.integer;\n");
+    switch (op) {
+        case BINOP_ADD: fprintf(out, "        AOT_SET_INT(sp[-2], AOT_WRAP(l, +, r)); sp--;\n"); break;
+        case BINOP_SUB: fprintf(out, "        AOT_SET_INT(sp[-2], AOT_WRAP(l, -, r)); sp--;\n"); break;
+        case BINOP_MUL: fprintf(out, "        AOT_SET_INT(sp[-2], AOT_WRAP(l, *, r)); sp--;\n"); break;
+        case BINOP_DIV:
+            fprintf(out, "        if (r != 0 && r != -1 && l %% r == 0) { AOT_SET_INT(sp[-2], l / r); sp--; } else AOT_STEP(%d);\n", index);
+            break;
+        case BINOP_MOD:
+            fprintf(out, "        if (r != 0 && r != -1) { AOT_SET_INT(sp[-2], l %% r); sp--; } else AOT_STEP(%d);\n", index);
+            break;
+        case BINOP_SHL: fprintf(out, "        AOT_SET_INT(sp[-2], (int64_t)((uint64_t)l << (r & 63))); sp--;\n"); break;
+        case BINOP_SHR: fprintf(out, "        AOT_SET_INT(sp[-2], l >> (r & 63)); sp--;\n"); break;
+        case BINOP_EQ: case BINOP_NE: case BINOP_LT: case BINOP_GT: case BINOP_LE: case BINOP_GE:
+            fprintf(out, "        AOT_SET_BOOL(sp[-2], l %s r); sp--;\n", comparisons[op - BINOP_EQ]);
+            break;
+        case BINOP_AND: fprintf(out, "        AOT_SET_BOOL(sp[-2], l != 0 && r != 0); sp--;\n"); break;
+        case BINOP_OR:  fprintf(out, "        AOT_SET_BOOL(sp[-2], l != 0 || r != 0); sp--;\n"); break;
+        default:        fprintf(out, "        (void)l; (void)r; AOT_STEP(%d);\n", index); break;
+    }
+}
+
+// Arithmetic and comparisons have an inline double form; the rest go through the VM
+static int has_double_operation(BinaryOperator op) {
+    return op == BINOP_ADD || op == BINOP_SUB || op == BINOP_MUL || op == BINOP_DIV || (op >= BINOP_EQ && op <= BINOP_GE);
+}
+
+// The statements computing op on two numbers l and r, at least one a double
+static void emit_double_operation(FILE *out, BinaryOperator op, int index) {
+    fprintf(out, "        double l = AOT_NUMBER(sp[-2]), r = AOT_NUMBER(sp[-1]);\n");
+    if (op == BINOP_DIV) {
+        fprintf(out, "        if (r != 0) { AOT_SET_DOUBLE(sp[-2], l / r); sp--; } else AOT_STEP(%d);\n", index);
+    } else if (op >= BINOP_EQ) {
+        fprintf(out, "        AOT_SET_BOOL(sp[-2], l %s r); sp--;\n", comparisons[op - BINOP_EQ]);
+    } else {
+        fprintf(out, "        AOT_SET_DOUBLE(sp[-2], l %c r); sp--;\n", op == BINOP_ADD ? '+' : op == BINOP_SUB ? '-' : '*');
+    }
+}
+
+static void emit_binary(FILE *out, const Instruction *ins, int index) {
+    BinaryOperator op = (BinaryOperator)ins->operand;
+    // Proven operand types (OP_BINARY_INT, OP_BINARY_DOUBLE) need only their form, unchecked
+    if (ins->op == OP_BINARY_INT) {
+        fprintf(out, "    {\n");
+        emit_int_operation(out, op, index);
+        fprintf(out, "    }\n");
+        return;
+    }
+    if (ins->op == OP_BINARY_DOUBLE) {
+        if (!has_double_operation(op)) {
+            fprintf(out, "    AOT_STEP(%d);\n", index);
+            return;
+        }
+        fprintf(out, "    {\n");
+        emit_double_operation(out, op, index);
+        fprintf(out, "    }\n");
+        return;
+    }
+    fprintf(out, "    if (sp[-2].type == VAL_INT && sp[-1].type == VAL_INT) {\n");
+    emit_int_operation(out, op, index);
+    if (has_double_operation(op)) {
+        fprintf(out, "    } else if (AOT_IS_NUMBER(sp[-2]) && AOT_IS_NUMBER(sp[-1])) {\n");
+        emit_double_operation(out, op, index);
+    }
+    fprintf(out, "    } else AOT_STEP(%d);\n", index);
+}
+
+static void emit_instruction(FILE *out, const BytecodeChunk *chunk, int index) {
+    const Instruction *ins = &chunk->code[index];
+    int k = ins->operand;
+    const char *base = ins->op == OP_LOAD_LOCAL || ins->op == OP_STORE_LOCAL || ins->op == OP_INCREMENT_LOCAL ? "slots" : "globals";
+    switch (ins->op) {
+        case OP_CONSTANT: {
+            Value constant = chunk->constants[k];
+            if (constant.type == VAL_INT) {
+                fprintf(out, "    AOT_SET_INT(*sp, ");
+                emit_int64(out, constant.as.integer);
+                fprintf(out, "); sp++;\n");
+            } else if (constant.type == VAL_DOUBLE && isfinite(constant.as.number)) {
+                fprintf(out, "    AOT_SET_DOUBLE(*sp, ");
+                emit_double(out, constant.as.number);
+                fprintf(out, "); sp++;\n");
+            } else if (constant.type == VAL_BOOL) {
+                fprintf(out, "    AOT_SET_BOOL(*sp, %d); sp++;\n", constant.as.boolean);
+            } else {
+                fprintf(out, "    AOT_STEP(%d);\n", index);
+            }
+            return;
+        }
+        case OP_POP:
+            fprintf(out, "    if (VALUE_IS_REFCOUNTED(sp[-1])) AOT_STEP(%d); else sp--;\n", index);
+            return;
+        case OP_LOAD_LOCAL:
+        case OP_LOAD_GLOBAL:
+            fprintf(out, "    if (VALUE_IS_REFCOUNTED(%s[%d])) AOT_STEP(%d); else { AOT_COPY(*sp, %s[%d]); sp++; }\n", base, k, index, base, k);
+            return;
+        case OP_STORE_LOCAL:
+        case OP_STORE_GLOBAL:
+            fprintf(out, "    if (VALUE_IS_REFCOUNTED(%s[%d]) || VALUE_IS_REFCOUNTED(sp[-1])) AOT_STEP(%d); else AOT_COPY(%s[%d], sp[-1]);\n",
+                    base, k, index, base, k);
+            return;
+        case OP_INCREMENT_LOCAL:
+        case OP_INCREMENT_GLOBAL:
+            fprintf(out, "    if (%s[%d].type == VAL_INT) %s[%d].as.integer = AOT_WRAP(%s[%d].as.integer, +, %d); else AOT_STEP(%d);\n",
+                    base, k, base, k, base, k, (int)INCREMENT_DELTA(ins->node), index);
+            return;
+        case OP_INCREMENT:
+            fprintf(out, "    if (sp[-1].type == VAL_INT) sp[-1].as.integer = AOT_WRAP(sp[-1].as.integer, +, %d); else AOT_STEP(%d);\n", k, index);
+            return;
+        case OP_BINARY:
+        case OP_BINARY_INT:
+        case OP_BINARY_DOUBLE:
+            emit_binary(out, ins, index);
+            return;
+        case OP_JUMP:
+            if (k <= index) fprintf(out, "    if (*gc_pending) AOT_STEP(%d); // Safe point\n", index);
+            fprintf(out, "    goto i%d;\n", k);
+            return;
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_TRUE:
+            fprintf(out, "    if (sp[-1].type == VAL_BOOL) { if (%s(--sp)->as.boolean) goto i%d; }\n",
+                    ins->op == OP_JUMP_IF_FALSE ? "!" : "", k);
+            fprintf(out, "    else if (AOT_STEP(%d), aot_next == EXEC_JUMP) goto i%d;\n", index, k);
+            return;
+        case OP_JUMP_IF_FALSE_BOOL:
+        case OP_JUMP_IF_TRUE_BOOL:
+            fprintf(out, "    if (%s(--sp)->as.boolean) goto i%d;\n", ins->op == OP_JUMP_IF_FALSE_BOOL ? "!" : "", k);
+            return;
+        case OP_TAIL_CALL:
+            fprintf(out, "    if (AOT_STEP(%d), aot_next == EXEC_RESTART) goto i0;\n", index);
+            fprintf(out, "    goto done;\n");
+            return;
+        case OP_EXEC_AST:
+            fprintf(out, "    if (AOT_STEP(%d), aot_next == EXEC_RETURN) goto done;\n", index);
+            return;
+        case OP_RETURN:
+            fprintf(out, "    state->result = *--sp;\n");
+            fprintf(out, "    goto done;\n");
+            return;
+        case OP_HALT:
+            fprintf(out, "    goto done;\n");
+            return;
+        default:
+            fprintf(out, "    AOT_STEP(%d);\n", index);
+            return;
+    }
+}
+
+static void emit_chunk(FILE *out, const BytecodeChunk *chunk, int node_index) {
+    char *targets = (char*)calloc((size_t)chunk->count + 1, 1);
+    if (!targets) return;
+    for (int i = 0; i < chunk->count; i++) {
+        const Instruction *ins = &chunk->code[i];
+        if (ins->op == OP_JUMP || ins->op == OP_JUMP_IF_FALSE || ins->op == OP_JUMP_IF_TRUE ||
+            ins->op == OP_JUMP_IF_FALSE_BOOL || ins->op == OP_JUMP_IF_TRUE_BOOL) targets[ins->operand] = 1;
+        if (ins->op == OP_TAIL_CALL) targets[0] = 1;
+    }
+    fprintf(out, "\n// %s\n", chunk->name);
+    fprintf(out, "static void ouro_chunk_%d(ExecState *state) {\n", node_index);
+    fprintf(out, "    const Instruction *code = state->chunk->code;\n");
+    fprintf(out, "    const int *gc_pending = vm_gc_pending_flag();\n");
+    fprintf(out, "    Value *sp = state->sp, *slots = state->slots, *globals = state->globals;\n");
+    fprintf(out, "    ExecResult aot_next = EXEC_NEXT;\n");
+    fprintf(out, "    (void)code; (void)gc_pending; (void)slots; (void)globals; (void)aot_next;\n");
+    for (int i = 0; i < chunk->count; i++) {
+        if (targets[i]) fprintf(out, "i%d:\n", i);
+        fprintf(out, "    // %s\n", ir_opcode_name(chunk->code[i].op));
+        emit_instruction(out, chunk, i);
+    }
+    if (targets[chunk->count]) fprintf(out, "i%d:\n", chunk->count);
+    fprintf(out, "done:\n");
+    fprintf(out, "    state->sp = sp;\n");
+    fprintf(out, "}\n");
+    free(targets);
+}
+
+int aot_emit_c(ASTNode *root, const char *source_name, const char *out_path) {
+    Emitter e;
+    memset(&e, 0, sizeof(e));
+    number_nodes(&e, root);
+    if (e.failed || e.node_count == 0) {
+        fprintf(stderr, "Error: Cannot emit C for an empty or unallocatable program\n");
+        free(e.nodes);
+        free(e.links);
+        return 0;
+    }
+    FILE *out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "Error: Cannot open '%s' for writing\n", out_path);
+        free(e.nodes);
+        free(e.links);
+        return 0;
+    }
+
+    fprintf(out, "// Generated by ouroc -emit-c from %s. Build it against the runtime library:\n", source_name);
+    fprintf(out, "//   cc -O2 -iquote <ouroboros dir> %s <ouroboros dir>/libouroboros.a -lm\n", out_path);
+    fprintf(out, "#include \"aot.h\"\n\n");
+
+    // Slot names of function and program nodes, back to back
+    int *name_offsets = (int*)malloc(sizeof(int) * e.node_count);
+    if (!name_offsets) { fclose(out); free(e.nodes); free(e.links); return 0; }
+    int name_count = 0;
+    fprintf(out, "static const char *const ouro_names[] = {\n");
+    for (int i = 0; i < e.node_count; i++) {
+        ASTNode *node = e.nodes[i];
+        name_offsets[i] = node->local_names ? name_count : -1;
+        if (!node->local_names) continue;
+        for (int j = 0; j < node->local_count; j++, name_count++) {
+            fputs("    ", out);
+            emit_string(out, node->local_names[j]);
+            fputs(",\n", out);
+        }
+    }
+    fprintf(out, "    NULL\n};\n\n");
+
+    fprintf(out, "static const AotNode ouro_nodes[] = {\n");
+    for (int i = 0; i < e.node_count; i++) {
+        ASTNode *n = e.nodes[i];
+        fprintf(out, "    { %d, ", (int)n->type);
+        emit_string(out, n->value);
+        fprintf(out, ", %d, %d, %d, %d, %d, ", e.links[3 * i], e.links[3 * i + 1], e.links[3 * i + 2], n->line, n->col);
+        emit_string(out, n->data_type);
+        fputs(", ", out);
+        emit_string(out, n->generic_type);
+        fprintf(out, ", %d, %d, %d, ", n->is_void, n->is_array, n->array_size);
+        emit_string(out, n->access_modifier);
+        fputs(", ", out);
+        emit_string(out, n->parent_class_name);
+        fprintf(out, ", %d, %d, %d, %d, %d },\n", (int)n->var_scope, n->var_slot, n->local_count, name_offsets[i], (int)n->static_type);
+    }
+    fprintf(out, "};\n");
+
+    // One function per chunk, compiled exactly as the VM will compile it at run time
+    int chunk_count = 0;
+    int *chunk_nodes = (int*)malloc(sizeof(int) * e.node_count);
+    int *chunk_counts = (int*)malloc(sizeof(int) * e.node_count);
+    uint32_t *chunk_signatures = (uint32_t*)malloc(sizeof(uint32_t) * e.node_count);
+    if (!chunk_nodes || !chunk_counts || !chunk_signatures) e.failed = 1;
+    for (int i = 0; i < e.node_count && !e.failed; i++) {
+        if (i != 0 && !is_function_node(e.nodes[i])) continue;
+        BytecodeChunk *chunk = i == 0 ? ir_compile_program(e.nodes[i]) : ir_compile_function(e.nodes[i]);
+        if (!chunk) continue;
+        emit_chunk(out, chunk, i);
+        chunk_nodes[chunk_count] = i;
+        chunk_counts[chunk_count] = chunk->count;
+        chunk_signatures[chunk_count] = aot_chunk_signature(chunk);
+        chunk_count++;
+        ir_free_chunk(chunk);
+    }
+
+    fprintf(out, "\nstatic const AotChunk ouro_chunks[] = {\n");
+    for (int i = 0; i < chunk_count; i++) {
+        fprintf(out, "    { %d, ouro_chunk_%d, %d, %" PRIu32 "u },\n", chunk_nodes[i], chunk_nodes[i], chunk_counts[i], chunk_signatures[i]);
+    }
+    fprintf(out, "};\n\n");
+    fprintf(out, "static const AotProgram ouro_program = { ouro_nodes, %d, ouro_names, ouro_chunks, %d };\n\n", e.node_count, chunk_count);
+    fprintf(out, "int main(int argc, char **argv) {\n");
+    fprintf(out, "    return aot_main(&ouro_program, argc, argv);\n");
+    fprintf(out, "}\n");
+
+    int ok = !e.failed && !ferror(out);
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Error: Failed writing '%s'\n", out_path);
+    free(chunk_nodes);
+    free(chunk_counts);
+    free(chunk_signatures);
+    free(name_offsets);
+    free(e.nodes);
+    free(e.links);
+    return ok;
+}
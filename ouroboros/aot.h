@@ -0,0 +1,72 @@
+#ifndef AOT_H
+#define AOT_H
+
+#include <stdint.h>
+#include "ast_types.h"
+#include "jit.h" // For ExecState and vm_execute_instruction
+
+// Ahead-of-time compilation (-emit-c). aot_emit_c writes a C translation unit
+// holding the analyzed, optimized AST as static tables, plus one C function per
+// bytecode chunk (the program and every function and method). Linked against the
+// runtime library (every object but main.o; `make runtime`), it builds a standalone
+// executable whose main() is aot_main: the tree is rebuilt without lexing or parsing,
+// and each chunk runs its C function instead of the dispatch loop. Numbers, slots and
+// branches are open-coded; everything else calls vm_execute_instruction, as compiled
+// JIT code does.
+
+// One AST node; links are indices into the node table, -1 for none
+typedef struct AotNode {
+    ASTNodeType type;
+    const char *value;
+    int left, right, next;
+    int line, col;
+    const char *data_type;
+    const char *generic_type;
+    int is_void, is_array, array_size;
+    const char *access_modifier;
+    const char *parent_class_name; // NULL if none
+    VariableScope var_scope;
+    int var_slot;
+    int local_count;
+    int local_names;               // Index of the first of local_count names, -1 for none
+    StaticType static_type;        // Rebuilt so each chunk compiles to the bytecode it was generated from
+} AotNode;
+
+typedef void (*AotFunction)(ExecState *state);
+
+typedef struct AotChunk {
+    int node;               // The function node, or the program node for top-level code
+    AotFunction function;
+    int instruction_count;
+    uint32_t signature;     // aot_chunk_signature() of the bytecode it was generated from
+} AotChunk;
+
+typedef struct AotProgram {
+    const AotNode *nodes;   // nodes[0] is the program
+    int node_count;
+    const char *const *names;
+    const AotChunk *chunks;
+    int chunk_count;
+} AotProgram;
+
+// Compiler side: 1 on success
+int aot_emit_c(ASTNode *root, const char *source_name, const char *out_path);
+
+// Runtime side
+int aot_main(const AotProgram *program, int argc, char **argv);
+void aot_attach(struct BytecodeChunk *chunk, ASTNode *node); // Sets chunk->compiled when node was compiled ahead of time
+uint32_t aot_chunk_signature(const struct BytecodeChunk *chunk);
+
+// Helpers for generated code, which keeps the operand stack top in a local `sp` and
+// syncs it around every call into the VM
+#define AOT_STEP(i) (state->sp = sp, aot_next = vm_execute_instruction(state, &code[i]), sp = state->sp)
+#define AOT_SET_INT(v, n) ((v).type = VAL_INT, (v).as.integer = (n))
+#define AOT_SET_DOUBLE(v, d) ((v).type = VAL_DOUBLE, (v).as.number = (d))
+#define AOT_SET_BOOL(v, b) ((v).type = VAL_BOOL, (v).as.integer = 0, (v).as.boolean = (b) ? 1 : 0)
+// Field by field, so a copy reads back what was just stored the way it was stored
+#define AOT_COPY(dest, src) ((dest).type = (src).type, (dest).as = (src).as)
+#define AOT_IS_NUMBER(v) ((v).type == VAL_INT || (v).type == VAL_DOUBLE)
+#define AOT_NUMBER(v) ((v).type == VAL_INT ? (double)(v).as.integer : (v).as.number)
+#define AOT_WRAP(l, op, r) ((int64_t)((uint64_t)(l) op (uint64_t)(r))) // Two's complement wrapping, as eval.c
+
+#endif // AOT_H
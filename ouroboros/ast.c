@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "ast_types.h"
+#include "intern.h"
 
 // Create a new AST node
 ASTNode* create_node(ASTNodeType type, const char* value, int line, int col) { // Added line, col
@@ -12,12 +13,7 @@ ASTNode* create_node(ASTNodeType type, const char* value, int line, int col) { /
     }
     
     node->type = type;
-    if (value) {
-        strncpy(node->value, value, sizeof(node->value) - 1);
-        node->value[sizeof(node->value) - 1] = '\0';
-    } else {
-        node->value[0] = '\0';
-    }
+    node->value = intern(value);
     
     node->left = NULL;
     node->right = NULL;
@@ -34,6 +30,19 @@ ASTNode* create_node(ASTNodeType type, const char* value, int line, int col) { /
     node->array_size = 0;
     node->access_modifier[0] = '\0';
     node->parent_class_name = NULL; // Changed from parent_class
+    node->has_literal_value = 0;
+    node->literal_value = value_undefined();
+    node->map_key = value_undefined();
+    node->op_code = -1;
+    node->op_is_assignment = 0;
+    node->fold_reported = 0;
+    node->bytecode = NULL;
+    node->inline_cache = NULL;
+    node->var_scope = VAR_UNRESOLVED;
+    node->var_slot = -1;
+    node->local_count = 0;
+    node->local_names = NULL;
+    node->static_type = STATIC_UNKNOWN;
     
     return node;
 }
@@ -157,11 +166,10 @@ void free_ast(ASTNode* node) {
     free_ast(node->right);
     free_ast(node->next);
     
-    // Free parent class name if allocated
-    if (node->parent_class_name) { // Changed from parent_class
-        free(node->parent_class_name);
-        node->parent_class_name = NULL;
-    }
+    if (node->has_literal_value) value_release(node->literal_value);
+    value_release(node->map_key);
+    free(node->local_names);
+    free(node->inline_cache);
     
     // Free this node
     free(node);
@@ -1,6 +1,10 @@
 #ifndef AST_TYPES_H
 #define AST_TYPES_H
 
+#include "value.h" // For cached literal values
+
+struct BytecodeChunk; // Compiled form of a function body (ir.h)
+
 // Node types for AST
 typedef enum {
     AST_PROGRAM,
@@ -44,10 +48,27 @@ typedef enum {
     AST_UNKNOWN           // Unknown node type
 } ASTNodeType;
 
+// Where a variable reference lives at runtime, resolved by semantic analysis
+typedef enum {
+    VAR_UNRESOLVED,       // Looked up by name (class members, caller locals, undeclared names)
+    VAR_LOCAL,            // slots[var_slot] of the current function's frame
+    VAR_GLOBAL            // slots[var_slot] of the global frame
+} VariableScope;
+
+// Type an expression's value always has, as proven by the optimizer (optimize.c); the
+// bytecode compiler picks operations that skip type checks from it
+typedef enum {
+    STATIC_UNKNOWN,       // Not proven
+    STATIC_INT,
+    STATIC_DOUBLE,
+    STATIC_NUMBER,        // An int or a double
+    STATIC_BOOL
+} StaticType;
+
 // AST node structure
 typedef struct ASTNode {
     ASTNodeType type;
-    char value[256];
+    const char *value;       // Interned (intern.h): names compare with ==
     struct ASTNode *left;
     struct ASTNode *right;
     struct ASTNode *next;
@@ -65,7 +86,28 @@ typedef struct ASTNode {
     
     // Access modifiers for object properties
     char access_modifier[16]; // "public", "private", "static"
-    char* parent_class_name; // Name of parent class for methods (strdup'd)
+    const char *parent_class_name; // Name of parent class for methods (interned)
+
+    // Runtime cache: literal text decoded once into a Value on first evaluation
+    int has_literal_value;
+    Value literal_value;
+    // Runtime cache for the key node of a map literal pair (identifier or literal): its
+    // text as a string, VAL_UNDEFINED until the map is first built
+    Value map_key;
+    // Runtime cache for AST_BINARY_OP: the operator decoded from value (BinaryOperator, eval.h;
+    // for compound assignments the arithmetic they apply), -1 until first evaluation
+    int op_code;
+    int op_is_assignment;
+    int fold_reported;       // AST_BINARY_OP: the optimizer already reported it divides by zero
+    struct BytecodeChunk *bytecode; // Compiled body for function nodes; owned by the VM
+    struct InlineCache *inline_cache; // AST_CALL and AST_MEMBER_ACCESS sites: resolutions per receiver (vm.c)
+
+    // Variable slots assigned by semantic analysis
+    VariableScope var_scope; // Identifiers, declarations and parameters
+    int var_slot;
+    int local_count;         // Function and program nodes: slots their frame needs
+    const char **local_names; // Function and program nodes: interned name of each slot (array owned)
+    StaticType static_type;  // Expressions: set by the optimizer, STATIC_UNKNOWN otherwise
 } ASTNode;
 
 // Function prototypes
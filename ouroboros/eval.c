@@ -5,19 +5,16 @@
 #include <ctype.h>
 #include "eval.h"
 #include "ast_types.h"
-#include "vm.h" // For Object, find_object_by_id, find_static_class_object, current_class, execute_function_call, etc.
+#include "vm.h" // For Object, find_object_by_ref, find_static_class_object, current_class, execute_function_call, etc.
 #include "semantic.h" // For Symbol, SymbolTable related types (if needed directly, though usually through vm)
 
-#define MAX_RESULT_LENGTH 1024
-
 extern ASTNode *program; 
-static char result_buffer[1024]; // Static buffer for string results of operations
 
 // Forward declarations for VM helpers when vm.h not available in include path
 #ifndef VM_HELPERS_DECL
 #define VM_HELPERS_DECL
 extern Object* create_object(const char *class_name);
-extern void set_object_property(Object *obj, const char *name, const char *value);
+extern void set_object_property(Object *obj, const char *name, Value value);
 extern void register_user_function(ASTNode *func_node);
 extern ASTNode* find_user_function(const char *name, const char *class_name);
 #endif
@@ -49,47 +46,110 @@ int is_numeric_string(const char* str) {
 }
 
 // Forward declarations for internal functions
-#define LOCAL_COPY_IF_ALIAS(ptr, bufname) \
-    const char *bufname = (ptr);          \
-    char bufname##_copy[512];             \
-    if ((ptr) == result_buffer) {         \
-        strncpy(bufname##_copy, (ptr), sizeof(bufname##_copy)-1); \
-        bufname##_copy[sizeof(bufname##_copy)-1] = '\0';          \
-        bufname = bufname##_copy;         \
+static BinaryOperator binary_node_operator(ASTNode *binary_node);
+static void assign_to_target(ASTNode *target_node, Value new_value, StackFrame *frame);
+
+// Decodes a literal node's text once and caches the resulting Value on the node.
+static Value literal_value(ASTNode *literal_node) {
+    if (!literal_node->has_literal_value) {
+        const char *text = literal_node->value;
+        const char *type = literal_node->data_type;
+        Value v;
+        if (strcmp(type, "string") == 0) {
+            v = value_string(text);
+        } else if (strcmp(type, "bool") == 0) {
+            v = value_bool(strcmp(text, "true") == 0);
+        } else if (strcmp(type, "null") == 0 || strcmp(text, "null") == 0) {
+            v = value_undefined();
+        } else if (strcmp(type, "int") == 0 || strcmp(type, "float") == 0) {
+            v = value_from_text(text);
+            if (v.type == VAL_STRING) { // e.g. "1e3" or out-of-range integers
+                char *end = NULL;
+                double d = strtod(text, &end);
+                if (end && *end == '\0') { value_release(v); v = value_double(d); }
+            }
+        } else {
+            v = value_from_text(text); // Literals synthesized without a data_type
+        }
+        literal_node->literal_value = v;
+        literal_node->has_literal_value = 1;
+    }
+    return value_copy(literal_node->literal_value);
+}
+
+// Calls func_node on receiver with args_list evaluated in frame
+static Value invoke_with_arguments(ASTNode *func_node, Value receiver, const char *class_context, ASTNode *args_list, StackFrame *frame) {
+    int arg_count = 0;
+    for (ASTNode *arg = args_list; arg; arg = arg->next) arg_count++;
+    Value args_stack[8];
+    Value *args = arg_count <= 8 ? args_stack : (Value*)malloc(sizeof(Value) * arg_count);
+    if (!args) return value_undefined();
+    vm_gc_push_root(receiver);
+    int i = 0;
+    for (ASTNode *arg = args_list; arg; arg = arg->next) {
+        args[i] = evaluate_expression(arg, frame);
+        vm_gc_push_root(args[i++]);
     }
+    Value result = vm_invoke_function(func_node, receiver, class_context, args, arg_count, frame);
+    vm_gc_pop_roots(arg_count + 1);
+    for (i = 0; i < arg_count; i++) value_release(args[i]);
+    if (args != args_stack) free(args);
+    return result;
+}
 
-static const char* evaluate_binary_op_internal(ASTNode* expr_node, const char *op_str, const char *left_val_str_final, const char *right_val_str_final);
-const char* evaluate_member_access(ASTNode *member_access_expr_node, StackFrame *frame); // Added forward declaration
+Value* lookup_variable(ASTNode *node, StackFrame *frame) {
+    switch (node->var_scope) {
+        case VAR_LOCAL:  return &frame->slots[node->var_slot];
+        case VAR_GLOBAL: return &frame->globals->slots[node->var_slot];
+        default:         return get_variable(frame, node->value);
+    }
+}
 
+void store_variable(ASTNode *node, StackFrame *frame, Value value) {
+    Value *slot;
+    switch (node->var_scope) {
+        case VAR_LOCAL:  slot = &frame->slots[node->var_slot]; break;
+        case VAR_GLOBAL: slot = &frame->globals->slots[node->var_slot]; break;
+        default:
+            set_variable(frame, node->value, value);
+            return;
+    }
+    if (!VALUE_IS_REFCOUNTED(*slot) && !VALUE_IS_REFCOUNTED(value)) {
+        *slot = value;
+        return;
+    }
+    Value old_value = *slot;
+    *slot = value_copy(value);
+    value_release(old_value);
+}
 
-const char* evaluate_expression(ASTNode *expr_node, StackFrame *frame) {
-    if (!expr_node) return "undefined";
+Value evaluate_expression(ASTNode *expr_node, StackFrame *frame) {
+    if (!expr_node) return value_undefined();
     
     switch (expr_node->type) {
         case AST_LITERAL:
-            return expr_node->value;
+            return literal_value(expr_node);
             
         case AST_IDENTIFIER: {
             const char *var_name = expr_node->value;
-            const char *value_str = get_variable(frame, var_name);
-            if (value_str) return value_str;
+            Value *var_value = lookup_variable(expr_node, frame);
+            if (var_value) return VALUE_IS_REFCOUNTED(*var_value) ? value_copy(*var_value) : *var_value;
 
             if (current_class[0] != '\0') {
-                const char *this_obj_ref_str = get_variable(frame, "this");
-                if (this_obj_ref_str && strncmp(this_obj_ref_str, "obj:", 4) == 0) {
-                    int this_obj_id = atoi(this_obj_ref_str + 4);
-                    Object *this_obj = find_object_by_id(this_obj_id);
+                Value *this_val = get_variable(frame, name_this);
+                if (this_val && this_val->type == VAL_OBJECT) {
+                    Object *this_obj = find_object_by_ref(*this_val);
                     if (this_obj) {
-                        const char *instance_member_val = get_object_property_with_access(this_obj, var_name, current_class);
-                        if (instance_member_val && strcmp(instance_member_val, "undefined") != 0) {
+                        Value instance_member_val = get_object_property_with_access(this_obj, var_name, current_class);
+                        if (instance_member_val.type != VAL_UNDEFINED) {
                             return instance_member_val;
                         }
                     }
                 }
                 Object *static_obj_for_current_class = find_static_class_object(current_class);
                 if (static_obj_for_current_class) {
-                     const char *static_member_val = get_object_property_with_access(static_obj_for_current_class, var_name, current_class);
-                     if (static_member_val && strcmp(static_member_val, "undefined") != 0) {
+                     Value static_member_val = get_object_property_with_access(static_obj_for_current_class, var_name, current_class);
+                     if (static_member_val.type != VAL_UNDEFINED) {
                         return static_member_val;
                      }
                 }
@@ -99,179 +159,134 @@ const char* evaluate_expression(ASTNode *expr_node, StackFrame *frame) {
                  // Check if it's a registered class to return its name for static member access
                  // This needs vm.c to expose a "is_class_registered" or similar.
                  // For now, relying on semantic analysis to have typed it or this heuristic.
-                 return var_name; 
+                 return value_string(var_name); 
             }
 
             // fprintf(stderr, "Error (L%d:%d): Undefined identifier '%s'.\n", expr_node->line, expr_node->col, var_name);
-            return "undefined";
+            return value_undefined();
         }
             
         case AST_BINARY_OP: {
-            if (strcmp(expr_node->value, "=") == 0 || strcmp(expr_node->value, "+=") == 0 || strcmp(expr_node->value, "-=") == 0 || strcmp(expr_node->value, "*=") == 0 || strcmp(expr_node->value, "/=") == 0 || strcmp(expr_node->value, "%=") == 0) { 
-                const char *rhs_val_str = evaluate_expression(expr_node->right, frame);
+            BinaryOperator op = binary_node_operator(expr_node);
+            if (expr_node->op_is_assignment) {
+                Value new_value = evaluate_expression(expr_node->right, frame);
 
                 /* For compound assignments, compute new RHS as lhs <op> rhs */
-                const char *effective_rhs = rhs_val_str;
-                char compound_result_buf[64];
-                if (strcmp(expr_node->value, "=") != 0) {
+                if (op != BINOP_UNKNOWN) {
                     /* Need current LHS value */
-                    const char *lhs_current_val = evaluate_expression(expr_node->left, frame);
-                    const char *op_for_compound = NULL;
-                    if (strcmp(expr_node->value, "+=") == 0) op_for_compound = "+";
-                    else if (strcmp(expr_node->value, "-=") == 0) op_for_compound = "-";
-                    else if (strcmp(expr_node->value, "*=") == 0) op_for_compound = "*";
-                    else if (strcmp(expr_node->value, "/=") == 0) op_for_compound = "/";
-                    else if (strcmp(expr_node->value, "%=") == 0) op_for_compound = "%"; /* modulus to implement later */
-
-                    if (op_for_compound) {
-                        const char *temp_res = evaluate_binary_op_internal(expr_node, op_for_compound, lhs_current_val, rhs_val_str);
-                        strncpy(compound_result_buf, temp_res, sizeof(compound_result_buf)-1);
-                        compound_result_buf[sizeof(compound_result_buf)-1] = '\0';
-                        effective_rhs = compound_result_buf;
-                    }
+                    vm_gc_push_root(new_value);
+                    Value lhs_current_val = evaluate_expression(expr_node->left, frame);
+                    vm_gc_pop_roots(1);
+                    Value combined = evaluate_binary_operator(op, lhs_current_val, new_value);
+                    value_release(lhs_current_val);
+                    value_release(new_value);
+                    new_value = combined;
                 }
 
-                if (expr_node->left->type == AST_IDENTIFIER) {
-                    set_variable(frame, expr_node->left->value, effective_rhs);
-                    return effective_rhs; 
-                } else if (expr_node->left->type == AST_MEMBER_ACCESS) {
-                    ASTNode *member_access = expr_node->left; 
-                    ASTNode *target_node = member_access->left;   
-                    const char *prop_name = member_access->value; 
-
-                    const char *target_ref_str;
-                    if (target_node->type == AST_THIS) target_ref_str = get_variable(frame, "this");
-                    else target_ref_str = evaluate_expression(target_node, frame);
-
-                    if (target_ref_str && strncmp(target_ref_str, "obj:", 4) == 0) { 
-                        int obj_id = atoi(target_ref_str + 4);
-                        Object *obj_instance = find_object_by_id(obj_id);
-                        if (obj_instance) {
-                            set_object_property_with_access(obj_instance, prop_name, effective_rhs, ACCESS_MODIFIER_PUBLIC, 0);
-                            return effective_rhs;
-                        } else { fprintf(stderr, "Error (L%d:%d): Object %s not found for assignment to '%s'.\n", member_access->line, member_access->col, target_ref_str, prop_name); }
-                    } else if (target_ref_str && isupper((unsigned char)target_ref_str[0])) { // Assume ClassName for static
-                        Object* static_obj = find_static_class_object(target_ref_str);
-                        if (static_obj) {
-                             set_object_property_with_access(static_obj, prop_name, effective_rhs, ACCESS_MODIFIER_PUBLIC, 1);
-                             return effective_rhs;
-                        } else { fprintf(stderr, "Error (L%d:%d): Class %s not found for static assignment to '%s'.\n", target_node->line, target_node->col, target_ref_str, prop_name); }
-                    } else { fprintf(stderr, "Error (L%d:%d): Invalid target for member assignment to '%s'. Target was '%s'\n", target_node->line, target_node->col, prop_name, target_ref_str ? target_ref_str : "null");}
-                    return "undefined"; 
-                } else {
-                    fprintf(stderr, "Error (L%d:%d): Invalid left-hand side in assignment.\n", expr_node->left->line, expr_node->left->col);
-                    return "undefined";
-                }
+                vm_gc_push_root(new_value); // The target expression may run user code
+                assign_to_target(expr_node->left, new_value, frame);
+                vm_gc_pop_roots(1);
+                return new_value;
             } else { 
-                const char *left_eval_result = evaluate_expression(expr_node->left, frame);
-                char left_stable_val[1024]; 
-                const char* left_final_val_ptr;
-
-                if (left_eval_result == result_buffer) { 
-                    strncpy(left_stable_val, result_buffer, sizeof(left_stable_val) - 1);
-                    left_stable_val[sizeof(left_stable_val) - 1] = '\0';
-                    left_final_val_ptr = left_stable_val;
-                } else {
-                    left_final_val_ptr = left_eval_result; 
-                }
+                Value left_val = evaluate_expression(expr_node->left, frame);
 
-                if (strcmp(expr_node->value, "&&") == 0) {
-                    int left_truthy = left_final_val_ptr && strcmp(left_final_val_ptr, "0") != 0 && strcmp(left_final_val_ptr, "false") != 0 && strcmp(left_final_val_ptr, "") != 0;
-                    if (!left_truthy) return "false"; 
-                    const char *right_eval_result = evaluate_expression(expr_node->right, frame);
-                    int right_truthy = right_eval_result && strcmp(right_eval_result, "0") != 0 && strcmp(right_eval_result, "false") != 0 && strcmp(right_eval_result, "") != 0;
-                    return right_truthy ? "true" : "false";
+                if (op == BINOP_AND || op == BINOP_OR) {
+                    int left_truthy = value_is_truthy(left_val);
+                    value_release(left_val);
+                    if (op == BINOP_AND && !left_truthy) return value_bool(0); 
+                    if (op == BINOP_OR && left_truthy) return value_bool(1); 
+                    Value right_val = evaluate_expression(expr_node->right, frame);
+                    int right_truthy = value_is_truthy(right_val);
+                    value_release(right_val);
+                    return value_bool(right_truthy);
                 }
-                if (strcmp(expr_node->value, "||") == 0) {
-                    int left_truthy = left_final_val_ptr && strcmp(left_final_val_ptr, "0") != 0 && strcmp(left_final_val_ptr, "false") != 0 && strcmp(left_final_val_ptr, "") != 0;
-                    if (left_truthy) return "true"; 
-                    const char *right_eval_result = evaluate_expression(expr_node->right, frame);
-                    int right_truthy = right_eval_result && strcmp(right_eval_result, "0") != 0 && strcmp(right_eval_result, "false") != 0 && strcmp(right_eval_result, "") != 0;
-                    return right_truthy ? "true" : "false";
+                vm_gc_push_root(left_val);
+                Value right_val = evaluate_expression(expr_node->right, frame);
+                vm_gc_pop_roots(1);
+                if (left_val.type == VAL_INT && right_val.type == VAL_INT) { // Unboxed: nothing to release
+                    return evaluate_int_binary_operator(op, left_val.as.integer, right_val.as.integer);
                 }
-                const char *right_eval_result = evaluate_expression(expr_node->right, frame);
-                return evaluate_binary_op_internal(expr_node, expr_node->value, left_final_val_ptr, right_eval_result);
+                Value result = evaluate_binary_operator(op, left_val, right_val);
+                value_release(left_val);
+                value_release(right_val);
+                return result;
             }
         } // End AST_BINARY_OP
         case AST_UNARY_OP: {
-            const char *operand_val_str = evaluate_expression(expr_node->left, frame);
+            Value operand_val = evaluate_expression(expr_node->left, frame);
             if (strcmp(expr_node->value, "-") == 0) {
-                if (!operand_val_str || !is_numeric_string(operand_val_str)) {
-                     fprintf(stderr, "Error (L%d:%d): Unary '-' requires numeric operand, got '%s'.\n", expr_node->line, expr_node->col, operand_val_str ? operand_val_str : "undefined"); return "undefined";
-                }
-                double val = atof(operand_val_str);
-                snprintf(result_buffer, sizeof(result_buffer), "%g", -val); return result_buffer;
+                Value result = evaluate_negate(expr_node, operand_val);
+                value_release(operand_val);
+                return result;
             } else if (strcmp(expr_node->value, "!") == 0) {
-                 int truthy = operand_val_str && strcmp(operand_val_str, "0") != 0 && strcmp(operand_val_str, "false") != 0 && strcmp(operand_val_str, "") != 0;
-                 return truthy ? "false" : "true";
+                 int truthy = value_is_truthy(operand_val);
+                 value_release(operand_val);
+                 return value_bool(!truthy);
             } else if (strcmp(expr_node->value, "++") == 0 || strcmp(expr_node->value, "--") == 0) {
                  int delta = (expr_node->value[0] == '+') ? 1 : -1;
-                 if (!operand_val_str || !is_numeric_string(operand_val_str)) {
-                     fprintf(stderr, "Error (L%d:%d): '%s' operator requires numeric operand, got '%s'.\n", expr_node->line, expr_node->col, expr_node->value, operand_val_str ? operand_val_str : "undefined");
-                     return "undefined";
-                 }
-                 int new_val = atoi(operand_val_str) + delta;
-                 char new_val_str[64]; snprintf(new_val_str, sizeof(new_val_str), "%d", new_val);
+                 Value new_val = evaluate_increment(expr_node, operand_val, delta);
+                 value_release(operand_val);
+                 if (new_val.type == VAL_UNDEFINED) return new_val;
 
                  /* Assign back to operand (identifier or member) */
-                 if (expr_node->left->type == AST_IDENTIFIER) {
-                     set_variable(frame, expr_node->left->value, new_val_str);
-                 } else if (expr_node->left->type == AST_MEMBER_ACCESS) {
-                     ASTNode *member_access = expr_node->left;
-                     const char *prop_name = member_access->value;
-                     const char *target_ref_str;
-                     if (member_access->left->type == AST_THIS) target_ref_str = get_variable(frame, "this");
-                     else target_ref_str = evaluate_expression(member_access->left, frame);
-
-                     if (target_ref_str && strncmp(target_ref_str, "obj:", 4) == 0) {
-                         int obj_id = atoi(target_ref_str + 4);
-                         Object *obj_instance = find_object_by_id(obj_id);
-                         if (obj_instance) {
-                             set_object_property_with_access(obj_instance, prop_name, new_val_str, ACCESS_MODIFIER_PUBLIC, 0);
-                         }
-                     }
+                 if (expr_node->left->type == AST_IDENTIFIER || expr_node->left->type == AST_MEMBER_ACCESS) {
+                     assign_to_target(expr_node->left, new_val, frame);
                  }
-                 strncpy(result_buffer, new_val_str, sizeof(result_buffer)-1);
-                 result_buffer[sizeof(result_buffer)-1] = '\0';
-                 return result_buffer;
+                 return new_val;
             }
+            value_release(operand_val);
             fprintf(stderr, "Error (L%d:%d): Unknown unary operator '%s'.\n", expr_node->line, expr_node->col, expr_node->value);
-            return "undefined";
+            return value_undefined();
         }
         case AST_CALL: {
             // Dispatch user-defined class methods on instances
             char qualified_name_buffer[512];
+            if (expr_node->right && expr_node->right->type == AST_SUPER) {
+                // super.method(...): resolve in the parent of the current class, keep 'this'
+                const char *parent = get_parent_class_name(current_class);
+                ASTNode *method = parent ? find_class_method(parent, expr_node->value) : NULL;
+                Value *this_val = get_variable(frame, name_this);
+                if (!method || !this_val) {
+                    fprintf(stderr, "Error (L%d:%d): No parent method '%s' for super call.\n", expr_node->line, expr_node->col, expr_node->value);
+                    return value_undefined();
+                }
+                Value receiver = value_copy(*this_val);
+                Value result = invoke_with_arguments(method, receiver, parent, expr_node->left, frame);
+                value_release(receiver);
+                return result;
+            }
             if (expr_node->right) {
-                const char *t = evaluate_expression(expr_node->right, frame);
-                if (t && strncmp(t, "obj:", 4) == 0) {
-                    int inst_id = atoi(t + 4);
-                    Object *inst = find_object_by_id(inst_id);
-                    if (inst) {
-                        // Extract class name before '#' in instance class_name
-                        char class_name_only[128];
-                        char *hash_pos = strchr(inst->class_name, '#');
-                        if (hash_pos) {
-                            size_t class_len = hash_pos - inst->class_name;
-                            if (class_len < sizeof(class_name_only)) {
-                                strncpy(class_name_only, inst->class_name, class_len);
-                                class_name_only[class_len] = '\0';
-                            } else {
-                                strncpy(class_name_only, inst->class_name, sizeof(class_name_only) - 1);
-                                class_name_only[sizeof(class_name_only) - 1] = '\0';
-                            }
-                        } else {
-                            strncpy(class_name_only, inst->class_name, sizeof(class_name_only) - 1);
-                            class_name_only[sizeof(class_name_only) - 1] = '\0';
-                        }
-                        snprintf(qualified_name_buffer, sizeof(qualified_name_buffer), "%s.%s", class_name_only, expr_node->value);
-                    } else {
-                        // Fallback if instance not found
-                        snprintf(qualified_name_buffer, sizeof(qualified_name_buffer), "%s.%s", t, expr_node->value);
+                Value target = evaluate_expression(expr_node->right, frame);
+                if (target.type == VAL_ARRAY || target.type == VAL_MAP) {
+                    int arg_count = 1;
+                    for (ASTNode *arg = expr_node->left; arg; arg = arg->next) arg_count++;
+                    Value args_stack[8];
+                    Value *args = arg_count <= 8 ? args_stack : (Value*)malloc(sizeof(Value) * arg_count);
+                    if (!args) { value_release(target); return value_undefined(); }
+                    args[0] = target;
+                    vm_gc_push_root(target);
+                    int i = 1;
+                    for (ASTNode *arg = expr_node->left; arg; arg = arg->next) {
+                        args[i] = evaluate_expression(arg, frame);
+                        vm_gc_push_root(args[i++]);
                     }
-                } else {
-                    // Plain method or function call on class/static
-                    snprintf(qualified_name_buffer, sizeof(qualified_name_buffer), "%s.%s", t ? t : "undefined_target", expr_node->value);
+                    Value result = vm_call_value_method(expr_node, args, arg_count, frame);
+                    vm_gc_pop_roots(arg_count);
+                    for (i = 0; i < arg_count; i++) value_release(args[i]);
+                    if (args != args_stack) free(args);
+                    return result;
                 }
+                Object *receiver = target.type == VAL_OBJECT ? find_object_by_ref(target) : NULL;
+                const char *class_context;
+                ASTNode *method = receiver ? vm_cached_method(expr_node, receiver, &class_context) : NULL;
+                if (method) return invoke_with_arguments(method, target, class_context, expr_node->left, frame);
+                char text_buf[VALUE_TEXT_BUFFER_SIZE];
+                // Instances dispatch as "obj:N.method" so the callee can bind 'this';
+                // class names dispatch as "ClassName.method" against the static companion.
+                snprintf(qualified_name_buffer, sizeof(qualified_name_buffer), "%s.%s",
+                         target.type == VAL_UNDEFINED ? "undefined_target" : value_to_text(target, text_buf, sizeof(text_buf)),
+                         expr_node->value);
+                value_release(target);
             } else {
                 // Simple function call
                 strncpy(qualified_name_buffer, expr_node->value, sizeof(qualified_name_buffer) - 1);
@@ -282,367 +297,409 @@ const char* evaluate_expression(ASTNode *expr_node, StackFrame *frame) {
         case AST_ARRAY: {
             // Simplified: if parser put elements in value, use that. Otherwise, placeholder.
             if (expr_node->value[0] != '\0' && strcmp(expr_node->value, "array_literal") != 0) {
-                return expr_node->value; 
+                return value_string(expr_node->value); 
             } else if (expr_node->left) { // Chain of expression nodes for elements
-                // This needs to build a string representation or an actual array object.
-                // For now, very basic string join into result_buffer for demo.
-                result_buffer[0] = '['; result_buffer[1] = '\0';
-                ASTNode* elem = expr_node->left;
-                int first = 1;
-                size_t current_len = 1;
-                while(elem) {
-                    if (!first) { strncat(result_buffer, ",", sizeof(result_buffer) - current_len -1); current_len++;}
-                    const char* elem_val = evaluate_expression(elem, frame);
-                    strncat(result_buffer, elem_val, sizeof(result_buffer) - current_len -1);
-                    current_len += strlen(elem_val);
-                    first = 0;
-                    elem = elem->next;
+                int count = 0;
+                for (ASTNode* elem = expr_node->left; elem; elem = elem->next) count++;
+                Value array_val = value_array(count);
+                vm_gc_push_root(array_val); // Element expressions may run user code
+                for (ASTNode* elem = expr_node->left; elem; elem = elem->next) {
+                    Value elem_val = evaluate_expression(elem, frame);
+                    array_push(array_val.as.array, elem_val);
+                    value_release(elem_val);
                 }
-                strncat(result_buffer, "]", sizeof(result_buffer) - current_len -1);
-                return result_buffer;
+                vm_gc_pop_roots(1);
+                return array_val;
             }
-            return "[array_obj_ref]"; 
+            return value_array(0); 
         }
         case AST_NEW: {
             if (!expr_node->value[0]) {
                 fprintf(stderr, "Error (L%d:%d): Class name missing in new expression\n", expr_node->line, expr_node->col);
-                return "undefined";
+                return value_undefined();
             }
             Object *obj = create_object(expr_node->value); 
             if (!obj) {
                 fprintf(stderr, "Error (L%d:%d): Failed to create object of class '%s'\n", expr_node->line, expr_node->col, expr_node->value);
-                return "undefined";
-            }
-            int obj_id_val = 0;
-            sscanf(obj->class_name, "%*[^#]#%d", &obj_id_val);
-            snprintf(result_buffer, sizeof(result_buffer), "obj:%d", obj_id_val); 
-
-            /* Only attempt to invoke constructor if user actually defined one */
-            if (find_user_function(expr_node->value, expr_node->value)) {
-                // Invoke constructor using qualified name and args list
-                execute_function_call(expr_node->value, expr_node->left, frame);
+                return value_undefined();
             }
-            return result_buffer; // Return the object reference string
+            Value obj_ref = object_ref_value(obj);
+
+            /* Only attempt to invoke constructor if user actually defined one:
+               either a method named "new" or one named after the class. */
+            ASTNode *ctor = find_class_method(expr_node->value, "new");
+            if (!ctor) ctor = find_class_method(expr_node->value, expr_node->value);
+            if (ctor) value_release(invoke_with_arguments(ctor, obj_ref, expr_node->value, expr_node->left, frame));
+            return obj_ref; // Return the object reference
         }
         case AST_MEMBER_ACCESS: {
             return evaluate_member_access(expr_node, frame);
         }
         case AST_THIS: {
-            const char *this_val = get_variable(frame, "this");
+            Value *this_val = get_variable(frame, name_this);
             if (!this_val) {
                 fprintf(stderr, "Error (L%d:%d): 'this' is undefined in current context.\n", expr_node->line, expr_node->col);
-                return "undefined";
+                return value_undefined();
             }
-            return this_val;
+            return value_copy(*this_val);
         }
         case AST_SUPER: {
-            /* For now, treat 'super' the same as 'this' (no real inheritance yet) */
-            const char *this_val = get_variable(frame, "this");
+            /* Outside of super.method() calls, 'super' evaluates to 'this' */
+            Value *this_val = get_variable(frame, name_this);
             if (!this_val) {
                 fprintf(stderr, "Error (L%d:%d): 'super' is undefined in current context.\n", expr_node->line, expr_node->col);
-                return "undefined";
+                return value_undefined();
             }
             extern char g_super_target_class[128];
-            const char *parent = NULL;
-            extern const char* get_parent_class_name(const char* class_name);
-            parent = get_parent_class_name(current_class);
+            const char *parent = get_parent_class_name(current_class);
             if (parent) { strncpy(g_super_target_class, parent, sizeof(g_super_target_class)-1); g_super_target_class[sizeof(g_super_target_class)-1] = '\0'; }
             else g_super_target_class[0] = '\0';
-            return this_val;
+            return value_copy(*this_val);
         }
         case AST_INDEX_ACCESS: {
-            const char* target_val_str = evaluate_expression(expr_node->left, frame);
-            const char* index_val_str = evaluate_expression(expr_node->right, frame);
-            
-            // Rudimentary string/array indexing for demo, add guard to suppress spam
-            if (!target_val_str || strcmp(target_val_str, "undefined") == 0) {
-                return "undefined"; // nothing to index
-            }
-
-            // Handle pseudo array literal represented as "[a,b,c]"
-            if (target_val_str[0] == '[' && target_val_str[strlen(target_val_str)-1] == ']') {
-                // This is a placeholder for actual array object indexing
-                // It assumes target_val_str is like "[elem1,elem2,elem3]"
-                int index_num = atoi(index_val_str);
-                /* Depth-aware tokenisation so commas inside nested sub-arrays are ignored. */
-                char token_buf[512]; int token_len = 0; int depth = 0; int curr_idx = 0; int found = 0;
-                const char *p = target_val_str + 1; /* skip opening '[' */
-                for (; *p && !(depth == 0 && *p == ']'); ++p) {
-                    char ch = *p;
-                    if (ch == '[') { depth++; token_buf[token_len++] = ch; }
-                    else if (ch == ']') { depth--; token_buf[token_len++] = ch; }
-                    else if (ch == ',' && depth == 0) {
-                        token_buf[token_len] = '\0';
-                        if (curr_idx == index_num) { found = 1; break; }
-                        curr_idx++; token_len = 0; /* reset for next token */
-                    } else {
-                        token_buf[token_len++] = ch;
-                    }
-                    if (token_len >= (int)sizeof(token_buf)-1) token_len = sizeof(token_buf)-2; /* prevent overflow */
-                }
-                if (!found) {
-                    token_buf[token_len] = '\0'; /* null terminate last element */
-                    if (curr_idx == index_num) found = 1; /* last element matches */
-                }
-                if (found) {
-                    /* Trim leading/trailing whitespace */
-                    char *start = token_buf; while(isspace((unsigned char)*start)) start++;
-                    char *end = start + strlen(start) - 1; while(end >= start && isspace((unsigned char)*end)) { *end = '\0'; end--; }
-                    strncpy(result_buffer, start, sizeof(result_buffer)-1);
-                    result_buffer[sizeof(result_buffer)-1] = '\0';
-                    return result_buffer;
-                }
-                if (index_num < 50) {
-                    fprintf(stderr, "Warning (L%d:%d): Index %d out of bounds for pseudo-array.\n", expr_node->line, expr_node->col, index_num);
-                }
-                return "undefined";
-            } else if (is_numeric_string(index_val_str)) { // Basic string indexing on plain string
-                int index = atoi(index_val_str);
-                if (index >= 0 && index < (int)strlen(target_val_str)) {
-                    snprintf(result_buffer, 2, "%c", target_val_str[index]);
-                    return result_buffer;
-                } else {
-                    // warn once, but avoid spamming by length threshold
-                    if (index < 50) {
-                        fprintf(stderr, "Warning (L%d:%d): Index %d out of bounds for string '%s'.\n", expr_node->line, expr_node->col, index, target_val_str);
-                    }
-                    return "undefined";
-                }
-            }
-            // Fallback for unhandled index access
-            snprintf(result_buffer, sizeof(result_buffer), "indexed_value_of_%s_at_%s", target_val_str ? target_val_str : "null", index_val_str ? index_val_str : "null");
-            return result_buffer;
+            Value target_val = evaluate_expression(expr_node->left, frame);
+            vm_gc_push_root(target_val);
+            Value index_val = evaluate_expression(expr_node->right, frame);
+            vm_gc_pop_roots(1);
+            Value result = evaluate_index(expr_node, target_val, index_val);
+            value_release(target_val);
+            value_release(index_val);
+            return result;
         }
         case AST_TERNARY: {
-            const char *cond_val = evaluate_expression(expr_node->left, frame);
-            int truthy = cond_val && strcmp(cond_val, "0") != 0 && strcmp(cond_val, "false") != 0 && strcmp(cond_val, "") != 0;
+            Value cond_val = evaluate_expression(expr_node->left, frame);
+            int truthy = value_is_truthy(cond_val);
+            value_release(cond_val);
             if (truthy) return evaluate_expression(expr_node->right, frame);
             else if (expr_node->next) return evaluate_expression(expr_node->next, frame);
-            return "undefined";
+            return value_undefined();
         }
         case AST_FUNCTION: {
-            /* Anonymous function expression – register on first evaluation and return its name */
+            /* Anonymous function expression – register on first evaluation and return a reference to it */
             if (!find_user_function(expr_node->value, NULL)) {
                 register_user_function(expr_node);
             }
-            return expr_node->value; // function name string acts as reference
+            return value_function(expr_node);
         }
         case AST_MAP: {
-            /* Create a real runtime object instead of serialising to a string */
-            Object *map_obj = create_object("Object");
-            if (!map_obj) return "undefined";
+            Value map_val = value_map();
+            vm_gc_push_root(map_val); // Member expressions may run user code
 
-            ASTNode *pair = expr_node->left;
-            while (pair) {
-                const char *key_str;
+            for (ASTNode *pair = expr_node->left; pair; pair = pair->next) {
+                Value val_result = evaluate_expression(pair->right, frame);
+                Value key_val;
                 if (pair->left->type == AST_IDENTIFIER || pair->left->type == AST_LITERAL) {
-                    key_str = pair->left->value; // use raw token text
-                } else {
-                    key_str = evaluate_expression(pair->left, frame);
-                }
-
-                const char *val_result;
-                if (pair->right->type == AST_FUNCTION) {
-                    /* Evaluate will register and return the synthetic name */
-                    val_result = evaluate_expression(pair->right, frame);
+                    // Raw token text, cached on the key node so its hash is computed once
+                    if (pair->left->map_key.type != VAL_STRING) pair->left->map_key = value_string(pair->left->value);
+                    key_val = value_copy(pair->left->map_key);
                 } else {
-                    val_result = evaluate_expression(pair->right, frame);
+                    vm_gc_push_root(val_result);
+                    Value key_expr_val = evaluate_expression(pair->left, frame);
+                    vm_gc_pop_roots(1);
+                    key_val = value_to_string(key_expr_val);
+                    value_release(key_expr_val);
                 }
-                set_object_property_with_access(map_obj, key_str, val_result, ACCESS_MODIFIER_PUBLIC, 1);
-                pair = pair->next;
+                map_set(map_val.as.map, key_val.as.string, val_result);
+                value_release(key_val);
+                value_release(val_result);
             }
-
-            /* Build and return the obj reference string */
-            static char obj_ref_buf[32];
-            int obj_id_val = 0;
-            sscanf(map_obj->class_name, "%*[^#]#%d", &obj_id_val);
-            snprintf(obj_ref_buf, sizeof(obj_ref_buf), "obj:%d", obj_id_val);
-            return obj_ref_buf;
+            vm_gc_pop_roots(1);
+            return map_val;
         }
         default:
             fprintf(stderr, "Error (L%d:%d): Cannot evaluate unknown AST node type %s (%d).\n", expr_node->line, expr_node->col, node_type_to_string(expr_node->type), expr_node->type);
-            return "undefined";
+            return value_undefined();
     }
 }
 
-// Forward declaration for binary op evaluation
-static const char* evaluate_binary_op_internal(ASTNode* expr_node, const char *op_str, const char *left_val_str_final, const char *right_val_str_final) {
-    (void)expr_node;
-    /* Single shared buffer for return value */
-    static char result_buffer[MAX_RESULT_LENGTH];
-    result_buffer[0] = '\0';
-
-    /* Ensure we never read from the same buffer we are about to overwrite */
-    LOCAL_COPY_IF_ALIAS(left_val_str_final, safe_left);
-    LOCAL_COPY_IF_ALIAS(right_val_str_final, safe_right);
+// Reads target[index]: array items, map entries, object properties by key and characters
+// of strings
+Value evaluate_index(ASTNode *expr_node, Value target_val, Value index_val) {
+    Value result = value_undefined();
+    char index_buf[VALUE_TEXT_BUFFER_SIZE];
+    const char *index_text = value_to_text(index_val, index_buf, sizeof(index_buf));
     
-    // Arithmetic operations
-    if (strcmp(op_str, "+") == 0) {
-        // Numeric addition when BOTH operands are numeric
-        if (is_numeric_string(safe_left) && is_numeric_string(safe_right)) {
-            double left_num = atof(safe_left);
-            double right_num = atof(safe_right);
-            double result = left_num + right_num;
-
-            // Emit integer without decimal part when possible
-            if (result == (int)result) {
-                snprintf(result_buffer, sizeof(result_buffer), "%d", (int)result);
-            } else {
-                snprintf(result_buffer, sizeof(result_buffer), "%g", result);
+    if (target_val.type == VAL_ARRAY) {
+        int64_t index_num = index_val.type == VAL_INT ? index_val.as.integer : (int64_t)value_as_double(index_val);
+        const Value *item = value_is_number(index_val) ? array_get(target_val.as.array, index_num) : NULL;
+        if (item) return value_copy(*item);
+        fprintf(stderr, "Warning (L%d:%d): Index %s out of bounds for array of length %d.\n", expr_node->line, expr_node->col, index_text, target_val.as.array->count);
+        return result;
+    }
+    if (target_val.type == VAL_MAP) {
+        Value key = value_to_string(index_val);
+        const Value *entry_value = map_get(target_val.as.map, key.as.string);
+        value_release(key);
+        return entry_value ? value_copy(*entry_value) : result;
+    }
+    if (target_val.type == VAL_STRING) {
+        const char *target_text = ouro_string_chars(target_val.as.string);
+        size_t target_len = target_val.as.string->length;
+        int index_num = index_val.type == VAL_INT ? (int)index_val.as.integer : atoi(index_text);
+        if (value_is_number(index_val) || is_numeric_string(index_text)) { // Characters by position
+            if (index_num >= 0 && (size_t)index_num < target_len) {
+                result = value_string_with_length(target_text + index_num, 1);
+            } else if (index_num < 50) {
+                // warn once, but avoid spamming by length threshold
+                fprintf(stderr, "Warning (L%d:%d): Index %d out of bounds for string '%s'.\n", expr_node->line, expr_node->col, index_num, target_text);
             }
-        } else {
-            // Treat as string concatenation otherwise (default behaviour in many scripting languages)
-            snprintf(result_buffer, sizeof(result_buffer), "%s%s", safe_left ? safe_left : "", safe_right ? safe_right : "");
         }
+    } else if (target_val.type == VAL_OBJECT) { // obj["key"] reads a property
+        Object *obj = find_object_by_ref(target_val);
+        if (obj) result = get_object_property_with_access(obj, index_text, current_class);
     }
-    else if (strcmp(op_str, "-") == 0) {
-        if (is_numeric_string(safe_left) && is_numeric_string(safe_right)) {
-            double left_num = atof(safe_left);
-            double right_num = atof(safe_right);
-            double result = left_num - right_num;
-            
-            if (result == (int)result) {
-                snprintf(result_buffer, sizeof(result_buffer), "%d", (int)result);
-            } else {
-                snprintf(result_buffer, sizeof(result_buffer), "%g", result);
-            }
+    return result;
+}
+
+// Stores target[index] = new_value for arrays, maps and objects (new_value is borrowed)
+void assign_index(ASTNode *expr_node, Value target_val, Value index_val, Value new_value) {
+    if (target_val.type == VAL_ARRAY) {
+        int64_t index_num = index_val.type == VAL_INT ? index_val.as.integer : (int64_t)value_as_double(index_val);
+        if (!value_is_number(index_val) || !array_set(target_val.as.array, index_num, new_value)) {
+            char index_buf[VALUE_TEXT_BUFFER_SIZE];
+            fprintf(stderr, "Error (L%d:%d): Index %s out of bounds for assignment to array of length %d.\n", expr_node->line, expr_node->col, value_to_text(index_val, index_buf, sizeof(index_buf)), target_val.as.array->count);
         }
+    } else if (target_val.type == VAL_MAP) {
+        Value key = value_to_string(index_val);
+        map_set(target_val.as.map, key.as.string, new_value);
+        value_release(key);
+    } else if (target_val.type == VAL_OBJECT) { // obj["key"] = v sets a property
+        Object *obj = find_object_by_ref(target_val);
+        char index_buf[VALUE_TEXT_BUFFER_SIZE];
+        if (obj) set_object_property_with_access(obj, value_to_text(index_val, index_buf, sizeof(index_buf)), new_value, ACCESS_MODIFIER_PUBLIC, 0);
+        else fprintf(stderr, "Error (L%d:%d): Object obj:%d not found for index assignment.\n", expr_node->line, expr_node->col, target_val.as.object.id);
+    } else {
+        char text_buf[VALUE_TEXT_BUFFER_SIZE];
+        fprintf(stderr, "Error (L%d:%d): Cannot assign by index into '%s'.\n", expr_node->line, expr_node->col, value_to_text(target_val, text_buf, sizeof(text_buf)));
     }
-    else if (strcmp(op_str, "*") == 0) {
-        if (is_numeric_string(safe_left) && is_numeric_string(safe_right)) {
-            double left_num = atof(safe_left);
-            double right_num = atof(safe_right);
-            double result = left_num * right_num;
-            
-            if (result == (int)result) {
-                snprintf(result_buffer, sizeof(result_buffer), "%d", (int)result);
-            } else {
-                snprintf(result_buffer, sizeof(result_buffer), "%g", result);
-            }
+}
+
+Value evaluate_negate(ASTNode *expr_node, Value operand_val) {
+    if (operand_val.type == VAL_INT) return value_int((int64_t)(0 - (uint64_t)operand_val.as.integer));
+    if (operand_val.type == VAL_DOUBLE) return value_double(-operand_val.as.number);
+    char text_buf[VALUE_TEXT_BUFFER_SIZE];
+    fprintf(stderr, "Error (L%d:%d): Unary '-' requires numeric operand, got '%s'.\n", expr_node->line, expr_node->col, value_to_text(operand_val, text_buf, sizeof(text_buf)));
+    return value_undefined();
+}
+
+Value evaluate_increment(ASTNode *expr_node, Value operand_val, int delta) {
+    if (operand_val.type == VAL_INT) return value_int((int64_t)((uint64_t)operand_val.as.integer + (uint64_t)(int64_t)delta));
+    if (operand_val.type == VAL_DOUBLE) return value_double(operand_val.as.number + delta);
+    char text_buf[VALUE_TEXT_BUFFER_SIZE];
+    fprintf(stderr, "Error (L%d:%d): '%s' operator requires numeric operand, got '%s'.\n", expr_node->line, expr_node->col, expr_node->value, value_to_text(operand_val, text_buf, sizeof(text_buf)));
+    return value_undefined();
+}
+
+// Stores new_value into an identifier or member-access target (value is borrowed)
+static void assign_to_target(ASTNode *target_node, Value new_value, StackFrame *frame) {
+    if (target_node->type == AST_IDENTIFIER) {
+        store_variable(target_node, frame, new_value);
+    } else if (target_node->type == AST_MEMBER_ACCESS) {
+        ASTNode *member_access = target_node; 
+        ASTNode *object_node = member_access->left;   
+        const char *prop_name = member_access->value; 
+
+        Value target_ref;
+        if (object_node->type == AST_THIS) {
+            Value *this_val = get_variable(frame, name_this);
+            target_ref = this_val ? value_copy(*this_val) : value_undefined();
+        } else {
+            target_ref = evaluate_expression(object_node, frame);
         }
+
+        if (target_ref.type == VAL_MAP) {
+            Value key = value_string(prop_name);
+            map_set(target_ref.as.map, key.as.string, new_value);
+            value_release(key);
+        } else if (target_ref.type == VAL_OBJECT) { 
+            Object *obj_instance = find_object_by_ref(target_ref);
+            if (obj_instance) {
+                vm_set_member_property(member_access, obj_instance, new_value);
+            } else { fprintf(stderr, "Error (L%d:%d): Object obj:%d not found for assignment to '%s'.\n", member_access->line, member_access->col, target_ref.as.object.id, prop_name); }
+        } else if (target_ref.type == VAL_STRING && isupper((unsigned char)ouro_string_chars(target_ref.as.string)[0])) { // Assume ClassName for static
+            Object* static_obj = find_static_class_object(ouro_string_chars(target_ref.as.string));
+            if (static_obj) {
+                 set_object_property_with_access(static_obj, prop_name, new_value, ACCESS_MODIFIER_PUBLIC, 1);
+            } else { fprintf(stderr, "Error (L%d:%d): Class %s not found for static assignment to '%s'.\n", object_node->line, object_node->col, ouro_string_chars(target_ref.as.string), prop_name); }
+        } else {
+            char text_buf[VALUE_TEXT_BUFFER_SIZE];
+            fprintf(stderr, "Error (L%d:%d): Invalid target for member assignment to '%s'. Target was '%s'\n", object_node->line, object_node->col, prop_name, target_ref.type == VAL_UNDEFINED ? "null" : value_to_text(target_ref, text_buf, sizeof(text_buf)));
+        }
+        value_release(target_ref);
+    } else if (target_node->type == AST_INDEX_ACCESS) {
+        Value target_val = evaluate_expression(target_node->left, frame);
+        vm_gc_push_root(target_val);
+        Value index_val = evaluate_expression(target_node->right, frame);
+        vm_gc_pop_roots(1);
+        assign_index(target_node, target_val, index_val, new_value);
+        value_release(target_val);
+        value_release(index_val);
+    } else {
+        fprintf(stderr, "Error (L%d:%d): Invalid left-hand side in assignment.\n", target_node->line, target_node->col);
     }
-    else if (strcmp(op_str, "/") == 0) {
-        if (is_numeric_string(safe_left) && is_numeric_string(safe_right)) {
-            double left_num = atof(safe_left);
-            double right_num = atof(safe_right);
-            
-            if (right_num == 0) {
+}
+
+// Two ints: exact 64-bit arithmetic, wrapping on overflow. Division stays an int
+// when it is exact and otherwise gives a double.
+Value evaluate_int_binary_operator(BinaryOperator op, int64_t l, int64_t r) {
+    switch (op) {
+        case BINOP_ADD: return value_int((int64_t)((uint64_t)l + (uint64_t)r));
+        case BINOP_SUB: return value_int((int64_t)((uint64_t)l - (uint64_t)r));
+        case BINOP_MUL: return value_int((int64_t)((uint64_t)l * (uint64_t)r));
+        case BINOP_DIV:
+            if (r == 0) {
                 fprintf(stderr, "[RUNTIME] Error: Division by zero\n");
-                strcpy(result_buffer, "NaN");
-            } else {
-                double result = left_num / right_num;
-                
-                if (result == (int)result) {
-                    snprintf(result_buffer, sizeof(result_buffer), "%d", (int)result);
-                } else {
-                    snprintf(result_buffer, sizeof(result_buffer), "%g", result);
-                }
+                return value_double(NAN);
             }
-        }
-    }
-    else if (strcmp(op_str, "%") == 0) {
-        if (is_numeric_string(safe_left) && is_numeric_string(safe_right)) {
-            long left_num = atol(safe_left);
-            long right_num = atol(safe_right);
-            if (right_num == 0) {
+            if (!(l == INT64_MIN && r == -1) && l % r == 0) return value_int(l / r);
+            return value_double((double)l / (double)r);
+        case BINOP_MOD:
+            if (r == 0) {
                 fprintf(stderr, "[RUNTIME] Error: Modulus by zero\n");
-                strcpy(result_buffer, "NaN");
-            } else {
-                long result = left_num % right_num;
-                snprintf(result_buffer, sizeof(result_buffer), "%ld", result);
+                return value_double(NAN);
             }
-        }
+            return value_int(r == -1 ? 0 : l % r);
+        case BINOP_SHL: return value_int((int64_t)((uint64_t)l << (r & 63)));
+        case BINOP_SHR: return value_int(l >> (r & 63)); // '>>>' treated same as '>>' in this simple impl
+        case BINOP_EQ:  return value_bool(l == r);
+        case BINOP_NE:  return value_bool(l != r);
+        case BINOP_LT:  return value_bool(l < r);
+        case BINOP_GT:  return value_bool(l > r);
+        case BINOP_LE:  return value_bool(l <= r);
+        case BINOP_GE:  return value_bool(l >= r);
+        case BINOP_AND: return value_bool(l != 0 && r != 0);
+        case BINOP_OR:  return value_bool(l != 0 || r != 0);
+        case BINOP_UNKNOWN: break;
     }
-    else if (strcmp(op_str, "<<") == 0 || strcmp(op_str, ">>") == 0 || strcmp(op_str, ">>>") == 0) {
-        if (is_numeric_string(safe_left) && is_numeric_string(safe_right)) {
-            long left_num = atol(safe_left);
-            int shift = atoi(safe_right);
-            long result;
-            if (strcmp(op_str, "<<") == 0) result = left_num << shift;
-            else result = left_num >> shift; // '>>>' treated same as '>>' in this simple impl
-            snprintf(result_buffer, sizeof(result_buffer), "%ld", result);
-        }
+    return value_undefined();
+}
+
+// Numbers where at least one is a double: the int is promoted. Comparisons follow
+// IEEE 754, so NaN is unordered: only != holds against it.
+Value evaluate_double_binary_operator(BinaryOperator op, double l, double r) {
+    switch (op) {
+        case BINOP_ADD: return value_double(l + r);
+        case BINOP_SUB: return value_double(l - r);
+        case BINOP_MUL: return value_double(l * r);
+        case BINOP_DIV:
+            if (r == 0) {
+                fprintf(stderr, "[RUNTIME] Error: Division by zero\n");
+                return value_double(NAN);
+            }
+            return value_double(l / r);
+        case BINOP_MOD:
+            if (r == 0) {
+                fprintf(stderr, "[RUNTIME] Error: Modulus by zero\n");
+                return value_double(NAN);
+            }
+            return value_double(fmod(l, r));
+        case BINOP_SHL: return value_int((int64_t)((uint64_t)(int64_t)l << ((int64_t)r & 63)));
+        case BINOP_SHR: return value_int((int64_t)l >> ((int64_t)r & 63));
+        case BINOP_EQ:  return value_bool(l == r);
+        case BINOP_NE:  return value_bool(l != r);
+        case BINOP_LT:  return value_bool(l < r);
+        case BINOP_GT:  return value_bool(l > r);
+        case BINOP_LE:  return value_bool(l <= r);
+        case BINOP_GE:  return value_bool(l >= r);
+        case BINOP_AND: return value_bool(l != 0.0 && r != 0.0);
+        case BINOP_OR:  return value_bool(l != 0.0 || r != 0.0);
+        case BINOP_UNKNOWN: break;
     }
-    
-    // Comparison operations
-    else if (strcmp(op_str, "==") == 0) {
-        int result;
-        if (is_numeric_string(safe_left) && is_numeric_string(safe_right)) {
-            double left_num = atof(safe_left);
-            double right_num = atof(safe_right);
-            result = (left_num == right_num);
-        } else {
-            result = (strcmp(safe_left, safe_right) == 0);
-        }
-        strcpy(result_buffer, result ? "true" : "false");
+    return value_undefined();
+}
+
+// Three-way comparison of operands that are not both numbers: by text. Two numbers
+// never get here, as NaN has no order; evaluate_double_binary_operator compares them
+static int compare_values(Value left_val, Value right_val) {
+    char left_buf[VALUE_TEXT_BUFFER_SIZE], right_buf[VALUE_TEXT_BUFFER_SIZE];
+    return strcmp(value_to_text(left_val, left_buf, sizeof(left_buf)), value_to_text(right_val, right_buf, sizeof(right_buf)));
+}
+
+BinaryOperator binary_operator_from_string(const char *op_str) {
+    switch (op_str[0]) {
+        case '+': return op_str[1] == '\0' ? BINOP_ADD : BINOP_UNKNOWN;
+        case '-': return op_str[1] == '\0' ? BINOP_SUB : BINOP_UNKNOWN;
+        case '*': return op_str[1] == '\0' ? BINOP_MUL : BINOP_UNKNOWN;
+        case '/': return op_str[1] == '\0' ? BINOP_DIV : BINOP_UNKNOWN;
+        case '%': return op_str[1] == '\0' ? BINOP_MOD : BINOP_UNKNOWN;
+        case '=': return strcmp(op_str, "==") == 0 ? BINOP_EQ : BINOP_UNKNOWN;
+        case '!': return strcmp(op_str, "!=") == 0 ? BINOP_NE : BINOP_UNKNOWN;
+        case '<':
+            if (op_str[1] == '\0') return BINOP_LT;
+            if (strcmp(op_str, "<=") == 0) return BINOP_LE;
+            if (strcmp(op_str, "<<") == 0) return BINOP_SHL;
+            return BINOP_UNKNOWN;
+        case '>':
+            if (op_str[1] == '\0') return BINOP_GT;
+            if (strcmp(op_str, ">=") == 0) return BINOP_GE;
+            if (strcmp(op_str, ">>") == 0 || strcmp(op_str, ">>>") == 0) return BINOP_SHR; // '>>>' treated same as '>>'
+            return BINOP_UNKNOWN;
+        case '&': return strcmp(op_str, "&&") == 0 ? BINOP_AND : BINOP_UNKNOWN;
+        case '|': return strcmp(op_str, "||") == 0 ? BINOP_OR : BINOP_UNKNOWN;
     }
-    else if (strcmp(op_str, "!=") == 0) {
-        int result;
-        if (is_numeric_string(safe_left) && is_numeric_string(safe_right)) {
-            double left_num = atof(safe_left);
-            double right_num = atof(safe_right);
-            result = (left_num != right_num);
-        } else {
-            result = (strcmp(safe_left, safe_right) != 0);
-        }
-        strcpy(result_buffer, result ? "true" : "false");
+    return BINOP_UNKNOWN;
+}
+
+Value evaluate_binary_operator(BinaryOperator op, Value left_val, Value right_val) {
+    // Numbers are computed unboxed; only the remaining cases look at text
+    if (left_val.type == VAL_INT && right_val.type == VAL_INT) {
+        return evaluate_int_binary_operator(op, left_val.as.integer, right_val.as.integer);
     }
-    else if (strcmp(op_str, "<") == 0) {
-        int result;
-        if (is_numeric_string(safe_left) && is_numeric_string(safe_right)) {
-            double left_num = atof(safe_left);
-            double right_num = atof(safe_right);
-            result = (left_num < right_num);
-        } else {
-            result = (strcmp(safe_left, safe_right) < 0);
-        }
-        strcpy(result_buffer, result ? "true" : "false");
+    if (value_is_number(left_val) && value_is_number(right_val)) {
+        return evaluate_double_binary_operator(op, value_as_double(left_val), value_as_double(right_val));
     }
-    else if (strcmp(op_str, ">") == 0) {
-        int result;
-        if (is_numeric_string(safe_left) && is_numeric_string(safe_right)) {
-            double left_num = atof(safe_left);
-            double right_num = atof(safe_right);
-            result = (left_num > right_num);
-        } else {
-            result = (strcmp(safe_left, safe_right) > 0);
+
+    switch (op) {
+        case BINOP_ADD: {
+            // String concatenation when either operand is not a number (default behaviour in many scripting languages).
+            // Long results are ropes, so building a string by repeated `+` stays linear.
+            Value left_text = value_to_string(left_val), right_text = value_to_string(right_val);
+            Value result = value_string_join(left_text.as.string, right_text.as.string);
+            value_release(left_text);
+            value_release(right_text);
+            return result;
         }
-        strcpy(result_buffer, result ? "true" : "false");
-    }
-    else if (strcmp(op_str, "<=") == 0) {
-        int result;
-        if (is_numeric_string(safe_left) && is_numeric_string(safe_right)) {
-            double left_num = atof(safe_left);
-            double right_num = atof(safe_right);
-            result = (left_num <= right_num);
-        } else {
-            result = (strcmp(safe_left, safe_right) <= 0);
+        case BINOP_SUB: case BINOP_MUL: case BINOP_DIV: case BINOP_MOD:
+        case BINOP_SHL: case BINOP_SHR:
+            return value_undefined(); // Arithmetic needs two numbers
+
+        // Comparison operations
+        case BINOP_EQ:
+        case BINOP_NE: {
+            int equal;
+            if (left_val.type == VAL_OBJECT && right_val.type == VAL_OBJECT) equal = left_val.as.object.id == right_val.as.object.id;
+            else if (left_val.type == VAL_ARRAY || right_val.type == VAL_ARRAY) equal = left_val.type == right_val.type && left_val.as.array == right_val.as.array;
+            else if (left_val.type == VAL_MAP || right_val.type == VAL_MAP) equal = left_val.type == right_val.type && left_val.as.map == right_val.as.map;
+            else if (left_val.type == VAL_STRING_BUILDER || right_val.type == VAL_STRING_BUILDER) equal = left_val.type == right_val.type && left_val.as.builder == right_val.as.builder;
+            else equal = compare_values(left_val, right_val) == 0;
+            return value_bool(op == BINOP_EQ ? equal : !equal);
         }
-        strcpy(result_buffer, result ? "true" : "false");
+        case BINOP_LT: return value_bool(compare_values(left_val, right_val) < 0);
+        case BINOP_GT: return value_bool(compare_values(left_val, right_val) > 0);
+        case BINOP_LE: return value_bool(compare_values(left_val, right_val) <= 0);
+        case BINOP_GE: return value_bool(compare_values(left_val, right_val) >= 0);
+
+        // Logical operations
+        case BINOP_AND: return value_bool(value_is_truthy(left_val) && value_is_truthy(right_val));
+        case BINOP_OR:  return value_bool(value_is_truthy(left_val) || value_is_truthy(right_val));
+
+        case BINOP_UNKNOWN: break;
     }
-    else if (strcmp(op_str, ">=") == 0) {
-        int result;
-        if (is_numeric_string(safe_left) && is_numeric_string(safe_right)) {
-            double left_num = atof(safe_left);
-            double right_num = atof(safe_right);
-            result = (left_num >= right_num);
+    return value_undefined();
+}
+
+// Decodes an AST_BINARY_OP node's operator text once and caches it on the node
+static BinaryOperator binary_node_operator(ASTNode *binary_node) {
+    if (binary_node->op_code < 0) {
+        const char *op = binary_node->value;
+        binary_node->op_is_assignment = strcmp(op, "=") == 0 || strcmp(op, "+=") == 0 || strcmp(op, "-=") == 0 ||
+                                        strcmp(op, "*=") == 0 || strcmp(op, "/=") == 0 || strcmp(op, "%=") == 0;
+        if (binary_node->op_is_assignment) {
+            char arith_op[2] = { op[0], '\0' };
+            binary_node->op_code = op[1] ? binary_operator_from_string(arith_op) : BINOP_UNKNOWN;
         } else {
-            result = (strcmp(safe_left, safe_right) >= 0);
+            binary_node->op_code = binary_operator_from_string(op);
         }
-        strcpy(result_buffer, result ? "true" : "false");
     }
-    
-    // Logical operations
-    else if (strcmp(op_str, "&&") == 0) {
-        int left_bool = (strcmp(safe_left, "true") == 0);
-        int right_bool = (strcmp(safe_right, "true") == 0);
-        strcpy(result_buffer, (left_bool && right_bool) ? "true" : "false");
-    }
-    else if (strcmp(op_str, "||") == 0) {
-        int left_bool = (strcmp(safe_left, "true") == 0);
-        int right_bool = (strcmp(safe_right, "true") == 0);
-        strcpy(result_buffer, (left_bool || right_bool) ? "true" : "false");
-    }
-    
-    return result_buffer;
+    return (BinaryOperator)binary_node->op_code;
 }
\ No newline at end of file
@@ -5,11 +5,43 @@
 #include "ast_types.h" // For ASTNode
 
 // Main evaluation function for an expression AST node
-// Returns a C-string representing the evaluated value.
-// For complex types (objects, arrays), this might be a reference string (e.g., "obj:123").
-// The caller should be aware that some results might point to a static internal buffer
-// in eval.c and should be used or copied immediately.
-const char* evaluate_expression(ASTNode *expr_node, StackFrame *frame);
+// Returns the evaluated Value. Objects are returned as VAL_OBJECT references (the
+// "obj:123" form when printed). The result is owned by the caller, who must
+// value_release() it.
+Value evaluate_expression(ASTNode *expr_node, StackFrame *frame);
+
+// Variable access for identifier, declaration and parameter nodes: resolved nodes
+// go straight to their frame slot, unresolved ones are looked up by name.
+Value* lookup_variable(ASTNode *node, StackFrame *frame); // Borrowed; NULL if not found
+void store_variable(ASTNode *node, StackFrame *frame, Value value); // Stores a copy of value
+
+// Member access (obj.prop, ClassName.prop, str.length); implemented in vm.c
+Value evaluate_member_access(ASTNode *member_access_expr_node, StackFrame *frame);
+
+// Binary operators, decoded once from the operator text of AST_BINARY_OP nodes
+typedef enum {
+    BINOP_ADD, BINOP_SUB, BINOP_MUL, BINOP_DIV, BINOP_MOD, BINOP_SHL, BINOP_SHR,
+    BINOP_EQ, BINOP_NE, BINOP_LT, BINOP_GT, BINOP_LE, BINOP_GE,
+    BINOP_AND, BINOP_OR, // Eager forms; evaluate_expression short-circuits && and ||
+    BINOP_UNKNOWN
+} BinaryOperator;
+
+BinaryOperator binary_operator_from_string(const char *op_str);
+// Applies op to two borrowed operands; the result is owned by the caller
+Value evaluate_binary_operator(BinaryOperator op, Value left_val, Value right_val);
+// The same operator on two unboxed ints; the bytecode VM calls it directly when both operands are ints
+Value evaluate_int_binary_operator(BinaryOperator op, int64_t l, int64_t r);
+// And on two numbers at least one of which was a double, promoted
+Value evaluate_double_binary_operator(BinaryOperator op, double l, double r);
+
+// target[index] on borrowed operands: array items, object properties by key, string characters.
+// Errors are reported against expr_node's location.
+Value evaluate_index(ASTNode *expr_node, Value target_val, Value index_val);
+void assign_index(ASTNode *expr_node, Value target_val, Value index_val, Value new_value); // Stores a copy
+
+// Unary '-' and '++'/'--' on a borrowed operand; report errors against expr_node's location
+Value evaluate_negate(ASTNode *expr_node, Value operand_val);
+Value evaluate_increment(ASTNode *expr_node, Value operand_val, int delta);
 
 // Helper to check if a string is numeric (used internally by eval.c, but could be util)
 int is_numeric_string(const char *s);
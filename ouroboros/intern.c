@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+#include "value.h" // For string_hash
+
+#define INTERN_INITIAL_CAPACITY 1024 // Table slots; a power of two
+#define INTERN_BLOCK_SIZE 16384      // Bytes per character block
+
+// Interned text is packed into large blocks rather than allocated one string at a time
+typedef struct InternBlock {
+    struct InternBlock *next;
+    size_t used;
+    size_t size;
+    char chars[];
+} InternBlock;
+
+typedef struct InternEntry {
+    const char *chars; // NULL for an empty slot
+    size_t length;
+    uint32_t hash;
+} InternEntry;
+
+static InternEntry *intern_entries = NULL; // Open addressing, linear probing, at most half full
+static size_t intern_capacity = 0;
+static size_t intern_count = 0;
+static InternBlock *intern_blocks = NULL;
+
+static char* intern_store(const char *s, size_t length) {
+    if (!intern_blocks || intern_blocks->size - intern_blocks->used < length + 1) {
+        size_t size = length + 1 > INTERN_BLOCK_SIZE ? length + 1 : INTERN_BLOCK_SIZE;
+        InternBlock *block = (InternBlock*)malloc(sizeof(InternBlock) + size);
+        if (!block) {
+            fprintf(stderr, "Error: Memory allocation failed interning %zu bytes\n", length);
+            exit(EXIT_FAILURE);
+        }
+        block->used = 0;
+        block->size = size;
+        block->next = intern_blocks;
+        intern_blocks = block;
+    }
+    char *copy = intern_blocks->chars + intern_blocks->used;
+    memcpy(copy, s, length);
+    copy[length] = '\0';
+    intern_blocks->used += length + 1;
+    return copy;
+}
+
+static InternEntry* intern_find(const char *s, size_t length, uint32_t hash) {
+    size_t mask = intern_capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        InternEntry *entry = &intern_entries[i];
+        if (!entry->chars) return entry;
+        if (entry->hash == hash && entry->length == length && memcmp(entry->chars, s, length) == 0) return entry;
+    }
+}
+
+static void intern_grow(void) {
+    InternEntry *old_entries = intern_entries;
+    size_t old_capacity = intern_capacity;
+    intern_capacity = old_capacity ? old_capacity * 2 : INTERN_INITIAL_CAPACITY;
+    intern_entries = (InternEntry*)calloc(intern_capacity, sizeof(InternEntry));
+    if (!intern_entries) {
+        fprintf(stderr, "Error: Memory allocation failed growing intern table to %zu entries\n", intern_capacity);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_entries[i].chars) *intern_find(old_entries[i].chars, old_entries[i].length, old_entries[i].hash) = old_entries[i];
+    }
+    free(old_entries);
+}
+
+const char* intern_with_length(const char *s, size_t length) {
+    if ((intern_count + 1) * 2 > intern_capacity) intern_grow();
+    uint32_t hash = string_hash(s, length);
+    InternEntry *entry = intern_find(s, length, hash);
+    if (!entry->chars) {
+        entry->chars = intern_store(s, length);
+        entry->length = length;
+        entry->hash = hash;
+        intern_count++;
+    }
+    return entry->chars;
+}
+
+const char* intern(const char *s) {
+    return intern_with_length(s ? s : "", s ? strlen(s) : 0);
+}
+
+const char* intern_lookup(const char *s) {
+    if (!s || intern_count == 0) return NULL;
+    size_t length = strlen(s);
+    return intern_find(s, length, string_hash(s, length))->chars;
+}
+
+void intern_table_free(void) {
+    while (intern_blocks) {
+        InternBlock *next = intern_blocks->next;
+        free(intern_blocks);
+        intern_blocks = next;
+    }
+    free(intern_entries);
+    intern_entries = NULL;
+    intern_capacity = 0;
+    intern_count = 0;
+}
@@ -0,0 +1,16 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+
+// Global table of unique, immutable strings. Interning a string returns the one
+// shared copy of its text, so two interned names are equal exactly when their
+// pointers are. The lexer interns every token and the parser every node value;
+// identifiers, property, class and function names are then compared with ==.
+// Interned strings live until intern_table_free().
+const char* intern(const char *s);
+const char* intern_with_length(const char *s, size_t length);
+const char* intern_lookup(const char *s); // Interned copy of s, or NULL if s was never interned
+void intern_table_free(void);
+
+#endif // INTERN_H
@@ -1,10 +1,592 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
 #include "ir.h"
+#include "eval.h" // For BinaryOperator and literal decoding
+#include "jit.h"  // For jit_free_code
+
+// Pending jumps out of (break) or to the next iteration of (continue) a loop
+typedef struct LoopContext {
+    int *break_jumps;
+    int break_count;
+    int break_capacity;
+    int *continue_jumps;
+    int continue_count;
+    int continue_capacity;
+    struct LoopContext *enclosing;
+} LoopContext;
+
+typedef struct Compiler {
+    BytecodeChunk *chunk;
+    int stack_depth;
+    LoopContext *loop;
+} Compiler;
+
+static void compile_expression(Compiler *c, ASTNode *node);
+static void compile_statement(Compiler *c, ASTNode *node);
+
+static BytecodeChunk* new_chunk(const char *name) {
+    BytecodeChunk *chunk = (BytecodeChunk*)calloc(1, sizeof(BytecodeChunk));
+    if (!chunk) {
+        fprintf(stderr, "Error: Memory allocation failed for bytecode chunk '%s'\n", name);
+        exit(EXIT_FAILURE);
+    }
+    strncpy(chunk->name, name, sizeof(chunk->name) - 1);
+    return chunk;
+}
+
+void ir_free_chunk(BytecodeChunk *chunk) {
+    if (!chunk) return;
+    for (int i = 0; i < chunk->constant_count; i++) value_release(chunk->constants[i]);
+    free(chunk->constants);
+    free(chunk->code);
+    jit_free_code(chunk->native);
+    free(chunk);
+}
+
+// Appends an instruction and tracks the operand stack depth it leaves behind
+static int emit(Compiler *c, OpCode op, int operand, ASTNode *node, int stack_effect) {
+    BytecodeChunk *chunk = c->chunk;
+    if (chunk->count == chunk->capacity) {
+        int new_capacity = chunk->capacity ? chunk->capacity * 2 : 32;
+        Instruction *grown = (Instruction*)realloc(chunk->code, sizeof(Instruction) * new_capacity);
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed for bytecode in '%s'\n", chunk->name);
+            exit(EXIT_FAILURE);
+        }
+        chunk->code = grown;
+        chunk->capacity = new_capacity;
+    }
+    Instruction *ins = &chunk->code[chunk->count];
+    ins->op = op;
+    ins->operand = operand;
+    ins->node = node;
+    c->stack_depth += stack_effect;
+    if (c->stack_depth > chunk->max_stack) chunk->max_stack = c->stack_depth;
+    return chunk->count++;
+}
+
+// Takes ownership of value
+static void emit_constant(Compiler *c, Value value, ASTNode *node) {
+    BytecodeChunk *chunk = c->chunk;
+    if (chunk->constant_count == chunk->constant_capacity) {
+        int new_capacity = chunk->constant_capacity ? chunk->constant_capacity * 2 : 8;
+        Value *grown = (Value*)realloc(chunk->constants, sizeof(Value) * new_capacity);
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed for constants in '%s'\n", chunk->name);
+            exit(EXIT_FAILURE);
+        }
+        chunk->constants = grown;
+        chunk->constant_capacity = new_capacity;
+    }
+    chunk->constants[chunk->constant_count] = value;
+    emit(c, OP_CONSTANT, chunk->constant_count++, node, 1);
+}
+
+static void patch_jump(Compiler *c, int jump_index) {
+    c->chunk->code[jump_index].operand = c->chunk->count;
+}
+
+static void add_pending_jump(int **jumps, int *count, int *capacity, int jump_index) {
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 4;
+        *jumps = (int*)realloc(*jumps, sizeof(int) * (*capacity));
+        if (!*jumps) {
+            fprintf(stderr, "Error: Memory allocation failed for loop jumps\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    (*jumps)[(*count)++] = jump_index;
+}
+
+static int count_list(ASTNode *node) {
+    int count = 0;
+    for (; node; node = node->next) count++;
+    return count;
+}
+
+// Variables resolved by semantic analysis are addressed by slot; the rest by name
+static void emit_load(Compiler *c, ASTNode *node) {
+    switch (node->var_scope) {
+        case VAR_LOCAL:  emit(c, OP_LOAD_LOCAL, node->var_slot, node, 1); break;
+        case VAR_GLOBAL: emit(c, OP_LOAD_GLOBAL, node->var_slot, node, 1); break;
+        default:         emit(c, OP_LOAD_NAME, 0, node, 1); break;
+    }
+}
+
+static void emit_store(Compiler *c, ASTNode *node) {
+    switch (node->var_scope) {
+        case VAR_LOCAL:  emit(c, OP_STORE_LOCAL, node->var_slot, node, 0); break;
+        case VAR_GLOBAL: emit(c, OP_STORE_GLOBAL, node->var_slot, node, 0); break;
+        default:         emit(c, OP_STORE_NAME, 0, node, 0); break;
+    }
+}
+
+// `i += 4` or `i -= 4` with an int literal that fits an instruction immediate
+static int is_constant_step(ASTNode *node) {
+    if (node->type != AST_BINARY_OP || (strcmp(node->value, "+=") != 0 && strcmp(node->value, "-=") != 0)) return 0;
+    if (!node->right || node->right->type != AST_LITERAL || strcmp(node->right->data_type, "int") != 0) return 0;
+    Value step = evaluate_expression(node->right, NULL); // Also caches it on the literal for INCREMENT_DELTA
+    int fits = step.type == VAL_INT && step.as.integer >= -INT32_MAX && step.as.integer <= INT32_MAX;
+    value_release(step);
+    return fits;
+}
+
+// Compiles an expression whose value is not used. An increment of a slot
+// variable (`i++` in a for loop's update, or `i += 4`) becomes a single in-place
+// instruction.
+static void compile_discarded_expression(Compiler *c, ASTNode *node) {
+    if (((node->type == AST_UNARY_OP && (strcmp(node->value, "++") == 0 || strcmp(node->value, "--") == 0)) || is_constant_step(node)) &&
+        node->left && node->left->type == AST_IDENTIFIER &&
+        (node->left->var_scope == VAR_LOCAL || node->left->var_scope == VAR_GLOBAL)) {
+        emit(c, node->left->var_scope == VAR_LOCAL ? OP_INCREMENT_LOCAL : OP_INCREMENT_GLOBAL, node->left->var_slot, node, 0);
+        return;
+    }
+    compile_expression(c, node);
+    emit(c, OP_POP, 0, node, -1);
+}
+
+static int is_number_type(StaticType type) {
+    return type == STATIC_INT || type == STATIC_DOUBLE || type == STATIC_NUMBER;
+}
+
+// The BINARY form for operands of the types the optimizer proved (node->static_type)
+static OpCode binary_opcode(ASTNode *left, ASTNode *right) {
+    StaticType l = left ? left->static_type : STATIC_UNKNOWN, r = right ? right->static_type : STATIC_UNKNOWN;
+    if (l == STATIC_INT && r == STATIC_INT) return OP_BINARY_INT;
+    if (is_number_type(l) && is_number_type(r) && (l == STATIC_DOUBLE || r == STATIC_DOUBLE)) return OP_BINARY_DOUBLE;
+    return OP_BINARY;
+}
+
+// Pops cond's value and jumps on it; a proven bool needs no truthiness test
+static int emit_jump_if(Compiler *c, int if_true, ASTNode *cond, ASTNode *node) {
+    if (cond && cond->static_type == STATIC_BOOL) return emit(c, if_true ? OP_JUMP_IF_TRUE_BOOL : OP_JUMP_IF_FALSE_BOOL, -1, node, -1);
+    return emit(c, if_true ? OP_JUMP_IF_TRUE : OP_JUMP_IF_FALSE, -1, node, -1);
+}
+
+static int is_assignment_operator(const char *op) {
+    return strcmp(op, "=") == 0 || strcmp(op, "+=") == 0 || strcmp(op, "-=") == 0 ||
+           strcmp(op, "*=") == 0 || strcmp(op, "/=") == 0 || strcmp(op, "%=") == 0;
+}
+
+static void compile_expression(Compiler *c, ASTNode *node) {
+    if (!node) {
+        emit_constant(c, value_undefined(), NULL);
+        return;
+    }
+
+    switch (node->type) {
+        case AST_LITERAL:
+            emit_constant(c, evaluate_expression(node, NULL), node);
+            return;
+
+        case AST_IDENTIFIER:
+            emit_load(c, node);
+            return;
+
+        case AST_BINARY_OP: {
+            const char *op = node->value;
+            if (is_assignment_operator(op)) {
+                if (op[0] == '=' && node->left && node->left->type == AST_INDEX_ACCESS) {
+                    compile_expression(c, node->left->left);
+                    compile_expression(c, node->left->right);
+                    compile_expression(c, node->right);
+                    emit(c, OP_SET_INDEX, 0, node->left, -2);
+                    return;
+                }
+                if (!node->left || node->left->type != AST_IDENTIFIER) break; // Member targets stay on the AST path
+                if (op[0] == '=') {
+                    compile_expression(c, node->right);
+                } else {
+                    char arith_op[2] = { op[0], '\0' };
+                    emit_load(c, node->left);
+                    compile_expression(c, node->right);
+                    emit(c, binary_opcode(node->left, node->right), binary_operator_from_string(arith_op), node, -1);
+                }
+                emit_store(c, node->left);
+                return;
+            }
+            if (strcmp(op, "&&") == 0 || strcmp(op, "||") == 0) {
+                // Short-circuit: the result is always a bool
+                int is_and = op[0] == '&';
+                compile_expression(c, node->left);
+                int short_jump = emit_jump_if(c, !is_and, node->left, node);
+                compile_expression(c, node->right);
+                if (!node->right || node->right->static_type != STATIC_BOOL) emit(c, OP_TO_BOOL, 0, node, 0);
+                int end_jump = emit(c, OP_JUMP, -1, node, 0);
+                patch_jump(c, short_jump);
+                c->stack_depth--; // The short-circuit path arrives without the right operand
+                emit_constant(c, value_bool(!is_and), node);
+                patch_jump(c, end_jump);
+                return;
+            }
+            BinaryOperator bop = binary_operator_from_string(op);
+            if (bop == BINOP_UNKNOWN) break;
+            compile_expression(c, node->left);
+            compile_expression(c, node->right);
+            emit(c, binary_opcode(node->left, node->right), bop, node, -1);
+            return;
+        }
+
+        case AST_UNARY_OP:
+            if (strcmp(node->value, "-") == 0) {
+                compile_expression(c, node->left);
+                emit(c, OP_NEGATE, 0, node, 0);
+                return;
+            }
+            if (strcmp(node->value, "!") == 0) {
+                compile_expression(c, node->left);
+                emit(c, OP_NOT, 0, node, 0);
+                return;
+            }
+            if ((strcmp(node->value, "++") == 0 || strcmp(node->value, "--") == 0) &&
+                node->left && node->left->type == AST_IDENTIFIER) {
+                emit_load(c, node->left);
+                emit(c, OP_INCREMENT, node->value[0] == '+' ? 1 : -1, node, 0);
+                emit_store(c, node->left);
+                return;
+            }
+            break;
+
+        case AST_CALL: {
+            int arg_count = count_list(node->left);
+            if (!node->right) {
+                for (ASTNode *arg = node->left; arg; arg = arg->next) compile_expression(c, arg);
+                emit(c, OP_CALL, arg_count, node, 1 - arg_count);
+                return;
+            }
+            if (node->right->type == AST_SUPER) break; // super.method() binds 'this' on the AST path
+            compile_expression(c, node->right);
+            for (ASTNode *arg = node->left; arg; arg = arg->next) compile_expression(c, arg);
+            emit(c, OP_CALL_METHOD, arg_count, node, -arg_count);
+            return;
+        }
+
+        case AST_INDEX_ACCESS:
+            compile_expression(c, node->left);
+            compile_expression(c, node->right);
+            emit(c, OP_GET_INDEX, 0, node, -1);
+            return;
+
+        case AST_TERNARY: {
+            compile_expression(c, node->left);
+            int else_jump = emit_jump_if(c, 0, node->left, node);
+            compile_expression(c, node->right);
+            int end_jump = emit(c, OP_JUMP, -1, node, 0);
+            patch_jump(c, else_jump);
+            c->stack_depth--; // Only one branch's value reaches the join point
+            compile_expression(c, node->next);
+            patch_jump(c, end_jump);
+            return;
+        }
+
+        default:
+            break;
+    }
+
+    // Objects, arrays, maps, member access and other constructs are evaluated by eval.c
+    emit(c, OP_EVAL_AST, 0, node, 1);
+}
+
+static void compile_loop_body(Compiler *c, ASTNode *body, LoopContext *loop) {
+    loop->enclosing = c->loop;
+    c->loop = loop;
+    compile_statement(c, body);
+    c->loop = loop->enclosing;
+}
+
+static void finish_loop(Compiler *c, LoopContext *loop, int continue_target) {
+    for (int i = 0; i < loop->continue_count; i++) c->chunk->code[loop->continue_jumps[i]].operand = continue_target;
+    for (int i = 0; i < loop->break_count; i++) patch_jump(c, loop->break_jumps[i]);
+    free(loop->continue_jumps);
+    free(loop->break_jumps);
+}
+
+// return value; a ?: returns from each branch, so a call in either is in tail position
+static void compile_return(Compiler *c, ASTNode *node, ASTNode *value) {
+    if (c->chunk->function && value && value->type == AST_TERNARY) {
+        compile_expression(c, value->left);
+        int else_jump = emit_jump_if(c, 0, value->left, value);
+        compile_return(c, node, value->right);
+        patch_jump(c, else_jump);
+        compile_return(c, node, value->next);
+        return;
+    }
+    if (c->chunk->function && value && value->type == AST_CALL && !value->right) {
+        // return f(...): the VM decides at run time whether f is this function
+        int arg_count = count_list(value->left);
+        for (ASTNode *arg = value->left; arg; arg = arg->next) compile_expression(c, arg);
+        emit(c, OP_TAIL_CALL, arg_count, value, -arg_count);
+        return;
+    }
+    compile_expression(c, value);
+    emit(c, OP_RETURN, 0, node, -1);
+}
+
+static void compile_statement_list(Compiler *c, ASTNode *stmt) {
+    for (; stmt; stmt = stmt->next) {
+        if (stmt->type == AST_ELSE) continue; // Compiled with the preceding AST_IF
+        compile_statement(c, stmt);
+    }
+}
+
+static void compile_statement(Compiler *c, ASTNode *node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case AST_PROGRAM:
+        case AST_BLOCK:
+            compile_statement_list(c, node->left);
+            return;
+
+        case AST_FUNCTION: case AST_TYPED_FUNCTION: case AST_CLASS: case AST_STRUCT:
+        case AST_IMPORT: case AST_ELSE:
+            return;
+
+        case AST_PRINT:
+            compile_expression(c, node->left);
+            emit(c, OP_PRINT, 0, node, -1);
+            return;
+
+        case AST_VAR_DECL:
+        case AST_TYPED_VAR_DECL:
+            if (node->right) {
+                compile_expression(c, node->right);
+            } else if (node->type == AST_TYPED_VAR_DECL) { // Default init for typed vars if no explicit init
+                if (strcmp(node->data_type, "int") == 0 || strcmp(node->data_type, "long") == 0) emit_constant(c, value_int(0), node);
+                else if (strcmp(node->data_type, "float") == 0 || strcmp(node->data_type, "double") == 0) emit_constant(c, value_double(0.0), node);
+                else if (strcmp(node->data_type, "bool") == 0) emit_constant(c, value_bool(0), node);
+                else if (strcmp(node->data_type, "string") == 0) emit_constant(c, value_string(""), node);
+                else emit_constant(c, value_undefined(), node);
+            } else {
+                emit_constant(c, value_undefined(), node);
+            }
+            emit_store(c, node);
+            emit(c, OP_POP, 0, node, -1);
+            return;
+
+        case AST_ASSIGN:
+            if (node->left && node->left->type == AST_IDENTIFIER) {
+                compile_expression(c, node->right);
+                emit_store(c, node->left);
+                emit(c, OP_POP, 0, node, -1);
+                return;
+            }
+            break;
+
+        case AST_RETURN:
+            compile_return(c, node, node->left);
+            return;
+
+        case AST_IF: {
+            compile_expression(c, node->left);
+            int else_jump = emit_jump_if(c, 0, node->left, node);
+            compile_statement(c, node->right);
+            if (node->next && node->next->type == AST_ELSE) {
+                int end_jump = emit(c, OP_JUMP, -1, node, 0);
+                patch_jump(c, else_jump);
+                compile_statement(c, node->next->left);
+                patch_jump(c, end_jump);
+            } else {
+                patch_jump(c, else_jump);
+            }
+            return;
+        }
+
+        case AST_WHILE: {
+            LoopContext loop;
+            memset(&loop, 0, sizeof(loop));
+            int loop_start = c->chunk->count;
+            compile_expression(c, node->left);
+            int exit_jump = emit_jump_if(c, 0, node->left, node);
+            compile_loop_body(c, node->right, &loop);
+            emit(c, OP_JUMP, loop_start, node, 0);
+            patch_jump(c, exit_jump);
+            finish_loop(c, &loop, loop_start);
+            return;
+        }
+
+        case AST_FOR: {
+            ASTNode *init_expr = NULL, *cond_expr = NULL, *incr_expr = NULL;
+            ASTNode *control = node->left;
+            if (control) { init_expr = control; control = control->next; }
+            if (control) { cond_expr = control; control = control->next; }
+            if (control) { incr_expr = control; }
+
+            if (init_expr) {
+                if (init_expr->type == AST_VAR_DECL || init_expr->type == AST_TYPED_VAR_DECL) {
+                    compile_statement(c, init_expr);
+                } else {
+                    compile_discarded_expression(c, init_expr);
+                }
+            }
+            LoopContext loop;
+            memset(&loop, 0, sizeof(loop));
+            int loop_start = c->chunk->count;
+            int exit_jump = -1;
+            if (cond_expr) {
+                compile_expression(c, cond_expr);
+                exit_jump = emit_jump_if(c, 0, cond_expr, node);
+            }
+            compile_loop_body(c, node->right, &loop);
+            int continue_target = c->chunk->count;
+            if (incr_expr) compile_discarded_expression(c, incr_expr);
+            emit(c, OP_JUMP, loop_start, node, 0);
+            if (exit_jump >= 0) patch_jump(c, exit_jump);
+            finish_loop(c, &loop, continue_target);
+            return;
+        }
+
+        case AST_BREAK:
+            if (c->loop) {
+                int jump = emit(c, OP_JUMP, -1, node, 0);
+                add_pending_jump(&c->loop->break_jumps, &c->loop->break_count, &c->loop->break_capacity, jump);
+            }
+            return;
+
+        case AST_CONTINUE:
+            if (c->loop) {
+                int jump = emit(c, OP_JUMP, -1, node, 0);
+                add_pending_jump(&c->loop->continue_jumps, &c->loop->continue_count, &c->loop->continue_capacity, jump);
+            }
+            return;
+
+        case AST_CALL: case AST_BINARY_OP: case AST_UNARY_OP: case AST_LITERAL:
+        case AST_IDENTIFIER: case AST_MEMBER_ACCESS: case AST_NEW:
+            compile_discarded_expression(c, node);
+            return;
+
+        default:
+            break;
+    }
+    emit(c, OP_EXEC_AST, 0, node, 0);
+}
+
+BytecodeChunk* ir_compile_function(ASTNode *func_node) {
+    if (!func_node) return NULL;
+    Compiler c;
+    memset(&c, 0, sizeof(c));
+    c.chunk = new_chunk(func_node->value);
+    c.chunk->function = func_node;
+    compile_statement(&c, func_node->right);
+    emit(&c, OP_HALT, 0, func_node, 0);
+    return c.chunk;
+}
+
+BytecodeChunk* ir_compile_program(ASTNode *program_node) {
+    if (!program_node) return NULL;
+    Compiler c;
+    memset(&c, 0, sizeof(c));
+    c.chunk = new_chunk("<program>");
+    compile_statement(&c, program_node);
+    emit(&c, OP_HALT, 0, program_node, 0);
+    return c.chunk;
+}
+
+const char* ir_opcode_name(OpCode op) {
+    switch (op) {
+        case OP_CONSTANT:      return "CONSTANT";
+        case OP_POP:           return "POP";
+        case OP_LOAD_NAME:     return "LOAD_NAME";
+        case OP_STORE_NAME:    return "STORE_NAME";
+        case OP_LOAD_LOCAL:    return "LOAD_LOCAL";
+        case OP_STORE_LOCAL:   return "STORE_LOCAL";
+        case OP_LOAD_GLOBAL:   return "LOAD_GLOBAL";
+        case OP_STORE_GLOBAL:  return "STORE_GLOBAL";
+        case OP_INCREMENT_LOCAL:  return "INCREMENT_LOCAL";
+        case OP_INCREMENT_GLOBAL: return "INCREMENT_GLOBAL";
+        case OP_BINARY:        return "BINARY";
+        case OP_BINARY_INT:    return "BINARY_INT";
+        case OP_BINARY_DOUBLE: return "BINARY_DOUBLE";
+        case OP_NEGATE:        return "NEGATE";
+        case OP_NOT:           return "NOT";
+        case OP_TO_BOOL:       return "TO_BOOL";
+        case OP_INCREMENT:     return "INCREMENT";
+        case OP_GET_INDEX:     return "GET_INDEX";
+        case OP_SET_INDEX:     return "SET_INDEX";
+        case OP_JUMP:          return "JUMP";
+        case OP_JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+        case OP_JUMP_IF_TRUE:  return "JUMP_IF_TRUE";
+        case OP_JUMP_IF_FALSE_BOOL: return "JUMP_IF_FALSE_BOOL";
+        case OP_JUMP_IF_TRUE_BOOL:  return "JUMP_IF_TRUE_BOOL";
+        case OP_CALL:          return "CALL";
+        case OP_CALL_METHOD:   return "CALL_METHOD";
+        case OP_TAIL_CALL:     return "TAIL_CALL";
+        case OP_EVAL_AST:      return "EVAL_AST";
+        case OP_EXEC_AST:      return "EXEC_AST";
+        case OP_PRINT:         return "PRINT";
+        case OP_RETURN:        return "RETURN";
+        case OP_HALT:          return "HALT";
+    }
+    return "UNKNOWN";
+}
+
+void ir_disassemble_chunk(const BytecodeChunk *chunk, FILE *out) {
+    if (!chunk) return;
+    fprintf(out, "== %s (%d instructions, max stack %d) ==\n", chunk->name, chunk->count, chunk->max_stack);
+    for (int i = 0; i < chunk->count; i++) {
+        const Instruction *ins = &chunk->code[i];
+        fprintf(out, "%04d  %-16s", i, ir_opcode_name(ins->op));
+        switch (ins->op) {
+            case OP_CONSTANT: {
+                char text_buf[VALUE_TEXT_BUFFER_SIZE];
+                Value v = chunk->constants[ins->operand];
+                fprintf(out, " #%d (%s %s)", ins->operand, value_type_name(v.type), value_to_text(v, text_buf, sizeof(text_buf)));
+                break;
+            }
+            case OP_LOAD_NAME: case OP_STORE_NAME:
+                fprintf(out, " %s", ins->node->value);
+                break;
+            case OP_LOAD_LOCAL: case OP_STORE_LOCAL: case OP_LOAD_GLOBAL: case OP_STORE_GLOBAL:
+                fprintf(out, " %d (%s)", ins->operand, ins->node->value);
+                break;
+            case OP_INCREMENT_LOCAL: case OP_INCREMENT_GLOBAL:
+                fprintf(out, " %d (%s) %+" PRId64, ins->operand, ins->node->left->value, (int64_t)INCREMENT_DELTA(ins->node));
+                break;
+            case OP_BINARY: case OP_BINARY_INT: case OP_BINARY_DOUBLE: {
+                static const char *operator_names[] = { "+", "-", "*", "/", "%", "<<", ">>", "==", "!=", "<", ">", "<=", ">=", "&&", "||", "?" };
+                fprintf(out, " %s", operator_names[ins->operand]);
+                break;
+            }
+            case OP_INCREMENT:
+                fprintf(out, " %+d", ins->operand);
+                break;
+            case OP_JUMP: case OP_JUMP_IF_FALSE: case OP_JUMP_IF_TRUE:
+            case OP_JUMP_IF_FALSE_BOOL: case OP_JUMP_IF_TRUE_BOOL:
+                fprintf(out, " -> %04d", ins->operand);
+                break;
+            case OP_CALL: case OP_CALL_METHOD: case OP_TAIL_CALL:
+                fprintf(out, " %s/%d", ins->node->value, ins->operand);
+                break;
+            case OP_EVAL_AST: case OP_EXEC_AST:
+                fprintf(out, " %s '%s' (L%d)", node_type_to_string(ins->node->type), ins->node->value, ins->node->line);
+                break;
+            default:
+                break;
+        }
+        fprintf(out, "\n");
+    }
+}
+
+static void dump_functions(ASTNode *node) {
+    for (; node; node = node->next) {
+        if (node->type == AST_FUNCTION || node->type == AST_TYPED_FUNCTION || node->type == AST_CLASS_METHOD) {
+            BytecodeChunk *chunk = ir_compile_function(node);
+            ir_disassemble_chunk(chunk, stdout);
+            ir_free_chunk(chunk);
+        } else if (node->type == AST_CLASS || node->type == AST_STRUCT) {
+            dump_functions(node->left);
+        }
+    }
+}
 
 void generate_ir(ASTNode *root) {
     if (!root) return;
-    printf("[IR] Generating IR for node: %s\n", root->value);
-    generate_ir(root->left);
-    generate_ir(root->right);
-    generate_ir(root->next);
+    printf("\n==== Bytecode ====\n");
+    BytecodeChunk *chunk = ir_compile_program(root);
+    ir_disassemble_chunk(chunk, stdout);
+    ir_free_chunk(chunk);
+    if (root->type == AST_PROGRAM) dump_functions(root->left);
 }
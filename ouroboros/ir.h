@@ -1,8 +1,87 @@
 #ifndef IR_H
 #define IR_H
 
+#include <stdio.h>
 #include "parser.h"
+#include "value.h"
 
+// Bytecode instruction set. Operands are decoded at compile time so the dispatch
+// loop in vm.c never inspects operator strings.
+typedef enum {
+    OP_CONSTANT,       // push constants[operand]
+    OP_POP,            // discard top of stack
+    OP_LOAD_NAME,      // push variable node->value (falls back to evaluate_expression for members/classes)
+    OP_STORE_NAME,     // store top of stack into variable node->value (value stays on the stack)
+    OP_LOAD_LOCAL,     // push slots[operand] of the current frame
+    OP_STORE_LOCAL,    // store top of stack into slots[operand] of the current frame (value stays)
+    OP_LOAD_GLOBAL,    // push slots[operand] of the global frame
+    OP_STORE_GLOBAL,   // store top of stack into slots[operand] of the global frame (value stays)
+    OP_INCREMENT_LOCAL,  // slots[operand] += INCREMENT_DELTA(node) (i++, i--, i += 4); pushes nothing
+    OP_INCREMENT_GLOBAL, // the same for slots[operand] of the global frame
+    OP_BINARY,         // pop right, pop left, push left <operand> right (operand is a BinaryOperator)
+    OP_BINARY_INT,     // OP_BINARY on operands proven to be ints (node->static_type): no type checks
+    OP_BINARY_DOUBLE,  // OP_BINARY on proven numbers, one of them a double: computed in double
+    OP_NEGATE,         // unary '-'
+    OP_NOT,            // unary '!'
+    OP_TO_BOOL,        // replace top of stack with its truthiness
+    OP_INCREMENT,      // add operand (+1/-1) to a numeric top of stack
+    OP_GET_INDEX,      // pop index, pop target, push target[index]
+    OP_SET_INDEX,      // pop value, index, target; target[index] = value; push value
+    OP_JUMP,           // ip = operand
+    OP_JUMP_IF_FALSE,  // pop; if falsy, ip = operand
+    OP_JUMP_IF_TRUE,   // pop; if truthy, ip = operand
+    OP_JUMP_IF_FALSE_BOOL, // OP_JUMP_IF_FALSE on a value proven to be a bool
+    OP_JUMP_IF_TRUE_BOOL,  // OP_JUMP_IF_TRUE on a value proven to be a bool
+    OP_CALL,           // pop operand args, call node->value, push result
+    OP_CALL_METHOD,    // pop operand args and the target, call target.node->value, push result
+    OP_TAIL_CALL,      // return node->value(operand args); a call of the chunk's own function reruns it in place
+    OP_EVAL_AST,       // push evaluate_expression(node) for expressions the compiler does not lower
+    OP_EXEC_AST,       // run_vm_node(node) for statements the compiler does not lower
+    OP_PRINT,          // pop and print as "[OUTPUT] value"
+    OP_RETURN,         // pop and return from the chunk
+    OP_HALT            // end of chunk; returns undefined
+} OpCode;
+
+typedef struct Instruction {
+    OpCode op;
+    int operand;       // Constant index, slot, jump target, argument count, operator or delta
+    ASTNode *node;     // Source node: names for loads/stores/calls, fallback subtrees, error locations
+} Instruction;
+
+struct ExecState; // State of a running chunk (jit.h)
+
+typedef struct BytecodeChunk {
+    char name[128];
+    Instruction *code;
+    int count;
+    int capacity;
+    Value *constants;
+    int constant_count;
+    int constant_capacity;
+    int max_stack;     // Deepest operand stack the chunk can reach
+    ASTNode *function; // Function whose body this is; NULL for a program
+    // Profiling counters and native code (jit.h)
+    int call_count;    // Interpreted runs of the chunk
+    int loop_count;    // Interpreted loop back-edges taken
+    int jit_failed;    // Compilation was tried and failed; stay interpreted
+    struct JitCode *native; // Compiled code, or NULL
+    void (*compiled)(struct ExecState *state); // Ahead-of-time code from -emit-c (aot.h), or NULL
+} BytecodeChunk;
+
+// What OP_INCREMENT_LOCAL/GLOBAL adds: 1 or -1 for ++ and --, or the int literal
+// of a += or -= (the compiler decodes it into node->right->literal_value)
+#define INCREMENT_DELTA(node) ((node)->type == AST_UNARY_OP ? ((node)->value[0] == '+' ? 1 : -1) : \
+    (node)->value[0] == '+' ? (node)->right->literal_value.as.integer : -(node)->right->literal_value.as.integer)
+
+// Compile a function's body (func_node->right) or a program's top-level statements.
+// Declarations (functions, classes, imports) are skipped; run_vm registers them.
+BytecodeChunk* ir_compile_function(ASTNode *func_node);
+BytecodeChunk* ir_compile_program(ASTNode *program_node);
+void ir_free_chunk(BytecodeChunk *chunk);
+void ir_disassemble_chunk(const BytecodeChunk *chunk, FILE *out);
+const char* ir_opcode_name(OpCode op);
+
+// Compile and print the bytecode for a program and every function/method it declares
 void generate_ir(ASTNode *root);
 
 #endif // IR_H
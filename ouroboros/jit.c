@@ -0,0 +1,710 @@
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE // For MAP_ANONYMOUS under -std=c99
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "jit.h"
+#include "eval.h" // For BinaryOperator
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define JIT_SUPPORTED 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+struct JitCode {
+    unsigned char *code;   // Executable mapping
+    size_t mapped_size;
+    uint32_t *entries;     // Offset of each instruction's code; [count] is the exit
+};
+
+static int perf_map_enabled = 0;
+static FILE *perf_map = NULL;
+
+int jit_available(void) {
+    return JIT_SUPPORTED;
+}
+
+void jit_set_perf_map_enabled(int enabled) {
+    perf_map_enabled = enabled;
+}
+
+void jit_free_code(struct JitCode *code) {
+    if (!code) return;
+#if JIT_SUPPORTED
+    munmap(code->code, code->mapped_size);
+#endif
+    free(code->entries);
+    free(code);
+}
+
+void jit_shutdown(void) {
+    if (perf_map) fclose(perf_map);
+    perf_map = NULL;
+}
+
+#if JIT_SUPPORTED
+
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+enum { CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A = 0x7, CC_AE = 0x3, CC_P = 0xA, CC_NP = 0xB, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+
+// Registers of compiled code; all callee-saved, so they survive calls into the VM
+#define REG_SP RBX       // Operand stack top, written back to ExecState.sp around calls
+#define REG_SLOTS R12    // Current frame's slots
+#define REG_STATE R13    // ExecState*
+#define REG_GLOBALS R14  // Global frame's slots
+
+#define VALUE_TYPE 0     // Offsets within a Value
+#define VALUE_BITS 8
+#define SLOT(i) ((int32_t)((i) * (int)sizeof(Value)))
+
+#define MAX_SLOW_BRANCHES 8
+
+// Out-of-line path for an instruction whose inline guards failed: the instruction
+// runs through vm_execute_instruction, then execution rejoins the inline code
+typedef struct SlowPath {
+    int index;
+    uint32_t branches[MAX_SLOW_BRANCHES]; // rel32 fields of the guard jumps
+    int branch_count;
+    uint32_t resume;
+} SlowPath;
+
+typedef struct Fixup {
+    uint32_t at;  // rel32 field
+    int target;   // Instruction index; the chunk's count for the exit
+} Fixup;
+
+typedef struct Assembler {
+    const BytecodeChunk *chunk;
+    unsigned char *buf;
+    size_t length;
+    size_t capacity;
+    uint32_t *labels;
+    Fixup *fixups;
+    int fixup_count;
+    int fixup_capacity;
+    SlowPath *slow_paths;
+    int slow_path_count;
+    int slow_path_capacity;
+    int failed;
+} Assembler;
+
+static void emit8(Assembler *a, int byte) {
+    if (a->length == a->capacity) {
+        size_t capacity = a->capacity ? a->capacity * 2 : 4096;
+        unsigned char *grown = (unsigned char*)realloc(a->buf, capacity);
+        if (!grown) { a->failed = 1; a->length = 0; return; }
+        a->buf = grown;
+        a->capacity = capacity;
+    }
+    a->buf[a->length++] = (unsigned char)byte;
+}
+
+static void emit32(Assembler *a, uint32_t v) {
+    for (int i = 0; i < 4; i++) emit8(a, (v >> (8 * i)) & 0xFF);
+}
+
+static void emit64(Assembler *a, uint64_t v) {
+    for (int i = 0; i < 8; i++) emit8(a, (int)((v >> (8 * i)) & 0xFF));
+}
+
+static void patch32(Assembler *a, uint32_t at, uint32_t v) {
+    if (a->failed) return;
+    for (int i = 0; i < 4; i++) a->buf[at + i] = (v >> (8 * i)) & 0xFF;
+}
+
+static void emit_rex(Assembler *a, int wide, int reg, int rm) {
+    int rex = 0x40 | (wide ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((rm & 8) ? 1 : 0);
+    if (rex != 0x40) emit8(a, rex);
+}
+
+static void emit_opcode(Assembler *a, int opcode) {
+    if (opcode > 0xFF) emit8(a, opcode >> 8);
+    emit8(a, opcode & 0xFF);
+}
+
+// opcode reg, [base + disp32]; reg doubles as the opcode extension for /digit forms
+static void emit_rm(Assembler *a, int wide, int opcode, int reg, int base, int32_t disp) {
+    emit_rex(a, wide, reg, base);
+    emit_opcode(a, opcode);
+    emit8(a, 0x80 | ((reg & 7) << 3) | (base & 7));
+    if ((base & 7) == RSP) emit8(a, 0x24); // SIB for rsp/r12 bases
+    emit32(a, (uint32_t)disp);
+}
+
+// opcode reg, rm with both operands in registers
+static void emit_rr(Assembler *a, int wide, int opcode, int reg, int rm) {
+    emit_rex(a, wide, reg, rm);
+    emit_opcode(a, opcode);
+    emit8(a, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+static void emit_load64(Assembler *a, int reg, int base, int32_t disp) { emit_rm(a, 1, 0x8B, reg, base, disp); }
+static void emit_store64(Assembler *a, int base, int32_t disp, int reg) { emit_rm(a, 1, 0x89, reg, base, disp); }
+static void emit_load32(Assembler *a, int reg, int base, int32_t disp) { emit_rm(a, 0, 0x8B, reg, base, disp); }
+
+static void emit_cmp_mem32_imm(Assembler *a, int base, int32_t disp, int32_t imm) {
+    emit_rm(a, 0, 0x81, 7, base, disp);
+    emit32(a, (uint32_t)imm);
+}
+
+static void emit_mov_mem32_imm(Assembler *a, int base, int32_t disp, int32_t imm) {
+    emit_rm(a, 0, 0xC7, 0, base, disp);
+    emit32(a, (uint32_t)imm);
+}
+
+static void emit_add_mem64_imm(Assembler *a, int base, int32_t disp, int32_t imm) {
+    emit_rm(a, 1, 0x81, 0, base, disp);
+    emit32(a, (uint32_t)imm);
+}
+
+static void emit_cmp_reg32_imm(Assembler *a, int reg, int32_t imm) {
+    emit_rr(a, 0, 0x81, 7, reg);
+    emit32(a, (uint32_t)imm);
+}
+
+static void emit_cmp_reg64_imm(Assembler *a, int reg, int32_t imm) {
+    emit_rr(a, 1, 0x81, 7, reg);
+    emit32(a, (uint32_t)imm);
+}
+
+static void emit_add_reg64_imm(Assembler *a, int reg, int32_t imm) {
+    emit_rr(a, 1, 0x81, 0, reg);
+    emit32(a, (uint32_t)imm);
+}
+
+static void emit_mov_reg64_imm(Assembler *a, int reg, uint64_t imm) {
+    emit_rex(a, 1, 0, reg);
+    emit8(a, 0xB8 + (reg & 7));
+    emit64(a, imm);
+}
+
+// SSE2 scalar double op: prefix, then opcode xmm, xmm
+static void emit_sse_rr(Assembler *a, int prefix, int opcode, int dst, int src) {
+    emit8(a, prefix);
+    emit_rr(a, 0, opcode, dst, src);
+}
+
+static void emit_sse_rm(Assembler *a, int prefix, int wide, int opcode, int xmm, int base, int32_t disp) {
+    emit8(a, prefix);
+    emit_rm(a, wide, opcode, xmm, base, disp);
+}
+
+static void emit_setcc_al(Assembler *a, int cc) {
+    emit_rr(a, 0, 0x0F90 | cc, 0, RAX);
+    emit_rr(a, 0, 0x0FB6, RAX, RAX); // movzx eax, al
+}
+
+// eax = cc1 <combine> cc2, combine being and (0x22) or or (0x0A) of al and cl
+static void emit_setcc_pair(Assembler *a, int cc1, int cc2, int combine) {
+    emit_rr(a, 0, 0x0F90 | cc1, 0, RAX);
+    emit_rr(a, 0, 0x0F90 | cc2, 0, RCX);
+    emit_rr(a, 0, combine, RAX, RCX);
+    emit_rr(a, 0, 0x0FB6, RAX, RAX); // movzx eax, al
+}
+
+// Forward branch within the current template; returns its rel32 field for patch_here
+static uint32_t emit_jcc_forward(Assembler *a, int cc) {
+    emit8(a, 0x0F);
+    emit8(a, 0x80 | cc);
+    emit32(a, 0);
+    return (uint32_t)a->length - 4;
+}
+
+static uint32_t emit_jmp_forward(Assembler *a) {
+    emit8(a, 0xE9);
+    emit32(a, 0);
+    return (uint32_t)a->length - 4;
+}
+
+static void patch_here(Assembler *a, uint32_t at) {
+    patch32(a, at, (uint32_t)(a->length - (at + 4)));
+}
+
+static void add_fixup(Assembler *a, uint32_t at, int target) {
+    if (a->fixup_count == a->fixup_capacity) {
+        int capacity = a->fixup_capacity ? a->fixup_capacity * 2 : 64;
+        Fixup *grown = (Fixup*)realloc(a->fixups, sizeof(Fixup) * capacity);
+        if (!grown) { a->failed = 1; return; }
+        a->fixups = grown;
+        a->fixup_capacity = capacity;
+    }
+    a->fixups[a->fixup_count].at = at;
+    a->fixups[a->fixup_count].target = target;
+    a->fixup_count++;
+}
+
+// Branches to an instruction's code, or to the exit when target is the chunk's count
+static void emit_jcc_to(Assembler *a, int cc, int target) {
+    add_fixup(a, emit_jcc_forward(a, cc), target);
+}
+
+static void emit_jmp_to(Assembler *a, int target) {
+    add_fixup(a, emit_jmp_forward(a), target);
+}
+
+static SlowPath* begin_slow_path(Assembler *a, int index) {
+    if (a->slow_path_count == a->slow_path_capacity) {
+        int capacity = a->slow_path_capacity ? a->slow_path_capacity * 2 : 32;
+        SlowPath *grown = (SlowPath*)realloc(a->slow_paths, sizeof(SlowPath) * capacity);
+        if (!grown) { a->failed = 1; return NULL; }
+        a->slow_paths = grown;
+        a->slow_path_capacity = capacity;
+    }
+    SlowPath *slow = &a->slow_paths[a->slow_path_count++];
+    slow->index = index;
+    slow->branch_count = 0;
+    slow->resume = 0;
+    return slow;
+}
+
+// Guard: leave the inline code for the slow path when cc holds
+static void emit_guard(Assembler *a, SlowPath *slow, int cc) {
+    if (!slow || slow->branch_count == MAX_SLOW_BRANCHES) { a->failed = 1; return; }
+    slow->branches[slow->branch_count++] = emit_jcc_forward(a, cc);
+}
+
+static void emit_guard_always(Assembler *a, SlowPath *slow) {
+    if (!slow || slow->branch_count == MAX_SLOW_BRANCHES) { a->failed = 1; return; }
+    slow->branches[slow->branch_count++] = emit_jmp_forward(a);
+}
+
+static void end_slow_path(Assembler *a, SlowPath *slow) {
+    if (slow) slow->resume = (uint32_t)a->length;
+}
+
+// Slow path when the type in reg is reference counted (VALUE_IS_REFCOUNTED)
+static void emit_guard_unboxed(Assembler *a, SlowPath *slow, int reg) {
+    emit_cmp_reg32_imm(a, reg, VAL_STRING);
+    emit_guard(a, slow, CC_E);
+    emit_cmp_reg32_imm(a, reg, VAL_ARRAY);
+    emit_guard(a, slow, CC_AE);
+}
+
+// Calls vm_execute_instruction(state, ins) and acts on its ExecResult; falls through
+// on EXEC_NEXT
+static void emit_execute_instruction(Assembler *a, int index) {
+    const Instruction *ins = &a->chunk->code[index];
+    emit_store64(a, REG_STATE, offsetof(ExecState, sp), REG_SP);
+    emit_rr(a, 1, 0x89, REG_STATE, RDI);
+    emit_mov_reg64_imm(a, RSI, (uint64_t)(uintptr_t)ins);
+    emit_mov_reg64_imm(a, RAX, (uint64_t)(uintptr_t)&vm_execute_instruction);
+    emit_rr(a, 0, 0xFF, 2, RAX); // call rax
+    emit_load64(a, REG_SP, REG_STATE, offsetof(ExecState, sp));
+    switch (ins->op) {
+        case OP_JUMP:
+            emit_jmp_to(a, ins->operand);
+            break;
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_TRUE:
+        case OP_JUMP_IF_FALSE_BOOL:
+        case OP_JUMP_IF_TRUE_BOOL:
+            emit_cmp_reg32_imm(a, RAX, EXEC_JUMP);
+            emit_jcc_to(a, CC_E, ins->operand);
+            break;
+        case OP_TAIL_CALL:
+            emit_cmp_reg32_imm(a, RAX, EXEC_RESTART);
+            emit_jcc_to(a, CC_E, 0);
+            emit_jmp_to(a, a->chunk->count);
+            break;
+        case OP_EXEC_AST:
+            emit_cmp_reg32_imm(a, RAX, EXEC_RETURN);
+            emit_jcc_to(a, CC_E, a->chunk->count);
+            break;
+        case OP_RETURN:
+        case OP_HALT:
+            emit_jmp_to(a, a->chunk->count);
+            break;
+        default:
+            break;
+    }
+}
+
+// Loads the number at [REG_SP + disp] into xmm, converting an int; anything else
+// takes the slow path. type_reg holds its type.
+static void emit_load_number(Assembler *a, SlowPath *slow, int xmm, int type_reg, int32_t disp) {
+    emit_cmp_reg32_imm(a, type_reg, VAL_DOUBLE);
+    uint32_t not_double = emit_jcc_forward(a, CC_NE);
+    emit_sse_rm(a, 0xF2, 0, 0x0F10, xmm, REG_SP, disp + VALUE_BITS); // movsd
+    uint32_t loaded = emit_jmp_forward(a);
+    patch_here(a, not_double);
+    emit_cmp_reg32_imm(a, type_reg, VAL_INT);
+    emit_guard(a, slow, CC_NE);
+    emit_sse_rm(a, 0xF2, 1, 0x0F2A, xmm, REG_SP, disp + VALUE_BITS); // cvtsi2sd
+    patch_here(a, loaded);
+}
+
+// Loads an operand of proven type (OP_BINARY_DOUBLE) at [REG_SP + disp] into xmm as a double
+static void emit_load_proven_number(Assembler *a, SlowPath *slow, int xmm, StaticType type, int32_t disp) {
+    if (type == STATIC_DOUBLE) {
+        emit_sse_rm(a, 0xF2, 0, 0x0F10, xmm, REG_SP, disp + VALUE_BITS); // movsd
+    } else if (type == STATIC_INT) {
+        emit_sse_rm(a, 0xF2, 1, 0x0F2A, xmm, REG_SP, disp + VALUE_BITS); // cvtsi2sd
+    } else {
+        emit_load32(a, RAX, REG_SP, disp + VALUE_TYPE);
+        emit_load_number(a, slow, xmm, RAX, disp);
+    }
+}
+
+// Pops two operands and pushes the result of op: int/int and int/double pairs inline,
+// with the same results as evaluate_int_binary_operator and evaluate_double_binary_operator.
+// OP_BINARY_INT and OP_BINARY_DOUBLE have proven operand types, so only their half is
+// emitted, without the type checks.
+static void emit_binary(Assembler *a, int index, BinaryOperator op) {
+    const int32_t left = -2 * (int32_t)sizeof(Value), right = -(int32_t)sizeof(Value);
+    const Instruction *ins = &a->chunk->code[index];
+    SlowPath *slow = begin_slow_path(a, index);
+    int result_type = VAL_INT;
+    uint32_t not_int = 0, not_int_right = 0, int_done = 0;
+
+    if (ins->op != OP_BINARY_DOUBLE) {
+        if (ins->op == OP_BINARY) {
+            emit_load32(a, RAX, REG_SP, left + VALUE_TYPE);
+            emit_load32(a, RCX, REG_SP, right + VALUE_TYPE);
+            emit_cmp_reg32_imm(a, RAX, VAL_INT);
+            not_int = emit_jcc_forward(a, CC_NE);
+            emit_cmp_reg32_imm(a, RCX, VAL_INT);
+            not_int_right = emit_jcc_forward(a, CC_NE);
+        }
+        emit_load64(a, RAX, REG_SP, left + VALUE_BITS);
+        emit_load64(a, RCX, REG_SP, right + VALUE_BITS);
+        switch (op) {
+            case BINOP_ADD: emit_rr(a, 1, 0x03, RAX, RCX); break;
+            case BINOP_SUB: emit_rr(a, 1, 0x2B, RAX, RCX); break;
+            case BINOP_MUL: emit_rr(a, 1, 0x0FAF, RAX, RCX); break;
+            case BINOP_DIV:
+            case BINOP_MOD:
+                // Division by 0 or -1 and inexact quotients take the slow path
+                emit_rr(a, 1, 0x85, RCX, RCX);
+                emit_guard(a, slow, CC_E);
+                emit_cmp_reg64_imm(a, RCX, -1);
+                emit_guard(a, slow, CC_E);
+                emit8(a, 0x48); emit8(a, 0x99); // cqo
+                emit_rr(a, 1, 0xF7, 7, RCX);    // idiv rcx
+                if (op == BINOP_DIV) {
+                    emit_rr(a, 1, 0x85, RDX, RDX);
+                    emit_guard(a, slow, CC_NE);
+                } else {
+                    emit_rr(a, 1, 0x8B, RAX, RDX);
+                }
+                break;
+            case BINOP_SHL: emit_rr(a, 1, 0xD3, 4, RAX); break; // The CPU masks the count to 6 bits
+            case BINOP_SHR: emit_rr(a, 1, 0xD3, 7, RAX); break;
+            case BINOP_EQ: case BINOP_NE: case BINOP_LT: case BINOP_GT: case BINOP_LE: case BINOP_GE: {
+                static const int conditions[] = { CC_E, CC_NE, CC_L, CC_G, CC_LE, CC_GE };
+                emit_rr(a, 1, 0x3B, RAX, RCX);
+                emit_setcc_al(a, conditions[op - BINOP_EQ]);
+                result_type = VAL_BOOL;
+                break;
+            }
+            case BINOP_AND:
+            case BINOP_OR:
+                emit_rr(a, 1, 0x85, RAX, RAX);
+                emit_rr(a, 0, 0x0F95, 0, RAX); // setne al
+                emit_rr(a, 1, 0x85, RCX, RCX);
+                emit_rr(a, 0, 0x0F95, 0, RCX); // setne cl
+                emit_rr(a, 0, op == BINOP_AND ? 0x22 : 0x0A, RAX, RCX);
+                emit_rr(a, 0, 0x0FB6, RAX, RAX);
+                result_type = VAL_BOOL;
+                break;
+            default:
+                emit_guard_always(a, slow);
+                break;
+        }
+        emit_mov_mem32_imm(a, REG_SP, left + VALUE_TYPE, result_type);
+        emit_store64(a, REG_SP, left + VALUE_BITS, RAX);
+        if (ins->op == OP_BINARY) {
+            int_done = emit_jmp_forward(a);
+            // At least one operand is not an int
+            patch_here(a, not_int);
+            patch_here(a, not_int_right);
+        }
+    }
+    if (ins->op != OP_BINARY_INT) {
+        result_type = VAL_DOUBLE;
+        switch (op) {
+            case BINOP_ADD: case BINOP_SUB: case BINOP_MUL: case BINOP_DIV:
+            case BINOP_EQ: case BINOP_NE: case BINOP_LT: case BINOP_GT: case BINOP_LE: case BINOP_GE:
+                if (ins->op == OP_BINARY_DOUBLE) {
+                    emit_load_proven_number(a, slow, 0, ins->node->left->static_type, left);
+                    emit_load_proven_number(a, slow, 1, ins->node->right->static_type, right);
+                } else {
+                    emit_load_number(a, slow, 0, RAX, left);
+                    emit_load_number(a, slow, 1, RCX, right);
+                }
+                break;
+            default:
+                emit_guard_always(a, slow); // Only numbers with an inline double form
+                break;
+        }
+        switch (op) {
+            case BINOP_ADD: emit_sse_rr(a, 0xF2, 0x0F58, 0, 1); break;
+            case BINOP_SUB: emit_sse_rr(a, 0xF2, 0x0F5C, 0, 1); break;
+            case BINOP_MUL: emit_sse_rr(a, 0xF2, 0x0F59, 0, 1); break;
+            case BINOP_DIV:
+                emit_sse_rr(a, 0x66, 0x0F57, 2, 2); // xorpd xmm2, xmm2
+                emit_sse_rr(a, 0x66, 0x0F2E, 1, 2); // ucomisd xmm1, xmm2: zero (or NaN) divisors take the slow path
+                emit_guard(a, slow, CC_E);
+                emit_sse_rr(a, 0xF2, 0x0F5E, 0, 1);
+                break;
+            // ucomisd sets ZF, PF and CF when either side is NaN: the ordered conditions
+            // (a, ae) and the parity flag keep every comparison with NaN false but !=
+            case BINOP_EQ: emit_sse_rr(a, 0x66, 0x0F2E, 0, 1); emit_setcc_pair(a, CC_E, CC_NP, 0x22); result_type = VAL_BOOL; break;
+            case BINOP_NE: emit_sse_rr(a, 0x66, 0x0F2E, 0, 1); emit_setcc_pair(a, CC_NE, CC_P, 0x0A); result_type = VAL_BOOL; break;
+            case BINOP_LT: emit_sse_rr(a, 0x66, 0x0F2E, 1, 0); emit_setcc_al(a, CC_A); result_type = VAL_BOOL; break;
+            case BINOP_GT: emit_sse_rr(a, 0x66, 0x0F2E, 0, 1); emit_setcc_al(a, CC_A); result_type = VAL_BOOL; break;
+            case BINOP_LE: emit_sse_rr(a, 0x66, 0x0F2E, 1, 0); emit_setcc_al(a, CC_AE); result_type = VAL_BOOL; break;
+            case BINOP_GE: emit_sse_rr(a, 0x66, 0x0F2E, 0, 1); emit_setcc_al(a, CC_AE); result_type = VAL_BOOL; break;
+            default: break;
+        }
+        emit_mov_mem32_imm(a, REG_SP, left + VALUE_TYPE, result_type);
+        if (result_type == VAL_DOUBLE) emit_sse_rm(a, 0xF2, 0, 0x0F11, 0, REG_SP, left + VALUE_BITS);
+        else emit_store64(a, REG_SP, left + VALUE_BITS, RAX);
+    }
+
+    if (ins->op == OP_BINARY) patch_here(a, int_done);
+    emit_add_reg64_imm(a, REG_SP, -(int32_t)sizeof(Value));
+    end_slow_path(a, slow);
+}
+
+static void emit_instruction(Assembler *a, int index) {
+    const Instruction *ins = &a->chunk->code[index];
+    const int32_t top = -(int32_t)sizeof(Value);
+    SlowPath *slow;
+    switch (ins->op) {
+        case OP_CONSTANT: {
+            Value constant = a->chunk->constants[ins->operand];
+            if (VALUE_IS_REFCOUNTED(constant)) break;
+            uint64_t bits;
+            memcpy(&bits, &constant.as, sizeof(bits));
+            emit_mov_mem32_imm(a, REG_SP, VALUE_TYPE, constant.type);
+            emit_mov_reg64_imm(a, RAX, bits);
+            emit_store64(a, REG_SP, VALUE_BITS, RAX);
+            emit_add_reg64_imm(a, REG_SP, sizeof(Value));
+            return;
+        }
+        case OP_POP:
+            slow = begin_slow_path(a, index);
+            emit_load32(a, RAX, REG_SP, top + VALUE_TYPE);
+            emit_guard_unboxed(a, slow, RAX);
+            emit_add_reg64_imm(a, REG_SP, top);
+            end_slow_path(a, slow);
+            return;
+        case OP_LOAD_LOCAL:
+        case OP_LOAD_GLOBAL: {
+            int base = ins->op == OP_LOAD_LOCAL ? REG_SLOTS : REG_GLOBALS;
+            slow = begin_slow_path(a, index);
+            emit_load64(a, RAX, base, SLOT(ins->operand) + VALUE_TYPE);
+            emit_guard_unboxed(a, slow, RAX);
+            emit_load64(a, RCX, base, SLOT(ins->operand) + VALUE_BITS);
+            emit_store64(a, REG_SP, VALUE_TYPE, RAX);
+            emit_store64(a, REG_SP, VALUE_BITS, RCX);
+            emit_add_reg64_imm(a, REG_SP, sizeof(Value));
+            end_slow_path(a, slow);
+            return;
+        }
+        case OP_STORE_LOCAL:
+        case OP_STORE_GLOBAL: {
+            int base = ins->op == OP_STORE_LOCAL ? REG_SLOTS : REG_GLOBALS;
+            slow = begin_slow_path(a, index);
+            emit_load32(a, RAX, base, SLOT(ins->operand) + VALUE_TYPE);
+            emit_guard_unboxed(a, slow, RAX);
+            emit_load64(a, RAX, REG_SP, top + VALUE_TYPE);
+            emit_guard_unboxed(a, slow, RAX);
+            emit_load64(a, RCX, REG_SP, top + VALUE_BITS);
+            emit_store64(a, base, SLOT(ins->operand) + VALUE_TYPE, RAX);
+            emit_store64(a, base, SLOT(ins->operand) + VALUE_BITS, RCX);
+            end_slow_path(a, slow);
+            return;
+        }
+        case OP_INCREMENT_LOCAL:
+        case OP_INCREMENT_GLOBAL: {
+            int base = ins->op == OP_INCREMENT_LOCAL ? REG_SLOTS : REG_GLOBALS;
+            slow = begin_slow_path(a, index);
+            emit_cmp_mem32_imm(a, base, SLOT(ins->operand) + VALUE_TYPE, VAL_INT);
+            emit_guard(a, slow, CC_NE);
+            emit_add_mem64_imm(a, base, SLOT(ins->operand) + VALUE_BITS, (int32_t)INCREMENT_DELTA(ins->node));
+            end_slow_path(a, slow);
+            return;
+        }
+        case OP_INCREMENT:
+            slow = begin_slow_path(a, index);
+            emit_cmp_mem32_imm(a, REG_SP, top + VALUE_TYPE, VAL_INT);
+            emit_guard(a, slow, CC_NE);
+            emit_add_mem64_imm(a, REG_SP, top + VALUE_BITS, ins->operand);
+            end_slow_path(a, slow);
+            return;
+        case OP_BINARY:
+        case OP_BINARY_INT:
+        case OP_BINARY_DOUBLE:
+            emit_binary(a, index, (BinaryOperator)ins->operand);
+            return;
+        case OP_JUMP:
+            if (ins->operand <= index) {
+                // Loop back-edge: a pending collection runs in the VM's safe point
+                slow = begin_slow_path(a, index);
+                emit_mov_reg64_imm(a, RAX, (uint64_t)(uintptr_t)vm_gc_pending_flag());
+                emit_cmp_mem32_imm(a, RAX, 0, 0);
+                emit_guard(a, slow, CC_NE);
+                end_slow_path(a, slow);
+            }
+            emit_jmp_to(a, ins->operand);
+            return;
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_TRUE:
+            slow = begin_slow_path(a, index);
+            emit_cmp_mem32_imm(a, REG_SP, top + VALUE_TYPE, VAL_BOOL);
+            emit_guard(a, slow, CC_NE);
+            emit_add_reg64_imm(a, REG_SP, top);
+            emit_cmp_mem32_imm(a, REG_SP, VALUE_BITS, 0);
+            emit_jcc_to(a, ins->op == OP_JUMP_IF_TRUE ? CC_NE : CC_E, ins->operand);
+            end_slow_path(a, slow);
+            return;
+        case OP_JUMP_IF_FALSE_BOOL:
+        case OP_JUMP_IF_TRUE_BOOL:
+            emit_add_reg64_imm(a, REG_SP, top);
+            emit_cmp_mem32_imm(a, REG_SP, VALUE_BITS, 0);
+            emit_jcc_to(a, ins->op == OP_JUMP_IF_TRUE_BOOL ? CC_NE : CC_E, ins->operand);
+            return;
+        case OP_RETURN:
+            emit_load64(a, RAX, REG_SP, top + VALUE_TYPE);
+            emit_load64(a, RCX, REG_SP, top + VALUE_BITS);
+            emit_store64(a, REG_STATE, offsetof(ExecState, result) + VALUE_TYPE, RAX);
+            emit_store64(a, REG_STATE, offsetof(ExecState, result) + VALUE_BITS, RCX);
+            emit_add_reg64_imm(a, REG_SP, top);
+            emit_jmp_to(a, a->chunk->count);
+            return;
+        case OP_HALT:
+            emit_jmp_to(a, a->chunk->count);
+            return;
+        default:
+            break;
+    }
+    emit_execute_instruction(a, index);
+}
+
+static void write_perf_map(const BytecodeChunk *chunk, const void *code, size_t size) {
+    if (!perf_map_enabled) return;
+    if (!perf_map) {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/perf-%ld.map", (long)getpid());
+        perf_map = fopen(path, "w");
+        if (!perf_map) { perf_map_enabled = 0; return; }
+    }
+    fprintf(perf_map, "%lx %lx ouro:%s\n", (unsigned long)(uintptr_t)code, (unsigned long)size, chunk->name);
+    fflush(perf_map);
+}
+
+// Entry: rdi = ExecState*, rsi = address of the instruction to start at
+static void emit_prologue(Assembler *a) {
+    emit8(a, 0x55);                                  // push rbp
+    emit_rr(a, 1, 0x89, RSP, RBP);                   // mov rbp, rsp
+    emit8(a, 0x53);                                  // push rbx
+    emit8(a, 0x41); emit8(a, 0x54);                  // push r12
+    emit8(a, 0x41); emit8(a, 0x55);                  // push r13
+    emit8(a, 0x41); emit8(a, 0x56);                  // push r14; rsp is 16-byte aligned again
+    emit_rr(a, 1, 0x89, RDI, REG_STATE);
+    emit_load64(a, REG_SP, REG_STATE, offsetof(ExecState, sp));
+    emit_load64(a, REG_SLOTS, REG_STATE, offsetof(ExecState, slots));
+    emit_load64(a, REG_GLOBALS, REG_STATE, offsetof(ExecState, globals));
+    emit_rr(a, 0, 0xFF, 4, RSI);                     // jmp rsi
+}
+
+static void emit_epilogue(Assembler *a) {
+    emit_store64(a, REG_STATE, offsetof(ExecState, sp), REG_SP);
+    emit8(a, 0x41); emit8(a, 0x5E);                  // pop r14
+    emit8(a, 0x41); emit8(a, 0x5D);                  // pop r13
+    emit8(a, 0x41); emit8(a, 0x5C);                  // pop r12
+    emit8(a, 0x5B);                                  // pop rbx
+    emit8(a, 0x5D);                                  // pop rbp
+    emit8(a, 0xC3);                                  // ret
+}
+
+static struct JitCode* assemble(BytecodeChunk *chunk) {
+    Assembler a;
+    memset(&a, 0, sizeof(a));
+    a.chunk = chunk;
+    a.labels = (uint32_t*)calloc((size_t)chunk->count + 1, sizeof(uint32_t));
+    if (!a.labels) return NULL;
+
+    emit_prologue(&a);
+    for (int i = 0; i < chunk->count; i++) {
+        a.labels[i] = (uint32_t)a.length;
+        emit_instruction(&a, i);
+    }
+    a.labels[chunk->count] = (uint32_t)a.length;
+    emit_epilogue(&a);
+
+    // Slow paths go after the function body, off the straight-line code
+    for (int i = 0; i < a.slow_path_count; i++) {
+        SlowPath *slow = &a.slow_paths[i];
+        for (int j = 0; j < slow->branch_count; j++) patch_here(&a, slow->branches[j]);
+        emit_execute_instruction(&a, slow->index);
+        emit8(&a, 0xE9);
+        emit32(&a, (uint32_t)(slow->resume - (a.length + 4)));
+    }
+    for (int i = 0; i < a.fixup_count; i++) {
+        patch32(&a, a.fixups[i].at, a.labels[a.fixups[i].target] - (a.fixups[i].at + 4));
+    }
+
+    struct JitCode *native = NULL;
+    if (!a.failed) native = (struct JitCode*)calloc(1, sizeof(struct JitCode));
+    if (native) {
+        // Written while writable, then flipped to executable: never both at once
+        long page_size = sysconf(_SC_PAGESIZE);
+        size_t page = page_size > 0 ? (size_t)page_size : 4096;
+        native->mapped_size = (a.length + page - 1) / page * page;
+        void *code = mmap(NULL, native->mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (code != MAP_FAILED) {
+            memcpy(code, a.buf, a.length);
+            if (mprotect(code, native->mapped_size, PROT_READ | PROT_EXEC) == 0) {
+                native->code = (unsigned char*)code;
+                native->entries = a.labels;
+                a.labels = NULL;
+                write_perf_map(chunk, code, a.length);
+            } else {
+                munmap(code, native->mapped_size);
+            }
+        }
+        if (!native->code) { free(native); native = NULL; }
+    }
+    free(a.buf);
+    free(a.labels);
+    free(a.fixups);
+    free(a.slow_paths);
+    return native;
+}
+
+int jit_compile(BytecodeChunk *chunk) {
+    if (chunk->native) return 1;
+    if (!chunk->jit_failed) chunk->native = assemble(chunk);
+    if (!chunk->native) chunk->jit_failed = 1;
+    return chunk->native != NULL;
+}
+
+void jit_execute(BytecodeChunk *chunk, ExecState *state, int entry) {
+    typedef void (*NativeEntry)(ExecState *state, const void *start);
+    struct JitCode *native = chunk->native;
+    NativeEntry run;
+    void *code = native->code;
+    memcpy(&run, &code, sizeof(run)); // ISO C has no object-to-function pointer cast
+    run(state, native->code + native->entries[entry]);
+}
+
+#else
+
+int jit_compile(BytecodeChunk *chunk) {
+    chunk->jit_failed = 1;
+    return 0;
+}
+
+void jit_execute(BytecodeChunk *chunk, ExecState *state, int entry) {
+    (void)chunk; (void)state; (void)entry;
+}
+
+#endif
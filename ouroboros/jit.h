@@ -0,0 +1,47 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "ir.h"
+#include "stack.h"
+
+// Template JIT. A chunk that gets hot in run_bytecode (enough runs, or enough loop
+// back-edges) is translated instruction by instruction into x86-64 machine code.
+// Compiled code works on the interpreter's own operand stack and frame slots, so it
+// can be entered at any instruction: from the top on a call, or at a loop header
+// while the interpreter is partway through the chunk. Numbers, bools, local and
+// global slots, jumps and increments are handled inline; every other opcode and
+// operand type calls vm_execute_instruction, so both engines share one definition
+// of the semantics. Only System V x86-64 is supported; elsewhere jit_available()
+// is 0 and every chunk stays interpreted.
+
+// Execution state of one run of a chunk, shared by run_bytecode and compiled code
+typedef struct ExecState {
+    Value *sp;          // Operand stack top; in memory whenever vm_execute_instruction runs
+    Value *stack;       // Operand stack base
+    Value *slots;       // frame->slots
+    Value *globals;     // frame->globals->slots
+    StackFrame *frame;
+    BytecodeChunk *chunk;
+    struct GcStackRoots *roots; // The operand stack's GC root record
+    Value result;       // What the chunk returns, once an instruction yields EXEC_RETURN
+} ExecState;
+
+typedef enum {
+    EXEC_NEXT,     // Continue with the following instruction
+    EXEC_JUMP,     // Continue at ins->operand
+    EXEC_RESTART,  // Continue at the first instruction (self tail call)
+    EXEC_RETURN    // Leave the chunk with state->result
+} ExecResult;
+
+// Provided by vm.c
+ExecResult vm_execute_instruction(ExecState *state, const Instruction *ins);
+const int* vm_gc_pending_flag(void); // Nonzero once a collection is due at the next safe point
+
+int jit_available(void);
+int jit_compile(BytecodeChunk *chunk); // Sets chunk->native; on failure sets chunk->jit_failed and returns 0
+void jit_execute(BytecodeChunk *chunk, ExecState *state, int entry); // Runs compiled code from instruction entry
+void jit_free_code(struct JitCode *code);
+void jit_set_perf_map_enabled(int enabled); // Describe compiled code in /tmp/perf-<pid>.map for perf (-perf-map)
+void jit_shutdown(void);
+
+#endif // JIT_H
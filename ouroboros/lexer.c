@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include "lexer.h"
+#include "intern.h"
 
 // --- Globals for string lexing ---
 static const char* current_source_string = NULL;
@@ -101,10 +102,18 @@ static int is_lexer_keyword(const char *text) {
     return 0;
 }
 
-static Token get_next_token_from_string() {
+// Token under construction; its text is interned once the token is complete
+typedef struct ScannedToken {
+    TokenType type;
+    char text[256];
+    int line;
+    int col;
+} ScannedToken;
+
+static ScannedToken scan_next_token() {
     skip_whitespace_and_comments_string();
 
-    Token tok = { TOKEN_EOF, "", current_line_lex, current_col_lex };
+    ScannedToken tok = { TOKEN_EOF, "", current_line_lex, current_col_lex };
     int c = string_getc_lex();
 
     if (c == EOF) return tok;
@@ -299,6 +308,12 @@ static Token get_next_token_from_string() {
     return tok;
 }
 
+static Token get_next_token_from_string() {
+    ScannedToken scanned = scan_next_token();
+    Token tok = { scanned.type, intern(scanned.text), scanned.line, scanned.col };
+    return tok;
+}
+
 
 Token* lex(const char* source) {
     current_source_string = source;
@@ -17,7 +17,7 @@ typedef enum {
 
 typedef struct Token {
     TokenType type;
-    char text[256]; // Increased buffer size for longer identifiers/strings
+    const char *text; // Interned (intern.h)
     int line;
     int col;
 } Token;
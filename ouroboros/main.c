@@ -9,6 +9,11 @@
 #include "vm.h"        // For vm_init, run_vm, vm_cleanup
 #include "stdlib.h"    // For register_stdlib_functions
 #include "module.h"    // For module_manager_init/cleanup, if used directly
+#include "ir.h"        // For generate_ir (bytecode dump)
+#include "intern.h"    // For intern_table_free
+#include "jit.h"       // For jit_set_perf_map_enabled
+#include "aot.h"       // For aot_emit_c
+#include "ssa.h"       // For generate_ssa (SSA dump)
 
 // Function to read file content into a string
 char* read_file_to_string(const char* filename) {
@@ -46,7 +51,9 @@ char* read_file_to_string(const char* filename) {
 int main(int argc, char *argv[]) {
     if (argc < 2) {
         printf("Usage: %s <filename.ouro> [options...]\n", argv[0]);
-        // Example options: -print-tokens, -print-ast, -no-optimize, -no-run
+        // Example options: -print-tokens, -print-ast, -print-ir, -print-bytecode, -print-opt, -no-optimize, -no-run,
+        // -bytecode (default) / -ast to pick the execution engine, -jit (default) / -no-jit,
+        // -perf-map, -gc-stats, -emit-c <out.c> to compile the program to C instead of running it
         return 1;
     }
     
@@ -54,13 +61,31 @@ int main(int argc, char *argv[]) {
     int print_tokens_flag = 0;
     int print_ast_flag = 0;
     int no_optimize_flag = 0;
+    int print_opt_flag = 0;
     int no_run_flag = 0;
+    int print_ir_flag = 0;
+    int print_bytecode_flag = 0;
+    int use_bytecode_flag = 1;
+    int gc_stats_flag = 0;
+    int jit_flag = 1;
+    int perf_map_flag = 0;
+    const char* emit_c_path = NULL;
 
     for (int i = 2; i < argc; ++i) {
         if (strcmp(argv[i], "-print-tokens") == 0) print_tokens_flag = 1;
         else if (strcmp(argv[i], "-print-ast") == 0) print_ast_flag = 1;
         else if (strcmp(argv[i], "-no-optimize") == 0) no_optimize_flag = 1;
+        else if (strcmp(argv[i], "-print-opt") == 0) print_opt_flag = 1;
         else if (strcmp(argv[i], "-no-run") == 0) no_run_flag = 1;
+        else if (strcmp(argv[i], "-print-ir") == 0) print_ir_flag = 1;
+        else if (strcmp(argv[i], "-print-bytecode") == 0) print_bytecode_flag = 1;
+        else if (strcmp(argv[i], "-bytecode") == 0) use_bytecode_flag = 1;
+        else if (strcmp(argv[i], "-ast") == 0) use_bytecode_flag = 0;
+        else if (strcmp(argv[i], "-gc-stats") == 0) gc_stats_flag = 1;
+        else if (strcmp(argv[i], "-jit") == 0) jit_flag = 1;
+        else if (strcmp(argv[i], "-no-jit") == 0) jit_flag = 0;
+        else if (strcmp(argv[i], "-perf-map") == 0) perf_map_flag = 1;
+        else if (strcmp(argv[i], "-emit-c") == 0 && i + 1 < argc) emit_c_path = argv[++i];
     }
 
     char* source_code = read_file_to_string(filename);
@@ -111,6 +136,7 @@ int main(int argc, char *argv[]) {
         printf("\n\n===============================\n");
         printf("==== OPTIMIZATION STARTING ====\n");
         printf("===============================\n\n");
+        optimize_set_print_opt_enabled(print_opt_flag);
         optimize_ast(ast_root);
         printf("\n==== OPTIMIZATION COMPLETE ====\n\n");
         if (print_ast_flag) {
@@ -121,11 +147,31 @@ int main(int argc, char *argv[]) {
         printf("\n==== Optimization Skipped ====\n");
     }
     
+    if (print_ir_flag) {
+        generate_ssa(ast_root, !no_optimize_flag);
+    }
+
+    if (print_bytecode_flag) {
+        generate_ir(ast_root);
+    }
+    
+    // --- Ahead-of-time compilation: write C instead of running ---
+    int exit_status = 0;
+    if (emit_c_path) {
+        if (aot_emit_c(ast_root, filename, emit_c_path)) printf("\n==== Wrote C translation to '%s' ====\n", emit_c_path);
+        else exit_status = 1;
+        no_run_flag = 1;
+    }
+
     // --- Execution (VM) ---
     if (!no_run_flag) {
         module_manager_init(); // Initialize module system if used by VM or stdlib
         register_stdlib_functions(); // Make standard library functions available to the VM
         
+        vm_set_bytecode_enabled(use_bytecode_flag);
+        vm_set_jit_enabled(jit_flag);
+        jit_set_perf_map_enabled(perf_map_flag);
+        vm_set_gc_stats_enabled(gc_stats_flag);
         vm_init();    // Initialize VM state
         run_vm(ast_root); // Execute the AST
         vm_cleanup(); // Clean up VM state
@@ -136,9 +182,11 @@ int main(int argc, char *argv[]) {
     }
 
     // --- Cleanup ---
+    optimize_cleanup();
     free_ast(ast_root);
     free(source_code);
+    intern_table_free(); // Node values and token text point into the table
 
     printf("\nCompilation and execution pipeline finished.\n");
-    return 0;
+    return exit_status;
 }
\ No newline at end of file
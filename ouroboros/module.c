@@ -1,3 +1,6 @@
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE // For strdup under -std=c99
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -216,7 +219,7 @@ Module* module_load(const char *module_name) {
     program = prev_program;
 
     // Analyze the module
-    analyze_program(module->ast);
+    analyze_module(module->ast);
     
     free(source);
     
@@ -330,6 +333,14 @@ ASTNode* compile_multiple_files(char **filenames, int file_count) {
                 cloned->is_void = func->is_void;
                 cloned->is_array = func->is_array;
                 cloned->array_size = func->array_size;
+                // The body's variables were resolved to slots of the original node
+                if (func->local_count > 0) {
+                    cloned->local_names = (const char**)malloc(sizeof(char*) * func->local_count);
+                    if (cloned->local_names) {
+                        memcpy(cloned->local_names, func->local_names, sizeof(char*) * func->local_count);
+                        cloned->local_count = func->local_count;
+                    }
+                }
                 
                 // Add to root's function list
                 if (!root->left) {
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "name_table.h"
+
+#define NAME_TABLE_INITIAL_CAPACITY 16
+
+static size_t name_table_index(const NameTable *table, const char *name, const char *scope) {
+    uint64_t h = ((uint64_t)(uintptr_t)name ^ ((uint64_t)(uintptr_t)scope << 17)) * UINT64_C(0x9E3779B97F4A7C15);
+    return (size_t)(h >> 32) & (table->capacity - 1);
+}
+
+static NameSlot* name_table_find(const NameTable *table, const char *name, const char *scope) {
+    size_t mask = table->capacity - 1;
+    for (size_t i = name_table_index(table, name, scope);; i = (i + 1) & mask) {
+        NameSlot *slot = &table->slots[i];
+        if (!slot->name || (slot->name == name && slot->scope == scope)) return slot;
+    }
+}
+
+void* name_table_get(const NameTable *table, const char *name, const char *scope) {
+    if (!table->count || !name) return NULL;
+    return name_table_find(table, name, scope)->value;
+}
+
+void name_table_set(NameTable *table, const char *name, const char *scope, void *value) {
+    if ((table->count + 1) * 2 > table->capacity) {
+        NameSlot *old_slots = table->slots;
+        size_t old_capacity = table->capacity;
+        table->capacity = old_capacity ? old_capacity * 2 : NAME_TABLE_INITIAL_CAPACITY;
+        table->slots = (NameSlot*)calloc(table->capacity, sizeof(NameSlot));
+        if (!table->slots) {
+            fprintf(stderr, "Error: Memory allocation failed growing name table to %zu slots\n", table->capacity);
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old_slots[i].name) *name_table_find(table, old_slots[i].name, old_slots[i].scope) = old_slots[i];
+        }
+        free(old_slots);
+    }
+    NameSlot *slot = name_table_find(table, name, scope);
+    if (!slot->name) {
+        slot->name = name;
+        slot->scope = scope;
+        table->count++;
+    }
+    slot->value = value;
+}
+
+void name_table_free(NameTable *table) {
+    free(table->slots);
+    table->slots = NULL;
+    table->count = table->capacity = 0;
+}
+
+int name_set_has(const NameSet *set, const char *name) {
+    return name_table_get(set, name, NULL) != NULL;
+}
+
+void name_set_add(NameSet *set, const char *name) {
+    if (name) name_table_set(set, name, NULL, (void*)name);
+}
+
+void name_set_free(NameSet *set) {
+    name_table_free(set);
+}
@@ -0,0 +1,31 @@
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+
+#include <stddef.h>
+
+// Hash table keyed by interned name pointers (intern.h), plus an optional interned
+// scope (the class of a method). Open addressing, linear probing, at most half full.
+typedef struct NameSlot {
+    const char *name; // NULL for an empty slot
+    const char *scope;
+    void *value;
+} NameSlot;
+
+typedef struct NameTable {
+    NameSlot *slots;
+    size_t count;
+    size_t capacity; // A power of two
+} NameTable;
+
+void* name_table_get(const NameTable *table, const char *name, const char *scope); // NULL if absent
+void name_table_set(NameTable *table, const char *name, const char *scope, void *value);
+void name_table_free(NameTable *table);
+
+// A set of interned names: a table of the names themselves, with no scope
+typedef NameTable NameSet;
+
+int name_set_has(const NameSet *set, const char *name);
+void name_set_add(NameSet *set, const char *name);
+void name_set_free(NameSet *set);
+
+#endif // NAME_TABLE_H
@@ -1,78 +1,3053 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
+#include <math.h>
 #include "optimize.h"
 // #include "parser.h" // No longer needed if ast_types.h is included by optimize.h
 #include "ast_types.h" // For node_type_to_string and ASTNode structure
+#include "intern.h"
+#include "name_table.h"
+#include "eval.h" // For the runtime's operator semantics
+#include "ssa.h"
+
+// Constant propagation and folding over the analyzed AST, before it is compiled.
+// Calls to small functions are first inlined (see Inlining, below), and objects that
+// never leave the function that makes them are replaced with locals (see Escape analysis).
+//
+// Operators on literals are folded with the runtime's own operator code, so a folded
+// expression has exactly the value it would have had at run time. Slot variables
+// (semantic.c) are followed through each body in execution order: once a literal is
+// stored, reads of the variable become that literal until it is written again. Facts
+// do not survive a join with a path that writes the variable, a loop that writes it,
+// or a call when some function writes that global. Globals declared once, with a
+// literal, before any top-level code runs are known inside every function. An if or
+// ?: whose condition folds keeps only the branch taken. Folding can expose more
+// constants (a folded initializer makes a global constant), so the pass repeats
+// until nothing changes. Loops are then rewritten once (see Loops, below), each body
+// goes through the SSA passes (see SSA), dead code is removed (see Dead code), and
+// the types slot variables always hold are proven for the bytecode compiler (see
+// Static types).
+
+#define OPTIMIZE_MAX_ROUNDS 8
+#define FOLD_STRING_LIMIT 4096 // Longer folded strings are left to the runtime
+
+// What is known about one slot variable at a point in the program
+typedef struct ConstFact {
+    VariableScope scope;   // VAR_LOCAL or VAR_GLOBAL
+    int slot;
+    const char *text;      // Interned text of the literal it holds (NULL in write sets)
+    const char *data_type; // The literal's data_type: "int", "float", "bool" or "string"
+} ConstFact;
+
+typedef struct ConstEnv {
+    ConstFact *facts;
+    int count;
+    int capacity;
+} ConstEnv;
+
+static ConstEnv global_constants; // Globals known on entry to every function
+static ConstEnv function_writes;  // Globals some function writes: unknown after any call
+static int changes;               // Rewrites made in the current round
+
+static void optimize_expression(ASTNode **link, ConstEnv *env);
+static void optimize_statement(ASTNode **link, ConstEnv *env, int in_list);
+static void optimize_statement_list(ASTNode **link, ConstEnv *env);
+static void optimize_function(ASTNode *func_node);
+
+// --- Fact sets ---
+
+static int env_find(const ConstEnv *env, VariableScope scope, int slot) {
+    for (int i = 0; i < env->count; i++) {
+        if (env->facts[i].slot == slot && env->facts[i].scope == scope) return i;
+    }
+    return -1;
+}
+
+static void env_set(ConstEnv *env, VariableScope scope, int slot, const char *text, const char *data_type) {
+    int i = env_find(env, scope, slot);
+    if (i < 0) {
+        if (env->count == env->capacity) {
+            int new_capacity = env->capacity ? env->capacity * 2 : 16;
+            ConstFact *grown = (ConstFact*)realloc(env->facts, sizeof(ConstFact) * new_capacity);
+            if (!grown) {
+                fprintf(stderr, "Fatal Error: Could not allocate constant propagation state.\n");
+                exit(EXIT_FAILURE);
+            }
+            env->facts = grown;
+            env->capacity = new_capacity;
+        }
+        i = env->count++;
+        env->facts[i].scope = scope;
+        env->facts[i].slot = slot;
+    }
+    env->facts[i].text = text;
+    env->facts[i].data_type = data_type;
+}
+
+static void env_remove(ConstEnv *env, VariableScope scope, int slot) {
+    int i = env_find(env, scope, slot);
+    if (i >= 0) env->facts[i] = env->facts[--env->count];
+}
+
+static void env_remove_all(ConstEnv *env, const ConstEnv *writes) {
+    for (int i = 0; i < writes->count && env->count > 0; i++) env_remove(env, writes->facts[i].scope, writes->facts[i].slot);
+}
+
+static void env_add_slots(ConstEnv *writes, const ConstEnv *slots) {
+    for (int i = 0; i < slots->count; i++) env_set(writes, slots->facts[i].scope, slots->facts[i].slot, NULL, NULL);
+}
+
+static void env_copy(ConstEnv *dest, const ConstEnv *src) {
+    dest->facts = NULL;
+    dest->count = dest->capacity = 0;
+    for (int i = 0; i < src->count; i++) {
+        env_set(dest, src->facts[i].scope, src->facts[i].slot, src->facts[i].text, src->facts[i].data_type);
+    }
+}
+
+// Keeps the facts of env that also hold in other: the state where two paths join
+static void env_intersect(ConstEnv *env, const ConstEnv *other) {
+    for (int i = env->count - 1; i >= 0; i--) {
+        int j = env_find(other, env->facts[i].scope, env->facts[i].slot);
+        if (j < 0 || other->facts[j].text != env->facts[i].text ||
+            strcmp(other->facts[j].data_type, env->facts[i].data_type) != 0) {
+            env->facts[i] = env->facts[--env->count];
+        }
+    }
+}
+
+static void env_free(ConstEnv *env) {
+    free(env->facts);
+    env->facts = NULL;
+    env->count = env->capacity = 0;
+}
+
+// --- Literals ---
+
+static int is_slot_variable(ASTNode *node) {
+    return node->var_scope == VAR_LOCAL || node->var_scope == VAR_GLOBAL;
+}
+
+static int is_assignment_operator(const char *op) {
+    return strcmp(op, "=") == 0 || strcmp(op, "+=") == 0 || strcmp(op, "-=") == 0 ||
+           strcmp(op, "*=") == 0 || strcmp(op, "/=") == 0 || strcmp(op, "%=") == 0;
+}
+
+static int is_increment(ASTNode *node) {
+    return strcmp(node->value, "++") == 0 || strcmp(node->value, "--") == 0;
+}
+
+static int is_function_node(ASTNode *node) {
+    return node->type == AST_FUNCTION || node->type == AST_TYPED_FUNCTION || node->type == AST_CLASS_METHOD;
+}
+
+// The data_type of a literal the pass can compute with, or NULL (null, or not a literal)
+static const char* literal_type(ASTNode *node) {
+    if (!node || node->type != AST_LITERAL) return NULL;
+    if (strcmp(node->data_type, "int") == 0) return "int";
+    if (strcmp(node->data_type, "float") == 0) return "float";
+    if (strcmp(node->data_type, "bool") == 0) return "bool";
+    if (strcmp(node->data_type, "string") == 0) return "string";
+    return NULL;
+}
+
+// A literal decodes exactly as the runtime decodes it; the caller releases the value
+static Value literal_node_value(ASTNode *node) {
+    return evaluate_expression(node, NULL);
+}
+
+static int literal_is_truthy(ASTNode *node) {
+    Value v = literal_node_value(node);
+    int truthy = value_is_truthy(v);
+    value_release(v);
+    return truthy;
+}
+
+// Turns node into a literal with the given text, dropping its operands
+static void set_literal(ASTNode *node, const char *text, const char *data_type) {
+    free_ast(node->left);
+    free_ast(node->right);
+    node->left = NULL;
+    node->right = NULL;
+    if (node->has_literal_value) value_release(node->literal_value);
+    node->has_literal_value = 0;
+    node->literal_value = value_undefined();
+    node->type = AST_LITERAL;
+    node->value = intern(text);
+    node->var_scope = VAR_UNRESOLVED;
+    node->var_slot = -1;
+    strncpy(node->data_type, data_type, sizeof(node->data_type) - 1);
+    node->data_type[sizeof(node->data_type) - 1] = '\0';
+    changes++;
+}
+
+// Shortest text that reads back as d, with a '.' or an exponent so it stays a float
+static int format_double(double d, char *buf, size_t size) {
+    if (!isfinite(d)) return 0; // No literal spelling; left to the runtime
+    for (int precision = 15; precision <= 17; precision++) {
+        snprintf(buf, size, "%.*g", precision, d);
+        if (strtod(buf, NULL) == d) break;
+    }
+    if (!strpbrk(buf, ".e")) strncat(buf, ".0", size - strlen(buf) - 1);
+    return 1;
+}
+
+// Replaces node with a literal holding v (borrowed); 0 if v has no literal form
+static int set_value_literal(ASTNode *node, Value v) {
+    char text[64];
+    switch (v.type) {
+        case VAL_INT:
+            snprintf(text, sizeof(text), "%" PRId64, v.as.integer);
+            set_literal(node, text, "int");
+            break;
+        case VAL_DOUBLE:
+            if (!format_double(v.as.number, text, sizeof(text))) return 0;
+            set_literal(node, text, "float");
+            break;
+        case VAL_BOOL:
+            set_literal(node, v.as.boolean ? "true" : "false", "bool");
+            break;
+        case VAL_STRING:
+            if (v.as.string->length > FOLD_STRING_LIMIT) return 0;
+            set_literal(node, ouro_string_chars(v.as.string), "string");
+            break;
+        default:
+            return 0; // Undefined results (e.g. "a" - 1) stay where the runtime produces them
+    }
+    return 1;
+}
+
+static int make_literal(ASTNode *node, Value v) {
+    if (!set_value_literal(node, v)) return 0;
+    printf("[OPT] Folded constant: %s at L%d:%d (New type: %s)\n", node->value, node->line, node->col, node->data_type);
+    return 1;
+}
+
+// --- Folding ---
+
+// Folds node in place when it is an operator whose operands are literals; 1 if it did
+static int fold_operator(ASTNode *node) {
+    if (node->type == AST_UNARY_OP) {
+        if (!literal_type(node->left)) return 0;
+        Value operand = literal_node_value(node->left);
+        Value result = value_undefined();
+        if (strcmp(node->value, "!") == 0) result = value_bool(!value_is_truthy(operand));
+        else if (strcmp(node->value, "-") == 0 && value_is_number(operand)) result = evaluate_negate(node, operand);
+        value_release(operand);
+        int folded = make_literal(node, result);
+        value_release(result);
+        return folded;
+    }
+
+    if (node->type != AST_BINARY_OP || !literal_type(node->left) || !literal_type(node->right)) return 0;
+    if (strcmp(node->value, "&&") == 0 || strcmp(node->value, "||") == 0) {
+        // Both engines short-circuit on truthiness, whatever the operand types
+        int left_truthy = literal_is_truthy(node->left), right_truthy = literal_is_truthy(node->right);
+        return make_literal(node, value_bool(node->value[0] == '&' ? left_truthy && right_truthy : left_truthy || right_truthy));
+    }
+    BinaryOperator op = binary_operator_from_string(node->value);
+    if (op == BINOP_UNKNOWN) return 0; // Assignments and operators the runtime leaves to eval.c
+
+    Value l_val = literal_node_value(node->left);
+    Value r_val = literal_node_value(node->right);
+    int folded = 0;
+    if ((op == BINOP_DIV || op == BINOP_MOD) && value_is_number(l_val) && value_is_number(r_val) && value_as_double(r_val) == 0) {
+        // Left for the runtime, which reports it when (and if) the expression runs; noted
+        // once, however many rounds see it again
+        if (!node->fold_reported) {
+            fprintf(stderr, "[OPT L%d:%d] Error: %s by zero during constant folding: %s %s %s \n", node->line, node->col,
+                    op == BINOP_DIV ? "Division" : "Modulus", node->left->value, node->value, node->right->value);
+            node->fold_reported = 1;
+        }
+    } else {
+        Value result = evaluate_binary_operator(op, l_val, r_val);
+        folded = make_literal(node, result);
+        value_release(result);
+    }
+    value_release(l_val);
+    value_release(r_val);
+    return folded;
+}
 
 void constant_fold(ASTNode *node) {
+    if (!node || (node->type != AST_BINARY_OP && node->type != AST_UNARY_OP)) return;
+    constant_fold(node->left);
+    constant_fold(node->right);
+    fold_operator(node);
+}
+
+// Comparisons, negations and logical operators always produce a bool
+static int is_boolean_expression(ASTNode *node) {
+    if (node->type == AST_LITERAL) return literal_type(node) && strcmp(node->data_type, "bool") == 0;
+    if (node->type == AST_UNARY_OP) return strcmp(node->value, "!") == 0;
+    if (node->type != AST_BINARY_OP) return 0;
+    if (strcmp(node->value, "&&") == 0 || strcmp(node->value, "||") == 0) return 1;
+    BinaryOperator op = binary_operator_from_string(node->value);
+    return op >= BINOP_EQ && op <= BINOP_GE;
+}
+
+// --- Writes ---
+
+// The slot node a node stores into: declarations, parameters, assignment and ++/-- targets
+static ASTNode* write_target(ASTNode *node) {
+    switch (node->type) {
+        case AST_VAR_DECL: case AST_TYPED_VAR_DECL: case AST_PARAMETER:
+            return node;
+        case AST_ASSIGN:
+            return node->left;
+        case AST_BINARY_OP:
+            return is_assignment_operator(node->value) ? node->left : NULL;
+        case AST_UNARY_OP:
+            return is_increment(node) ? node->left : NULL;
+        default:
+            return NULL;
+    }
+}
+
+// Adds every slot variable node may write to writes, counting what calls can write
+static void collect_writes(ASTNode *node, ConstEnv *writes) {
     if (!node) return;
+    ASTNode *target = write_target(node);
+    if (target && is_slot_variable(target)) env_set(writes, target->var_scope, target->var_slot, NULL, NULL);
+    if (node->type == AST_CALL || node->type == AST_NEW) env_add_slots(writes, &function_writes);
+    for (ASTNode *child = node->left; child; child = child->next) collect_writes(child, writes);
+    for (ASTNode *child = node->right; child; child = child->next) collect_writes(child, writes);
+    // The false branch of ?: and the else of an if hang off ->next
+    if (node->type == AST_TERNARY || (node->type == AST_IF && node->next && node->next->type == AST_ELSE)) {
+        collect_writes(node->next, writes);
+    }
+}
 
-    // Fold children first, unless this node itself will become a literal
-    // (in which case its children will be detached and freed).
-    if (node->type != AST_BINARY_OP) { 
-      if (node->left) constant_fold(node->left);
-      if (node->right) constant_fold(node->right);
-    } else { 
-        if (node->left && node->left->type != AST_LITERAL) constant_fold(node->left);
-        if (node->right && node->right->type != AST_LITERAL) constant_fold(node->right);
-    }
-
-
-    if (node->type == AST_BINARY_OP) {
-        if (node->left && node->right &&
-            node->left->type == AST_LITERAL &&
-            node->right->type == AST_LITERAL) {
-
-            int l_val = atoi(node->left->value);
-            int r_val = atoi(node->right->value);
-            int result = 0;
-            int folded = 1; 
-
-            if (strcmp(node->value, "+") == 0) result = l_val + r_val;
-            else if (strcmp(node->value, "-") == 0) result = l_val - r_val;
-            else if (strcmp(node->value, "*") == 0) result = l_val * r_val;
-            else if (strcmp(node->value, "/") == 0) {
-                if (r_val != 0) result = l_val / r_val;
-                else {
-                    fprintf(stderr, "[OPT L%d:%d] Error: Division by zero during constant folding: %s / %s \n", node->line, node->col, node->left->value, node->right->value);
-                    folded = 0; 
-                }
+// Counts the writes of each global slot in the whole program, and records the
+// globals written inside function bodies
+static void count_global_writes(ASTNode *node, int in_function, int *write_counts, int global_count) {
+    for (; node; node = node->next) {
+        ASTNode *target = write_target(node);
+        if (target && target->var_scope == VAR_GLOBAL && target->var_slot >= 0 && target->var_slot < global_count) {
+            write_counts[target->var_slot]++;
+            if (in_function) env_set(&function_writes, VAR_GLOBAL, target->var_slot, NULL, NULL);
+        }
+        int body_in_function = in_function || is_function_node(node);
+        count_global_writes(node->left, body_in_function, write_counts, global_count);
+        count_global_writes(node->right, body_in_function, write_counts, global_count);
+    }
+}
+
+// A global is constant everywhere when its only write is a top-level declaration
+// with a literal, and nothing but declarations comes before it: no code, and so no
+// function, can have run before it is set
+static void find_global_constants(ASTNode *program_node) {
+    global_constants.count = 0;
+    function_writes.count = 0;
+    int global_count = program_node->local_count;
+    int *write_counts = (int*)calloc(global_count > 0 ? global_count : 1, sizeof(int));
+    if (!write_counts) return;
+    count_global_writes(program_node->left, 0, write_counts, global_count);
+
+    for (ASTNode *stmt = program_node->left; stmt; stmt = stmt->next) {
+        if (stmt->type == AST_FUNCTION || stmt->type == AST_TYPED_FUNCTION || stmt->type == AST_CLASS ||
+            stmt->type == AST_STRUCT || stmt->type == AST_IMPORT) continue;
+        if (stmt->type != AST_VAR_DECL && stmt->type != AST_TYPED_VAR_DECL) break;
+        if (!stmt->right) continue;
+        const char *type = literal_type(stmt->right);
+        if (!type) break; // The initializer runs code
+        if (stmt->var_scope == VAR_GLOBAL && stmt->var_slot >= 0 && stmt->var_slot < global_count &&
+            write_counts[stmt->var_slot] == 1) {
+            env_set(&global_constants, VAR_GLOBAL, stmt->var_slot, stmt->right->value, type);
+        }
+    }
+    free(write_counts);
+}
+
+// --- Expressions ---
+
+static void propagate_identifier(ASTNode *node, ConstEnv *env) {
+    if (!is_slot_variable(node)) return;
+    int i = env_find(env, node->var_scope, node->var_slot);
+    if (i < 0) return;
+    const char *name = node->value;
+    set_literal(node, env->facts[i].text, env->facts[i].data_type);
+    printf("[OPT] Propagated constant: %s = %s at L%d:%d\n", name, node->value, node->line, node->col);
+}
+
+// Records what a store of value_node into target leaves known
+static void record_store(ASTNode *target, ASTNode *value_node, ConstEnv *env) {
+    if (!is_slot_variable(target)) return;
+    const char *type = literal_type(value_node);
+    if (type) env_set(env, target->var_scope, target->var_slot, value_node->value, type);
+    else env_remove(env, target->var_scope, target->var_slot);
+}
+
+// An expression that runs only on some paths: it sees the facts of this point, and
+// whatever it may write is unknown afterwards
+static void optimize_conditional(ASTNode **link, ConstEnv *env) {
+    if (!*link) return;
+    ConstEnv writes = {0}, branch;
+    collect_writes(*link, &writes);
+    env_copy(&branch, env);
+    optimize_expression(link, &branch);
+    env_remove_all(env, &writes);
+    env_free(&branch);
+    env_free(&writes);
+}
+
+// Expressions whose evaluation order is not modelled (member and index access,
+// array and map literals, new): each part sees only the facts that hold before the
+// whole expression and that nothing in it can change
+static void optimize_opaque(ASTNode *node, ConstEnv *env) {
+    ConstEnv writes = {0};
+    collect_writes(node, &writes);
+    env_remove_all(env, &writes);
+    env_free(&writes);
+    if (node->type == AST_MAP) {
+        // Keys are property names; only the values are expressions
+        for (ASTNode *pair = node->left; pair; pair = pair->next) {
+            ConstEnv part;
+            env_copy(&part, env);
+            optimize_expression(&pair->right, &part);
+            env_free(&part);
+        }
+        return;
+    }
+    for (int side = 0; side < 2; side++) {
+        for (ASTNode **link = side ? &node->right : &node->left; *link; link = &(*link)->next) {
+            ConstEnv part;
+            env_copy(&part, env);
+            optimize_expression(link, &part);
+            env_free(&part);
+        }
+    }
+}
+
+static void optimize_logical(ASTNode **link, ConstEnv *env) {
+    ASTNode *node = *link;
+    int is_and = node->value[0] == '&';
+    optimize_expression(&node->left, env);
+    if (!literal_type(node->left)) {
+        optimize_conditional(&node->right, env);
+        return;
+    }
+    int left_truthy = literal_is_truthy(node->left);
+    if (left_truthy != is_and) { // Decided by the left operand; the right one never runs
+        make_literal(node, value_bool(left_truthy));
+        return;
+    }
+    // The result is the truthiness of the right operand, which now always runs
+    optimize_expression(&node->right, env);
+    if (fold_operator(node) || !is_boolean_expression(node->right)) return;
+    ASTNode *right = node->right;
+    right->next = node->next;
+    node->right = NULL;
+    node->next = NULL;
+    free_ast(node);
+    *link = right;
+    changes++;
+}
+
+static void optimize_ternary(ASTNode **link, ConstEnv *env) {
+    ASTNode *node = *link;
+    optimize_expression(&node->left, env);
+    if (!literal_type(node->left) || !node->right || !node->next) {
+        optimize_conditional(&node->right, env);
+        optimize_conditional(&node->next, env);
+        return;
+    }
+
+    int truthy = literal_is_truthy(node->left);
+    ASTNode *false_branch = node->next;
+    ASTNode *rest = false_branch->next; // Whatever followed the whole expression
+    ASTNode *taken = truthy ? node->right : false_branch;
+    ASTNode *not_taken = truthy ? false_branch : node->right;
+    false_branch->next = NULL;
+    node->right = NULL;
+    node->next = NULL;
+    free_ast(not_taken);
+    printf("[OPT] Pruned ?: at L%d:%d: condition is always %s\n", node->line, node->col, truthy ? "true" : "false");
+    free_ast(node); // And its condition
+
+    ASTNode *tail = taken;
+    while (tail->next) tail = tail->next;
+    tail->next = rest;
+    *link = taken;
+    changes++;
+    optimize_expression(link, env);
+}
+
+static void optimize_expression(ASTNode **link, ConstEnv *env) {
+    ASTNode *node = *link;
+    if (!node) return;
+
+    switch (node->type) {
+        case AST_LITERAL:
+            return;
+
+        case AST_IDENTIFIER:
+            propagate_identifier(node, env);
+            return;
+
+        case AST_BINARY_OP:
+            if (is_assignment_operator(node->value)) {
+                if (!node->left || node->left->type != AST_IDENTIFIER) break;
+                optimize_expression(&node->right, env);
+                if (node->value[0] == '=') record_store(node->left, node->right, env);
+                else if (is_slot_variable(node->left)) env_remove(env, node->left->var_scope, node->left->var_slot);
+                return;
+            }
+            if (strcmp(node->value, "&&") == 0 || strcmp(node->value, "||") == 0) {
+                optimize_logical(link, env);
+                return;
+            }
+            optimize_expression(&node->left, env);
+            optimize_expression(&node->right, env);
+            fold_operator(node);
+            return;
+
+        case AST_UNARY_OP:
+            if (is_increment(node)) {
+                if (!node->left || node->left->type != AST_IDENTIFIER) break;
+                if (is_slot_variable(node->left)) env_remove(env, node->left->var_scope, node->left->var_slot);
+                return;
+            }
+            optimize_expression(&node->left, env);
+            fold_operator(node);
+            return;
+
+        case AST_TERNARY:
+            optimize_ternary(link, env);
+            return;
+
+        case AST_CALL:
+            // The receiver, then the arguments in order; the callee may write any global a function writes
+            optimize_expression(&node->right, env);
+            for (ASTNode **arg = &node->left; *arg; arg = &(*arg)->next) optimize_expression(arg, env);
+            env_remove_all(env, &function_writes);
+            return;
+
+        case AST_FUNCTION: case AST_TYPED_FUNCTION: case AST_CLASS_METHOD:
+            optimize_function(node);
+            return;
+
+        default:
+            break;
+    }
+    optimize_opaque(node, env);
+}
+
+// --- Statements ---
+
+// Replaces an if whose condition is constant by the branch it takes; 0 if it has to stay
+static int prune_if(ASTNode **link, int truthy, int in_list) {
+    ASTNode *node = *link;
+    ASTNode *else_node = node->next && node->next->type == AST_ELSE ? node->next : NULL;
+    ASTNode *rest = else_node ? else_node->next : node->next;
+    ASTNode *taken = truthy ? node->right : (else_node ? else_node->left : NULL);
+    // A branch is a single statement, but an if keeps its own else in ->next
+    if (taken && taken->next && !(taken->type == AST_IF && taken->next->type == AST_ELSE && !taken->next->next)) return 0;
+
+    if (truthy) node->right = NULL;
+    else if (else_node) else_node->left = NULL;
+    if (else_node) else_node->next = NULL;
+    node->next = NULL;
+    printf("[OPT] Pruned if at L%d:%d: condition is always %s\n", node->line, node->col, truthy ? "true" : "false");
+    if (!taken && !in_list) taken = create_node(AST_BLOCK, "block", node->line, node->col); // A body can't be empty
+    free_ast(node); // The condition and the branch not taken
+    free_ast(else_node);
+
+    if (taken) {
+        ASTNode *tail = taken;
+        while (tail->next) tail = tail->next;
+        tail->next = rest;
+        *link = taken;
+    } else {
+        *link = rest;
+    }
+    changes++;
+    return 1;
+}
+
+// A single statement in a branch or loop body
+static void optimize_body(ASTNode **link, ConstEnv *env) {
+    ASTNode *node;
+    do {
+        node = *link;
+        if (!node) return;
+        optimize_statement(link, env, 0);
+    } while (*link != node); // Replaced by a pruned if's branch: optimize that too
+}
+
+static void optimize_if(ASTNode **link, ConstEnv *env, int in_list) {
+    ASTNode *node = *link;
+    optimize_expression(&node->left, env);
+    if (literal_type(node->left) && prune_if(link, literal_is_truthy(node->left), in_list)) return;
+
+    ASTNode *else_node = node->next && node->next->type == AST_ELSE ? node->next : NULL;
+    ConstEnv else_env;
+    env_copy(&else_env, env);
+    optimize_body(&node->right, env);
+    if (else_node) optimize_body(&else_node->left, &else_env);
+    env_intersect(env, &else_env);
+    env_free(&else_env);
+}
+
+// Every iteration starts from the facts before the loop, minus what the loop writes;
+// the same facts hold after it
+static void optimize_loop(ASTNode *node, ConstEnv *env) {
+    ASTNode **cond = &node->left, **incr = NULL;
+    if (node->type == AST_FOR) {
+        // Control parts are positional, as the compiler reads them: init, condition, update
+        ASTNode *init = node->left;
+        if (init) {
+            if (init->type == AST_VAR_DECL || init->type == AST_TYPED_VAR_DECL) optimize_statement(&node->left, env, 0);
+            else optimize_expression(&node->left, env);
+        }
+        cond = node->left ? &node->left->next : NULL;
+        incr = cond && *cond ? &(*cond)->next : NULL;
+    }
+
+    ConstEnv writes = {0};
+    if (cond) collect_writes(*cond, &writes);
+    if (incr) collect_writes(*incr, &writes);
+    collect_writes(node->right, &writes);
+    env_remove_all(env, &writes);
+    env_free(&writes);
+
+    ConstEnv body_env;
+    env_copy(&body_env, env);
+    if (cond) optimize_expression(cond, &body_env);
+    optimize_body(&node->right, &body_env);
+    env_free(&body_env);
+    incr = node->type == AST_FOR && cond && *cond ? &(*cond)->next : NULL; // The condition may have been replaced
+    if (incr && *incr) {
+        env_copy(&body_env, env);
+        optimize_expression(incr, &body_env);
+        env_free(&body_env);
+    }
+}
+
+static void optimize_class(ASTNode *class_node) {
+    // Field initializers run on the constructing caller's frame: fold only
+    ConstEnv no_facts = {0};
+    for (ASTNode *member = class_node->left; member; member = member->next) {
+        if (is_function_node(member)) optimize_function(member);
+        else if (member->type == AST_CLASS_FIELD) optimize_expression(&member->left, &no_facts);
+        else if (member->type == AST_VAR_DECL || member->type == AST_TYPED_VAR_DECL) optimize_expression(&member->right, &no_facts);
+        no_facts.count = 0;
+    }
+    env_free(&no_facts);
+}
+
+static void optimize_statement(ASTNode **link, ConstEnv *env, int in_list) {
+    ASTNode *node = *link;
+
+    switch (node->type) {
+        case AST_BLOCK:
+            optimize_statement_list(&node->left, env);
+            return;
+
+        case AST_VAR_DECL: case AST_TYPED_VAR_DECL:
+            optimize_expression(&node->right, env);
+            if (node->right) record_store(node, node->right, env);
+            else if (is_slot_variable(node)) env_remove(env, node->var_scope, node->var_slot);
+            return;
+
+        case AST_ASSIGN:
+            if (node->left && node->left->type == AST_IDENTIFIER) {
+                optimize_expression(&node->right, env);
+                record_store(node->left, node->right, env);
             } else {
-                folded = 0; 
+                optimize_opaque(node, env);
+            }
+            return;
+
+        case AST_IF:
+            optimize_if(link, env, in_list);
+            return;
+
+        case AST_WHILE: case AST_FOR:
+            optimize_loop(node, env);
+            return;
+
+        case AST_FUNCTION: case AST_TYPED_FUNCTION: case AST_CLASS_METHOD:
+            optimize_function(node);
+            return;
+
+        case AST_CLASS:
+            optimize_class(node);
+            return;
+
+        case AST_STRUCT: case AST_IMPORT: case AST_ELSE: case AST_BREAK: case AST_CONTINUE:
+            return;
+
+        case AST_PRINT: case AST_RETURN:
+            optimize_expression(&node->left, env);
+            return;
+
+        default:
+            optimize_expression(link, env);
+            return;
+    }
+}
+
+static void optimize_statement_list(ASTNode **link, ConstEnv *env) {
+    while (*link) {
+        ASTNode *node = *link;
+        optimize_statement(link, env, 1);
+        if (*link != node) continue; // Replaced: optimize what took its place
+        link = &node->next;
+    }
+}
+
+// A function can be called whenever: only the program-wide constants hold on entry
+static void optimize_function(ASTNode *func_node) {
+    ConstEnv env;
+    env_copy(&env, &global_constants);
+    optimize_body(&func_node->right, &env);
+    env_free(&env);
+}
+
+// --- Loops ---
+//
+// Once the constants have settled, each while and for loop is rewritten in two steps.
+// Strength reduction: in a for loop that counts a variable i by a constant step, and
+// writes it nowhere else, repeated products i * k become a temporary advanced by
+// step * k at the top of every iteration. Code motion: the largest subexpressions
+// that read only slot variables the loop never writes are computed once, into
+// temporaries declared just before the loop. Nothing that can report an error is
+// moved out of code that might not run, and reads of arrays, maps and objects
+// (.length, pure builtins) are only moved out of loops that cannot change them.
+// Temporaries are extra slots of the enclosing function (or program) named
+// inv.<slot> and ind.<slot>, which no identifier can spell; -print-ast shows them.
+
+#define STRENGTH_REDUCTION_MIN_USES 2 // The update is one in-place increment on the bytecode engines
+
+enum { NOT_INVARIANT, INVARIANT, INVARIANT_MAY_FAIL };
+
+typedef struct LoopInfo {
+    ASTNode *loop;
+    ConstEnv writes;     // Slots written anywhere in the loop
+    int writes_memory;   // Has calls, new, or stores into arrays, maps and objects
+    ASTNode *temps;      // Declarations of the loop's temporaries, to go before it
+    ASTNode **temps_tail;
+} LoopInfo;
+
+// Builtins that only compute a result from their arguments
+static const char *const pure_builtins[] = { "to_string", "string_length", "string_concat" };
+#define PURE_BUILTIN_COUNT (int)(sizeof(pure_builtins) / sizeof(pure_builtins[0]))
+static int pure_builtin_usable[PURE_BUILTIN_COUNT]; // 0 when the program could call something else by that name
+
+static ASTNode *temp_owner;      // Function or program node whose frame holds the temporaries
+static VariableScope temp_scope; // VAR_LOCAL, or VAR_GLOBAL for the program
+
+// 1 if anything in the tree declares name, which would shadow a builtin
+static int declares_name(ASTNode *node, const char *name) {
+    for (; node; node = node->next) {
+        switch (node->type) {
+            case AST_FUNCTION: case AST_TYPED_FUNCTION: case AST_CLASS_METHOD: case AST_CLASS: case AST_STRUCT:
+            case AST_VAR_DECL: case AST_TYPED_VAR_DECL: case AST_PARAMETER:
+                if (node->value == name) return 1;
+                break;
+            case AST_IMPORT:
+                return 1; // Modules register functions of their own
+            default:
+                break;
+        }
+        if (declares_name(node->left, name) || declares_name(node->right, name)) return 1;
+    }
+    return 0;
+}
+
+static int is_pure_builtin_call(ASTNode *call) {
+    if (call->right) return 0; // Methods belong to the receiver
+    for (int i = 0; i < PURE_BUILTIN_COUNT; i++) {
+        if (strcmp(call->value, pure_builtins[i]) == 0) return pure_builtin_usable[i];
+    }
+    return 0;
+}
+
+// Clears the builtins a program could shadow with a name of its own
+static void find_pure_builtins(ASTNode *program_node) {
+    for (int i = 0; i < PURE_BUILTIN_COUNT; i++) {
+        pure_builtin_usable[i] = !declares_name(program_node->left, intern(pure_builtins[i]));
+    }
+}
+
+// Calls, new, and stores through anything but a slot variable may change any array,
+// map or object the loop reads
+static int writes_memory(ASTNode *node) {
+    for (; node; node = node->next) {
+        if (is_function_node(node)) continue; // Defined here, not run
+        ASTNode *target = NULL;
+        switch (node->type) {
+            case AST_CALL:
+                if (!is_pure_builtin_call(node)) return 1;
+                break;
+            case AST_NEW:
+                return 1;
+            case AST_ASSIGN:
+                target = node->left;
+                break;
+            case AST_BINARY_OP:
+                if (is_assignment_operator(node->value)) target = node->left;
+                break;
+            case AST_UNARY_OP:
+                if (is_increment(node)) target = node->left;
+                break;
+            default:
+                break;
+        }
+        if (target && !is_slot_variable(target)) return 1;
+        if (writes_memory(node->left) || writes_memory(node->right)) return 1;
+    }
+    return 0;
+}
+
+static int is_nonzero_number(ASTNode *node) {
+    const char *type = literal_type(node);
+    if (!type || (strcmp(type, "int") != 0 && strcmp(type, "float") != 0)) return 0;
+    Value v = literal_node_value(node);
+    int nonzero = value_as_double(v) != 0;
+    value_release(v);
+    return nonzero;
+}
+
+// Whether node has the same value on every iteration of the loop, and whether
+// computing it can report an error
+static int invariance(ASTNode *node, const LoopInfo *info) {
+    if (!node) return NOT_INVARIANT;
+    int result = INVARIANT;
+    switch (node->type) {
+        case AST_LITERAL:
+            return INVARIANT;
+
+        case AST_IDENTIFIER:
+            if (!is_slot_variable(node) || env_find(&info->writes, node->var_scope, node->var_slot) >= 0) return NOT_INVARIANT;
+            return INVARIANT;
+
+        case AST_UNARY_OP:
+            if (strcmp(node->value, "!") == 0) return invariance(node->left, info);
+            if (strcmp(node->value, "-") == 0) return invariance(node->left, info) ? INVARIANT_MAY_FAIL : NOT_INVARIANT; // Non-numbers
+            return NOT_INVARIANT;
+
+        case AST_BINARY_OP: {
+            if (is_assignment_operator(node->value)) return NOT_INVARIANT;
+            int is_logical = strcmp(node->value, "&&") == 0 || strcmp(node->value, "||") == 0;
+            BinaryOperator op = binary_operator_from_string(node->value);
+            if (!is_logical && op == BINOP_UNKNOWN) return NOT_INVARIANT;
+            int left = invariance(node->left, info), right = invariance(node->right, info);
+            if (!left || !right) return NOT_INVARIANT;
+            if (left == INVARIANT_MAY_FAIL || right == INVARIANT_MAY_FAIL) result = INVARIANT_MAY_FAIL;
+            if ((op == BINOP_DIV || op == BINOP_MOD) && !is_nonzero_number(node->right)) result = INVARIANT_MAY_FAIL;
+            return result;
+        }
+
+        case AST_MEMBER_ACCESS:
+            // Reports an error for targets that have no properties
+            if (info->writes_memory || !node->left || node->left->type == AST_THIS) return NOT_INVARIANT;
+            return invariance(node->left, info) ? INVARIANT_MAY_FAIL : NOT_INVARIANT;
+
+        case AST_CALL:
+            if (info->writes_memory || !is_pure_builtin_call(node)) return NOT_INVARIANT;
+            for (ASTNode *arg = node->left; arg; arg = arg->next) {
+                if (arg->type == AST_TERNARY) return NOT_INVARIANT;
+                int arg_invariance = invariance(arg, info);
+                if (!arg_invariance) return NOT_INVARIANT;
+                if (arg_invariance == INVARIANT_MAY_FAIL) result = INVARIANT_MAY_FAIL;
             }
+            return result;
+
+        default:
+            return NOT_INVARIANT;
+    }
+}
 
-            if (folded) {
-                free_ast(node->left); 
-                free_ast(node->right);
+// Structural equality of two invariant expressions
+static int same_expression(ASTNode *a, ASTNode *b) {
+    if (!a || !b) return a == b;
+    if (a->type != b->type || a->value != b->value) return 0;
+    if (a->type == AST_LITERAL && strcmp(a->data_type, b->data_type) != 0) return 0;
+    if (a->type == AST_IDENTIFIER && (a->var_scope != b->var_scope || a->var_slot != b->var_slot)) return 0;
+    if (!same_expression(a->right, b->right)) return 0;
+    if (a->type != AST_CALL) return same_expression(a->left, b->left);
+    for (a = a->left, b = b->left; a && b; a = a->next, b = b->next) {
+        if (!same_expression(a, b)) return 0;
+    }
+    return a == b;
+}
 
-                snprintf(node->value, sizeof(node->value), "%d", result); 
-                node->type = AST_LITERAL;
-                node->left = NULL; 
-                node->right = NULL;
-                
-                strncpy(node->data_type, "int", sizeof(node->data_type) - 1);
-                node->data_type[sizeof(node->data_type) - 1] = '\0';
+// Readable text of a small expression, for the report
+static void append_text(char *buf, size_t size, const char *text) {
+    size_t length = strlen(buf);
+    if (length + 1 < size) strncat(buf, text, size - length - 1);
+}
 
-                printf("[OPT] Folded constant: %d at L%d:%d (New type: %s)\n", result, node->line, node->col, node->data_type);
+static void append_expression(char *buf, size_t size, ASTNode *node, int nested) {
+    switch (node->type) {
+        case AST_LITERAL:
+            if (strcmp(node->data_type, "string") == 0) {
+                append_text(buf, size, "\"");
+                append_text(buf, size, node->value);
+                append_text(buf, size, "\"");
+            } else {
+                append_text(buf, size, node->value);
             }
+            return;
+        case AST_IDENTIFIER:
+            append_text(buf, size, node->value);
+            return;
+        case AST_UNARY_OP:
+            append_text(buf, size, node->value);
+            if (node->left) append_expression(buf, size, node->left, 1);
+            return;
+        case AST_BINARY_OP:
+            if (nested) append_text(buf, size, "(");
+            if (node->left) append_expression(buf, size, node->left, 1);
+            append_text(buf, size, " ");
+            append_text(buf, size, node->value);
+            append_text(buf, size, " ");
+            if (node->right) append_expression(buf, size, node->right, 1);
+            if (nested) append_text(buf, size, ")");
+            return;
+        case AST_MEMBER_ACCESS:
+            if (node->left) append_expression(buf, size, node->left, 1);
+            append_text(buf, size, ".");
+            append_text(buf, size, node->value);
+            return;
+        case AST_CALL:
+            append_text(buf, size, node->value);
+            append_text(buf, size, "(");
+            for (ASTNode *arg = node->left; arg; arg = arg->next) {
+                append_expression(buf, size, arg, 0);
+                if (arg->next) append_text(buf, size, ", ");
+            }
+            append_text(buf, size, ")");
+            return;
+        default:
+            append_text(buf, size, "...");
+            return;
+    }
+}
+
+// Declares a new temporary slot, named <prefix>.<slot>, in the current frame
+static ASTNode* new_temporary(const char *prefix, int line, int col) {
+    char name[96];
+    snprintf(name, sizeof(name), "%s.%d", prefix, temp_owner->local_count);
+    const char **grown = (const char**)realloc(temp_owner->local_names, sizeof(char*) * (temp_owner->local_count + 1));
+    if (!grown) {
+        fprintf(stderr, "Fatal Error: Could not allocate variable slot '%s' in '%s'.\n", name, temp_owner->value);
+        exit(EXIT_FAILURE);
+    }
+    temp_owner->local_names = grown;
+    temp_owner->local_names[temp_owner->local_count] = intern(name);
+
+    ASTNode *decl = create_node(AST_VAR_DECL, name, line, col);
+    decl->var_scope = temp_scope;
+    decl->var_slot = temp_owner->local_count++;
+    return decl;
+}
+
+// Puts the declarations decls..*decls_tail before the statement at *link, making the two a
+// block when the statement is not in a list; returns the link that now holds the first
+static ASTNode** insert_before_statement(ASTNode **link, int in_list, ASTNode *decls, ASTNode **decls_tail) {
+    ASTNode *stmt = *link;
+    if (!in_list) {
+        // A body holds one statement
+        ASTNode *block = create_node(AST_BLOCK, "block", stmt->line, stmt->col);
+        block->next = stmt->next;
+        stmt->next = NULL;
+        *link = block;
+        link = &block->left;
+    }
+    *decls_tail = stmt;
+    *link = decls;
+    return link;
+}
+
+// A temporary of the loop, initialized with init
+static ASTNode* declare_temporary(LoopInfo *info, const char *prefix, ASTNode *init) {
+    ASTNode *decl = new_temporary(prefix, info->loop->line, info->loop->col);
+    decl->right = init;
+    *info->temps_tail = decl;
+    info->temps_tail = &decl->next;
+    env_set(&info->writes, decl->var_scope, decl->var_slot, NULL, NULL);
+    return decl;
+}
+
+// Turns node, in place, into a read of the temporary decl declares
+static void set_temporary_read(ASTNode *node, ASTNode *decl) {
+    free_ast(node->left);
+    free_ast(node->right);
+    node->left = NULL;
+    node->right = NULL;
+    if (node->has_literal_value) value_release(node->literal_value);
+    node->has_literal_value = 0;
+    node->literal_value = value_undefined();
+    free(node->inline_cache);
+    node->inline_cache = NULL;
+    node->type = AST_IDENTIFIER;
+    node->value = decl->value;
+    node->data_type[0] = '\0';
+    node->op_code = -1;
+    node->op_is_assignment = 0;
+    node->var_scope = decl->var_scope;
+    node->var_slot = decl->var_slot;
+}
+
+static ASTNode* temporary_read(ASTNode *decl, int line, int col) {
+    ASTNode *node = create_node(AST_IDENTIFIER, decl->value, line, col);
+    node->var_scope = decl->var_scope;
+    node->var_slot = decl->var_slot;
+    return node;
+}
+
+// Moves the invariant expression at node into a temporary before the loop
+static void hoist(ASTNode *node, LoopInfo *info) {
+    char text[96] = "";
+    append_expression(text, sizeof(text), node, 0);
+    for (ASTNode *decl = info->temps; decl; decl = decl->next) {
+        if (decl->right && decl->right->type != AST_LITERAL && same_expression(decl->right, node)) {
+            set_temporary_read(node, decl); // Computed once already
+            printf("[OPT] Reused %s for %s at L%d:%d\n", decl->value, text, node->line, node->col);
+            return;
         }
     }
+
+    ASTNode *init = (ASTNode*)malloc(sizeof(ASTNode));
+    if (!init) {
+        fprintf(stderr, "Fatal Error: Could not allocate AST node for loop-invariant code motion.\n");
+        exit(EXIT_FAILURE);
+    }
+    *init = *node; // Takes over the operands, cached literal and inline cache
+    init->next = NULL;
+    node->left = node->right = NULL;
+    node->has_literal_value = 0;
+    node->map_key = value_undefined();
+    node->inline_cache = NULL;
+    ASTNode *decl = declare_temporary(info, "inv", init);
+    set_temporary_read(node, decl);
+    printf("[OPT] Hoisted loop-invariant %s at L%d:%d out of the loop at L%d:%d into %s\n",
+           text, init->line, init->col, info->loop->line, info->loop->col, decl->value);
 }
 
-void optimize_ast(ASTNode *root) {
-    if (!root) return;
-    
-    if (root->left) {
-        optimize_ast(root->left);
+static void hoist_from(ASTNode *node, LoopInfo *info, int always_runs);
+
+// A list of siblings; a ?: takes its false branch (its ->next) with it
+static void hoist_from_list(ASTNode *node, LoopInfo *info, int always_runs) {
+    for (; node; node = node->next) {
+        hoist_from(node, info, always_runs);
+        if (node->type == AST_TERNARY && node->next) node = node->next;
+    }
+}
+
+// Hoists the largest invariant subexpressions of node. always_runs is set where node
+// is computed whenever the loop is reached, so it may be moved even if it can fail.
+static void hoist_from(ASTNode *node, LoopInfo *info, int always_runs) {
+    if (!node || is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT) return;
+    int invariant = invariance(node, info);
+    if (invariant == INVARIANT || (invariant == INVARIANT_MAY_FAIL && always_runs)) {
+        if (node->type != AST_LITERAL && node->type != AST_IDENTIFIER) hoist(node, info);
+        return;
+    }
+    if (node->type == AST_TERNARY) {
+        hoist_from(node->left, info, always_runs);
+        hoist_from(node->right, info, 0);
+        hoist_from(node->next, info, 0);
+        return;
+    }
+    if (node->type == AST_BINARY_OP && (strcmp(node->value, "&&") == 0 || strcmp(node->value, "||") == 0)) {
+        hoist_from(node->left, info, always_runs);
+        hoist_from(node->right, info, 0);
+        return;
+    }
+    if (node->type == AST_MAP) {
+        for (ASTNode *pair = node->left; pair; pair = pair->next) hoist_from(pair->right, info, always_runs);
+        return;
+    }
+    hoist_from_list(node->left, info, always_runs);
+    hoist_from_list(node->right, info, always_runs);
+}
+
+// The slot a for loop's initializer sets to an int literal; 0 if it does something else
+static int induction_start(ASTNode *init, ASTNode **var, int64_t *start) {
+    ASTNode *target = NULL, *value = NULL;
+    if (init->type == AST_VAR_DECL || (init->type == AST_TYPED_VAR_DECL && strcmp(init->data_type, "int") == 0)) {
+        target = init;
+        value = init->right;
+    } else if (init->type == AST_BINARY_OP && strcmp(init->value, "=") == 0 && init->left && init->left->type == AST_IDENTIFIER) {
+        target = init->left;
+        value = init->right;
+    }
+    if (!target || !is_slot_variable(target) || !value || !literal_type(value) || strcmp(value->data_type, "int") != 0) return 0;
+    Value v = literal_node_value(value);
+    if (v.type != VAL_INT) return 0;
+    *var = target;
+    *start = v.as.integer;
+    return 1;
+}
+
+static int is_same_slot(ASTNode *node, ASTNode *var) {
+    return node && node->type == AST_IDENTIFIER && node->var_scope == var->var_scope && node->var_slot == var->var_slot;
+}
+
+// The int literal node holds, or 0
+static int int_literal(ASTNode *node, int64_t *n) {
+    if (!node || !literal_type(node) || strcmp(node->data_type, "int") != 0) return 0;
+    Value v = literal_node_value(node);
+    if (v.type != VAL_INT) return 0;
+    *n = v.as.integer;
+    return 1;
+}
+
+// The constant step of an update that only counts var: i++, i--, i += c, i -= c, i = i + c
+static int induction_step(ASTNode *incr, ASTNode *var, int64_t *step) {
+    if (incr->type == AST_UNARY_OP && is_increment(incr) && is_same_slot(incr->left, var)) {
+        *step = incr->value[0] == '+' ? 1 : -1;
+        return 1;
+    }
+    if (incr->type != AST_BINARY_OP || !is_same_slot(incr->left, var)) return 0;
+    int64_t c;
+    if ((strcmp(incr->value, "+=") == 0 || strcmp(incr->value, "-=") == 0) && int_literal(incr->right, &c)) {
+        *step = incr->value[0] == '+' ? c : (int64_t)(0 - (uint64_t)c);
+        return 1;
+    }
+    ASTNode *sum = incr->right;
+    if (strcmp(incr->value, "=") != 0 || !sum || sum->type != AST_BINARY_OP) return 0;
+    if (strcmp(sum->value, "+") == 0 && is_same_slot(sum->left, var) && int_literal(sum->right, &c)) *step = c;
+    else if (strcmp(sum->value, "+") == 0 && is_same_slot(sum->right, var) && int_literal(sum->left, &c)) *step = c;
+    else if (strcmp(sum->value, "-") == 0 && is_same_slot(sum->left, var) && int_literal(sum->right, &c)) *step = (int64_t)(0 - (uint64_t)c);
+    else return 0;
+    return 1;
+}
+
+static ASTNode* new_int_literal(int64_t n, ASTNode *at) {
+    char text[32];
+    snprintf(text, sizeof(text), "%" PRId64, n);
+    ASTNode *node = create_node(AST_LITERAL, text, at->line, at->col);
+    strcpy(node->data_type, "int");
+    return node;
+}
+
+typedef struct ProductList {
+    ASTNode **nodes;
+    int64_t *factors;
+    int count;
+    int capacity;
+} ProductList;
+
+// Collects the i * k and k * i (k an int literal) in the tree
+static void collect_products(ASTNode *node, ASTNode *var, ProductList *list) {
+    for (; node; node = node->next) {
+        if (is_function_node(node) || node->type == AST_CLASS) continue;
+        int64_t factor;
+        if (node->type == AST_BINARY_OP && strcmp(node->value, "*") == 0 &&
+            ((is_same_slot(node->left, var) && int_literal(node->right, &factor)) ||
+             (is_same_slot(node->right, var) && int_literal(node->left, &factor)))) {
+            if (list->count == list->capacity) {
+                int new_capacity = list->capacity ? list->capacity * 2 : 8;
+                ASTNode **nodes = (ASTNode**)realloc(list->nodes, sizeof(ASTNode*) * new_capacity);
+                int64_t *factors = nodes ? (int64_t*)realloc(list->factors, sizeof(int64_t) * new_capacity) : NULL;
+                if (!nodes || !factors) {
+                    fprintf(stderr, "Fatal Error: Could not allocate strength reduction state.\n");
+                    exit(EXIT_FAILURE);
+                }
+                list->nodes = nodes;
+                list->factors = factors;
+                list->capacity = new_capacity;
+            }
+            list->nodes[list->count] = node;
+            list->factors[list->count++] = factor;
+            continue; // Its operands are a variable and a literal
+        }
+        collect_products(node->left, var, list);
+        collect_products(node->right, var, list);
     }
-    if (root->right) {
-        optimize_ast(root->right);
+}
+
+// Runs stmt first in the loop body (body is a body slot)
+static void prepend_to_body(ASTNode **body, ASTNode *stmt) {
+    if (!*body || (*body)->type != AST_BLOCK) {
+        ASTNode *block = create_node(AST_BLOCK, "block", stmt->line, stmt->col);
+        block->left = *body;
+        *body = block;
     }
-    
-    constant_fold(root); 
+    stmt->next = (*body)->left;
+    (*body)->left = stmt;
+}
+
+static void reduce_strength(LoopInfo *info) {
+    ASTNode *loop = info->loop;
+    ASTNode *init = loop->left, *cond = init ? init->next : NULL, *incr = cond ? cond->next : NULL;
+    ASTNode *var;
+    int64_t start, step;
+    if (!incr || !loop->right || !induction_start(init, &var, &start) || !induction_step(incr, var, &step)) return;
+
+    ConstEnv writes = {0};
+    collect_writes(cond, &writes);
+    collect_writes(loop->right, &writes);
+    int written = env_find(&writes, var->var_scope, var->var_slot) >= 0;
+    env_free(&writes);
+    if (written) return;
 
-    if (root->next) {
-        optimize_ast(root->next);
+    ProductList products = {0};
+    collect_products(loop->right, var, &products);
+    for (int i = 0; i < products.count; i++) {
+        if (!products.nodes[i]) continue;
+        int64_t factor = products.factors[i];
+        int uses = 0;
+        for (int j = i; j < products.count; j++) {
+            if (products.nodes[j] && products.factors[j] == factor) uses++;
+        }
+        if (uses < STRENGTH_REDUCTION_MIN_USES) continue;
+
+        // The body first sees start * k: the temporary starts a step behind, and every
+        // entry to the body (after the update, continue included) advances it
+        Value behind = evaluate_int_binary_operator(BINOP_SUB, start, step);
+        Value initial = evaluate_int_binary_operator(BINOP_MUL, behind.as.integer, factor);
+        Value delta = evaluate_int_binary_operator(BINOP_MUL, step, factor);
+        ASTNode *decl = declare_temporary(info, "ind", new_int_literal(initial.as.integer, loop));
+
+        ASTNode *update = create_node(AST_BINARY_OP, "+=", loop->line, loop->col);
+        update->left = temporary_read(decl, loop->line, loop->col);
+        update->right = new_int_literal(delta.as.integer, loop);
+        prepend_to_body(&loop->right, update);
+
+        char text[96] = "";
+        append_expression(text, sizeof(text), products.nodes[i], 0);
+        for (int j = i; j < products.count; j++) {
+            if (!products.nodes[j] || products.factors[j] != factor) continue;
+            set_temporary_read(products.nodes[j], decl);
+            products.nodes[j] = NULL;
+        }
+        printf("[OPT] Strength-reduced %s (%d uses) in the loop at L%d:%d to %s += %s\n",
+               text, uses, loop->line, loop->col, decl->value, update->right->value);
     }
-}
\ No newline at end of file
+    free(products.nodes);
+    free(products.factors);
+}
+
+static ASTNode** optimize_loops_in_statement(ASTNode **link, int in_list);
+
+// Rewrites the loop at *link and the loops inside it; returns the link that now holds it
+static ASTNode** move_loop_invariants(ASTNode **link, int in_list) {
+    ASTNode *loop = *link;
+    LoopInfo info = { loop, {0}, 0, NULL, NULL };
+    info.temps_tail = &info.temps;
+    collect_writes(loop, &info.writes);
+    info.writes_memory = writes_memory(loop->left) || writes_memory(loop->right);
+
+    if (loop->type == AST_FOR) reduce_strength(&info);
+    ASTNode *cond = loop->type == AST_FOR ? (loop->left ? loop->left->next : NULL) : loop->left;
+    hoist_from(cond, &info, 1); // Computed at least once whenever the loop is reached
+    if (loop->type == AST_FOR && cond) hoist_from(cond->next, &info, 0);
+    hoist_from_list(loop->right, &info, 0);
+    env_free(&info.writes);
+
+    if (info.temps) {
+        link = insert_before_statement(link, in_list, info.temps, info.temps_tail);
+        while (*link != loop) link = &(*link)->next;
+    }
+    if (loop->right) optimize_loops_in_statement(&loop->right, 0);
+    return link;
+}
+
+// Runs visit on the body of func_node, whose frame then holds the temporaries
+static void visit_function_body(ASTNode *func_node, ASTNode** (*visit)(ASTNode **link, int in_list)) {
+    ASTNode *owner = temp_owner;
+    VariableScope scope = temp_scope;
+    temp_owner = func_node;
+    temp_scope = VAR_LOCAL;
+    if (func_node->right) visit(&func_node->right, 0);
+    temp_owner = owner;
+    temp_scope = scope;
+}
+
+static void optimize_loops_in_function(ASTNode *func_node) {
+    visit_function_body(func_node, optimize_loops_in_statement);
+}
+
+static ASTNode** optimize_loops_in_statement(ASTNode **link, int in_list) {
+    ASTNode *node = *link;
+    switch (node->type) {
+        case AST_BLOCK:
+            for (ASTNode **stmt = &node->left; *stmt; stmt = &(*stmt)->next) stmt = optimize_loops_in_statement(stmt, 1);
+            break;
+        case AST_IF:
+            if (node->right) optimize_loops_in_statement(&node->right, 0);
+            if (node->next && node->next->type == AST_ELSE && node->next->left) {
+                optimize_loops_in_statement(&node->next->left, 0); // In a list the else is skipped below
+            }
+            break;
+        case AST_WHILE: case AST_FOR:
+            return move_loop_invariants(link, in_list);
+        case AST_FUNCTION: case AST_TYPED_FUNCTION: case AST_CLASS_METHOD:
+            optimize_loops_in_function(node);
+            break;
+        case AST_CLASS:
+            for (ASTNode *member = node->left; member; member = member->next) {
+                if (is_function_node(member)) optimize_loops_in_function(member);
+            }
+            break;
+        default:
+            break;
+    }
+    return link;
+}
+
+static void optimize_loops(ASTNode *program_node) {
+    temp_owner = program_node;
+    temp_scope = VAR_GLOBAL;
+    for (ASTNode **stmt = &program_node->left; *stmt; stmt = &(*stmt)->next) stmt = optimize_loops_in_statement(stmt, 1);
+    temp_owner = NULL;
+}
+
+// --- Inlining ---
+//
+// Before constants are propagated, calls to small free functions are replaced with a
+// copy of what the function returns, so the arguments can fold into it and the call
+// needs no frame. A function is inlined when it is defined once, at the top of a
+// program that imports nothing, and its body is only `return <expression>;`, of at
+// most INLINE_MAX_NODES nodes once the calls in it are inlined, reading nothing but
+// its parameters and globals and calling only builtins and other such functions, none
+// of which lead back to it. The copy reads a literal or slot variable argument in
+// place of the parameter when the body cannot write variables; otherwise the other
+// arguments are computed, in order, into temporaries named <parameter>.<slot> declared
+// just before the statement, so the call must be the first thing the statement
+// computes: an initializer, the value of a return, print or plain assignment, or a
+// call statement. Functions stay defined for calls made by name at run time.
+// -print-opt reports every decision.
+
+#define INLINE_MAX_NODES 16
+
+enum { INLINE_UNKNOWN, INLINE_VISITING, INLINE_YES, INLINE_NO };
+
+// A name functions are defined under, and whether calls to it can be inlined
+typedef struct InlineFunction {
+    const char *name;
+    ASTNode *func;          // The top-level definition, or NULL if there is none
+    int definitions;        // Functions of that name anywhere in the program
+    int state;
+    const char *reason;     // Why calls are not inlined
+    int writes;             // The returned expression may write variables
+    int visited;            // Calls in its body have been inlined
+} InlineFunction;
+
+static InlineFunction *inline_functions;
+static int inline_function_count;
+static int inline_function_capacity;
+static int program_imports;
+static int print_opt_enabled;
+
+void optimize_set_print_opt_enabled(int enabled) {
+    print_opt_enabled = enabled;
+}
+
+static InlineFunction* find_inline_function(const char *name) {
+    for (int i = 0; i < inline_function_count; i++) {
+        if (inline_functions[i].name == name) return &inline_functions[i];
+    }
+    return NULL;
+}
+
+static InlineFunction* add_inline_function(const char *name) {
+    InlineFunction *entry = find_inline_function(name);
+    if (entry) return entry;
+    if (inline_function_count == inline_function_capacity) {
+        int new_capacity = inline_function_capacity ? inline_function_capacity * 2 : 16;
+        InlineFunction *grown = (InlineFunction*)realloc(inline_functions, sizeof(InlineFunction) * new_capacity);
+        if (!grown) {
+            fprintf(stderr, "Fatal Error: Could not allocate the inlining table.\n");
+            exit(EXIT_FAILURE);
+        }
+        inline_functions = grown;
+        inline_function_capacity = new_capacity;
+    }
+    entry = &inline_functions[inline_function_count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->name = name;
+    return entry;
+}
+
+// Counts the free functions defined under each name; class members are looked up
+// through their class instead
+static void count_definitions(ASTNode *node, int class_members) {
+    for (; node; node = node->next) {
+        if (node->type == AST_IMPORT) program_imports = 1;
+        if ((node->type == AST_FUNCTION || node->type == AST_TYPED_FUNCTION) && !class_members) {
+            add_inline_function(node->value)->definitions++;
+        }
+        int is_class = node->type == AST_CLASS || node->type == AST_STRUCT;
+        count_definitions(node->left, is_class);
+        count_definitions(node->right, 0);
+    }
+}
+
+// What a function returns, if its body is only `return <expression>;`
+static ASTNode* returned_expression(ASTNode *func) {
+    ASTNode *stmt = func->right;
+    if (stmt && stmt->type == AST_BLOCK) stmt = stmt->left;
+    if (!stmt || stmt->next || stmt->type != AST_RETURN) return NULL;
+    return stmt->left;
+}
+
+// Number of parameters, if they are plain slots 0..n-1 bound in order; -1 otherwise
+static int parameter_count(ASTNode *func) {
+    int count = 0;
+    for (ASTNode *param = func->left; param; param = param->next, count++) {
+        if (param->type != AST_PARAMETER || param->var_scope != VAR_LOCAL || param->var_slot != count) return -1;
+    }
+    return count;
+}
+
+static ASTNode* parameter_at(ASTNode *func, int index) {
+    ASTNode *param = func->left;
+    while (param && index-- > 0) param = param->next;
+    return param;
+}
+
+static int has_parameter_named(ASTNode *func, const char *name) {
+    for (ASTNode *param = func->left; param; param = param->next) {
+        if (param->value == name) return 1;
+    }
+    return 0;
+}
+
+static int count_nodes(ASTNode *node) {
+    int count = 0;
+    for (; node; node = node->next) count += 1 + count_nodes(node->left) + count_nodes(node->right);
+    return count;
+}
+
+static InlineFunction* resolve_inline_function(InlineFunction *entry);
+
+// Why the expression, in the body of entry's function, cannot be copied into a
+// caller; NULL if it can
+static const char* inline_obstacle(ASTNode *node, InlineFunction *entry) {
+    for (; node; node = node->next) {
+        switch (node->type) {
+            case AST_LITERAL: case AST_BINARY_OP: case AST_MEMBER_ACCESS:
+            case AST_INDEX_ACCESS: case AST_ARRAY: case AST_TERNARY:
+                break;
+            case AST_UNARY_OP:
+                if (is_increment(node) && node->left && node->left->var_scope == VAR_LOCAL) return "assigns its parameters";
+                break;
+            case AST_IDENTIFIER:
+                if (!is_slot_variable(node)) return "reads names looked up at run time";
+                break;
+            case AST_CALL: {
+                if (node->right) return "calls methods";
+                if (has_parameter_named(entry->func, node->value)) return "calls a parameter";
+                InlineFunction *callee = find_inline_function(node->value);
+                if (!callee) break; // A builtin: it sees only its arguments
+                if (callee == entry || callee->state == INLINE_VISITING) return "recursive";
+                if (resolve_inline_function(callee)->state != INLINE_YES) return "calls functions that are not inlined";
+                break;
+            }
+            default:
+                return "has expressions that cannot be inlined"; // this, new, maps, functions
+        }
+        if (node->type == AST_BINARY_OP && is_assignment_operator(node->value) && node->left &&
+            node->left->var_scope == VAR_LOCAL) return "assigns its parameters";
+        const char *reason = inline_obstacle(node->left, entry);
+        if (!reason) reason = inline_obstacle(node->right, entry);
+        if (reason) return reason;
+    }
+    return NULL;
+}
+
+// 1 if evaluating the expression may write a variable
+static int inline_body_writes(ASTNode *node) {
+    for (; node; node = node->next) {
+        if ((node->type == AST_BINARY_OP && is_assignment_operator(node->value)) ||
+            (node->type == AST_UNARY_OP && is_increment(node))) return 1;
+        if (node->type == AST_CALL && !is_pure_builtin_call(node)) {
+            InlineFunction *callee = find_inline_function(node->value);
+            if (!callee || callee->state != INLINE_YES || callee->writes) return 1;
+        }
+        if (inline_body_writes(node->left) || inline_body_writes(node->right)) return 1;
+    }
+    return 0;
+}
+
+static void inline_in_function(ASTNode *func_node);
+
+// Decides whether calls to entry's function can be inlined, inlining into its body first
+static InlineFunction* resolve_inline_function(InlineFunction *entry) {
+    if (entry->state != INLINE_UNKNOWN) return entry;
+    entry->state = INLINE_VISITING;
+    ASTNode *expr = entry->func ? returned_expression(entry->func) : NULL;
+    const char *reason = NULL;
+    if (!entry->func) reason = "not a top-level function";
+    else if (program_imports) reason = "the program imports modules";
+    else if (entry->definitions > 1) reason = "defined more than once";
+    else if (!expr) reason = "the body is not a single return";
+    else if (parameter_count(entry->func) < 0) reason = "its parameters are not plain";
+    else reason = inline_obstacle(expr, entry);
+    if (!reason) {
+        inline_in_function(entry->func); // A copy of the body then needs nothing more
+        expr = returned_expression(entry->func);
+        if (!expr) reason = "its own calls need temporaries";
+        else if (count_nodes(expr) > INLINE_MAX_NODES) reason = "the body is too large";
+    }
+    entry->state = reason ? INLINE_NO : INLINE_YES;
+    entry->reason = reason;
+    entry->writes = !reason && inline_body_writes(expr);
+    return entry;
+}
+
+// What a parameter reads in the copy: a copy of its argument, or a temporary
+typedef struct InlineArgument {
+    ASTNode *value;
+    ASTNode *temp;
+} InlineArgument;
+
+// Copies the returned expression with the parameters bound to arguments (a list, for
+// a node that is one; a ?: keeps its false branch in ->next)
+static ASTNode* copy_inlined(ASTNode *node, const InlineArgument *arguments);
+
+static ASTNode* copy_inlined_list(ASTNode *node, const InlineArgument *arguments) {
+    ASTNode *head = NULL, **tail = &head;
+    for (; node; node = node->next) {
+        *tail = copy_inlined(node, arguments);
+        if (node->type == AST_TERNARY) break; // Its next was the false branch
+        tail = &(*tail)->next;
+    }
+    return head;
+}
+
+static ASTNode* copy_inlined(ASTNode *node, const InlineArgument *arguments) {
+    if (arguments && node->type == AST_IDENTIFIER && node->var_scope == VAR_LOCAL) {
+        const InlineArgument *argument = &arguments[node->var_slot];
+        if (argument->temp) return temporary_read(argument->temp, node->line, node->col);
+        return copy_inlined(argument->value, NULL);
+    }
+    ASTNode *copy = (ASTNode*)malloc(sizeof(ASTNode));
+    if (!copy) {
+        fprintf(stderr, "Fatal Error: Could not allocate AST node for inlining.\n");
+        exit(EXIT_FAILURE);
+    }
+    *copy = *node;
+    copy->has_literal_value = 0; // Caches are per node
+    copy->literal_value = value_undefined();
+    copy->map_key = value_undefined();
+    copy->inline_cache = NULL;
+    copy->bytecode = NULL;
+    copy->local_names = NULL;
+    copy->left = copy_inlined_list(node->left, arguments);
+    copy->right = copy_inlined_list(node->right, arguments);
+    copy->next = node->type == AST_TERNARY && node->next ? copy_inlined(node->next, arguments) : NULL;
+    return copy;
+}
+
+// Expressions that run as statements (vm.c, ir.c)
+static int is_statement_expression(ASTNode *node) {
+    switch (node->type) {
+        case AST_CALL: case AST_BINARY_OP: case AST_UNARY_OP: case AST_LITERAL:
+        case AST_IDENTIFIER: case AST_MEMBER_ACCESS: case AST_NEW:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Replaces call, in place, with a copy of the expression its function returns; 1 if it
+// did. temps_tail is set when the call is the first thing a statement computes:
+// arguments to compute first are then moved into declarations appended there.
+static int inline_call(ASTNode *call, ASTNode ***temps_tail, int value_used) {
+    InlineFunction *entry = call->right ? NULL : find_inline_function(call->value);
+    if (!entry) return 0; // A method or a builtin
+    const char *reason = entry->state == INLINE_YES ? NULL : entry->reason ? entry->reason : "recursive";
+    ASTNode *expr = reason ? NULL : returned_expression(entry->func);
+    int arg_count = 0, needs_temps = 0;
+    for (ASTNode *arg = call->left; arg; arg = arg->next) {
+        arg_count++;
+        if (arg->type == AST_TERNARY) reason = reason ? reason : "an argument is a ?:";
+        else if (arg->type != AST_LITERAL && (arg->type != AST_IDENTIFIER || !is_slot_variable(arg) || entry->writes)) needs_temps = 1;
+    }
+    if (!reason && arg_count != parameter_count(entry->func)) reason = "the argument count differs from the parameters";
+    else if (!reason && needs_temps && !temps_tail) reason = "its arguments need temporaries, and the call does not start a statement";
+    else if (!reason && !value_used && !is_statement_expression(expr)) reason = "its value is unused";
+    else if (!reason && expr->type == AST_TERNARY && !(temps_tail && value_used)) reason = "a ?: can only replace the value of a statement";
+    if (reason) {
+        if (print_opt_enabled) printf("[OPT] Not inlining %s at L%d:%d: %s\n", call->value, call->line, call->col, reason);
+        return 0;
+    }
+
+    InlineArgument *arguments = (InlineArgument*)calloc(arg_count ? arg_count : 1, sizeof(InlineArgument));
+    if (!arguments) {
+        fprintf(stderr, "Fatal Error: Could not allocate arguments for inlining.\n");
+        exit(EXIT_FAILURE);
+    }
+    int temp_count = 0;
+    ASTNode *arg = call->left;
+    call->left = NULL;
+    for (int i = 0; arg; i++) {
+        ASTNode *next = arg->next;
+        arg->next = NULL;
+        if (needs_temps && arg->type != AST_LITERAL) {
+            // Computed in order before the statement, as the call computed them
+            arguments[i].temp = new_temporary(parameter_at(entry->func, i)->value, arg->line, arg->col);
+            arguments[i].temp->right = arg;
+            **temps_tail = arguments[i].temp;
+            *temps_tail = &arguments[i].temp->next;
+            temp_count++;
+        } else {
+            arguments[i].value = arg;
+        }
+        arg = next;
+    }
+    ASTNode *copy = copy_inlined(expr, arguments);
+    for (int i = 0; i < arg_count; i++) free_ast(arguments[i].value);
+    free(arguments);
+
+    if (print_opt_enabled) {
+        printf("[OPT] Inlined %s at L%d:%d (%d nodes", call->value, call->line, call->col, count_nodes(copy));
+        if (temp_count) printf(", %d %s", temp_count, temp_count == 1 ? "temporary" : "temporaries");
+        printf(")\n");
+    }
+    ASTNode *next = call->next;
+    free(call->inline_cache);
+    *call = *copy;
+    if (copy->type != AST_TERNARY) call->next = next; // A ?: only replaces a value with no siblings
+    free(copy);
+    return 1;
+}
+
+static ASTNode** inline_in_statement(ASTNode **link, int in_list);
+
+static void inline_in_expression(ASTNode *node);
+
+// Inlines the calls in a list of expressions, innermost first
+static void inline_in_list(ASTNode *node) {
+    for (; node; node = node->next) inline_in_expression(node);
+}
+
+static void inline_in_expression(ASTNode *node) {
+    if (is_function_node(node)) {
+        inline_in_function(node);
+        return;
+    }
+    if (node->type == AST_CLASS || node->type == AST_STRUCT) return;
+    inline_in_list(node->left);
+    inline_in_list(node->right);
+    if (node->type == AST_CALL) inline_call(node, NULL, 1);
+}
+
+// The statement at *link computes value first, so a call there may take temporaries;
+// returns the link that now holds the statement
+static ASTNode** inline_statement_value(ASTNode **link, int in_list, ASTNode *value, int value_used) {
+    if (!value) return link;
+    if (value->type != AST_CALL) {
+        inline_in_expression(value);
+        return link;
+    }
+    ASTNode *stmt = *link;
+    ASTNode *temps = NULL, **temps_tail = &temps;
+    if (!inline_call(value, &temps_tail, value_used)) {
+        inline_in_list(value->left);
+        inline_in_list(value->right);
+        return link;
+    }
+    if (!temps) return link;
+    // The temporaries start statements of their own
+    link = insert_before_statement(link, in_list, temps, temps_tail);
+    while (*link != stmt) link = &(*inline_in_statement(link, 1))->next;
+    return link;
+}
+
+static ASTNode** inline_in_statement(ASTNode **link, int in_list) {
+    ASTNode *node = *link;
+    switch (node->type) {
+        case AST_BLOCK:
+            for (ASTNode **stmt = &node->left; *stmt; stmt = &(*stmt)->next) stmt = inline_in_statement(stmt, 1);
+            break;
+        case AST_IF:
+            inline_in_expression(node->left);
+            if (node->right) inline_in_statement(&node->right, 0);
+            if (node->next && node->next->type == AST_ELSE && node->next->left) {
+                inline_in_statement(&node->next->left, 0); // In a list the else is skipped below
+            }
+            break;
+        case AST_WHILE:
+            inline_in_expression(node->left);
+            if (node->right) inline_in_statement(&node->right, 0);
+            break;
+        case AST_FOR:
+            inline_in_list(node->left); // Initializer, condition and update
+            if (node->right) inline_in_statement(&node->right, 0);
+            break;
+        case AST_FUNCTION: case AST_TYPED_FUNCTION: case AST_CLASS_METHOD:
+            inline_in_function(node);
+            break;
+        case AST_CLASS:
+            for (ASTNode *member = node->left; member; member = member->next) {
+                if (is_function_node(member)) inline_in_function(member);
+            }
+            break;
+        case AST_VAR_DECL: case AST_TYPED_VAR_DECL:
+            return inline_statement_value(link, in_list, node->right, 1);
+        case AST_RETURN: case AST_PRINT:
+            return inline_statement_value(link, in_list, node->left, 1);
+        case AST_BINARY_OP:
+            if (strcmp(node->value, "=") == 0 && node->left && node->left->type == AST_IDENTIFIER) {
+                return inline_statement_value(link, in_list, node->right, 1);
+            }
+            inline_in_expression(node);
+            break;
+        case AST_CALL:
+            return inline_statement_value(link, in_list, node, 0);
+        case AST_UNARY_OP: case AST_MEMBER_ACCESS: case AST_NEW: case AST_INDEX_ACCESS:
+            inline_in_expression(node);
+            break;
+        default:
+            break;
+    }
+    return link;
+}
+
+static void inline_in_function(ASTNode *func_node) {
+    InlineFunction *entry = find_inline_function(func_node->value);
+    if (entry && entry->func == func_node) {
+        if (entry->visited) return;
+        entry->visited = 1;
+    }
+    visit_function_body(func_node, inline_in_statement);
+}
+
+static void inline_calls(ASTNode *program_node) {
+    program_imports = 0;
+    for (ASTNode *node = program_node->left; node; node = node->next) {
+        if (node->type == AST_FUNCTION || node->type == AST_TYPED_FUNCTION) add_inline_function(node->value)->func = node;
+    }
+    count_definitions(program_node->left, 0);
+    // Callees are decided, and inlined into, before their callers
+    for (int i = 0; i < inline_function_count; i++) resolve_inline_function(&inline_functions[i]);
+
+    temp_owner = program_node;
+    temp_scope = VAR_GLOBAL;
+    for (ASTNode **stmt = &program_node->left; *stmt; stmt = &(*stmt)->next) stmt = inline_in_statement(stmt, 1);
+    temp_owner = NULL;
+    free(inline_functions);
+    inline_functions = NULL;
+    inline_function_count = inline_function_capacity = 0;
+}
+
+// --- Dead code ---
+//
+// Last, code that cannot run or whose effect is never seen is removed. Statements
+// after a return, or after a break or continue in a loop, never run. A store into a
+// local that its function never reads is dropped, leaving the stored value as a
+// statement when computing it may have an effect; a local whose name something looks
+// up at run time (an unresolved identifier, a call, a string naming a function) is
+// kept. Then only reachable declarations are kept: those named, directly or through
+// other reachable declarations, from the top-level statements or main. A class takes
+// its members and its parent with it, and a class with field initializers that do
+// more than compute a value is reachable from the start, as run_vm makes an instance
+// of every class. A program that imports modules keeps its declarations, which module
+// code may call by name: run_vm adds each module to the analysis and registers only
+// what is reached (optimize_declaration_reachable). Functions named only by computed
+// strings are not seen.
+
+static NameSet reached_names;   // Names the reachable code uses
+static ASTNode **unreached;     // Top-level declarations no reachable code names yet
+static int unreached_count;
+static int unreached_capacity;
+static int imports_pending;     // run_vm is to register only the reachable declarations
+
+static int is_declaration(ASTNode *node) {
+    return node->type == AST_FUNCTION || node->type == AST_TYPED_FUNCTION ||
+           node->type == AST_CLASS || node->type == AST_STRUCT;
+}
+
+static const char* declaration_kind(ASTNode *node) {
+    return node->type == AST_CLASS ? "class" : node->type == AST_STRUCT ? "struct" : "function";
+}
+
+// 1 if computing node only produces its value: what code motion would compute once
+// in a loop that writes nothing, or a new array of such values
+static int has_no_effect(ASTNode *node) {
+    if (node->type == AST_ARRAY) {
+        for (ASTNode *element = node->left; element; element = element->next) {
+            if (element->type == AST_TERNARY || !has_no_effect(element)) return 0;
+        }
+        return 1;
+    }
+    LoopInfo nothing_written = {0};
+    return invariance(node, &nothing_written) == INVARIANT;
+}
+
+// Adds the names node and everything under it may use at run time: calls, variables
+// and types, and strings, which can name functions
+static void add_used_names(ASTNode *node, NameSet *set) {
+    switch (node->type) {
+        case AST_CALL: case AST_IDENTIFIER: case AST_NEW: case AST_STRUCT_INIT: case AST_TYPE:
+            name_set_add(set, node->value);
+            break;
+        case AST_LITERAL:
+            if (strcmp(node->data_type, "string") == 0) name_set_add(set, node->value);
+            break;
+        default:
+            break;
+    }
+    if (node->data_type[0]) name_set_add(set, intern(node->data_type));
+    for (ASTNode *child = node->left; child; child = child->next) add_used_names(child, set);
+    for (ASTNode *child = node->right; child; child = child->next) add_used_names(child, set);
+}
+
+// -- Unreachable statements --
+
+static void remove_unreachable_in_statement(ASTNode *node, int in_loop);
+
+// Cuts the statements after one that always leaves the list; at the top level,
+// declarations stay, as run_vm registers them before anything runs
+static void remove_unreachable_in_list(ASTNode **link, int in_loop, int top_level) {
+    for (; *link; link = &(*link)->next) {
+        ASTNode *stmt = *link;
+        remove_unreachable_in_statement(stmt, in_loop);
+        // break and continue outside a loop stop a list on one engine but not the other
+        int leaves = stmt->type == AST_RETURN || (in_loop && (stmt->type == AST_BREAK || stmt->type == AST_CONTINUE));
+        if (!leaves || !stmt->next) continue;
+        int removed = 0;
+        ASTNode **rest = &stmt->next;
+        while (*rest) {
+            ASTNode *dead = *rest;
+            if (top_level && (is_declaration(dead) || dead->type == AST_IMPORT)) {
+                rest = &dead->next;
+                continue;
+            }
+            *rest = dead->next;
+            dead->next = NULL;
+            free_ast(dead);
+            removed++;
+        }
+        if (removed) {
+            printf("[OPT] Removed %d unreachable statement%s after the %s at L%d:%d\n", removed, removed == 1 ? "" : "s",
+                   stmt->type == AST_RETURN ? "return" : stmt->type == AST_BREAK ? "break" : "continue", stmt->line, stmt->col);
+        }
+    }
+}
+
+static void remove_unreachable_in_body(ASTNode *body, int in_loop) {
+    if (!body) return;
+    if (body->type == AST_BLOCK) remove_unreachable_in_list(&body->left, in_loop, 0);
+    else remove_unreachable_in_statement(body, in_loop);
+}
+
+static void remove_unreachable_in_statement(ASTNode *node, int in_loop) {
+    switch (node->type) {
+        case AST_BLOCK:
+            remove_unreachable_in_list(&node->left, in_loop, 0);
+            break;
+        case AST_IF:
+            remove_unreachable_in_body(node->right, in_loop);
+            if (node->next && node->next->type == AST_ELSE) remove_unreachable_in_body(node->next->left, in_loop);
+            break;
+        case AST_WHILE: case AST_FOR:
+            remove_unreachable_in_body(node->right, 1);
+            break;
+        case AST_FUNCTION: case AST_TYPED_FUNCTION: case AST_CLASS_METHOD:
+            remove_unreachable_in_body(node->right, 0);
+            break;
+        case AST_CLASS:
+            for (ASTNode *member = node->left; member; member = member->next) {
+                if (is_function_node(member)) remove_unreachable_in_body(member->right, 0);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// -- Dead stores --
+
+// Counts the reads of each local slot in a function body; the target of a plain
+// assignment is not read
+static void count_local_reads(ASTNode *node, int *reads, int local_count) {
+    for (; node; node = node->next) {
+        if (is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT) continue; // Frames of their own
+        if (node->type == AST_IDENTIFIER && node->var_scope == VAR_LOCAL && node->var_slot < local_count) {
+            reads[node->var_slot]++;
+        }
+        ASTNode *left = node->left;
+        if ((node->type == AST_ASSIGN || (node->type == AST_BINARY_OP && strcmp(node->value, "=") == 0)) &&
+            left && left->type == AST_IDENTIFIER) left = NULL;
+        count_local_reads(left, reads, local_count);
+        count_local_reads(node->right, reads, local_count);
+    }
+}
+
+typedef struct DeadStores {
+    int *reads;
+    int local_count;
+    const NameSet *looked_up;
+    int removed;
+} DeadStores;
+
+static void remove_dead_stores_in_statement(ASTNode *node, DeadStores *dead);
+
+// The variable a statement stores into, and the value, if it is a local or a
+// plain assignment to one
+static ASTNode* stored_local(ASTNode *stmt, ASTNode **value) {
+    ASTNode *target = NULL;
+    if (stmt->type == AST_VAR_DECL) {
+        target = stmt;
+    } else if ((stmt->type == AST_ASSIGN || (stmt->type == AST_BINARY_OP && strcmp(stmt->value, "=") == 0)) &&
+               stmt->left && stmt->left->type == AST_IDENTIFIER) {
+        target = stmt->left;
+    }
+    if (!target || target->var_scope != VAR_LOCAL) return NULL;
+    *value = stmt->right;
+    return target;
+}
+
+static void remove_dead_stores_in_list(ASTNode **link, DeadStores *dead) {
+    while (*link) {
+        ASTNode *stmt = *link, *value = NULL;
+        ASTNode *target = stored_local(stmt, &value);
+        if (!target || target->var_slot >= dead->local_count || dead->reads[target->var_slot] ||
+            name_set_has(dead->looked_up, target->value)) {
+            remove_dead_stores_in_statement(stmt, dead);
+            link = &stmt->next;
+            continue;
+        }
+        if (value && !has_no_effect(value)) {
+            if (!is_statement_expression(value)) {
+                link = &stmt->next;
+                continue;
+            }
+            printf("[OPT] Removed dead store to %s at L%d:%d (value kept as a statement)\n", target->value, stmt->line, stmt->col);
+            stmt->right = NULL;
+            value->next = stmt->next;
+            *link = value;
+        } else {
+            printf("[OPT] Removed dead store to %s at L%d:%d\n", target->value, stmt->line, stmt->col);
+            *link = stmt->next;
+        }
+        stmt->next = NULL;
+        free_ast(stmt);
+        dead->removed++;
+    }
+}
+
+static void remove_dead_stores_in_body(ASTNode *body, DeadStores *dead) {
+    if (body && body->type == AST_BLOCK) remove_dead_stores_in_list(&body->left, dead);
+    else if (body) remove_dead_stores_in_statement(body, dead);
+}
+
+static void remove_dead_stores_in_statement(ASTNode *node, DeadStores *dead) {
+    switch (node->type) {
+        case AST_BLOCK:
+            remove_dead_stores_in_list(&node->left, dead);
+            break;
+        case AST_IF:
+            remove_dead_stores_in_body(node->right, dead);
+            if (node->next && node->next->type == AST_ELSE) remove_dead_stores_in_body(node->next->left, dead);
+            break;
+        case AST_WHILE: case AST_FOR:
+            remove_dead_stores_in_body(node->right, dead); // Not the for's own variable
+            break;
+        default:
+            break;
+    }
+}
+
+// Drops the stores into locals of func_node that are never read, until none are left
+static void remove_dead_stores(ASTNode *func_node, const NameSet *looked_up) {
+    if (!func_node->right || func_node->local_count <= 0) return;
+    DeadStores dead = {0};
+    dead.local_count = func_node->local_count;
+    dead.looked_up = looked_up;
+    dead.reads = (int*)malloc(sizeof(int) * func_node->local_count);
+    if (!dead.reads) {
+        fprintf(stderr, "Fatal Error: Could not allocate read counts for '%s'.\n", func_node->value);
+        exit(EXIT_FAILURE);
+    }
+    do {
+        dead.removed = 0;
+        memset(dead.reads, 0, sizeof(int) * func_node->local_count);
+        count_local_reads(func_node->right, dead.reads, dead.local_count);
+        remove_dead_stores_in_body(func_node->right, &dead);
+    } while (dead.removed);
+    free(dead.reads);
+}
+
+// Every function, method and function expression in the tree
+static void remove_dead_stores_in_functions(ASTNode *node, const NameSet *looked_up) {
+    for (; node; node = node->next) {
+        if (is_function_node(node)) remove_dead_stores(node, looked_up);
+        remove_dead_stores_in_functions(node->left, looked_up);
+        remove_dead_stores_in_functions(node->right, looked_up);
+    }
+}
+
+// -- Reachable declarations --
+
+// 1 if making an instance of the class runs more than computing values
+static int class_runs_initializers(ASTNode *decl) {
+    if (decl->type != AST_CLASS && decl->type != AST_STRUCT) return 0;
+    for (ASTNode *member = decl->left; member; member = member->next) {
+        if (!is_function_node(member) && member->right && !has_no_effect(member->right)) return 1;
+    }
+    return 0;
+}
+
+// Top-level declarations of list become candidates; the other statements are run
+// (run is 0 for modules, whose top-level statements are not) and so reached
+static void track_declarations(ASTNode *list, int run) {
+    for (ASTNode *node = list; node; node = node->next) {
+        if (!is_declaration(node)) {
+            if (run && node->type != AST_IMPORT) add_used_names(node, &reached_names);
+            continue;
+        }
+        if (unreached_count == unreached_capacity) {
+            int new_capacity = unreached_capacity ? unreached_capacity * 2 : 32;
+            ASTNode **grown = (ASTNode**)realloc(unreached, sizeof(ASTNode*) * new_capacity);
+            if (!grown) {
+                fprintf(stderr, "Fatal Error: Could not allocate the reachability table.\n");
+                exit(EXIT_FAILURE);
+            }
+            unreached = grown;
+            unreached_capacity = new_capacity;
+        }
+        unreached[unreached_count++] = node;
+    }
+}
+
+// Moves the declarations reachable code names out of unreached, adding the names they
+// use, until no more are reached
+static void close_reachability(void) {
+    int reached = 1;
+    while (reached) {
+        reached = 0;
+        for (int i = 0; i < unreached_count; i++) {
+            ASTNode *decl = unreached[i];
+            if (!name_set_has(&reached_names, decl->value) && !class_runs_initializers(decl)) continue;
+            memmove(&unreached[i], &unreached[i + 1], sizeof(ASTNode*) * (unreached_count - i - 1));
+            unreached_count--;
+            i--;
+            for (ASTNode *child = decl->left; child; child = child->next) add_used_names(child, &reached_names);
+            for (ASTNode *child = decl->right; child; child = child->next) add_used_names(child, &reached_names);
+            reached = 1;
+        }
+    }
+}
+
+static void remove_unreachable_declarations(ASTNode *program_node) {
+    int imports = 0;
+    for (ASTNode *node = program_node->left; node; node = node->next) {
+        if (node->type == AST_IMPORT) imports = 1;
+    }
+    optimize_cleanup();
+    name_set_add(&reached_names, intern("main")); // run_vm calls it after the top level
+    track_declarations(program_node->left, 1);
+    close_reachability();
+    if (imports) {
+        imports_pending = 1; // Decided once run_vm has loaded the modules
+        return;
+    }
+    for (ASTNode **link = &program_node->left; *link;) {
+        ASTNode *node = *link;
+        int is_unreached = 0;
+        for (int i = 0; i < unreached_count && !is_unreached; i++) is_unreached = unreached[i] == node;
+        if (!is_unreached) {
+            link = &node->next;
+            continue;
+        }
+        printf("[OPT] Removed unreachable %s %s (L%d:%d)\n", declaration_kind(node), node->value, node->line, node->col);
+        *link = node->next;
+        node->next = NULL;
+        free_ast(node);
+    }
+    optimize_cleanup();
+}
+
+static void eliminate_dead_code(ASTNode *program_node) {
+    remove_unreachable_in_list(&program_node->left, 0, 1);
+    NameSet looked_up = {0};
+    add_looked_up_names(program_node->left, &looked_up);
+    remove_dead_stores_in_functions(program_node->left, &looked_up);
+    name_set_free(&looked_up);
+    remove_unreachable_declarations(program_node);
+}
+
+int optimize_prunes_imports(void) {
+    return imports_pending;
+}
+
+void optimize_reach_module(ASTNode *module_program) {
+    if (!imports_pending || !module_program) return;
+    track_declarations(module_program->left, 0);
+    close_reachability();
+}
+
+int optimize_declaration_reachable(ASTNode *decl) {
+    if (!imports_pending) return 1;
+    for (int i = 0; i < unreached_count; i++) {
+        if (unreached[i] == decl) return 0;
+    }
+    return 1;
+}
+
+void optimize_cleanup(void) {
+    name_set_free(&reached_names);
+    free(unreached);
+    unreached = NULL;
+    unreached_count = unreached_capacity = 0;
+    imports_pending = 0;
+}
+
+// --- Escape analysis ---
+//
+// After inlining, an object made by `let v = new C(...)` in a function and used only
+// as v.field cannot be seen anywhere else, so its fields can live in locals. The
+// function must use v only after the declaration, in later statements of the same
+// list, except for `v = new C(...)` statements there. v must not be a name that
+// anything looks up at run time. C must be a class defined once, with no parent and
+// no private fields, whose instance fields have literal initializers. Its
+// constructor, if it has one, may only store into those fields values computed from
+// its parameters and globals. Each `new C(...)` then becomes a declaration of each
+// field as a local named v.<field>.<slot>, holding what the object would have held.
+// Arguments are first computed into temporaries, as inlining does. Each v.field
+// becomes a read or write of its local. No object is made, so later objects get
+// lower ids. -print-opt reports every object that is not replaced.
+
+typedef struct ScalarObject {
+    ASTNode *decl;          // let v = new C(...)
+    ASTNode *class_node;
+    ASTNode *ctor;          // NULL if C has no constructor
+    int param_count;
+    ASTNode **fields;       // C's instance fields, in order
+    ASTNode **locals;       // The declarations of the locals that replace them
+    int field_count;
+    int uses;               // References to v that are fine, counted before replacing
+    int renewals;           // v = new C(...) anywhere, and as statements
+    int renewal_statements;
+    int escapes;
+    int locals_placed;      // The declarations in locals are in the tree
+} ScalarObject;
+
+static ASTNode *escape_program;
+static NameSet escape_looked_up; // Names looked up at run time, which may find v by name
+
+static ASTNode* field_initializer(ASTNode *member) {
+    return member->type == AST_CLASS_FIELD ? member->left : member->right;
+}
+
+static int is_instance_field(ASTNode *member) {
+    return (member->type == AST_VAR_DECL || member->type == AST_TYPED_VAR_DECL || member->type == AST_CLASS_FIELD) &&
+           strcmp(member->access_modifier, "static") != 0;
+}
+
+static int scalar_field_index(const ScalarObject *object, const char *name) {
+    for (int i = 0; i < object->field_count; i++) {
+        if (object->fields[i]->value == name) return i;
+    }
+    return -1;
+}
+
+// 1 if the expression reads nothing but the first param_count locals (parameters) and globals
+static int reads_only_parameters(ASTNode *node, int param_count) {
+    for (; node; node = node->next) {
+        if (node->type == AST_THIS || node->type == AST_SUPER) return 0;
+        if (node->type == AST_IDENTIFIER && (!is_slot_variable(node) ||
+            (node->var_scope == VAR_LOCAL && node->var_slot >= param_count))) return 0;
+        if (!reads_only_parameters(node->left, param_count) || !reads_only_parameters(node->right, param_count)) return 0;
+    }
+    return 1;
+}
+
+// The field a statement of the constructor stores into, if it is `this.field = value`
+static ASTNode* constructor_store(ASTNode *stmt) {
+    if (stmt->type != AST_BINARY_OP || strcmp(stmt->value, "=") != 0 || !stmt->left ||
+        stmt->left->type != AST_MEMBER_ACCESS || !stmt->left->left || stmt->left->left->type != AST_THIS) return NULL;
+    return stmt->left;
+}
+
+static ASTNode* constructor_body(ASTNode *ctor) {
+    ASTNode *body = ctor->right;
+    return body && body->type == AST_BLOCK ? body->left : body;
+}
+
+// Why objects of the class new_node makes cannot be replaced with locals; NULL if
+// they can, with object filled in
+static const char* scalar_class_obstacle(ASTNode *new_node, ScalarObject *object) {
+    ASTNode *class_node = NULL;
+    for (ASTNode *node = escape_program->left; node; node = node->next) {
+        if (node->type == AST_IMPORT) return "the program imports modules";
+        if ((node->type == AST_CLASS || node->type == AST_STRUCT) && node->value == new_node->value) {
+            if (class_node || node->type != AST_CLASS) return "not a class defined once";
+            class_node = node;
+        }
+    }
+    if (!class_node) return "not a class defined once";
+    if (class_node->right) return "the class extends another";
+    object->class_node = class_node;
+    object->ctor = NULL;
+    object->field_count = 0;
+    const char *ctor_name = intern("new");
+    for (ASTNode *member = class_node->left; member; member = member->next) {
+        if (is_function_node(member) && (member->value == ctor_name || member->value == class_node->value)) {
+            if (object->ctor && object->ctor->value == member->value) return "the class has more than one constructor";
+            if (!object->ctor || member->value == ctor_name) object->ctor = member; // new() is found first
+        } else if (is_instance_field(member)) {
+            if (strcmp(member->access_modifier, "private") == 0) return "the class has private fields";
+            ASTNode *init = field_initializer(member);
+            if (init && init->type != AST_LITERAL) return "a field initializer is not a literal";
+            object->field_count++;
+        }
+    }
+    if (object->field_count == 0) return "the class has no fields";
+
+    int arg_count = 0;
+    for (ASTNode *arg = new_node->left; arg; arg = arg->next) arg_count++;
+    object->param_count = 0;
+    if (!object->ctor) return arg_count ? "arguments with no constructor" : NULL;
+    object->param_count = parameter_count(object->ctor);
+    if (object->param_count < 0) return "the constructor's parameters are not plain";
+    if (arg_count != object->param_count) return "the argument count differs from the constructor's";
+    for (ASTNode *stmt = constructor_body(object->ctor); stmt; stmt = stmt->next) {
+        ASTNode *target = constructor_store(stmt);
+        if (!target) return "the constructor does more than store fields";
+        ASTNode *field = NULL;
+        for (ASTNode *member = class_node->left; member && !field; member = member->next) {
+            if (is_instance_field(member) && member->value == target->value) field = member;
+        }
+        if (!field) return "the constructor stores a field the class does not declare";
+        if (!stmt->right || stmt->right->type == AST_TERNARY || !has_no_effect(stmt->right) ||
+            !reads_only_parameters(stmt->right, object->param_count)) {
+            return "the constructor stores values that are not computed from its parameters";
+        }
+    }
+    for (ASTNode *arg = new_node->left; arg; arg = arg->next) {
+        if (arg->type == AST_TERNARY) return "an argument is a ?:";
+    }
+    return NULL;
+}
+
+static int is_object_variable(ASTNode *node, const ScalarObject *object) {
+    return node && node->type == AST_IDENTIFIER && node->var_scope == VAR_LOCAL && node->var_slot == object->decl->var_slot;
+}
+
+static int is_renewal(ASTNode *node, const ScalarObject *object) {
+    return node->type == AST_BINARY_OP && strcmp(node->value, "=") == 0 && is_object_variable(node->left, object) &&
+           node->right && node->right->type == AST_NEW && node->right->value == object->class_node->value;
+}
+
+// Counts the references to v's slot in a function body, other than in functions it defines
+static int count_slot_references(ASTNode *node, int slot) {
+    int count = 0;
+    for (; node; node = node->next) {
+        if (is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT) continue;
+        if ((node->type == AST_IDENTIFIER || node->type == AST_VAR_DECL || node->type == AST_TYPED_VAR_DECL) &&
+            node->var_scope == VAR_LOCAL && node->var_slot == slot) count++;
+        count += count_slot_references(node->left, slot) + count_slot_references(node->right, slot);
+    }
+    return count;
+}
+
+// Counts the uses of v that replacing it keeps meaning the same: v.field, not called,
+// and v = new C(...); an array in a field must not be stored into through v
+static void count_scalar_uses(ASTNode *node, ScalarObject *object) {
+    for (; node; node = node->next) {
+        if (is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT) continue;
+        if (node->type == AST_MEMBER_ACCESS && is_object_variable(node->left, object) &&
+            scalar_field_index(object, node->value) >= 0) object->uses++;
+        if (is_renewal(node, object)) {
+            object->uses++;
+            object->renewals++;
+        }
+        ASTNode *target = NULL;
+        if (node->type == AST_ASSIGN || (node->type == AST_BINARY_OP && is_assignment_operator(node->value)) ||
+            (node->type == AST_UNARY_OP && is_increment(node))) target = node->left;
+        while (target && target->type == AST_INDEX_ACCESS) {
+            target = target->left;
+            if (target && target->type == AST_MEMBER_ACCESS && is_object_variable(target->left, object)) object->escapes = 1;
+        }
+        count_scalar_uses(node->left, object);
+        count_scalar_uses(node->right, object);
+    }
+}
+
+static void count_renewal_statements(ASTNode *node, ScalarObject *object);
+
+static void count_renewal_statements_in_body(ASTNode *body, ScalarObject *object) {
+    if (body && body->type == AST_BLOCK) {
+        for (ASTNode *stmt = body->left; stmt; stmt = stmt->next) count_renewal_statements(stmt, object);
+    } else if (body) {
+        count_renewal_statements(body, object);
+    }
+}
+
+static void count_renewal_statements(ASTNode *node, ScalarObject *object) {
+    switch (node->type) {
+        case AST_BLOCK:
+            count_renewal_statements_in_body(node, object);
+            break;
+        case AST_IF:
+            count_renewal_statements_in_body(node->right, object);
+            if (node->next && node->next->type == AST_ELSE) count_renewal_statements_in_body(node->next->left, object);
+            break;
+        case AST_WHILE: case AST_FOR:
+            count_renewal_statements_in_body(node->right, object);
+            break;
+        default:
+            if (is_renewal(node, object)) object->renewal_statements++;
+            break;
+    }
+}
+
+// The declarations that make the fields of an object new_node would have made: the
+// arguments' temporaries, then one declaration per field
+static ASTNode* construct_scalars(ASTNode *new_node, ScalarObject *object, ASTNode ***tail) {
+    ASTNode *head = NULL;
+    *tail = &head;
+    InlineArgument *arguments = (InlineArgument*)calloc(object->param_count ? object->param_count : 1, sizeof(InlineArgument));
+    if (!arguments) {
+        fprintf(stderr, "Fatal Error: Could not allocate arguments for scalar replacement.\n");
+        exit(EXIT_FAILURE);
+    }
+    ASTNode *arg = new_node->left;
+    new_node->left = NULL;
+    for (int i = 0; arg; i++) {
+        ASTNode *next = arg->next;
+        arg->next = NULL;
+        if (arg->type == AST_LITERAL) {
+            arguments[i].value = arg;
+        } else {
+            // Computed in order, as the call to the constructor computed them
+            arguments[i].temp = new_temporary(parameter_at(object->ctor, i)->value, arg->line, arg->col);
+            arguments[i].temp->right = arg;
+            **tail = arguments[i].temp;
+            *tail = &arguments[i].temp->next;
+        }
+        arg = next;
+    }
+    for (int i = 0; i < object->field_count; i++) {
+        ASTNode *value = field_initializer(object->fields[i]);
+        if (object->ctor) {
+            for (ASTNode *stmt = constructor_body(object->ctor); stmt; stmt = stmt->next) {
+                if (constructor_store(stmt)->value == object->fields[i]->value) value = stmt->right; // The last store wins
+            }
+        }
+        ASTNode *decl = object->locals[i];
+        if (object->locals_placed) {
+            // Made again: the local is declared afresh
+            decl = create_node(AST_VAR_DECL, decl->value, new_node->line, new_node->col);
+            decl->var_scope = object->locals[i]->var_scope;
+            decl->var_slot = object->locals[i]->var_slot;
+        } else {
+            decl->line = new_node->line;
+            decl->col = new_node->col;
+        }
+        if (value) decl->right = value->type == AST_LITERAL ? copy_inlined(value, NULL) : copy_inlined(value, arguments);
+        **tail = decl;
+        *tail = &decl->next;
+    }
+    object->locals_placed = 1;
+    for (int i = 0; i < object->param_count; i++) free_ast(arguments[i].value);
+    free(arguments);
+    return head;
+}
+
+// Puts the statements first..*last in place of the statement at *link
+static void replace_statement(ASTNode **link, int in_list, ASTNode *first, ASTNode **last) {
+    ASTNode *stmt = *link;
+    if (!in_list) {
+        ASTNode *block = create_node(AST_BLOCK, "block", stmt->line, stmt->col);
+        block->left = first;
+        block->next = stmt->next;
+        *link = block;
+    } else {
+        *last = stmt->next;
+        *link = first;
+    }
+    stmt->next = NULL;
+    free_ast(stmt);
+}
+
+static void replace_renewals(ASTNode **link, int in_list, ScalarObject *object);
+
+static void replace_renewals_in_body(ASTNode **link, ScalarObject *object) {
+    if (!*link) return;
+    if ((*link)->type == AST_BLOCK) {
+        for (ASTNode **stmt = &(*link)->left; *stmt; stmt = &(*stmt)->next) replace_renewals(stmt, 1, object);
+    } else {
+        replace_renewals(link, 0, object);
+    }
+}
+
+// Replaces v = new C(...) statements with the declarations of its fields; leaves link
+// at the last statement that replaced one
+static void replace_renewals(ASTNode **link, int in_list, ScalarObject *object) {
+    ASTNode *node = *link;
+    switch (node->type) {
+        case AST_BLOCK:
+            replace_renewals_in_body(link, object);
+            break;
+        case AST_IF:
+            replace_renewals_in_body(&node->right, object);
+            if (node->next && node->next->type == AST_ELSE) replace_renewals_in_body(&node->next->left, object);
+            break;
+        case AST_WHILE: case AST_FOR:
+            replace_renewals_in_body(&node->right, object);
+            break;
+        default:
+            if (is_renewal(node, object)) {
+                ASTNode **tail;
+                ASTNode *first = construct_scalars(node->right, object, &tail);
+                replace_statement(link, in_list, first, tail);
+            }
+            break;
+    }
+}
+
+// Turns v.field into reads and writes of the field's local
+static void replace_field_uses(ASTNode *node, ScalarObject *object) {
+    for (; node; node = node->next) {
+        if (is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT) continue;
+        if (node->type == AST_MEMBER_ACCESS && is_object_variable(node->left, object)) {
+            set_temporary_read(node, object->locals[scalar_field_index(object, node->value)]);
+            continue;
+        }
+        replace_field_uses(node->left, object);
+        replace_field_uses(node->right, object);
+    }
+}
+
+// Replaces the object the declaration at *link makes with locals, if it never escapes;
+// returns the link that holds the last statement replacing it
+static ASTNode** replace_scalar_object(ASTNode **link, ASTNode *func_node) {
+    ASTNode *decl = *link;
+    ASTNode *new_node = decl->right;
+    ScalarObject object = {0};
+    object.decl = decl;
+    const char *reason = scalar_class_obstacle(new_node, &object);
+    if (!reason && decl->type == AST_TYPED_VAR_DECL && strcmp(decl->data_type, new_node->value) != 0) reason = "declared with another type";
+    if (!reason && decl->var_slot < parameter_count(func_node)) reason = "it is a parameter";
+    if (!reason && name_set_has(&escape_looked_up, decl->value)) reason = "its name is looked up at run time";
+    if (!reason) {
+        object.fields = (ASTNode**)calloc(object.field_count * 2, sizeof(ASTNode*));
+        if (!object.fields) {
+            fprintf(stderr, "Fatal Error: Could not allocate fields for scalar replacement.\n");
+            exit(EXIT_FAILURE);
+        }
+        object.locals = object.fields + object.field_count;
+        int i = 0;
+        for (ASTNode *member = object.class_node->left; member; member = member->next) {
+            if (is_instance_field(member)) object.fields[i++] = member;
+        }
+        count_scalar_uses(decl->next, &object);
+        for (ASTNode *stmt = decl->next; stmt; stmt = stmt->next) count_renewal_statements(stmt, &object);
+        int references = count_slot_references(func_node->right, decl->var_slot);
+        if (object.escapes) reason = "an array in a field is stored into";
+        else if (references != 1 + object.uses) reason = "it is used other than through its fields, or before it is declared";
+        else if (object.renewals != object.renewal_statements) reason = "it is made again inside an expression";
+    }
+    if (reason) {
+        if (print_opt_enabled) printf("[OPT] Not replacing object %s (new %s) at L%d:%d: %s\n", decl->value, new_node->value, decl->line, decl->col, reason);
+        free(object.fields);
+        return link;
+    }
+
+    printf("[OPT] Replaced object %s (new %s) at L%d:%d with %d local%s\n", decl->value, new_node->value, decl->line, decl->col,
+           object.field_count, object.field_count == 1 ? "" : "s");
+    for (int i = 0; i < object.field_count; i++) {
+        char prefix[160];
+        snprintf(prefix, sizeof(prefix), "%s.%s", decl->value, object.fields[i]->value);
+        object.locals[i] = new_temporary(prefix, decl->line, decl->col);
+    }
+    for (ASTNode **stmt = &decl->next; *stmt; stmt = &(*stmt)->next) replace_renewals(stmt, 1, &object);
+    replace_field_uses(decl->next, &object);
+    ASTNode **tail;
+    ASTNode *first = construct_scalars(new_node, &object, &tail);
+    replace_statement(link, 1, first, tail);
+    free(object.fields);
+    while (&(*link)->next != tail) link = &(*link)->next;
+    return link;
+}
+
+static ASTNode** replace_scalars_in_statement(ASTNode **link, int in_list);
+
+static ASTNode *scalar_function; // The function whose body is being visited
+
+static void replace_scalars_in_function(ASTNode *func_node) {
+    ASTNode *outer = scalar_function;
+    scalar_function = func_node;
+    visit_function_body(func_node, replace_scalars_in_statement);
+    scalar_function = outer;
+}
+
+static ASTNode** replace_scalars_in_statement(ASTNode **link, int in_list) {
+    ASTNode *node = *link;
+    switch (node->type) {
+        case AST_BLOCK:
+            for (ASTNode **stmt = &node->left; *stmt; stmt = &(*stmt)->next) stmt = replace_scalars_in_statement(stmt, 1);
+            break;
+        case AST_IF:
+            if (node->right) replace_scalars_in_statement(&node->right, 0);
+            if (node->next && node->next->type == AST_ELSE && node->next->left) replace_scalars_in_statement(&node->next->left, 0);
+            break;
+        case AST_WHILE: case AST_FOR:
+            if (node->right) replace_scalars_in_statement(&node->right, 0);
+            break;
+        case AST_FUNCTION: case AST_TYPED_FUNCTION: case AST_CLASS_METHOD:
+            replace_scalars_in_function(node);
+            break;
+        case AST_CLASS:
+            for (ASTNode *member = node->left; member; member = member->next) {
+                if (is_function_node(member)) replace_scalars_in_function(member);
+            }
+            break;
+        case AST_VAR_DECL: case AST_TYPED_VAR_DECL:
+            if (in_list && scalar_function && node->var_scope == VAR_LOCAL && node->right && node->right->type == AST_NEW) {
+                return replace_scalar_object(link, scalar_function);
+            }
+            break;
+        default:
+            break;
+    }
+    return link;
+}
+
+static void replace_scalars(ASTNode *program_node) {
+    escape_program = program_node;
+    add_looked_up_names(program_node->left, &escape_looked_up);
+    for (ASTNode **stmt = &program_node->left; *stmt; stmt = &(*stmt)->next) stmt = replace_scalars_in_statement(stmt, 1);
+    name_set_free(&escape_looked_up);
+    escape_program = NULL;
+}
+
+// --- SSA ---
+//
+// After the loops, the top-level code and each function body are lowered to SSA form
+// (ssa.c) and run through its pass pipeline, which sees what the rounds above cannot:
+// a variable that keeps its value around a loop, a branch that is never taken because
+// of what an earlier one stored, or a value computed again in a later statement. What
+// the passes prove is written back into the tree for the engines. A pure expression
+// the passes proved constant becomes its literal. When global value numbering finds
+// an operator computed again from the same values as one that always runs first, the
+// later ones read it instead: from the variable the first one initializes, when that
+// declaration is the variable's only store, or else from a temporary declared before
+// the statement that computes it first, when the saving pays for the extra store.
+// Operators that can report an error are not reused. Folding can then go further, so
+// the constant rounds run again.
+
+#define CSE_TEMPORARY_COST 3 // Nodes saved that pay for a temporary's store and load
+
+typedef struct SsaRewrite {
+    SsaFunction *f;
+    char *dropped;          // Per expression: its node is gone or has moved
+    int rewrites;
+} SsaRewrite;
+
+// Drops the expressions under the expression at index, which come just before it
+static void drop_expressions(SsaRewrite *r, int index) {
+    for (int i = r->f->expressions[index].first_expression; i <= index; i++) r->dropped[i] = 1;
+}
+
+static void rewrite_constants(SsaRewrite *r) {
+    SsaFunction *f = r->f;
+    for (int i = f->expression_count - 1; i >= 0; i--) { // Outermost first
+        const SsaExpression *e = &f->expressions[i];
+        if (r->dropped[i]) continue;
+        const SsaValue *v = &f->values[ssa_resolve(f, e->value)];
+        if (v->op != SSA_CONST) continue;
+        char text[96] = "";
+        append_expression(text, sizeof(text), e->node, 0);
+        if (!set_value_literal(e->node, v->constant)) continue;
+        printf("[OPT] Proved %s constant at L%d:%d: %s\n", text, e->node->line, e->node->col, e->node->value);
+        drop_expressions(r, i);
+        r->rewrites++;
+    }
+}
+
+// The number of stores into a slot in a body, other than in the functions it defines
+static int count_slot_stores(ASTNode *node, VariableScope scope, int slot) {
+    int count = 0;
+    for (; node; node = node->next) {
+        if (is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT) continue;
+        ASTNode *target = write_target(node);
+        if (target && target->var_scope == scope && target->var_slot == slot) count++;
+        count += count_slot_stores(node->left, scope, slot) + count_slot_stores(node->right, scope, slot);
+    }
+    return count;
+}
+
+// The link holding stmt among the statements at *link, and whether it is in a list
+static ASTNode** find_statement(ASTNode **link, int in_list, ASTNode *stmt, int *stmt_in_list) {
+    for (; *link; link = &(*link)->next) {
+        ASTNode *node = *link;
+        if (node == stmt) {
+            // A block made around a lone if would leave its else behind
+            if (!in_list && node->type == AST_IF && node->next && node->next->type == AST_ELSE) return NULL;
+            *stmt_in_list = in_list;
+            return link;
+        }
+        ASTNode **found = NULL;
+        if (node->type == AST_BLOCK) found = find_statement(&node->left, 1, stmt, stmt_in_list);
+        else if (node->type == AST_ELSE) found = find_statement(&node->left, 0, stmt, stmt_in_list);
+        else if ((node->type == AST_IF || node->type == AST_WHILE || node->type == AST_FOR) && node->right) {
+            found = find_statement(&node->right, 0, stmt, stmt_in_list);
+        }
+        if (found) return found;
+        if (!in_list) break;
+    }
+    return NULL;
+}
+
+static int expression_size(ASTNode *node) {
+    return 1 + count_nodes(node->left) + count_nodes(node->right);
+}
+
+static int is_reusable(const SsaRewrite *r, int index) {
+    const SsaFunction *f = r->f;
+    const SsaExpression *e = &f->expressions[index];
+    SsaOp op = f->values[e->value].op;
+    // A variable's read has the value of what was stored: only operators are computed again
+    return !r->dropped[index] && f->values[e->value].node == e->node && (op == SSA_BINARY || op == SSA_NEGATE || op == SSA_NOT) &&
+           f->values[ssa_resolve(f, e->value)].op != SSA_CONST && !ssa_expression_may_fail(f, e);
+}
+
+static const SsaFunction *sorted_function;
+
+static int compare_expression_size(const void *a, const void *b) {
+    int size_a = expression_size(sorted_function->expressions[*(const int*)a].node);
+    int size_b = expression_size(sorted_function->expressions[*(const int*)b].node);
+    return size_a != size_b ? size_b - size_a : *(const int*)a - *(const int*)b;
+}
+
+// Makes the expressions that repeat the one at first read its value
+static void reuse_expression(SsaRewrite *r, int first, const int *repeats, int repeat_count) {
+    SsaFunction *f = r->f;
+    ASTNode *node = f->expressions[first].node, *stmt = f->expressions[first].statement;
+    char text[96] = "";
+    append_expression(text, sizeof(text), node, 0);
+    ASTNode *holder = NULL;
+    if (stmt && (stmt->type == AST_VAR_DECL || stmt->type == AST_TYPED_VAR_DECL) && stmt->right == node &&
+        stmt->var_scope == f->scope && stmt->var_slot >= 0 && stmt->var_slot < f->slot_count && f->tracked[stmt->var_slot] &&
+        count_slot_stores(f->scope == VAR_GLOBAL ? f->owner->left : f->owner->right, f->scope, stmt->var_slot) == 1) {
+        holder = stmt;
+    } else {
+        if (!stmt || repeat_count * (expression_size(node) - 1) <= CSE_TEMPORARY_COST) return;
+        int in_list = 0;
+        ASTNode **link = f->scope == VAR_GLOBAL ? find_statement(&f->owner->left, 1, stmt, &in_list)
+                                                : find_statement(&f->owner->right, 0, stmt, &in_list);
+        if (!link) return;
+        temp_owner = f->owner;
+        temp_scope = f->scope;
+        holder = new_temporary("cse", node->line, node->col);
+        temp_owner = NULL;
+        ASTNode *init = (ASTNode*)malloc(sizeof(ASTNode));
+        if (!init) {
+            fprintf(stderr, "Fatal Error: Could not allocate AST node for value numbering.\n");
+            exit(EXIT_FAILURE);
+        }
+        *init = *node; // Takes over the operands, cached literal and inline cache
+        init->next = NULL;
+        node->left = node->right = NULL;
+        node->has_literal_value = 0;
+        node->map_key = value_undefined();
+        node->inline_cache = NULL;
+        holder->right = init;
+        set_temporary_read(node, holder);
+        insert_before_statement(link, in_list, holder, &holder->next);
+        printf("[OPT] Computed %s at L%d:%d into %s\n", text, init->line, init->col, holder->value);
+    }
+    drop_expressions(r, first);
+    for (int i = 0; i < repeat_count; i++) {
+        ASTNode *repeat = f->expressions[repeats[i]].node;
+        set_temporary_read(repeat, holder);
+        printf("[OPT] Reused %s for %s at L%d:%d\n", holder->value, text, repeat->line, repeat->col);
+        drop_expressions(r, repeats[i]);
+        r->rewrites++;
+    }
+}
+
+static void reuse_values(SsaRewrite *r) {
+    SsaFunction *f = r->f;
+    int *firsts = (int*)malloc(sizeof(int) * (f->expression_count > 0 ? f->expression_count : 1));
+    int *repeats = (int*)malloc(sizeof(int) * (f->expression_count > 0 ? f->expression_count : 1));
+    if (!firsts || !repeats) {
+        fprintf(stderr, "Fatal Error: Could not allocate value numbering state.\n");
+        exit(EXIT_FAILURE);
+    }
+    // The expressions whose value others were numbered as, largest first
+    int first_count = 0;
+    for (int i = 0; i < f->expression_count; i++) {
+        if (is_reusable(r, i) && ssa_resolve(f, f->expressions[i].value) == f->expressions[i].value) firsts[first_count++] = i;
+    }
+    sorted_function = f;
+    qsort(firsts, first_count, sizeof(int), compare_expression_size);
+    sorted_function = NULL;
+    for (int i = 0; i < first_count; i++) {
+        int first = firsts[i], repeat_count = 0;
+        if (r->dropped[first]) continue;
+        for (int j = 0; j < f->expression_count; j++) {
+            if (j != first && is_reusable(r, j) && ssa_resolve(f, f->expressions[j].value) == f->expressions[first].value) {
+                repeats[repeat_count++] = j;
+            }
+        }
+        if (repeat_count > 0) reuse_expression(r, first, repeats, repeat_count);
+    }
+    free(firsts);
+    free(repeats);
+}
+
+static NameSet ssa_looked_up; // Names looked up at run time, whose slots the IR does not follow
+
+// Lowers owner's body, runs the passes and writes back what they proved; returns the rewrites
+static int optimize_ssa_body(ASTNode *program_node, ASTNode *owner) {
+    SsaFunction *f = ssa_build(program_node, owner, &ssa_looked_up);
+    if (!f) return 0;
+    ssa_optimize(f, print_opt_enabled ? stdout : NULL);
+    SsaRewrite r = { f, (char*)calloc(f->expression_count > 0 ? f->expression_count : 1, 1), 0 };
+    if (!r.dropped) {
+        fprintf(stderr, "Fatal Error: Could not allocate the SSA rewrite state.\n");
+        exit(EXIT_FAILURE);
+    }
+    rewrite_constants(&r);
+    reuse_values(&r);
+    free(r.dropped);
+    ssa_free(f);
+    return r.rewrites;
+}
+
+static int optimize_ssa_functions(ASTNode *program_node, ASTNode *node) {
+    int rewrites = 0;
+    for (; node; node = node->next) {
+        if (is_function_node(node)) rewrites += optimize_ssa_body(program_node, node);
+        rewrites += optimize_ssa_functions(program_node, node->left);
+        rewrites += optimize_ssa_functions(program_node, node->right);
+    }
+    return rewrites;
+}
+
+static int optimize_ssa(ASTNode *program_node) {
+    if (program_imports) return 0; // Module code can reach any global by name
+    add_looked_up_names(program_node->left, &ssa_looked_up);
+    int rewrites = optimize_ssa_body(program_node, program_node) + optimize_ssa_functions(program_node, program_node->left);
+    name_set_free(&ssa_looked_up);
+    return rewrites;
+}
+
+// --- Static types ---
+//
+// Last, the type each slot variable always holds is proven where the tree allows it,
+// and every expression whose type follows is marked (node->static_type) for ir.c,
+// which then compiles it to an operation that skips the type checks: int arithmetic,
+// double arithmetic and comparisons, and branches on bools. A slot's type is the join
+// of the types of everything stored into it, found by iterating from the literals
+// until nothing changes; type annotations are not enforced at run time, so only the
+// stored values count (a typed declaration without an initializer stores its
+// default). The slot must be read only where a declaration of it has run: in later
+// statements of the list holding the declaration, or in the rest of the for loop that
+// declares it. Parameters, names something looks up at run time and, for globals,
+// names any function uses are not typed. Neither is anything in a program that
+// imports modules. Comparisons and logical operators always give bools, whatever
+// their operands.
+
+#define TYPE_NONE SSA_TYPE_NONE // Join of no stores yet
+
+typedef struct SlotTypes {
+    ASTNode *owner;         // Function, or the program for globals
+    VariableScope scope;
+    int count;
+    int *types;             // Join of the types stored so far (StaticType or TYPE_NONE)
+    char *excluded;         // Slots that are not typed
+    char *declared;         // Slots a declaration of which has run at this point
+    int changed;
+} SlotTypes;
+
+static NameSet typed_looked_up; // Names looked up at run time, which may find a slot by name
+
+static int is_number_type(int type) {
+    return type == STATIC_INT || type == STATIC_DOUBLE || type == STATIC_NUMBER;
+}
+
+static int is_typed_slot(ASTNode *node, const SlotTypes *t) {
+    return node->var_scope == t->scope && node->var_slot >= 0 && node->var_slot < t->count;
+}
+
+static int expression_type(ASTNode *node, const SlotTypes *t) {
+    if (!node) return STATIC_UNKNOWN;
+    switch (node->type) {
+        case AST_LITERAL: {
+            if (strcmp(node->data_type, "string") == 0) return STATIC_UNKNOWN;
+            Value value = evaluate_expression(node, NULL);
+            int type = value.type == VAL_INT ? STATIC_INT : value.type == VAL_DOUBLE ? STATIC_DOUBLE :
+                       value.type == VAL_BOOL ? STATIC_BOOL : STATIC_UNKNOWN;
+            value_release(value);
+            return type;
+        }
+        case AST_IDENTIFIER:
+            if (!is_typed_slot(node, t) || t->excluded[node->var_slot]) return STATIC_UNKNOWN;
+            return t->types[node->var_slot];
+        case AST_BINARY_OP: {
+            const char *op = node->value;
+            if (is_assignment_operator(op)) {
+                if (op[0] == '=') return expression_type(node->right, t);
+                if (!node->left || node->left->type != AST_IDENTIFIER) return STATIC_UNKNOWN;
+                char arith_op[2] = { op[0], '\0' };
+                return ssa_binary_result_type(binary_operator_from_string(arith_op), expression_type(node->left, t), expression_type(node->right, t));
+            }
+            return ssa_binary_result_type(binary_operator_from_string(op), expression_type(node->left, t), expression_type(node->right, t));
+        }
+        case AST_UNARY_OP: {
+            if (strcmp(node->value, "!") == 0) return STATIC_BOOL;
+            if (strcmp(node->value, "-") != 0 && !is_increment(node)) return STATIC_UNKNOWN;
+            int operand = expression_type(node->left, t);
+            return operand == TYPE_NONE || is_number_type(operand) ? operand : STATIC_UNKNOWN;
+        }
+        case AST_TERNARY:
+            return ssa_join_types(expression_type(node->right, t), expression_type(node->next, t));
+        default:
+            return STATIC_UNKNOWN;
+    }
+}
+
+// What a declaration without an initializer stores
+static int default_type(ASTNode *decl) {
+    if (decl->type != AST_TYPED_VAR_DECL) return STATIC_UNKNOWN;
+    if (strcmp(decl->data_type, "int") == 0 || strcmp(decl->data_type, "long") == 0) return STATIC_INT;
+    if (strcmp(decl->data_type, "float") == 0 || strcmp(decl->data_type, "double") == 0) return STATIC_DOUBLE;
+    if (strcmp(decl->data_type, "bool") == 0) return STATIC_BOOL;
+    return STATIC_UNKNOWN;
+}
+
+static void join_store(SlotTypes *t, int slot, int type) {
+    int joined = ssa_join_types(t->types[slot], type);
+    if (joined != t->types[slot]) {
+        t->types[slot] = joined;
+        t->changed = 1;
+    }
+}
+
+// Joins the type of every store into a slot under node, other than in functions it defines
+static void join_stores(ASTNode *node, SlotTypes *t) {
+    for (; node; node = node->next) {
+        if (is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT) continue;
+        if ((node->type == AST_VAR_DECL || node->type == AST_TYPED_VAR_DECL) && is_typed_slot(node, t)) {
+            join_store(t, node->var_slot, node->right ? expression_type(node->right, t) : default_type(node));
+        } else if ((node->type == AST_ASSIGN || (node->type == AST_BINARY_OP && is_assignment_operator(node->value)) ||
+                    (node->type == AST_UNARY_OP && is_increment(node))) &&
+                   node->left && node->left->type == AST_IDENTIFIER && is_typed_slot(node->left, t)) {
+            join_store(t, node->left->var_slot, expression_type(node->type == AST_ASSIGN ? node->right : node, t));
+        }
+        join_stores(node->left, t);
+        join_stores(node->right, t);
+    }
+}
+
+// -- Reads before declarations --
+
+// Excludes the slots node reads (or writes) where no declaration of them has run
+static void exclude_undeclared(ASTNode *node, SlotTypes *t) {
+    if (!node || is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT) return;
+    if (node->type == AST_IDENTIFIER && is_typed_slot(node, t) && !t->declared[node->var_slot]) t->excluded[node->var_slot] = 1;
+    if (node->type == AST_TERNARY) exclude_undeclared(node->next, t); // The false branch
+    for (ASTNode *child = node->left; child; child = child->next) exclude_undeclared(child, t);
+    for (ASTNode *child = node->right; child; child = child->next) exclude_undeclared(child, t);
+}
+
+static void visit_declarations(ASTNode *node, SlotTypes *t);
+
+// Declarations in a body or list hold only until it ends
+static void visit_declarations_in_scope(ASTNode *node, SlotTypes *t, int is_list) {
+    char *saved = (char*)malloc(t->count > 0 ? t->count : 1);
+    if (!saved) {
+        fprintf(stderr, "Fatal Error: Could not allocate the declared slots of '%s'.\n", t->owner->value);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(saved, t->declared, t->count);
+    for (; node; node = is_list ? node->next : NULL) {
+        if (node->type != AST_ELSE) visit_declarations(node, t); // Visited with the preceding if
+    }
+    memcpy(t->declared, saved, t->count);
+    free(saved);
+}
+
+static void visit_declarations(ASTNode *node, SlotTypes *t) {
+    switch (node->type) {
+        case AST_FUNCTION: case AST_TYPED_FUNCTION: case AST_CLASS_METHOD: case AST_CLASS: case AST_STRUCT:
+            return;
+        case AST_VAR_DECL: case AST_TYPED_VAR_DECL:
+            exclude_undeclared(node->right, t);
+            if (is_typed_slot(node, t)) t->declared[node->var_slot] = 1;
+            return;
+        case AST_PROGRAM: case AST_BLOCK:
+            visit_declarations_in_scope(node->left, t, 1);
+            return;
+        case AST_IF:
+            exclude_undeclared(node->left, t);
+            if (node->right) visit_declarations_in_scope(node->right, t, 0);
+            if (node->next && node->next->type == AST_ELSE && node->next->left) visit_declarations_in_scope(node->next->left, t, 0);
+            return;
+        case AST_WHILE:
+            exclude_undeclared(node->left, t);
+            if (node->right) visit_declarations_in_scope(node->right, t, 0);
+            return;
+        case AST_FOR: {
+            // The loop is a scope of its own: init, then condition, body and update
+            ASTNode *init = node->left, *cond = init ? init->next : NULL, *incr = cond ? cond->next : NULL;
+            char *saved = (char*)malloc(t->count > 0 ? t->count : 1);
+            if (!saved) {
+                fprintf(stderr, "Fatal Error: Could not allocate the declared slots of '%s'.\n", t->owner->value);
+                exit(EXIT_FAILURE);
+            }
+            memcpy(saved, t->declared, t->count);
+            if (init && (init->type == AST_VAR_DECL || init->type == AST_TYPED_VAR_DECL)) visit_declarations(init, t);
+            else exclude_undeclared(init, t);
+            exclude_undeclared(cond, t);
+            if (node->right) visit_declarations_in_scope(node->right, t, 0);
+            exclude_undeclared(incr, t);
+            memcpy(t->declared, saved, t->count);
+            free(saved);
+            return;
+        }
+        default:
+            exclude_undeclared(node, t);
+            return;
+    }
+}
+
+// -- Proving and marking --
+
+static const char* static_type_name(int type) {
+    switch (type) {
+        case STATIC_INT:    return "int";
+        case STATIC_DOUBLE: return "float";
+        case STATIC_NUMBER: return "number";
+        case STATIC_BOOL:   return "bool";
+        default:            return "unknown";
+    }
+}
+
+// Marks every expression under node whose type is proven
+static void mark_static_types(ASTNode *node, const SlotTypes *t) {
+    for (; node; node = node->next) {
+        if (is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT) continue;
+        int type = expression_type(node, t);
+        node->static_type = type == TYPE_NONE ? STATIC_UNKNOWN : (StaticType)type;
+        if (node->type == AST_MAP) {
+            // Keys are property names, not evaluated; only the values are expressions
+            for (ASTNode *pair = node->left; pair; pair = pair->next) mark_static_types(pair->right, t);
+            continue;
+        }
+        mark_static_types(node->left, t);
+        mark_static_types(node->right, t);
+    }
+}
+
+// Proves the types of owner's slots and marks its expressions. excluded holds a
+// byte per slot, 1 for those that are not typed; it is updated.
+static void prove_slot_types(ASTNode *owner, VariableScope scope, ASTNode *body, char *excluded) {
+    SlotTypes t = {0};
+    t.owner = owner;
+    t.scope = scope;
+    t.count = owner->local_count;
+    t.excluded = excluded;
+    t.types = (int*)malloc(sizeof(int) * (t.count > 0 ? t.count : 1));
+    t.declared = (char*)calloc(t.count > 0 ? t.count : 1, 1);
+    if (!t.types || !t.declared) {
+        fprintf(stderr, "Fatal Error: Could not allocate the slot types of '%s'.\n", owner->value);
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < t.count; i++) {
+        t.types[i] = TYPE_NONE;
+        if (name_set_has(&typed_looked_up, owner->local_names[i])) excluded[i] = 1;
+    }
+    if (body) visit_declarations(body, &t);
+    do {
+        t.changed = 0;
+        if (body) join_stores(body->type == AST_PROGRAM ? body->left : body, &t);
+    } while (t.changed);
+
+    char proven[512];
+    size_t length = 0;
+    proven[0] = '\0';
+    for (int i = 0; i < t.count; i++) {
+        if (excluded[i] || t.types[i] == TYPE_NONE || t.types[i] == STATIC_UNKNOWN) {
+            excluded[i] = 1;
+            continue;
+        }
+        if (length < sizeof(proven)) {
+            length += (size_t)snprintf(proven + length, sizeof(proven) - length, "%s%s %s", length ? ", " : "",
+                                       owner->local_names[i], static_type_name(t.types[i]));
+        }
+    }
+    if (body) mark_static_types(body->type == AST_PROGRAM ? body->left : body, &t);
+    if (proven[0]) printf("[OPT] Proved static types in %s: %s\n", scope == VAR_GLOBAL ? "top-level code" : owner->value, proven);
+    free(t.types);
+    free(t.declared);
+}
+
+static void prove_function_types(ASTNode *node) {
+    for (; node; node = node->next) {
+        if (is_function_node(node)) {
+            char *excluded = (char*)calloc(node->local_count > 0 ? node->local_count : 1, 1);
+            if (!excluded) {
+                fprintf(stderr, "Fatal Error: Could not allocate the slot types of '%s'.\n", node->value);
+                exit(EXIT_FAILURE);
+            }
+            for (ASTNode *param = node->left; param; param = param->next) {
+                if (param->type == AST_PARAMETER && param->var_scope == VAR_LOCAL && param->var_slot >= 0) excluded[param->var_slot] = 1;
+            }
+            prove_slot_types(node, VAR_LOCAL, node->right, excluded);
+            free(excluded);
+        }
+        prove_function_types(node->left);
+        prove_function_types(node->right);
+    }
+}
+
+// Excludes the globals that code in functions uses
+static void exclude_function_globals(ASTNode *node, char *excluded, int in_function) {
+    for (; node; node = node->next) {
+        int inside = in_function || is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT;
+        if (inside && node->type == AST_IDENTIFIER && node->var_scope == VAR_GLOBAL && node->var_slot >= 0) excluded[node->var_slot] = 1;
+        exclude_function_globals(node->left, excluded, inside);
+        exclude_function_globals(node->right, excluded, inside);
+    }
+}
+
+static void prove_static_types(ASTNode *program_node) {
+    if (program_imports) return;
+    add_looked_up_names(program_node->left, &typed_looked_up);
+    char *excluded = (char*)calloc(program_node->local_count > 0 ? program_node->local_count : 1, 1);
+    if (!excluded) {
+        fprintf(stderr, "Fatal Error: Could not allocate the slot types of the program.\n");
+        exit(EXIT_FAILURE);
+    }
+    exclude_function_globals(program_node->left, excluded, 0);
+    prove_slot_types(program_node, VAR_GLOBAL, program_node, excluded);
+    free(excluded);
+    prove_function_types(program_node->left);
+    name_set_free(&typed_looked_up);
+}
+
+static void propagate_constants(ASTNode *program_node) {
+    for (int round = 0; round < OPTIMIZE_MAX_ROUNDS; round++) {
+        ConstEnv env = {0};
+        changes = 0;
+        find_global_constants(program_node);
+        optimize_statement_list(&program_node->left, &env);
+        env_free(&env);
+        if (!changes) break;
+    }
+}
+
+void optimize_ast(ASTNode *root) {
+    if (!root || root->type != AST_PROGRAM) {
+        constant_fold(root);
+        return;
+    }
+    find_pure_builtins(root);
+    inline_calls(root);
+    replace_scalars(root);
+    propagate_constants(root);
+    optimize_loops(root); // Calls and function writes are as the last round found them
+    if (optimize_ssa(root)) propagate_constants(root);
+    env_free(&global_constants);
+    env_free(&function_writes);
+    eliminate_dead_code(root);
+    prove_static_types(root);
+}
@@ -3,7 +3,23 @@
 
 #include "ast_types.h" // Changed from parser.h to ast_types.h for ASTNode definition
 
+// Inlining of small functions, constant propagation, folding, constant-branch pruning,
+// loop-invariant code motion, strength reduction, SSA-based constant propagation and
+// value numbering (ssa.h), dead-code elimination and static typing (node->static_type)
+// over a program that has been through semantic analysis (variable slots must be
+// resolved)
 void optimize_ast(ASTNode *root);
+void optimize_set_print_opt_enabled(int enabled); // -print-opt: report each inlining decision
+
+// Declarations of a program that imports modules are pruned as run_vm registers them:
+// it adds every imported module to the reachability analysis first, then skips the
+// declarations nothing reaches. Every declaration is reachable when the optimizer has
+// not run.
+int optimize_prunes_imports(void);
+void optimize_reach_module(ASTNode *module_program);
+int optimize_declaration_reachable(ASTNode *decl);
+void optimize_cleanup(void); // Frees the analysis kept for run_vm
+// Folds operators on literals in the expression rooted at node, in place
 void constant_fold(ASTNode *node); // Expose for potential direct use or testing
 
-#endif // OPTIMIZE_H
\ No newline at end of file
+#endif // OPTIMIZE_H
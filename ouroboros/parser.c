@@ -1,3 +1,6 @@
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE // For strdup under -std=c99
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -120,6 +123,8 @@ ASTNode* parse(Token* token_array) {
                 last_stmt = stmt;
             }
             else {
+                // An if-statement carries its AST_ELSE in ->next; append after it
+                while (last_stmt->next) last_stmt = last_stmt->next;
                 last_stmt->next = stmt;
                 last_stmt = stmt;
             }
@@ -211,8 +216,11 @@ static ASTNode* parse_statement() {
         if (peek.type == TOKEN_IDENTIFIER) { // MyType myVar;
             stmt = parse_typed_variable_declaration();
         }
-        else if (peek.type == TOKEN_SYMBOL && strcmp(peek.text, "[") == 0) { // MyType[] ...
-            stmt = parse_typed_variable_declaration();
+        else if (peek.type == TOKEN_SYMBOL && strcmp(peek.text, "[") == 0) { // MyType[] ..., not name[i] = ...
+            Token peek2 = peek_token_n(2);
+            if (peek2.type == TOKEN_SYMBOL && strcmp(peek2.text, "]") == 0) {
+                stmt = parse_typed_variable_declaration();
+            }
         }
         else if (peek.type == TOKEN_SYMBOL && strcmp(peek.text, ":") == 0) { // myVar: MyType
             stmt = parse_typed_variable_declaration();
@@ -278,6 +286,8 @@ static ASTNode* parse_block() {
                 last_stmt = stmt;
             }
             else {
+                // An if-statement carries its AST_ELSE in ->next; append after it
+                while (last_stmt->next) last_stmt = last_stmt->next;
                 last_stmt->next = stmt;
                 last_stmt = stmt;
             }
@@ -301,9 +311,6 @@ static ASTNode* parse_typed_variable_declaration() {
         Token next = peek_token();
         if (next.type == TOKEN_SYMBOL && strcmp(next.text, ":") == 0) {
             // This is colon-style: name: type
-            char var_name_str[sizeof(((ASTNode*)0)->value)];
-            strncpy(var_name_str, name_token.text, sizeof(var_name_str) - 1);
-            var_name_str[sizeof(var_name_str) - 1] = '\0';
             advance(); // consume name
             advance(); // consume ':'
             
@@ -365,7 +372,7 @@ static ASTNode* parse_typed_variable_declaration() {
                 array_dims++;
             }
             
-            ASTNode* var_decl = create_node(AST_TYPED_VAR_DECL, var_name_str, start_token.line, start_token.col);
+            ASTNode* var_decl = create_node(AST_TYPED_VAR_DECL, name_token.text, start_token.line, start_token.col);
             strncpy(var_decl->data_type, type_str, sizeof(var_decl->data_type) - 1);
             var_decl->data_type[sizeof(var_decl->data_type) - 1] = '\0';
             for(int i = 0; i < array_dims; i++) strcat(var_decl->data_type, "[]");
@@ -386,7 +393,7 @@ static ASTNode* parse_typed_variable_declaration() {
             }
             
             if (current_token.type != TOKEN_SYMBOL || strcmp(current_token.text, ";") != 0) {
-                fprintf(stderr, "Error (L%d:%d): Expected ';' after variable declaration of '%s'\n", current_token.line, current_token.col, var_name_str);
+                fprintf(stderr, "Error (L%d:%d): Expected ';' after variable declaration of '%s'\n", current_token.line, current_token.col, name_token.text);
                 free_ast(var_decl);
                 return NULL;
             }
@@ -464,14 +471,12 @@ static ASTNode* parse_typed_variable_declaration() {
         free(type_str);
         return NULL;
     }
-    char var_name_str[sizeof(((ASTNode*)0)->value)]; // Ensure buffer is same size as ASTNode.value
-    strncpy(var_name_str, current_token.text, sizeof(var_name_str) - 1);
-    var_name_str[sizeof(var_name_str) - 1] = '\0';
+    Token name_token = current_token;
     advance();
 
     // Do not modify type_str in-place; we'll build array suffix directly in var_decl below.
     // We'll set var_decl->is_array after we create the node below.
-    ASTNode* var_decl = create_node(AST_TYPED_VAR_DECL, var_name_str, type_token.line, type_token.col);
+    ASTNode* var_decl = create_node(AST_TYPED_VAR_DECL, name_token.text, type_token.line, type_token.col);
     strncpy(var_decl->data_type, type_str, sizeof(var_decl->data_type) - 1);
     var_decl->data_type[sizeof(var_decl->data_type) - 1] = '\0';
     for(int i=0;i<array_dims;i++) strcat(var_decl->data_type, "[]");
@@ -493,7 +498,7 @@ static ASTNode* parse_typed_variable_declaration() {
     }
 
     if (current_token.type != TOKEN_SYMBOL || strcmp(current_token.text, ";") != 0) {
-        fprintf(stderr, "Error (L%d:%d): Expected ';' after variable declaration of '%s'\n", current_token.line, current_token.col, var_name_str);
+        fprintf(stderr, "Error (L%d:%d): Expected ';' after variable declaration of '%s'\n", current_token.line, current_token.col, name_token.text);
         free_ast(var_decl);
         return NULL;
     }
@@ -563,9 +568,6 @@ static ASTNode* parse_variable_declaration() {
         Token next = peek_token();
         if (next.type == TOKEN_SYMBOL && strcmp(next.text, ":") == 0) {
             // This is colon-style with let/var/const
-            char var_name_str[sizeof(((ASTNode*)0)->value)];
-            strncpy(var_name_str, name_token.text, sizeof(var_name_str) - 1);
-            var_name_str[sizeof(var_name_str) - 1] = '\0';
             advance(); // consume name
             advance(); // consume ':'
             
@@ -627,7 +629,7 @@ static ASTNode* parse_variable_declaration() {
                 array_dims++;
             }
             
-            ASTNode* var_decl = create_node(AST_TYPED_VAR_DECL, var_name_str, keyword_token.line, keyword_token.col);
+            ASTNode* var_decl = create_node(AST_TYPED_VAR_DECL, name_token.text, keyword_token.line, keyword_token.col);
             strncpy(var_decl->data_type, type_str, sizeof(var_decl->data_type) - 1);
             var_decl->data_type[sizeof(var_decl->data_type) - 1] = '\0';
             for(int i = 0; i < array_dims; i++) strcat(var_decl->data_type, "[]");
@@ -652,7 +654,7 @@ static ASTNode* parse_variable_declaration() {
             }
             
             if (current_token.type != TOKEN_SYMBOL || strcmp(current_token.text, ";") != 0) {
-                fprintf(stderr, "Error (L%d:%d): Expected ';' after variable declaration of '%s'\n", current_token.line, current_token.col, var_name_str);
+                fprintf(stderr, "Error (L%d:%d): Expected ';' after variable declaration of '%s'\n", current_token.line, current_token.col, name_token.text);
                 free_ast(var_decl);
                 return NULL;
             }
@@ -1066,7 +1068,7 @@ static ASTNode* parse_binary_expression(ASTNode* left, int min_precedence) {
             }
             else { // Left-associative
                 if (next_prec <= prec) break;
-                right = parse_binary_expression(right, next_prec);
+                right = parse_binary_expression(right, prec); // Takes every operator that binds tighter than op
             }
 
             if (!right) { free_ast(left); return NULL; }
@@ -1148,9 +1150,10 @@ static ASTNode* parse_primary() {
             node = parse_array_literal();
         }
         else if (current_token.type == TOKEN_SYMBOL && strcmp(current_token.text, "{") == 0) {
-            // Distinguish map literal vs block: only parse map if key token follows
+            // Distinguish map literal vs block: only parse map if a key token or '}' follows
             Token next = peek_token();
-            if (next.type == TOKEN_IDENTIFIER || next.type == TOKEN_STRING || next.type == TOKEN_NUMBER) {
+            if (next.type == TOKEN_IDENTIFIER || next.type == TOKEN_STRING || next.type == TOKEN_NUMBER ||
+                (next.type == TOKEN_SYMBOL && strcmp(next.text, "}") == 0)) {
                 node = parse_map_literal();
             }
             // Otherwise leave '{' for block parsing in class/function
@@ -1210,7 +1213,7 @@ static ASTNode* parse_primary() {
             call_node->left = args;
             if (node->type == AST_MEMBER_ACCESS) {
                 call_node->right = node->left; // The object/class expression
-                strncpy(call_node->value, node->value, sizeof(call_node->value) - 1); // The method name from member access
+                call_node->value = node->value; // The method name from member access
                 // The original 'node' (which was AST_MEMBER_ACCESS) is now replaced by 'call_node'.
                 // We need to free the old 'node' to avoid memory leak if it was heap allocated.
                 // However, 'node' is just a pointer. If parse_member_access returned a new node,
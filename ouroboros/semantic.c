@@ -6,6 +6,7 @@
 #include "ast_types.h"
 #include "parser.h" // For is_builtin_type_keyword
 #include "vm.h" // For AccessModifierEnum
+#include "intern.h"
 
 // --- Symbol Table Implementation ---
 SymbolTable* g_st = NULL; 
@@ -46,6 +47,7 @@ void symbol_table_destroy(SymbolTable* st) {
     if (!st) return;
     while (st->current_scope_idx >= 0) {
         Scope* current = st->scope_stack[st->current_scope_idx];
+        free(current->symbols);
         free(current);
         st->scope_stack[st->current_scope_idx] = NULL;
         st->current_scope_idx--;
@@ -89,6 +91,7 @@ void symbol_table_exit_scope(SymbolTable* st) {
     Scope* exited_scope = st->scope_stack[st->current_scope_idx];
     // printf("[Scope] Exited scope: %s (level %d)\n", exited_scope->scope_name, exited_scope->level);
     
+    free(exited_scope->symbols);
     free(exited_scope);
     st->scope_stack[st->current_scope_idx] = NULL;
     st->current_scope_idx--;
@@ -102,8 +105,9 @@ int symbol_table_add_symbol(SymbolTable* st, const char* name, SymbolKind kind,
         return 0;
     }
 
+    name = intern(name);
     for (int i = 0; i < current_scope->symbol_count; ++i) {
-        if (strcmp(current_scope->symbols[i].name, name) == 0) {
+        if (current_scope->symbols[i].name == name) {
             fprintf(stderr, "[SEMANTIC L%d:%d] Error: Symbol '%s' already defined in this scope (previous def at L%d:%d as %s).\n",
                     decl_node->line, decl_node->col, name, 
                     current_scope->symbols[i].declaration_node->line, current_scope->symbols[i].declaration_node->col,
@@ -112,15 +116,19 @@ int symbol_table_add_symbol(SymbolTable* st, const char* name, SymbolKind kind,
         }
     }
 
-    if (current_scope->symbol_count >= MAX_SCOPE_SYMBOLS) {
-        fprintf(stderr, "Error (L%d:%d): Maximum symbols (%d) reached in scope '%s' when adding '%s'.\n",
-                decl_node->line, decl_node->col, MAX_SCOPE_SYMBOLS, current_scope->scope_name, name);
-        return 0;
+    if (current_scope->symbol_count == current_scope->symbol_capacity) {
+        int new_capacity = current_scope->symbol_capacity ? current_scope->symbol_capacity * 2 : 16;
+        Symbol* grown = (Symbol*)realloc(current_scope->symbols, sizeof(Symbol) * new_capacity);
+        if (!grown) {
+            fprintf(stderr, "Fatal Error: Could not grow scope '%s' when adding '%s'.\n", current_scope->scope_name, name);
+            exit(EXIT_FAILURE);
+        }
+        current_scope->symbols = grown;
+        current_scope->symbol_capacity = new_capacity;
     }
 
     Symbol* new_sym = &current_scope->symbols[current_scope->symbol_count];
-    strncpy(new_sym->name, name, sizeof(new_sym->name) - 1);
-    new_sym->name[sizeof(new_sym->name) - 1] = '\0';
+    new_sym->name = name;
     new_sym->kind = kind;
     if (type_name) {
         strncpy(new_sym->type_name, type_name, sizeof(new_sym->type_name) - 1);
@@ -139,10 +147,11 @@ int symbol_table_add_symbol(SymbolTable* st, const char* name, SymbolKind kind,
 Symbol* symbol_table_lookup_current_scope(SymbolTable* st, const char* name) {
     if (!st) return NULL;
     Scope* current_scope = symbol_table_get_current_scope(st);
-    if (!current_scope) return NULL;
+    name = intern_lookup(name);
+    if (!current_scope || !name) return NULL;
 
     for (int i = 0; i < current_scope->symbol_count; ++i) {
-        if (strcmp(current_scope->symbols[i].name, name) == 0) {
+        if (current_scope->symbols[i].name == name) {
             return &current_scope->symbols[i];
         }
     }
@@ -151,10 +160,12 @@ Symbol* symbol_table_lookup_current_scope(SymbolTable* st, const char* name) {
 
 Symbol* symbol_table_lookup_all_scopes(SymbolTable* st, const char* name) {
     if (!st) return NULL;
+    name = intern_lookup(name);
+    if (!name) return NULL;
     Scope* scope_to_search = symbol_table_get_current_scope(st);
     while (scope_to_search) {
         for (int i = 0; i < scope_to_search->symbol_count; ++i) {
-            if (strcmp(scope_to_search->symbols[i].name, name) == 0) {
+            if (scope_to_search->symbols[i].name == name) {
                 return &scope_to_search->symbols[i];
             }
         }
@@ -241,7 +252,6 @@ static void analyze_function_decl(ASTNode *func_node, ASTNode *parent_class_node
             return;
         }
         ASTNode* this_param = create_node(AST_PARAMETER, "this", func_node->line, func_node->col);
-        strncpy(this_param->value, "this", sizeof(this_param->value) - 1);
         this_param->left = create_node(AST_TYPE, parent_class_node_or_null->value, func_node->line, func_node->col);
         // Set access modifier string to "public"
         strncpy(this_param->access_modifier, "public", sizeof(this_param->access_modifier) - 1);
@@ -511,7 +521,147 @@ static void analyze_node(ASTNode *node) {
     }
 }
 
+// --- Variable Slot Resolution ---
+// The VM creates one frame per function call plus the global frame; blocks share
+// their function's frame. Each distinct name declared in a function (parameters and
+// var declarations at any block depth) therefore gets one slot in that function's
+// frame, and names declared in top-level code get a slot in the global frame.
+// References that match neither stay VAR_UNRESOLVED and are looked up by name:
+// class members, the caller's locals (frames chain to the caller) and names that
+// are only ever assigned without a declaration.
+
+typedef struct SlotScope {
+    ASTNode *owner;               // Function or program node holding the slot layout; NULL if none
+    VariableScope kind;           // VAR_LOCAL or VAR_GLOBAL
+    struct SlotScope *enclosing;  // Lexically enclosing function, then the program
+} SlotScope;
+
+static void resolve_slots_in_list(ASTNode *node, SlotScope *scope);
+
+// Names are node values, so they are interned and compared by pointer
+static int find_slot(ASTNode *owner, const char *name) {
+    for (int i = 0; i < owner->local_count; i++) {
+        if (owner->local_names[i] == name) return i;
+    }
+    return -1;
+}
+
+static int add_slot(ASTNode *owner, const char *name) {
+    int slot = find_slot(owner, name);
+    if (slot >= 0) return slot;
+    const char **grown = (const char**)realloc(owner->local_names, sizeof(char*) * (owner->local_count + 1));
+    if (!grown) {
+        fprintf(stderr, "Fatal Error: Could not allocate variable slot '%s' in '%s'.\n", name, owner->value);
+        exit(EXIT_FAILURE);
+    }
+    owner->local_names = grown;
+    owner->local_names[owner->local_count] = name;
+    return owner->local_count++;
+}
+
+// Allocates slots for every declaration in a statement list, without entering
+// nested functions or class bodies (they run in their own frames)
+static void declare_slots_in_list(ASTNode *node, ASTNode *owner) {
+    for (; node; node = node->next) {
+        switch (node->type) {
+            case AST_FUNCTION: case AST_TYPED_FUNCTION: case AST_CLASS_METHOD:
+            case AST_CLASS: case AST_STRUCT: case AST_IMPORT:
+                continue;
+            case AST_VAR_DECL: case AST_TYPED_VAR_DECL:
+                add_slot(owner, node->value);
+                break;
+            default:
+                break;
+        }
+        declare_slots_in_list(node->left, owner);
+        declare_slots_in_list(node->right, owner);
+    }
+}
+
+static void resolve_identifier_slot(ASTNode *node, SlotScope *scope) {
+    for (SlotScope *s = scope; s; s = s->enclosing) {
+        if (!s->owner) continue;
+        int slot = find_slot(s->owner, node->value);
+        if (slot < 0) continue;
+        // An enclosing function's local is only reachable through the caller chain
+        if (s == scope || s->kind == VAR_GLOBAL) {
+            node->var_scope = s->kind;
+            node->var_slot = slot;
+        }
+        return;
+    }
+}
+
+static void resolve_function_slots(ASTNode *func_node, SlotScope *enclosing) {
+    SlotScope scope = { func_node, VAR_LOCAL, enclosing };
+    // 'this' is bound by name when a method is invoked
+    for (ASTNode *param = func_node->left; param; param = param->next) {
+        if (param->type != AST_PARAMETER || strcmp(param->value, "this") == 0) continue;
+        param->var_scope = VAR_LOCAL;
+        param->var_slot = add_slot(func_node, param->value);
+    }
+    declare_slots_in_list(func_node->right, func_node);
+    resolve_slots_in_list(func_node->right, &scope);
+}
+
+static void resolve_slots_in_list(ASTNode *node, SlotScope *scope) {
+    for (; node; node = node->next) {
+        switch (node->type) {
+            case AST_FUNCTION: case AST_TYPED_FUNCTION: case AST_CLASS_METHOD:
+                resolve_function_slots(node, scope);
+                continue;
+            case AST_CLASS: case AST_STRUCT:
+                // Fields live on objects; only method bodies hold variables
+                for (ASTNode *member = node->left; member; member = member->next) {
+                    if (member->type == AST_FUNCTION || member->type == AST_TYPED_FUNCTION || member->type == AST_CLASS_METHOD) {
+                        resolve_function_slots(member, scope);
+                    }
+                }
+                continue;
+            case AST_IMPORT: case AST_TYPE: case AST_GENERIC: case AST_PARAMETER:
+                continue;
+            case AST_MAP:
+                // Keys are property names; only the values are expressions
+                for (ASTNode *pair = node->left; pair; pair = pair->next) {
+                    resolve_slots_in_list(pair->right, scope);
+                }
+                continue;
+            case AST_IDENTIFIER:
+                resolve_identifier_slot(node, scope);
+                break;
+            case AST_VAR_DECL: case AST_TYPED_VAR_DECL:
+                if (scope->owner) {
+                    node->var_scope = scope->kind;
+                    node->var_slot = find_slot(scope->owner, node->value);
+                }
+                break;
+            default:
+                break;
+        }
+        resolve_slots_in_list(node->left, scope);
+        resolve_slots_in_list(node->right, scope);
+    }
+}
+
+// Assigns slots for a whole program. Imported modules only contribute functions
+// and classes, so their top-level variables never get global slots.
+static void resolve_variable_slots(ASTNode *program_ast_root, int allocate_globals) {
+    SlotScope global_scope = { allocate_globals ? program_ast_root : NULL, VAR_GLOBAL, NULL };
+    if (allocate_globals) declare_slots_in_list(program_ast_root->left, program_ast_root);
+    resolve_slots_in_list(program_ast_root->left, &global_scope);
+}
+
+static void analyze_program_internal(ASTNode *program_ast_root, int is_module);
+
 void analyze_program(ASTNode *program_ast_root) {
+    analyze_program_internal(program_ast_root, 0);
+}
+
+void analyze_module(ASTNode *module_ast_root) {
+    analyze_program_internal(module_ast_root, 1);
+}
+
+static void analyze_program_internal(ASTNode *program_ast_root, int is_module) {
     if (!program_ast_root) {
         fprintf(stderr, "[SEMANTIC] Error: NULL AST provided for analysis.\n");
         return;
@@ -542,7 +692,8 @@ void analyze_program(ASTNode *program_ast_root) {
 
     /* Second pass: full semantic analysis */
     analyze_node(program_ast_root);
-    
+    resolve_variable_slots(program_ast_root, !is_module);
+
     symbol_table_destroy(g_st);
     g_st = NULL;
     printf("[SEMANTIC] Semantic analysis pass complete.\n");
@@ -833,6 +984,7 @@ static void analyze_for_stmt(ASTNode *for_node) {
 
 static void analyze_call_expr_or_stmt(ASTNode *call_node) {
     if (!call_node) return;
+    if (call_node->right) return; // Method calls (obj.m(), array.push()) resolve against their target at runtime
     
     Symbol* func_sym = symbol_table_lookup_all_scopes(g_st, call_node->value);
     if (!func_sym) {
@@ -3,8 +3,6 @@
 
 #include "ast_types.h"
 
-// Maximum number of symbols in a single scope
-#define MAX_SCOPE_SYMBOLS 100
 // Maximum scope depth (nesting)
 #define MAX_SCOPE_DEPTH 50
 
@@ -20,7 +18,7 @@ typedef enum {
 
 // Symbol structure
 typedef struct Symbol {
-    char name[128];
+    const char *name;         // Interned (intern.h)
     SymbolKind kind;
     char type_name[64];       // Data type name (e.g., "int", "MyClass")
     ASTNode* declaration_node; // Pointer to the AST node where it was declared
@@ -30,8 +28,9 @@ typedef struct Symbol {
 
 // Scope structure (part of the SymbolTable)
 typedef struct Scope {
-    Symbol symbols[MAX_SCOPE_SYMBOLS];
+    Symbol *symbols;          // Grows as symbols are added
     int symbol_count;
+    int symbol_capacity;
     struct Scope* parent_scope; // Enclosing scope
     int level;                // Nesting level (0 for global)
     char scope_name[128];     // e.g., function name, class name, "block"
@@ -56,7 +55,8 @@ Scope* symbol_table_get_current_scope(SymbolTable* st);
 
 
 // Analysis functions
-void analyze_program(ASTNode *ast); // Takes the root AST node
+void analyze_program(ASTNode *ast); // Takes the root AST node; also assigns variable slots (VAR_LOCAL/VAR_GLOBAL)
+void analyze_module(ASTNode *ast);  // Same for an imported module, whose top-level variables are never run
 void check_semantics(ASTNode *ast);  // Placeholder for more detailed checks
 
 #endif // SEMANTIC_H
\ No newline at end of file
@@ -0,0 +1,1516 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ssa.h"
+
+// Construction follows Braun et al., "Simple and Efficient Construction of Static
+// Single Assignment Form": the body is lowered in execution order, each block keeps
+// the value each tracked slot has at its end so far, and a read in a block that does
+// not store the slot asks its predecessors, placing a phi where several meet. A loop
+// header is sealed once its back edges are known; reads there until then get phis
+// that are completed when it is. Phis whose arguments turn out all the same are
+// replaced by that value. The lowering mirrors ir.c: what ir.c compiles to bytecode
+// becomes values and blocks here, and what it leaves to eval.c is opaque.
+
+#define SSA_MAX_ROUNDS 8
+#define SSA_STRING_LIMIT 4096 // Longer strings are not propagated
+
+typedef struct LoopTargets {
+    int break_block;
+    int continue_block;
+    struct LoopTargets *enclosing;
+} LoopTargets;
+
+typedef struct Builder {
+    SsaFunction *f;
+    int current;          // Block being filled
+    LoopTargets *loop;
+    int failed;           // break or continue outside a loop
+    int effects;          // Opaque values, stores and increments made so far
+    int stores;           // Stores into tracked slots made so far
+    int *stored_at;       // Per slot: stores made when it was last stored
+    int *read_stamp;      // Per slot: last opaque value that read it
+    ASTNode *statement;   // Statement being lowered, if a temporary could go before it
+    int statement_stores; // Stores made when it started
+} Builder;
+
+static int lower_expression(Builder *b, ASTNode *node);
+static void lower_statement(Builder *b, ASTNode *node);
+
+// --- Storage ---
+
+static void grow(void **items, int count, int *capacity, size_t item_size, const char *what) {
+    if (count < *capacity) return;
+    int new_capacity = *capacity ? *capacity * 2 : 8;
+    void *grown = realloc(*items, item_size * new_capacity);
+    if (!grown) {
+        fprintf(stderr, "Fatal Error: Could not allocate %s.\n", what);
+        exit(EXIT_FAILURE);
+    }
+    *items = grown;
+    *capacity = new_capacity;
+}
+
+static void add_arg(SsaFunction *f, int value, int arg) {
+    SsaValue *v = &f->values[value];
+    grow((void**)&v->args, v->arg_count, &v->arg_capacity, sizeof(int), "SSA operands");
+    v->args[v->arg_count++] = arg;
+}
+
+static void add_to_block(SsaFunction *f, int block, int value) {
+    SsaBlock *blk = &f->blocks[block];
+    grow((void**)&blk->values, blk->value_count, &blk->value_capacity, sizeof(int), "SSA block");
+    blk->values[blk->value_count++] = value;
+}
+
+static int new_value(SsaFunction *f, SsaOp op, int block, ASTNode *node) {
+    grow((void**)&f->values, f->value_count, &f->value_capacity, sizeof(SsaValue), "SSA values");
+    int id = f->value_count++;
+    SsaValue *v = &f->values[id];
+    memset(v, 0, sizeof(*v));
+    v->op = op;
+    v->slot = -1;
+    v->block = block;
+    v->constant = value_undefined();
+    v->type = STATIC_UNKNOWN;
+    v->node = node;
+    v->replaced_by = -1;
+    if (block >= 0) add_to_block(f, block, id);
+    return id;
+}
+
+static int new_block(SsaFunction *f) {
+    grow((void**)&f->blocks, f->block_count, &f->block_capacity, sizeof(SsaBlock), "SSA blocks");
+    int id = f->block_count++;
+    SsaBlock *blk = &f->blocks[id];
+    memset(blk, 0, sizeof(*blk));
+    blk->defs = (int*)malloc(sizeof(int) * (f->slot_count > 0 ? f->slot_count : 1));
+    if (!blk->defs) {
+        fprintf(stderr, "Fatal Error: Could not allocate SSA block.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < f->slot_count; i++) blk->defs[i] = -1;
+    return id;
+}
+
+int ssa_resolve(const SsaFunction *f, int value) {
+    while (value >= 0 && f->values[value].replaced_by >= 0) value = f->values[value].replaced_by;
+    return value;
+}
+
+static void replace_value(SsaFunction *f, int value, int by) {
+    by = ssa_resolve(f, by);
+    if (by == value) return;
+    f->values[value].replaced_by = by;
+    f->values[value].removed = 1;
+}
+
+static int is_terminator(SsaOp op) {
+    return op == SSA_JUMP || op == SSA_BRANCH || op == SSA_RETURN;
+}
+
+// Drops removed values from the blocks' lists
+static void compact_blocks(SsaFunction *f) {
+    for (int i = 0; i < f->block_count; i++) {
+        SsaBlock *blk = &f->blocks[i];
+        int kept = 0;
+        for (int j = 0; j < blk->value_count; j++) {
+            if (!f->values[blk->values[j]].removed) blk->values[kept++] = blk->values[j];
+        }
+        blk->value_count = kept;
+    }
+}
+
+// --- Types ---
+
+static int is_number_type(int type) {
+    return type == STATIC_INT || type == STATIC_DOUBLE || type == STATIC_NUMBER;
+}
+
+int ssa_join_types(int a, int b) {
+    if (a == SSA_TYPE_NONE) return b;
+    if (b == SSA_TYPE_NONE || a == b) return a;
+    if (a == STATIC_UNKNOWN || b == STATIC_UNKNOWN || a == STATIC_BOOL || b == STATIC_BOOL) return STATIC_UNKNOWN;
+    return STATIC_NUMBER;
+}
+
+// What op gives on operands of these types, as evaluate_binary_operator computes it
+int ssa_binary_result_type(BinaryOperator op, int left, int right) {
+    if (op >= BINOP_EQ && op <= BINOP_OR) return STATIC_BOOL;
+    if (op == BINOP_UNKNOWN) return STATIC_UNKNOWN;
+    if ((left != SSA_TYPE_NONE && !is_number_type(left)) || (right != SSA_TYPE_NONE && !is_number_type(right))) return STATIC_UNKNOWN;
+    if (left == SSA_TYPE_NONE || right == SSA_TYPE_NONE) return SSA_TYPE_NONE;
+    if (op == BINOP_SHL || op == BINOP_SHR) return STATIC_INT;
+    if (left == STATIC_DOUBLE || right == STATIC_DOUBLE) return STATIC_DOUBLE; // Division by zero gives NaN
+    if (left == STATIC_INT && right == STATIC_INT && op != BINOP_DIV && op != BINOP_MOD) return STATIC_INT;
+    return STATIC_NUMBER; // Inexact division, and modulus by zero, give doubles
+}
+
+static int constant_type(Value v) {
+    switch (v.type) {
+        case VAL_INT:    return STATIC_INT;
+        case VAL_DOUBLE: return STATIC_DOUBLE;
+        case VAL_BOOL:   return STATIC_BOOL;
+        default:         return STATIC_UNKNOWN;
+    }
+}
+
+// Proves the type of every value, from the constants up until nothing changes
+static void infer_types(SsaFunction *f) {
+    int *types = (int*)malloc(sizeof(int) * (f->value_count > 0 ? f->value_count : 1));
+    if (!types) {
+        fprintf(stderr, "Fatal Error: Could not allocate SSA types.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < f->value_count; i++) types[i] = SSA_TYPE_NONE;
+    int changed;
+    do {
+        changed = 0;
+        for (int i = 0; i < f->value_count; i++) {
+            const SsaValue *v = &f->values[i];
+            if (v->removed || is_terminator(v->op)) continue;
+            int arg = v->arg_count > 0 ? types[ssa_resolve(f, v->args[0])] : SSA_TYPE_NONE;
+            int type;
+            switch (v->op) {
+                case SSA_CONST:
+                    type = constant_type(v->constant);
+                    break;
+                case SSA_PHI:
+                    type = SSA_TYPE_NONE;
+                    for (int j = 0; j < v->arg_count; j++) type = ssa_join_types(type, types[ssa_resolve(f, v->args[j])]);
+                    break;
+                case SSA_BINARY:
+                    type = ssa_binary_result_type((BinaryOperator)v->op_code, arg, types[ssa_resolve(f, v->args[1])]);
+                    break;
+                case SSA_NEGATE: case SSA_INCREMENT:
+                    type = arg == SSA_TYPE_NONE || is_number_type(arg) ? arg : STATIC_UNKNOWN;
+                    break;
+                case SSA_NOT: case SSA_TO_BOOL:
+                    type = STATIC_BOOL;
+                    break;
+                default:
+                    type = STATIC_UNKNOWN;
+                    break;
+            }
+            type = ssa_join_types(types[i], type);
+            if (type != types[i]) {
+                types[i] = type;
+                changed = 1;
+            }
+        }
+    } while (changed);
+    for (int i = 0; i < f->value_count; i++) {
+        if (!f->values[i].removed) f->values[i].type = types[i] == SSA_TYPE_NONE ? STATIC_UNKNOWN : (StaticType)types[i];
+    }
+    free(types);
+}
+
+// Whether computing v can report an error
+static int value_may_fail(const SsaFunction *f, int value) {
+    const SsaValue *v = &f->values[value];
+    if (v->op == SSA_BINARY && (v->op_code == BINOP_DIV || v->op_code == BINOP_MOD)) {
+        const SsaValue *divisor = &f->values[ssa_resolve(f, v->args[1])];
+        return divisor->op != SSA_CONST || (value_is_number(divisor->constant) && value_as_double(divisor->constant) == 0);
+    }
+    if (v->op == SSA_NEGATE || v->op == SSA_INCREMENT) return !is_number_type(f->values[ssa_resolve(f, v->args[0])].type);
+    return 0;
+}
+
+int ssa_expression_may_fail(const SsaFunction *f, const SsaExpression *expr) {
+    for (int i = expr->first_value; i < expr->end_value; i++) {
+        if (value_may_fail(f, i)) return 1;
+    }
+    return 0;
+}
+
+// --- Construction ---
+
+static int is_tracked(const SsaFunction *f, ASTNode *node) {
+    return node->var_scope == f->scope && node->var_slot >= 0 && node->var_slot < f->slot_count && f->tracked[node->var_slot];
+}
+
+static int is_assignment_operator(const char *op) {
+    return strcmp(op, "=") == 0 || strcmp(op, "+=") == 0 || strcmp(op, "-=") == 0 ||
+           strcmp(op, "*=") == 0 || strcmp(op, "/=") == 0 || strcmp(op, "%=") == 0;
+}
+
+static int is_increment(ASTNode *node) {
+    return strcmp(node->value, "++") == 0 || strcmp(node->value, "--") == 0;
+}
+
+static int is_function_node(ASTNode *node) {
+    return node->type == AST_FUNCTION || node->type == AST_TYPED_FUNCTION || node->type == AST_CLASS_METHOD;
+}
+
+// The tracked slot node stores into, or -1
+static int stored_slot(const SsaFunction *f, ASTNode *node) {
+    if (node->type == AST_VAR_DECL || node->type == AST_TYPED_VAR_DECL) return is_tracked(f, node) ? node->var_slot : -1;
+    if ((node->type == AST_ASSIGN || (node->type == AST_BINARY_OP && is_assignment_operator(node->value)) ||
+         (node->type == AST_UNARY_OP && is_increment(node))) &&
+        node->left && node->left->type == AST_IDENTIFIER && is_tracked(f, node->left)) {
+        return node->left->var_slot;
+    }
+    return -1;
+}
+
+static void add_edge(SsaFunction *f, int from, int to) {
+    SsaBlock *source = &f->blocks[from];
+    source->succs[source->succ_count++] = to;
+    SsaBlock *target = &f->blocks[to];
+    grow((void**)&target->preds, target->pred_count, &target->pred_capacity, sizeof(int), "SSA block");
+    target->preds[target->pred_count++] = from;
+}
+
+static int read_slot(Builder *b, int block, int slot);
+
+static int new_phi(SsaFunction *f, int block, int slot) {
+    int phi = new_value(f, SSA_PHI, block, NULL);
+    f->values[phi].slot = slot;
+    return phi;
+}
+
+// A phi whose arguments are all one value (or the phi itself) is that value
+static int trivial_phi_value(const SsaFunction *f, int phi) {
+    const SsaValue *v = &f->values[phi];
+    int same = -1;
+    for (int i = 0; i < v->arg_count; i++) {
+        int arg = ssa_resolve(f, v->args[i]);
+        if (arg == same || arg == phi) continue;
+        if (same >= 0) return -1;
+        same = arg;
+    }
+    return same;
+}
+
+static int remove_trivial_phi(SsaFunction *f, int phi) {
+    int same = trivial_phi_value(f, phi);
+    if (same < 0) {
+        if (f->values[phi].arg_count > 0) return phi;
+        // Reached from nowhere but itself: the slot was never stored
+        same = new_value(f, SSA_UNDEF, f->values[phi].block, NULL);
+        f->values[same].slot = f->values[phi].slot;
+    }
+    replace_value(f, phi, same);
+    return same;
+}
+
+static void add_phi_args(Builder *b, int phi) {
+    SsaFunction *f = b->f;
+    int block = f->values[phi].block, slot = f->values[phi].slot;
+    for (int i = 0; i < f->blocks[block].pred_count; i++) add_arg(f, phi, read_slot(b, f->blocks[block].preds[i], slot));
+}
+
+static int read_slot(Builder *b, int block, int slot) {
+    SsaFunction *f = b->f;
+    if (f->blocks[block].defs[slot] >= 0) return ssa_resolve(f, f->blocks[block].defs[slot]);
+    int value;
+    if (!f->blocks[block].sealed) {
+        value = new_phi(f, block, slot);
+        SsaBlock *blk = &f->blocks[block];
+        grow((void**)&blk->incomplete, blk->incomplete_count, &blk->incomplete_capacity, sizeof(int), "SSA block");
+        blk->incomplete[blk->incomplete_count++] = value;
+    } else if (f->blocks[block].pred_count == 0) {
+        value = new_value(f, SSA_UNDEF, block, NULL);
+        f->values[value].slot = slot;
+    } else if (f->blocks[block].pred_count == 1) {
+        value = read_slot(b, f->blocks[block].preds[0], slot);
+    } else {
+        value = new_phi(f, block, slot);
+        f->blocks[block].defs[slot] = value; // Breaks cycles through loops
+        add_phi_args(b, value);
+        value = remove_trivial_phi(f, value);
+    }
+    f->blocks[block].defs[slot] = value;
+    return value;
+}
+
+static void write_slot(Builder *b, int slot, int value) {
+    b->f->blocks[b->current].defs[slot] = value;
+    b->stored_at[slot] = ++b->stores;
+    b->effects++;
+}
+
+// All predecessors of block are known: completes the phis read before
+static void seal_block(Builder *b, int block) {
+    SsaFunction *f = b->f;
+    for (int i = 0; i < f->blocks[block].incomplete_count; i++) {
+        int phi = f->blocks[block].incomplete[i];
+        add_phi_args(b, phi);
+        remove_trivial_phi(f, phi);
+    }
+    f->blocks[block].incomplete_count = 0;
+    f->blocks[block].sealed = 1;
+}
+
+static void jump(Builder *b, int target, ASTNode *node) {
+    new_value(b->f, SSA_JUMP, b->current, node);
+    add_edge(b->f, b->current, target);
+}
+
+static void branch(Builder *b, int cond, int if_true, int if_false, ASTNode *node) {
+    int v = new_value(b->f, SSA_BRANCH, b->current, node);
+    add_arg(b->f, v, cond);
+    add_edge(b->f, b->current, if_true);
+    add_edge(b->f, b->current, if_false);
+}
+
+// Code after return, break or continue goes into a block nothing reaches
+static void start_unreachable_block(Builder *b) {
+    b->current = new_block(b->f);
+    seal_block(b, b->current);
+}
+
+static int new_constant(SsaFunction *f, int block, Value value, ASTNode *node) {
+    int v = new_value(f, SSA_CONST, block, node);
+    f->values[v].constant = value;
+    return v;
+}
+
+static int undefined_value(Builder *b, ASTNode *node) {
+    return new_value(b->f, SSA_UNDEF, b->current, node);
+}
+
+// Adds the tracked slots read under node as arguments of the opaque value
+static void add_reads(Builder *b, int opaque, ASTNode *node) {
+    if (!node || is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT) return;
+    if (node->type == AST_IDENTIFIER && is_tracked(b->f, node) && b->read_stamp[node->var_slot] != opaque) {
+        b->read_stamp[node->var_slot] = opaque;
+        add_arg(b->f, opaque, read_slot(b, b->current, node->var_slot));
+    }
+    if (node->type == AST_TERNARY) add_reads(b, opaque, node->next); // The false branch
+    for (ASTNode *child = node->left; child; child = child->next) add_reads(b, opaque, child);
+    for (ASTNode *child = node->right; child; child = child->next) add_reads(b, opaque, child);
+}
+
+// Clobbers the tracked slots stored under node
+static void clobber_stores(Builder *b, int opaque, ASTNode *node) {
+    if (!node || is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT) return;
+    int slot = stored_slot(b->f, node);
+    if (slot >= 0) {
+        int clobber = new_value(b->f, SSA_CLOBBER, b->current, node);
+        b->f->values[clobber].slot = slot;
+        add_arg(b->f, clobber, opaque);
+        write_slot(b, slot, clobber);
+    }
+    if (node->type == AST_TERNARY) clobber_stores(b, opaque, node->next);
+    for (ASTNode *child = node->left; child; child = child->next) clobber_stores(b, opaque, child);
+    for (ASTNode *child = node->right; child; child = child->next) clobber_stores(b, opaque, child);
+}
+
+// A node the engines evaluate as a whole
+static int lower_opaque(Builder *b, ASTNode *node) {
+    int v = new_value(b->f, SSA_OPAQUE, b->current, node);
+    add_reads(b, v, node);
+    b->effects++;
+    clobber_stores(b, v, node);
+    return v;
+}
+
+// A store the IR does not follow, of a value it computed
+static void lower_opaque_store(Builder *b, ASTNode *node, int value) {
+    int v = new_value(b->f, SSA_OPAQUE, b->current, node);
+    add_arg(b->f, v, value);
+    b->effects++;
+}
+
+// Whether a tracked slot read under node was stored since the statement started
+static int stored_since_statement(Builder *b, ASTNode *node) {
+    if (!node) return 0;
+    if (node->type == AST_IDENTIFIER && is_tracked(b->f, node) && b->stored_at[node->var_slot] > b->statement_stores) return 1;
+    if (node->type == AST_TERNARY && stored_since_statement(b, node->next)) return 1;
+    for (ASTNode *child = node->left; child; child = child->next) {
+        if (stored_since_statement(b, child)) return 1;
+    }
+    for (ASTNode *child = node->right; child; child = child->next) {
+        if (stored_since_statement(b, child)) return 1;
+    }
+    return 0;
+}
+
+static void record_expression(Builder *b, ASTNode *node, int value, int first_value, int first_expression) {
+    SsaFunction *f = b->f;
+    grow((void**)&f->expressions, f->expression_count, &f->expression_capacity, sizeof(SsaExpression), "SSA expressions");
+    SsaExpression *e = &f->expressions[f->expression_count++];
+    e->node = node;
+    e->value = value;
+    e->first_value = first_value;
+    e->end_value = f->value_count;
+    e->first_expression = first_expression;
+    e->statement = b->statement && !stored_since_statement(b, node) ? b->statement : NULL;
+}
+
+// && and ||: the result is a bool, the right operand's or the one that decided early
+static int lower_logical(Builder *b, ASTNode *node) {
+    SsaFunction *f = b->f;
+    int is_and = node->value[0] == '&';
+    int left = lower_expression(b, node->left);
+    int decided = new_constant(f, b->current, value_bool(!is_and), node);
+    int right_block = new_block(f), join = new_block(f);
+    if (is_and) branch(b, left, right_block, join, node);
+    else branch(b, left, join, right_block, node);
+    seal_block(b, right_block);
+    b->current = right_block;
+    int operand = lower_expression(b, node->right);
+    int right = new_value(f, SSA_TO_BOOL, b->current, node);
+    add_arg(f, right, operand);
+    jump(b, join, node);
+    seal_block(b, join);
+    b->current = join;
+    int phi = new_phi(f, join, -1);
+    f->values[phi].node = node;
+    add_arg(f, phi, decided);
+    add_arg(f, phi, right);
+    return phi;
+}
+
+static int lower_ternary(Builder *b, ASTNode *node) {
+    SsaFunction *f = b->f;
+    int cond = lower_expression(b, node->left);
+    int then_block = new_block(f), else_block = new_block(f), join = new_block(f);
+    branch(b, cond, then_block, else_block, node);
+    seal_block(b, then_block);
+    seal_block(b, else_block);
+    b->current = then_block;
+    int then_value = node->right ? lower_expression(b, node->right) : undefined_value(b, node);
+    jump(b, join, node);
+    b->current = else_block;
+    int else_value = node->next ? lower_expression(b, node->next) : undefined_value(b, node);
+    jump(b, join, node);
+    seal_block(b, join);
+    b->current = join;
+    int phi = new_phi(f, join, -1);
+    f->values[phi].node = node;
+    add_arg(f, phi, then_value);
+    add_arg(f, phi, else_value);
+    return phi;
+}
+
+static int lower_expression_node(Builder *b, ASTNode *node) {
+    SsaFunction *f = b->f;
+    switch (node->type) {
+        case AST_LITERAL:
+            if (strcmp(node->data_type, "int") == 0 || strcmp(node->data_type, "float") == 0 ||
+                strcmp(node->data_type, "bool") == 0 || strcmp(node->data_type, "string") == 0) {
+                return new_constant(f, b->current, evaluate_expression(node, NULL), node);
+            }
+            break;
+
+        case AST_IDENTIFIER:
+            if (is_tracked(f, node)) return read_slot(b, b->current, node->var_slot);
+            break;
+
+        case AST_BINARY_OP: {
+            const char *op = node->value;
+            if (is_assignment_operator(op)) {
+                if (!node->left || node->left->type != AST_IDENTIFIER || !is_tracked(f, node->left)) break;
+                int slot = node->left->var_slot;
+                int value;
+                if (op[0] == '=') {
+                    value = lower_expression(b, node->right);
+                } else {
+                    char arith_op[2] = { op[0], '\0' };
+                    int left = read_slot(b, b->current, slot);
+                    int right = lower_expression(b, node->right);
+                    value = new_value(f, SSA_BINARY, b->current, node);
+                    f->values[value].op_code = binary_operator_from_string(arith_op);
+                    add_arg(f, value, left);
+                    add_arg(f, value, right);
+                }
+                write_slot(b, slot, value);
+                return value;
+            }
+            if (strcmp(op, "&&") == 0 || strcmp(op, "||") == 0) return lower_logical(b, node);
+            BinaryOperator bop = binary_operator_from_string(op);
+            if (bop == BINOP_UNKNOWN) break;
+            int left = lower_expression(b, node->left);
+            int right = lower_expression(b, node->right);
+            int value = new_value(f, SSA_BINARY, b->current, node);
+            f->values[value].op_code = bop;
+            add_arg(f, value, left);
+            add_arg(f, value, right);
+            return value;
+        }
+
+        case AST_UNARY_OP: {
+            SsaOp op;
+            if (strcmp(node->value, "-") == 0) op = SSA_NEGATE;
+            else if (strcmp(node->value, "!") == 0) op = SSA_NOT;
+            else if (is_increment(node) && node->left && node->left->type == AST_IDENTIFIER && is_tracked(f, node->left)) op = SSA_INCREMENT;
+            else break;
+            int operand = op == SSA_INCREMENT ? read_slot(b, b->current, node->left->var_slot) : lower_expression(b, node->left);
+            int value = new_value(f, op, b->current, node);
+            add_arg(f, value, operand);
+            if (op == SSA_INCREMENT) {
+                f->values[value].op_code = node->value[0] == '+' ? 1 : -1;
+                write_slot(b, node->left->var_slot, value);
+            }
+            return value;
+        }
+
+        case AST_TERNARY:
+            return lower_ternary(b, node);
+
+        default:
+            break;
+    }
+    // Calls, objects, arrays, maps, member and index access, untracked variables
+    return lower_opaque(b, node);
+}
+
+static int lower_expression(Builder *b, ASTNode *node) {
+    if (!node) return undefined_value(b, NULL);
+    int first_value = b->f->value_count, first_expression = b->f->expression_count, effects = b->effects;
+    int value = lower_expression_node(b, node);
+    if (b->effects == effects && node->type != AST_LITERAL) record_expression(b, node, value, first_value, first_expression);
+    return value;
+}
+
+static void begin_statement(Builder *b, ASTNode *statement) {
+    b->statement = statement;
+    b->statement_stores = b->stores;
+}
+
+// What a declaration stores: its initializer, or the default of its type
+static void lower_declaration(Builder *b, ASTNode *node) {
+    SsaFunction *f = b->f;
+    int value;
+    if (node->right) {
+        value = lower_expression(b, node->right);
+    } else if (node->type == AST_TYPED_VAR_DECL && (strcmp(node->data_type, "int") == 0 || strcmp(node->data_type, "long") == 0)) {
+        value = new_constant(f, b->current, value_int(0), node);
+    } else if (node->type == AST_TYPED_VAR_DECL && (strcmp(node->data_type, "float") == 0 || strcmp(node->data_type, "double") == 0)) {
+        value = new_constant(f, b->current, value_double(0.0), node);
+    } else if (node->type == AST_TYPED_VAR_DECL && strcmp(node->data_type, "bool") == 0) {
+        value = new_constant(f, b->current, value_bool(0), node);
+    } else if (node->type == AST_TYPED_VAR_DECL && strcmp(node->data_type, "string") == 0) {
+        value = new_constant(f, b->current, value_string(""), node);
+    } else {
+        value = undefined_value(b, node);
+    }
+    if (is_tracked(f, node)) write_slot(b, node->var_slot, value);
+    else lower_opaque_store(b, node, value);
+}
+
+static void lower_statement_list(Builder *b, ASTNode *stmt) {
+    for (; stmt && !b->failed; stmt = stmt->next) {
+        if (stmt->type == AST_ELSE) continue; // Lowered with the preceding AST_IF
+        lower_statement(b, stmt);
+    }
+}
+
+static void lower_loop_body(Builder *b, ASTNode *body, LoopTargets *loop) {
+    loop->enclosing = b->loop;
+    b->loop = loop;
+    if (body) lower_statement(b, body);
+    b->loop = loop->enclosing;
+}
+
+static void lower_statement(Builder *b, ASTNode *node) {
+    SsaFunction *f = b->f;
+    switch (node->type) {
+        case AST_PROGRAM:
+        case AST_BLOCK:
+            lower_statement_list(b, node->left);
+            return;
+
+        case AST_FUNCTION: case AST_TYPED_FUNCTION: case AST_CLASS_METHOD: case AST_CLASS: case AST_STRUCT:
+        case AST_IMPORT: case AST_ELSE:
+            return;
+
+        case AST_PRINT: {
+            begin_statement(b, node);
+            int value = lower_expression(b, node->left);
+            lower_opaque_store(b, node, value);
+            return;
+        }
+
+        case AST_VAR_DECL:
+        case AST_TYPED_VAR_DECL:
+            begin_statement(b, node);
+            lower_declaration(b, node);
+            return;
+
+        case AST_ASSIGN:
+            if (node->left && node->left->type == AST_IDENTIFIER) {
+                begin_statement(b, node);
+                int value = lower_expression(b, node->right);
+                if (is_tracked(f, node->left)) write_slot(b, node->left->var_slot, value);
+                else lower_opaque_store(b, node, value);
+                return;
+            }
+            break;
+
+        case AST_RETURN: {
+            begin_statement(b, node);
+            int value = lower_expression(b, node->left);
+            int ret = new_value(f, SSA_RETURN, b->current, node);
+            add_arg(f, ret, value);
+            start_unreachable_block(b);
+            return;
+        }
+
+        case AST_IF: {
+            begin_statement(b, node);
+            int cond = lower_expression(b, node->left);
+            int has_else = node->next && node->next->type == AST_ELSE;
+            int then_block = new_block(f), join = new_block(f);
+            int else_block = has_else ? new_block(f) : join;
+            branch(b, cond, then_block, else_block, node);
+            seal_block(b, then_block);
+            b->current = then_block;
+            if (node->right) lower_statement(b, node->right);
+            jump(b, join, node);
+            if (has_else) {
+                seal_block(b, else_block);
+                b->current = else_block;
+                if (node->next->left) lower_statement(b, node->next->left);
+                jump(b, join, node);
+            }
+            seal_block(b, join);
+            b->current = join;
+            return;
+        }
+
+        case AST_WHILE: {
+            int header = new_block(f);
+            jump(b, header, node);
+            b->current = header;
+            begin_statement(b, NULL); // The condition runs again every iteration
+            int cond = lower_expression(b, node->left);
+            int body = new_block(f), exit = new_block(f);
+            branch(b, cond, body, exit, node);
+            seal_block(b, body);
+            LoopTargets loop = { exit, header, NULL };
+            b->current = body;
+            lower_loop_body(b, node->right, &loop);
+            jump(b, header, node);
+            seal_block(b, header);
+            seal_block(b, exit);
+            b->current = exit;
+            return;
+        }
+
+        case AST_FOR: {
+            ASTNode *init = node->left, *cond = init ? init->next : NULL, *incr = cond ? cond->next : NULL;
+            if (init) {
+                begin_statement(b, node); // The initializer runs once, before the loop
+                if (init->type == AST_VAR_DECL || init->type == AST_TYPED_VAR_DECL) lower_declaration(b, init);
+                else lower_expression(b, init);
+            }
+            int header = new_block(f);
+            jump(b, header, node);
+            b->current = header;
+            int body = new_block(f), latch = new_block(f), exit = new_block(f);
+            begin_statement(b, NULL);
+            if (cond) branch(b, lower_expression(b, cond), body, exit, node);
+            else jump(b, body, node);
+            seal_block(b, body);
+            LoopTargets loop = { exit, latch, NULL };
+            b->current = body;
+            lower_loop_body(b, node->right, &loop);
+            jump(b, latch, node);
+            seal_block(b, latch);
+            b->current = latch;
+            begin_statement(b, NULL);
+            if (incr) lower_expression(b, incr);
+            jump(b, header, node);
+            seal_block(b, header);
+            seal_block(b, exit);
+            b->current = exit;
+            return;
+        }
+
+        case AST_BREAK:
+        case AST_CONTINUE:
+            // Outside a loop they stop a list on one engine but not the other
+            if (!b->loop) {
+                b->failed = 1;
+                return;
+            }
+            jump(b, node->type == AST_BREAK ? b->loop->break_block : b->loop->continue_block, node);
+            start_unreachable_block(b);
+            return;
+
+        case AST_CALL: case AST_BINARY_OP: case AST_UNARY_OP: case AST_LITERAL:
+        case AST_IDENTIFIER: case AST_MEMBER_ACCESS: case AST_NEW:
+            begin_statement(b, node);
+            lower_expression(b, node);
+            return;
+
+        default:
+            break;
+    }
+    begin_statement(b, node);
+    lower_opaque(b, node);
+}
+
+// -- Tracked slots --
+
+void add_looked_up_names(ASTNode *node, NameSet *set) {
+    for (; node; node = node->next) {
+        if ((node->type == AST_IDENTIFIER && node->var_scope == VAR_UNRESOLVED) || node->type == AST_CALL ||
+            (node->type == AST_LITERAL && strcmp(node->data_type, "string") == 0)) {
+            name_set_add(set, node->value);
+        }
+        add_looked_up_names(node->left, set);
+        add_looked_up_names(node->right, set);
+    }
+}
+
+// Unmarks the globals that code in functions uses
+static void untrack_function_globals(ASTNode *node, char *tracked, int count, int in_function) {
+    for (; node; node = node->next) {
+        int inside = in_function || is_function_node(node) || node->type == AST_CLASS || node->type == AST_STRUCT;
+        if (inside && node->type == AST_IDENTIFIER && node->var_scope == VAR_GLOBAL && node->var_slot >= 0 && node->var_slot < count) {
+            tracked[node->var_slot] = 0;
+        }
+        untrack_function_globals(node->left, tracked, count, inside);
+        untrack_function_globals(node->right, tracked, count, inside);
+    }
+}
+
+SsaFunction* ssa_build(ASTNode *program, ASTNode *owner, const NameSet *looked_up) {
+    if (!program || !owner) return NULL;
+
+    SsaFunction *f = (SsaFunction*)calloc(1, sizeof(SsaFunction));
+    Builder b;
+    memset(&b, 0, sizeof(b));
+    int slots = owner->local_count > 0 ? owner->local_count : 1;
+    if (f) {
+        f->tracked = (char*)malloc(slots);
+        b.stored_at = (int*)calloc(slots, sizeof(int));
+        b.read_stamp = (int*)malloc(sizeof(int) * slots);
+    }
+    if (!f || !f->tracked || !b.stored_at || !b.read_stamp) {
+        fprintf(stderr, "Fatal Error: Could not allocate the SSA form of '%s'.\n", owner->value);
+        exit(EXIT_FAILURE);
+    }
+    f->owner = owner;
+    f->scope = owner == program ? VAR_GLOBAL : VAR_LOCAL;
+    f->slot_count = owner->local_count;
+    for (int i = 0; i < f->slot_count; i++) {
+        f->tracked[i] = !name_set_has(looked_up, owner->local_names[i]);
+        b.read_stamp[i] = -1;
+    }
+    if (owner == program) untrack_function_globals(program->left, f->tracked, f->slot_count, 0);
+
+    b.f = f;
+    b.current = new_block(f);
+    seal_block(&b, b.current);
+    if (owner == program) {
+        lower_statement_list(&b, program->left);
+    } else {
+        for (ASTNode *param = owner->left; param; param = param->next) {
+            if (param->type != AST_PARAMETER || !is_tracked(f, param)) continue;
+            int value = new_value(f, SSA_PARAM, b.current, param);
+            f->values[value].slot = param->var_slot;
+            f->blocks[b.current].defs[param->var_slot] = value;
+        }
+        if (owner->right) lower_statement(&b, owner->right);
+    }
+    if (!b.failed) {
+        int value = undefined_value(&b, NULL);
+        add_arg(f, new_value(f, SSA_RETURN, b.current, owner), value);
+    }
+
+    for (int i = 0; i < f->block_count; i++) {
+        free(f->blocks[i].defs);
+        free(f->blocks[i].incomplete);
+        f->blocks[i].defs = f->blocks[i].incomplete = NULL;
+        f->blocks[i].incomplete_count = f->blocks[i].incomplete_capacity = 0;
+    }
+    free(b.stored_at);
+    free(b.read_stamp);
+    if (b.failed) {
+        ssa_free(f);
+        return NULL;
+    }
+    compact_blocks(f);
+    infer_types(f);
+    return f;
+}
+
+void ssa_free(SsaFunction *f) {
+    if (!f) return;
+    for (int i = 0; i < f->value_count; i++) {
+        free(f->values[i].args);
+        value_release(f->values[i].constant);
+    }
+    for (int i = 0; i < f->block_count; i++) {
+        free(f->blocks[i].preds);
+        free(f->blocks[i].values);
+        free(f->blocks[i].defs);
+        free(f->blocks[i].incomplete);
+    }
+    free(f->values);
+    free(f->blocks);
+    free(f->expressions);
+    free(f->tracked);
+    free(f);
+}
+
+// --- Passes ---
+
+// Removes the edge from -> to, and the phi arguments that arrive along it
+static void remove_edge(SsaFunction *f, int from, int to) {
+    SsaBlock *target = &f->blocks[to];
+    for (int i = target->pred_count - 1; i >= 0; i--) {
+        if (target->preds[i] != from) continue;
+        for (int j = 0; j < target->value_count; j++) {
+            SsaValue *v = &f->values[target->values[j]];
+            if (v->op != SSA_PHI || v->removed || i >= v->arg_count) continue;
+            memmove(&v->args[i], &v->args[i + 1], sizeof(int) * (v->arg_count - i - 1));
+            v->arg_count--;
+        }
+        memmove(&target->preds[i], &target->preds[i + 1], sizeof(int) * (target->pred_count - i - 1));
+        target->pred_count--;
+    }
+    SsaBlock *source = &f->blocks[from];
+    for (int i = 0; i < source->succ_count; i++) {
+        if (source->succs[i] != to) continue;
+        source->succs[i] = source->succs[--source->succ_count];
+        i--;
+    }
+}
+
+// -- Sparse conditional constant propagation --
+//
+// Wegman and Zadeck: values start unknown and only go down, to a constant and then
+// to varying; blocks and edges start unreachable and only become reachable when a
+// reachable branch can take them. A phi meets only the arguments of reachable edges,
+// so a variable that keeps its value around a loop, or is changed only on paths
+// never taken, stays a constant. Constants are computed by the runtime's own
+// operators; division and modulus by zero, and anything giving a value that is not
+// an int, double, bool or short string, are left varying.
+
+enum { LATTICE_UNKNOWN, LATTICE_CONSTANT, LATTICE_VARYING };
+
+typedef struct Lattice {
+    int state;
+    Value value;      // LATTICE_CONSTANT (owned)
+} Lattice;
+
+static int is_propagated(Value v) {
+    if (v.type == VAL_STRING) return v.as.string->length <= SSA_STRING_LIMIT;
+    return v.type == VAL_INT || v.type == VAL_DOUBLE || v.type == VAL_BOOL;
+}
+
+static int same_constant(Value a, Value b) {
+    if (a.type != b.type) return 0;
+    switch (a.type) {
+        case VAL_INT:    return a.as.integer == b.as.integer;
+        case VAL_DOUBLE: return memcmp(&a.as.number, &b.as.number, sizeof(double)) == 0; // Tells -0.0 from 0.0
+        case VAL_BOOL:   return !a.as.boolean == !b.as.boolean;
+        case VAL_STRING:
+            return a.as.string == b.as.string || (a.as.string->length == b.as.string->length &&
+                   memcmp(ouro_string_chars(a.as.string), ouro_string_chars(b.as.string), a.as.string->length) == 0);
+        default:         return 0;
+    }
+}
+
+static Lattice varying(void) {
+    Lattice l = { LATTICE_VARYING, value_undefined() };
+    return l;
+}
+
+// Takes ownership of v
+static Lattice constant(Value v) {
+    if (!is_propagated(v)) {
+        value_release(v);
+        return varying();
+    }
+    Lattice l = { LATTICE_CONSTANT, v };
+    return l;
+}
+
+// Lowers cell to its meet with next (owned); 1 if it changed
+static int lower_lattice(Lattice *cell, Lattice next) {
+    if (next.state == LATTICE_UNKNOWN || cell->state == LATTICE_VARYING) {
+        value_release(next.value);
+        return 0;
+    }
+    if (cell->state == LATTICE_UNKNOWN) {
+        *cell = next;
+        return 1;
+    }
+    if (next.state == LATTICE_CONSTANT && same_constant(cell->value, next.value)) {
+        value_release(next.value);
+        return 0;
+    }
+    value_release(cell->value);
+    value_release(next.value);
+    *cell = varying();
+    return 1;
+}
+
+typedef struct Sccp {
+    SsaFunction *f;
+    Lattice *cells;
+    char *block_reachable;
+    char **edge_reachable; // Per block, per predecessor
+} Sccp;
+
+static Lattice evaluate_value(Sccp *s, int id) {
+    SsaFunction *f = s->f;
+    const SsaValue *v = &f->values[id];
+    Lattice unknown = { LATTICE_UNKNOWN, value_undefined() };
+    const Lattice *a = v->arg_count > 0 ? &s->cells[ssa_resolve(f, v->args[0])] : NULL;
+    switch (v->op) {
+        case SSA_CONST:
+            return constant(value_copy(v->constant));
+        case SSA_PHI: {
+            Lattice result = unknown;
+            for (int i = 0; i < v->arg_count; i++) {
+                if (!s->edge_reachable[v->block][i]) continue;
+                const Lattice *arg = &s->cells[ssa_resolve(f, v->args[i])];
+                Lattice copy = { arg->state, value_copy(arg->value) };
+                lower_lattice(&result, copy);
+            }
+            return result;
+        }
+        case SSA_BINARY: {
+            const Lattice *r = &s->cells[ssa_resolve(f, v->args[1])];
+            if (a->state == LATTICE_VARYING || r->state == LATTICE_VARYING) return varying();
+            if (a->state == LATTICE_UNKNOWN || r->state == LATTICE_UNKNOWN) return unknown;
+            if ((v->op_code == BINOP_DIV || v->op_code == BINOP_MOD) && value_is_number(a->value) &&
+                value_is_number(r->value) && value_as_double(r->value) == 0) {
+                return varying(); // Reported by the runtime, if it runs
+            }
+            return constant(evaluate_binary_operator((BinaryOperator)v->op_code, a->value, r->value));
+        }
+        case SSA_NEGATE: case SSA_INCREMENT:
+            if (a->state != LATTICE_CONSTANT) return a->state == LATTICE_UNKNOWN ? unknown : varying();
+            if (!value_is_number(a->value)) return varying();
+            return constant(v->op == SSA_NEGATE ? evaluate_negate(v->node, a->value) : evaluate_increment(v->node, a->value, v->op_code));
+        case SSA_NOT: case SSA_TO_BOOL:
+            if (a->state != LATTICE_CONSTANT) return a->state == LATTICE_UNKNOWN ? unknown : varying();
+            return constant(value_bool(v->op == SSA_NOT ? !value_is_truthy(a->value) : value_is_truthy(a->value)));
+        default:
+            return varying();
+    }
+}
+
+static int reach_edge(Sccp *s, int from, int to) {
+    SsaBlock *target = &s->f->blocks[to];
+    int changed = !s->block_reachable[to];
+    s->block_reachable[to] = 1;
+    for (int i = 0; i < target->pred_count; i++) {
+        if (target->preds[i] == from && !s->edge_reachable[to][i]) {
+            s->edge_reachable[to][i] = 1;
+            changed = 1;
+        }
+    }
+    return changed;
+}
+
+// Evaluates the reachable blocks until nothing changes
+static void solve(Sccp *s) {
+    SsaFunction *f = s->f;
+    s->block_reachable[0] = 1;
+    int changed;
+    do {
+        changed = 0;
+        for (int b = 0; b < f->block_count; b++) {
+            if (!s->block_reachable[b] || f->blocks[b].removed) continue;
+            SsaBlock *blk = &f->blocks[b];
+            for (int i = 0; i < blk->value_count; i++) {
+                int id = blk->values[i];
+                const SsaValue *v = &f->values[id];
+                if (v->op == SSA_JUMP) {
+                    changed |= reach_edge(s, b, blk->succs[0]);
+                } else if (v->op == SSA_BRANCH) {
+                    const Lattice *cond = &s->cells[ssa_resolve(f, v->args[0])];
+                    if (cond->state == LATTICE_VARYING || (cond->state == LATTICE_CONSTANT && value_is_truthy(cond->value))) {
+                        changed |= reach_edge(s, b, blk->succs[0]);
+                    }
+                    if (cond->state == LATTICE_VARYING || (cond->state == LATTICE_CONSTANT && !value_is_truthy(cond->value))) {
+                        changed |= reach_edge(s, b, blk->succs[1]);
+                    }
+                } else if (v->op != SSA_RETURN) {
+                    changed |= lower_lattice(&s->cells[id], evaluate_value(s, id));
+                }
+            }
+        }
+    } while (changed);
+}
+
+static int propagate_constants(SsaFunction *f) {
+    Sccp s;
+    s.f = f;
+    s.cells = (Lattice*)calloc(f->value_count > 0 ? f->value_count : 1, sizeof(Lattice));
+    s.block_reachable = (char*)calloc(f->block_count, 1);
+    s.edge_reachable = (char**)calloc(f->block_count, sizeof(char*));
+    if (!s.cells || !s.block_reachable || !s.edge_reachable) {
+        fprintf(stderr, "Fatal Error: Could not allocate constant propagation state.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int b = 0; b < f->block_count; b++) {
+        s.edge_reachable[b] = (char*)calloc(f->blocks[b].pred_count > 0 ? f->blocks[b].pred_count : 1, 1);
+        if (!s.edge_reachable[b]) {
+            fprintf(stderr, "Fatal Error: Could not allocate constant propagation state.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < f->value_count; i++) s.cells[i].value = value_undefined();
+    solve(&s);
+
+    int rewrites = 0;
+    int value_count = f->value_count; // Constants made below are not revisited
+    for (int i = 0; i < value_count; i++) {
+        SsaValue *v = &f->values[i];
+        if (v->removed || v->op == SSA_CONST || is_terminator(v->op) || s.cells[i].state != LATTICE_CONSTANT) continue;
+        if (!s.block_reachable[v->block]) continue;
+        // Constants go first in the entry block, which every use follows
+        int c = new_value(f, SSA_CONST, -1, f->values[i].node);
+        f->values[c].block = 0;
+        f->values[c].constant = value_copy(s.cells[i].value);
+        SsaBlock *entry = &f->blocks[0];
+        grow((void**)&entry->values, entry->value_count, &entry->value_capacity, sizeof(int), "SSA block");
+        memmove(&entry->values[1], &entry->values[0], sizeof(int) * entry->value_count);
+        entry->values[0] = c;
+        entry->value_count++;
+        replace_value(f, i, c);
+        rewrites++;
+    }
+    for (int b = 0; b < f->block_count; b++) {
+        SsaBlock *blk = &f->blocks[b];
+        if (blk->removed || !s.block_reachable[b] || blk->value_count == 0) continue;
+        SsaValue *term = &f->values[blk->values[blk->value_count - 1]];
+        if (term->op != SSA_BRANCH) continue;
+        const SsaValue *cond = &f->values[ssa_resolve(f, term->args[0])];
+        if (cond->op != SSA_CONST) continue;
+        // A branch decided by a constant: the edge not taken goes
+        int taken = blk->succs[value_is_truthy(cond->constant) ? 0 : 1], not_taken = blk->succs[value_is_truthy(cond->constant) ? 1 : 0];
+        term->op = SSA_JUMP;
+        term->arg_count = 0;
+        if (taken != not_taken) remove_edge(f, b, not_taken);
+        blk->succs[0] = taken;
+        blk->succ_count = 1;
+        rewrites++;
+    }
+    for (int b = 0; b < f->block_count; b++) {
+        SsaBlock *blk = &f->blocks[b];
+        if (blk->removed || s.block_reachable[b]) continue;
+        while (blk->succ_count > 0) remove_edge(f, b, blk->succs[0]);
+        for (int i = 0; i < blk->value_count; i++) f->values[blk->values[i]].removed = 1;
+        blk->removed = 1;
+        rewrites++;
+    }
+
+    for (int i = 0; i < value_count; i++) value_release(s.cells[i].value);
+    for (int b = 0; b < f->block_count; b++) free(s.edge_reachable[b]);
+    free(s.edge_reachable);
+    free(s.block_reachable);
+    free(s.cells);
+    return rewrites;
+}
+
+// -- Copy propagation --
+//
+// A store makes no copy in this IR, so what remains to propagate are phis all of
+// whose arguments are one value (after the edges constant propagation removed, or
+// the values numbering merged): each is replaced by that value, and every argument
+// is pointed at the value it now refers to.
+
+static int propagate_copies(SsaFunction *f) {
+    int rewrites = 0, changed;
+    do {
+        changed = 0;
+        for (int i = 0; i < f->value_count; i++) {
+            if (f->values[i].removed || f->values[i].op != SSA_PHI) continue;
+            int same = trivial_phi_value(f, i);
+            if (same < 0) continue;
+            replace_value(f, i, same);
+            rewrites++;
+            changed = 1;
+        }
+    } while (changed);
+    for (int i = 0; i < f->value_count; i++) {
+        SsaValue *v = &f->values[i];
+        if (v->removed) continue;
+        for (int j = 0; j < v->arg_count; j++) v->args[j] = ssa_resolve(f, v->args[j]);
+    }
+    return rewrites;
+}
+
+// -- Global value numbering --
+//
+// The blocks are walked down the dominator tree with a table of the values computed
+// on the way from the entry: a value computed again from the same operands (a
+// constant, an operator, or a phi of the same block) is replaced by the first one,
+// which dominates it. Operations that can report an error are left alone.
+
+typedef struct ValueTable {
+    int *buckets;
+    int mask;
+    int *next;         // Per value: the next in its bucket
+    unsigned *hashes;  // Per value
+    int *entered;      // Values entered, innermost scope last
+    int entered_count;
+} ValueTable;
+
+static int is_numbered(const SsaFunction *f, int id) {
+    const SsaValue *v = &f->values[id];
+    switch (v->op) {
+        case SSA_CONST: case SSA_PHI: case SSA_BINARY: case SSA_NEGATE: case SSA_NOT: case SSA_TO_BOOL:
+            return !value_may_fail(f, id);
+        default:
+            return 0;
+    }
+}
+
+static unsigned hash_value(const SsaFunction *f, int id) {
+    const SsaValue *v = &f->values[id];
+    unsigned h = (unsigned)v->op * 31u + (unsigned)v->op_code;
+    if (v->op == SSA_PHI) h = h * 31u + (unsigned)v->block;
+    if (v->op == SSA_CONST) {
+        h = h * 31u + (unsigned)v->constant.type;
+        if (v->constant.type == VAL_INT) h = h * 31u + (unsigned)(v->constant.as.integer ^ (v->constant.as.integer >> 32));
+        else if (v->constant.type == VAL_BOOL) h = h * 31u + (unsigned)!v->constant.as.boolean;
+        else if (v->constant.type == VAL_STRING) h = h * 31u + (unsigned)v->constant.as.string->length;
+    }
+    for (int i = 0; i < v->arg_count; i++) h = h * 31u + (unsigned)ssa_resolve(f, v->args[i]);
+    return h;
+}
+
+static int same_computation(const SsaFunction *f, int a, int b) {
+    const SsaValue *x = &f->values[a], *y = &f->values[b];
+    if (x->op != y->op || x->op_code != y->op_code || x->arg_count != y->arg_count) return 0;
+    if (x->op == SSA_PHI && x->block != y->block) return 0;
+    if (x->op == SSA_CONST && !same_constant(x->constant, y->constant)) return 0;
+    for (int i = 0; i < x->arg_count; i++) {
+        if (ssa_resolve(f, x->args[i]) != ssa_resolve(f, y->args[i])) return 0;
+    }
+    return 1;
+}
+
+static int number_value(SsaFunction *f, ValueTable *table, int id) {
+    unsigned h = hash_value(f, id);
+    for (int other = table->buckets[h & table->mask]; other >= 0; other = table->next[other]) {
+        if (table->hashes[other] == h && same_computation(f, other, id)) {
+            replace_value(f, id, other);
+            return 1;
+        }
+    }
+    table->hashes[id] = h;
+    table->next[id] = table->buckets[h & table->mask];
+    table->buckets[h & table->mask] = id;
+    table->entered[table->entered_count++] = id;
+    return 0;
+}
+
+static int number_dominated(SsaFunction *f, ValueTable *table, int block, const int *first_child, const int *next_sibling) {
+    int rewrites = 0, mark = table->entered_count;
+    SsaBlock *blk = &f->blocks[block];
+    for (int phis = 1; phis >= 0; phis--) { // Phis first: they are at the start of the block
+        for (int i = 0; i < blk->value_count; i++) {
+            int id = blk->values[i];
+            if (f->values[id].removed || (f->values[id].op == SSA_PHI) != phis || !is_numbered(f, id)) continue;
+            rewrites += number_value(f, table, id);
+        }
+    }
+    for (int child = first_child[block]; child >= 0; child = next_sibling[child]) {
+        rewrites += number_dominated(f, table, child, first_child, next_sibling);
+    }
+    while (table->entered_count > mark) {
+        int id = table->entered[--table->entered_count];
+        table->buckets[table->hashes[id] & table->mask] = table->next[id];
+    }
+    return rewrites;
+}
+
+static void add_postorder(const SsaFunction *f, int block, char *visited, int *order, int *count) {
+    visited[block] = 1;
+    const SsaBlock *blk = &f->blocks[block];
+    for (int i = 0; i < blk->succ_count; i++) {
+        if (!visited[blk->succs[i]]) add_postorder(f, blk->succs[i], visited, order, count);
+    }
+    order[(*count)++] = block;
+}
+
+// Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm"
+static void find_dominators(const SsaFunction *f, int *idom) {
+    int n = f->block_count;
+    int *order = (int*)malloc(sizeof(int) * n), *position = (int*)malloc(sizeof(int) * n);
+    char *visited = (char*)calloc(n, 1);
+    if (!order || !position || !visited) {
+        fprintf(stderr, "Fatal Error: Could not allocate dominator state.\n");
+        exit(EXIT_FAILURE);
+    }
+    int count = 0;
+    add_postorder(f, 0, visited, order, &count);
+    for (int i = 0; i < n; i++) {
+        idom[i] = -1;
+        position[i] = -1;
+    }
+    for (int i = 0; i < count; i++) position[order[i]] = i;
+    idom[0] = 0;
+    int changed;
+    do {
+        changed = 0;
+        for (int i = count - 2; i >= 0; i--) { // Reverse postorder, after the entry
+            int block = order[i], new_idom = -1;
+            const SsaBlock *blk = &f->blocks[block];
+            for (int j = 0; j < blk->pred_count; j++) {
+                int pred = blk->preds[j];
+                if (position[pred] < 0 || idom[pred] < 0) continue;
+                if (new_idom < 0) {
+                    new_idom = pred;
+                    continue;
+                }
+                int x = pred, y = new_idom;
+                while (x != y) {
+                    while (position[x] < position[y]) x = idom[x];
+                    while (position[y] < position[x]) y = idom[y];
+                }
+                new_idom = x;
+            }
+            if (new_idom >= 0 && idom[block] != new_idom) {
+                idom[block] = new_idom;
+                changed = 1;
+            }
+        }
+    } while (changed);
+    free(order);
+    free(position);
+    free(visited);
+}
+
+static int number_values(SsaFunction *f) {
+    int n = f->block_count, values = f->value_count > 0 ? f->value_count : 1;
+    int *idom = (int*)malloc(sizeof(int) * n), *first_child = (int*)malloc(sizeof(int) * n), *next_sibling = (int*)malloc(sizeof(int) * n);
+    ValueTable table;
+    int buckets = 16;
+    while (buckets < values * 2) buckets *= 2;
+    table.buckets = (int*)malloc(sizeof(int) * buckets);
+    table.mask = buckets - 1;
+    table.next = (int*)malloc(sizeof(int) * values);
+    table.hashes = (unsigned*)malloc(sizeof(unsigned) * values);
+    table.entered = (int*)malloc(sizeof(int) * values);
+    table.entered_count = 0;
+    if (!idom || !first_child || !next_sibling || !table.buckets || !table.next || !table.hashes || !table.entered) {
+        fprintf(stderr, "Fatal Error: Could not allocate value numbering state.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < buckets; i++) table.buckets[i] = -1;
+    find_dominators(f, idom);
+    for (int i = 0; i < n; i++) first_child[i] = next_sibling[i] = -1;
+    for (int i = n - 1; i > 0; i--) {
+        if (idom[i] < 0 || f->blocks[i].removed) continue;
+        next_sibling[i] = first_child[idom[i]];
+        first_child[idom[i]] = i;
+    }
+    int rewrites = number_dominated(f, &table, 0, first_child, next_sibling);
+    free(idom);
+    free(first_child);
+    free(next_sibling);
+    free(table.buckets);
+    free(table.next);
+    free(table.hashes);
+    free(table.entered);
+    return rewrites;
+}
+
+// -- Dead-code elimination --
+//
+// Terminators, opaque values and operations that can report an error are kept, with
+// everything they use; the rest is removed.
+
+static int eliminate_dead_values(SsaFunction *f) {
+    char *live = (char*)calloc(f->value_count > 0 ? f->value_count : 1, 1);
+    int *work = (int*)malloc(sizeof(int) * (f->value_count > 0 ? f->value_count : 1));
+    if (!live || !work) {
+        fprintf(stderr, "Fatal Error: Could not allocate dead-code state.\n");
+        exit(EXIT_FAILURE);
+    }
+    int work_count = 0;
+    for (int i = 0; i < f->value_count; i++) {
+        const SsaValue *v = &f->values[i];
+        if (v->removed || !(is_terminator(v->op) || v->op == SSA_OPAQUE || value_may_fail(f, i))) continue;
+        live[i] = 1;
+        work[work_count++] = i;
+    }
+    while (work_count > 0) {
+        const SsaValue *v = &f->values[work[--work_count]];
+        for (int j = 0; j < v->arg_count; j++) {
+            int arg = ssa_resolve(f, v->args[j]);
+            if (!live[arg]) {
+                live[arg] = 1;
+                work[work_count++] = arg;
+            }
+        }
+    }
+    int rewrites = 0;
+    for (int i = 0; i < f->value_count; i++) {
+        if (f->values[i].removed || live[i]) continue;
+        f->values[i].removed = 1;
+        rewrites++;
+    }
+    free(live);
+    free(work);
+    return rewrites;
+}
+
+// -- Pass manager --
+
+typedef struct SsaPass {
+    const char *name;
+    int (*run)(SsaFunction *f); // Number of rewrites
+} SsaPass;
+
+static const SsaPass ssa_passes[] = {
+    { "sparse conditional constant propagation", propagate_constants },
+    { "copy propagation", propagate_copies },
+    { "global value numbering", number_values },
+    { "dead-code elimination", eliminate_dead_values },
+};
+#define SSA_PASS_COUNT (int)(sizeof(ssa_passes) / sizeof(ssa_passes[0]))
+
+static const char* function_name(const SsaFunction *f) {
+    return f->scope == VAR_GLOBAL ? "top-level code" : f->owner->value;
+}
+
+void ssa_optimize(SsaFunction *f, FILE *report) {
+    for (int round = 0; round < SSA_MAX_ROUNDS; round++) {
+        int changed = 0;
+        for (int p = 0; p < SSA_PASS_COUNT; p++) {
+            infer_types(f); // Passes ask which operations can fail
+            int rewrites = ssa_passes[p].run(f);
+            compact_blocks(f);
+            if (!rewrites) continue;
+            changed = 1;
+            if (report) fprintf(report, "[OPT] SSA %s in %s: %d rewrite%s\n", ssa_passes[p].name, function_name(f), rewrites, rewrites == 1 ? "" : "s");
+        }
+        if (!changed) break;
+    }
+    infer_types(f);
+}
+
+// --- Printing ---
+
+static const char* type_name(StaticType type) {
+    switch (type) {
+        case STATIC_INT:    return "int";
+        case STATIC_DOUBLE: return "float";
+        case STATIC_NUMBER: return "number";
+        case STATIC_BOOL:   return "bool";
+        default:            return "any";
+    }
+}
+
+static const char* slot_name(const SsaFunction *f, int slot) {
+    return slot >= 0 && slot < f->slot_count && f->owner->local_names ? f->owner->local_names[slot] : "?";
+}
+
+static void print_value(const SsaFunction *f, int id, FILE *out) {
+    static const char *operator_names[] = { "+", "-", "*", "/", "%", "<<", ">>", "==", "!=", "<", ">", "<=", ">=", "&&", "||", "?" };
+    const SsaValue *v = &f->values[id];
+    const SsaBlock *blk = &f->blocks[v->block];
+    if (is_terminator(v->op)) {
+        if (v->op == SSA_JUMP) fprintf(out, "  jump b%d\n", blk->succs[0]);
+        else if (v->op == SSA_BRANCH) fprintf(out, "  branch v%d ? b%d : b%d\n", ssa_resolve(f, v->args[0]), blk->succs[0], blk->succs[1]);
+        else fprintf(out, "  return v%d\n", ssa_resolve(f, v->args[0]));
+        return;
+    }
+    fprintf(out, "  v%d: %s = ", id, type_name(v->type));
+    switch (v->op) {
+        case SSA_CONST: {
+            char text_buf[VALUE_TEXT_BUFFER_SIZE];
+            const char *text = value_to_text(v->constant, text_buf, sizeof(text_buf));
+            if (v->constant.type == VAL_STRING) fprintf(out, "\"%.40s\"", text);
+            else fprintf(out, "%s", text);
+            break;
+        }
+        case SSA_PARAM:
+            fprintf(out, "param %s", slot_name(f, v->slot));
+            break;
+        case SSA_UNDEF:
+            fprintf(out, v->slot >= 0 ? "undefined %s" : "undefined", slot_name(f, v->slot));
+            break;
+        case SSA_PHI:
+            fprintf(out, "phi %s", v->slot >= 0 ? slot_name(f, v->slot) : node_type_to_string(v->node->type));
+            for (int i = 0; i < v->arg_count; i++) fprintf(out, "%s b%d: v%d", i ? "," : " [", blk->preds[i], ssa_resolve(f, v->args[i]));
+            if (v->arg_count) fprintf(out, "]");
+            break;
+        case SSA_BINARY:
+            fprintf(out, "v%d %s v%d", ssa_resolve(f, v->args[0]), operator_names[v->op_code], ssa_resolve(f, v->args[1]));
+            break;
+        case SSA_NEGATE:
+            fprintf(out, "-v%d", ssa_resolve(f, v->args[0]));
+            break;
+        case SSA_NOT:
+            fprintf(out, "!v%d", ssa_resolve(f, v->args[0]));
+            break;
+        case SSA_TO_BOOL:
+            fprintf(out, "bool v%d", ssa_resolve(f, v->args[0]));
+            break;
+        case SSA_INCREMENT:
+            fprintf(out, "v%d %+d", ssa_resolve(f, v->args[0]), v->op_code);
+            break;
+        case SSA_OPAQUE:
+            fprintf(out, "opaque %s '%s' (L%d)", node_type_to_string(v->node->type), v->node->value ? v->node->value : "", v->node->line);
+            for (int i = 0; i < v->arg_count; i++) fprintf(out, " v%d", ssa_resolve(f, v->args[i]));
+            break;
+        case SSA_CLOBBER:
+            fprintf(out, "clobber %s by v%d", slot_name(f, v->slot), ssa_resolve(f, v->args[0]));
+            break;
+        default:
+            break;
+    }
+    fprintf(out, "\n");
+}
+
+void ssa_print(const SsaFunction *f, FILE *out) {
+    int blocks = 0, values = 0;
+    for (int b = 0; b < f->block_count; b++) {
+        if (f->blocks[b].removed) continue;
+        blocks++;
+        values += f->blocks[b].value_count;
+    }
+    fprintf(out, "== %s (%d blocks, %d values) ==\n", f->scope == VAR_GLOBAL ? "<program>" : f->owner->value, blocks, values);
+    for (int b = 0; b < f->block_count; b++) {
+        const SsaBlock *blk = &f->blocks[b];
+        if (blk->removed) continue;
+        fprintf(out, "b%d:", b);
+        for (int i = 0; i < blk->pred_count; i++) fprintf(out, "%s b%d", i ? "," : "  <-", blk->preds[i]);
+        fprintf(out, "\n");
+        for (int phis = 1; phis >= 0; phis--) {
+            for (int i = 0; i < blk->value_count; i++) {
+                if ((f->values[blk->values[i]].op == SSA_PHI) == phis) print_value(f, blk->values[i], out);
+            }
+        }
+    }
+}
+
+// looked_up is NULL when the program imports modules
+static void dump_function(ASTNode *program, ASTNode *owner, const NameSet *looked_up, int optimize) {
+    SsaFunction *f = looked_up ? ssa_build(program, owner, looked_up) : NULL;
+    if (!f) {
+        printf("== %s: not lowered ==\n", owner == program ? "<program>" : owner->value);
+        return;
+    }
+    if (optimize) ssa_optimize(f, NULL);
+    ssa_print(f, stdout);
+    ssa_free(f);
+}
+
+static void dump_functions(ASTNode *program, ASTNode *node, const NameSet *looked_up, int optimize) {
+    for (; node; node = node->next) {
+        if (is_function_node(node)) dump_function(program, node, looked_up, optimize);
+        else if (node->type == AST_CLASS || node->type == AST_STRUCT) dump_functions(program, node->left, looked_up, optimize);
+    }
+}
+
+void generate_ssa(ASTNode *root, int optimize) {
+    if (!root || root->type != AST_PROGRAM) return;
+    printf("\n==== SSA IR ====\n");
+    int imports = 0;
+    for (ASTNode *stmt = root->left; stmt; stmt = stmt->next) {
+        if (stmt->type == AST_IMPORT) imports = 1;
+    }
+    NameSet looked_up = {0};
+    add_looked_up_names(root->left, &looked_up);
+    dump_function(root, root, imports ? NULL : &looked_up, optimize);
+    dump_functions(root, root->left, imports ? NULL : &looked_up, optimize);
+    name_set_free(&looked_up);
+}
@@ -0,0 +1,129 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include <stdio.h>
+#include "ast_types.h"
+#include "eval.h" // For BinaryOperator
+#include "name_table.h"
+
+// SSA form of a function body, or of a program's top-level code, lowered from the
+// analyzed AST. Slot variables the body alone can change (tracked slots) become
+// values: every store makes a new one, and a block where paths with different values
+// meet starts with a phi. Everything else, and any construct the IR does not model
+// (calls, members, arrays, untracked variables, print), is an opaque value evaluated
+// by the engines: its arguments are the tracked values it reads, and each tracked
+// slot stored under it is clobbered afterwards.
+typedef enum {
+    SSA_CONST,     // constant (int, double, bool or string)
+    SSA_PARAM,     // incoming value of parameter slot
+    SSA_UNDEF,     // slot before anything is stored into it, or an operand that is absent
+    SSA_PHI,       // args[i] arrives from preds[i] of its block
+    SSA_BINARY,    // args[0] <op_code> args[1], op_code a BinaryOperator
+    SSA_NEGATE,    // unary '-'
+    SSA_NOT,       // unary '!'
+    SSA_TO_BOOL,   // truthiness of args[0]
+    SSA_INCREMENT, // args[0] + op_code, for ++ and -- (reports non-numbers)
+    SSA_OPAQUE,    // node evaluated by the engines; may have effects
+    SSA_CLOBBER,   // tracked slot after the opaque args[0] stored into it
+    SSA_JUMP,      // block terminators: to succs[0]
+    SSA_BRANCH,    // to succs[0] if args[0] is truthy, else to succs[1]
+    SSA_RETURN     // args[0] leaves the body
+} SsaOp;
+
+typedef struct SsaValue {
+    SsaOp op;
+    int op_code;       // SSA_BINARY operator, SSA_INCREMENT delta
+    int slot;          // Slot a PARAM, UNDEF, PHI or CLOBBER is a value of; -1 for phis of ?:, && and ||
+    int block;
+    int *args;
+    int arg_count;
+    int arg_capacity;
+    Value constant;    // SSA_CONST (owned)
+    StaticType type;   // Type the value always has
+    ASTNode *node;     // Source node, or NULL
+    int replaced_by;   // Value the passes replaced it with, or -1; uses follow it (ssa_resolve)
+    int removed;       // No longer in its block
+} SsaValue;
+
+typedef struct SsaBlock {
+    int *preds;
+    int pred_count;
+    int pred_capacity;
+    int succs[2];
+    int succ_count;
+    int *values;       // In order; the terminator is last
+    int value_count;
+    int value_capacity;
+    int removed;       // Proven unreachable
+    // Construction only
+    int *defs;         // Value of each tracked slot at the end of the block so far, or -1
+    int *incomplete;   // Phis made before all predecessors were known
+    int incomplete_count;
+    int incomplete_capacity;
+    int sealed;
+} SsaBlock;
+
+// A pure expression of the body (no stores, calls or opaque values under it), for
+// the AST optimizer to rewrite from what the passes proved
+typedef struct SsaExpression {
+    ASTNode *node;
+    int value;         // Value of node (before the passes; ssa_resolve it)
+    int first_value;   // Values made while lowering node: first_value up to end_value
+    int end_value;
+    int first_expression; // Expressions under node: first_expression up to this one
+    // Statement node is evaluated in, when nothing it reads can change between the
+    // start of that statement and node, so a variable declared just before the
+    // statement would hold its value; NULL in loop conditions and updates
+    ASTNode *statement;
+} SsaExpression;
+
+typedef struct SsaFunction {
+    ASTNode *owner;    // Function, or the program for top-level code
+    VariableScope scope;
+    int slot_count;
+    char *tracked;     // 1 for each slot the IR follows
+    SsaValue *values;
+    int value_count;
+    int value_capacity;
+    SsaBlock *blocks;  // blocks[0] is the entry
+    int block_count;
+    int block_capacity;
+    SsaExpression *expressions;
+    int expression_count;
+    int expression_capacity;
+} SsaFunction;
+
+// Adds the names the list at node and everything under it look up through frames at
+// run time, which may find a slot by its name: unresolved identifiers, calls, and
+// strings, which can name variables
+void add_looked_up_names(ASTNode *node, NameSet *set);
+
+// Lowers owner's body (owner is a function of program, or program itself); looked_up
+// holds the names program looks up (add_looked_up_names), whose slots stay untracked.
+// Both are computed once per program by the caller, which also lowers nothing of a
+// program that imports modules, whose code can reach any global by name. NULL when
+// the body cannot be lowered: break or continue outside a loop.
+SsaFunction* ssa_build(ASTNode *program, ASTNode *owner, const NameSet *looked_up);
+// Runs the pass pipeline (sparse conditional constant propagation, copy propagation,
+// global value numbering, dead-code elimination) until nothing changes; each pass's
+// rewrites are reported to report unless it is NULL
+void ssa_optimize(SsaFunction *f, FILE *report);
+void ssa_print(const SsaFunction *f, FILE *out);
+void ssa_free(SsaFunction *f);
+
+// The value uses of value now refer to
+int ssa_resolve(const SsaFunction *f, int value);
+// Whether evaluating expr can report an error (division or modulus by what may be
+// zero, '-', '++' or '--' on what may not be a number)
+int ssa_expression_may_fail(const SsaFunction *f, const SsaExpression *expr);
+
+// Type rules shared with the optimizer's static types: SSA_TYPE_NONE is the join of
+// no types yet, while types are being proven
+#define SSA_TYPE_NONE -1
+int ssa_join_types(int a, int b);
+int ssa_binary_result_type(BinaryOperator op, int left, int right);
+
+// -print-ir: lower, optionally optimize, and print the program and every function it declares
+void generate_ssa(ASTNode *root, int optimize);
+
+#endif // SSA_H
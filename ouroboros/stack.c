@@ -3,12 +3,21 @@
 #include <string.h>
 #include "stack.h"
 
+// Frames are created and destroyed in strict LIFO order by calls, so destroyed
+// frames are kept on a free list and reused with their slot and variable buffers.
+static StackFrame *frame_pool = NULL;
+
 StackFrame* create_stack_frame(const char* name, StackFrame* parent) {
-    StackFrame* frame = (StackFrame*)calloc(1, sizeof(StackFrame)); // Use calloc
-    if (!frame) {
-        fprintf(stderr, "Error: Memory allocation failed for stack frame '%s'\n", name);
-        // In a real application, might try to recover or throw a more specific error.
-        exit(EXIT_FAILURE); // For simplicity, exit on critical alloc failure
+    StackFrame* frame = frame_pool;
+    if (frame) {
+        frame_pool = frame->parent;
+    } else {
+        frame = (StackFrame*)calloc(1, sizeof(StackFrame)); // Use calloc
+        if (!frame) {
+            fprintf(stderr, "Error: Memory allocation failed for stack frame '%s'\n", name);
+            // In a real application, might try to recover or throw a more specific error.
+            exit(EXIT_FAILURE); // For simplicity, exit on critical alloc failure
+        }
     }
     
     strncpy(frame->name, name, sizeof(frame->name) - 1);
@@ -21,57 +30,120 @@ StackFrame* create_stack_frame(const char* name, StackFrame* parent) {
     frame->function_name[sizeof(frame->function_name) - 1] = '\0';
     
     frame->parent = parent;
-    // var_count is 0 due to calloc
+    frame->globals = parent ? parent->globals : frame;
+    // slot_count and var_count are 0 for new and recycled frames
     
     return frame;
 }
 
 void destroy_stack_frame(StackFrame* frame) {
     if (frame) {
-        // Variables are stack-allocated within the frame struct, so no individual free needed for them
-        // unless their `value` field becomes dynamically allocated.
-        free(frame);
+        for (int i = 0; i < frame->slot_count; i++) {
+            value_release(frame->slots[i]);
+        }
+        for (int i = 0; i < frame->var_count; i++) {
+            value_release(frame->variables[i].value);
+        }
+        frame->slot_count = 0;
+        frame->slot_names = NULL;
+        frame->var_count = 0;
+        frame->parent = frame_pool; // Free-list link
+        frame_pool = frame;
+    }
+}
+
+void stack_frame_pool_clear(void) {
+    while (frame_pool) {
+        StackFrame *next = frame_pool->parent;
+        free(frame_pool->slots);
+        free(frame_pool->variables);
+        free(frame_pool);
+        frame_pool = next;
     }
 }
 
-void set_variable(StackFrame* frame, const char* name, const char* value) {
-    if (!frame || !name || !value) {
+void stack_frame_init_slots(StackFrame* frame, int slot_count, const char **slot_names) {
+    if (!frame || slot_count <= 0) return;
+    if (slot_count > frame->slot_capacity) {
+        Value *grown = (Value*)realloc(frame->slots, sizeof(Value) * slot_count);
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed for %d variable slots in frame '%s'\n", slot_count, frame->name);
+            exit(EXIT_FAILURE);
+        }
+        frame->slots = grown;
+        frame->slot_capacity = slot_count;
+    }
+    memset(frame->slots, 0, sizeof(Value) * slot_count); // Zeroed values are VAL_UNDEFINED
+    frame->slot_count = slot_count;
+    frame->slot_names = slot_names;
+}
+
+void stack_frame_clear(StackFrame* frame) {
+    for (int i = 0; i < frame->slot_count; i++) {
+        value_release(frame->slots[i]);
+        frame->slots[i] = value_undefined();
+    }
+    for (int i = 0; i < frame->var_count; i++) {
+        value_release(frame->variables[i].value);
+    }
+    frame->var_count = 0;
+}
+
+void set_variable(StackFrame* frame, const char* name, Value value) {
+    if (!frame || !name) {
         // fprintf(stderr, "Warning: Attempt to set variable with null frame, name, or value.\n");
         return;
     }
     
     // Try to update existing variable in the current frame only
     for (int i = 0; i < frame->var_count; i++) {
-        if (strcmp(frame->variables[i].name, name) == 0) {
-            strncpy(frame->variables[i].value, value, sizeof(frame->variables[i].value) - 1);
-            frame->variables[i].value[sizeof(frame->variables[i].value) - 1] = '\0';
+        if (frame->variables[i].name == name) {
+            Value old_value = frame->variables[i].value;
+            frame->variables[i].value = value_copy(value);
+            value_release(old_value);
+            return;
+        }
+    }
+    
+    for (int i = 0; i < frame->slot_count; i++) {
+        if (frame->slot_names[i] == name) {
+            Value old_value = frame->slots[i];
+            frame->slots[i] = value_copy(value);
+            value_release(old_value);
             return;
         }
     }
     
     // If not found in current frame, add as a new variable in the current frame
-    if (frame->var_count < MAX_VARIABLES) {
-        strncpy(frame->variables[frame->var_count].name, name, sizeof(frame->variables[frame->var_count].name) - 1);
-        frame->variables[frame->var_count].name[sizeof(frame->variables[frame->var_count].name) - 1] = '\0';
-        
-        strncpy(frame->variables[frame->var_count].value, value, sizeof(frame->variables[frame->var_count].value) - 1);
-        frame->variables[frame->var_count].value[sizeof(frame->variables[frame->var_count].value) - 1] = '\0';
-        
-        frame->var_count++;
-    } else {
-        fprintf(stderr, "Error: Stack frame '%s' variable limit (%d) reached when setting '%s'.\n", frame->name, MAX_VARIABLES, name);
-        // This is a critical runtime error.
+    if (frame->var_count == frame->var_capacity) {
+        int new_capacity = frame->var_capacity ? frame->var_capacity * 2 : 8;
+        Variable *grown = (Variable*)realloc(frame->variables, sizeof(Variable) * new_capacity);
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed for variable '%s' in frame '%s'\n", name, frame->name);
+            exit(EXIT_FAILURE);
+        }
+        frame->variables = grown;
+        frame->var_capacity = new_capacity;
     }
+    frame->variables[frame->var_count].name = name;
+    frame->variables[frame->var_count].value = value_copy(value);
+    
+    frame->var_count++;
 }
 
-const char* get_variable(StackFrame* frame, const char* name) {
+Value* get_variable(StackFrame* frame, const char* name) {
     if (!name) return NULL; // Or "undefined"
 
     StackFrame* current_frame_iter = frame;
     while (current_frame_iter) {
         for (int i = 0; i < current_frame_iter->var_count; i++) {
-            if (strcmp(current_frame_iter->variables[i].name, name) == 0) {
-                return current_frame_iter->variables[i].value;
+            if (current_frame_iter->variables[i].name == name) {
+                return &current_frame_iter->variables[i].value;
+            }
+        }
+        for (int i = 0; i < current_frame_iter->slot_count; i++) {
+            if (current_frame_iter->slot_names[i] == name) {
+                return &current_frame_iter->slots[i];
             }
         }
         current_frame_iter = current_frame_iter->parent; // Go to parent frame
@@ -1,13 +1,12 @@
 #ifndef STACK_H
 #define STACK_H
 
-// Maximum number of variables in a stack frame
-#define MAX_VARIABLES 64 // Consider making this dynamic or larger for complex functions
+#include "value.h"
 
 // Variable structure (within a stack frame)
 typedef struct Variable {
-    char name[128];       // Variable name
-    char value[1024];     // Variable value (as string). Consider dynamic allocation for large strings/objects.
+    const char *name;     // Interned variable name
+    Value value;          // Owned by the frame; released when overwritten or when the frame is destroyed
     // char type_name[64]; // Optionally store type here too, though symbol table is primary
 } Variable;
 
@@ -15,18 +14,29 @@ typedef struct Variable {
 typedef struct StackFrame {
     char name[128];           // Debug name for the frame (e.g., function name, "global", "block")
     char function_name[128];  // Specifically for the function this frame belongs to (if applicable)
-    Variable variables[MAX_VARIABLES];
+    Value *slots;             // Variables resolved to an index by semantic analysis
+    int slot_count;
+    int slot_capacity;        // Allocated slots; kept when the frame is recycled
+    const char **slot_names;  // Borrowed from the function/program node; lets by-name lookups see slots
+    Variable *variables;      // Variables only known by name (undeclared assignments, unanalyzed code)
     int var_count;
+    int var_capacity;
     // char *return_value; // Return value is now managed globally by vm.c's set_return_value
-    struct StackFrame *parent; // Link to the parent (caller's) stack frame
+    struct StackFrame *parent; // Link to the parent (caller's) stack frame; free-list link while pooled
+    struct StackFrame *globals; // Root of the parent chain, holding VAR_GLOBAL slots
 } StackFrame;
 
-// Stack frame functions
+// Stack frame functions. Destroyed frames go back to a LIFO pool and are reused
+// by the next create_stack_frame.
 StackFrame* create_stack_frame(const char* name, StackFrame *parent);
 void destroy_stack_frame(StackFrame *frame);
+void stack_frame_pool_clear(void); // Frees pooled frames
+void stack_frame_init_slots(StackFrame *frame, int slot_count, const char **slot_names); // Slots start undefined
+void stack_frame_clear(StackFrame *frame); // Releases every variable; slots stay, undefined
 
-// Variable management within a frame
-void set_variable(StackFrame *frame, const char *name, const char *value);
-const char* get_variable(StackFrame *frame, const char *name); // Searches current and parent frames
+// Variable management within a frame. Names must be interned (intern.h); they are
+// compared by pointer.
+void set_variable(StackFrame *frame, const char *name, Value value); // Stores a copy of value
+Value* get_variable(StackFrame *frame, const char *name); // Searches current and parent frames; NULL if not found
 
-#endif // STACK_H
\ No newline at end of file
+#endif // STACK_H
@@ -1020,36 +1020,63 @@ void wrapper_loading_animation() {
 // === STRING UTILITY FUNCTIONS ===
 void wrapper_to_string() {
     if (call_arg_count >= 1 && call_args[0]) {
-        set_return_value(call_args[0]);
+        set_return_value(value_string(call_args[0]));
         return;
     }
-    set_return_value("");
+    set_return_value(value_string(""));
 }
 
 void wrapper_string_concat() {
     if (call_arg_count >= 2) {
         const char *str1 = call_args[0] ? call_args[0] : "";
         const char *str2 = call_args[1] ? call_args[1] : "";
-        size_t len = strlen(str1) + strlen(str2);
-        char *buf = (char*)malloc(len + 1);
-        strcpy(buf, str1);
-        strcat(buf, str2);
-        set_return_value(buf);
-        free(buf);
+        set_return_value(value_string_concat(str1, strlen(str1), str2, strlen(str2)));
         return;
     }
-    set_return_value("");
+    set_return_value(value_string(""));
 }
 
 void wrapper_string_length() {
     if (call_arg_count >= 1) {
         const char *str = call_args[0] ? call_args[0] : "";
-        char buf[32];
-        sprintf(buf, "%zu", strlen(str));
-        set_return_value(buf);
+        set_return_value(value_int((int64_t)strlen(str)));
         return;
     }
-    set_return_value("0");
+    set_return_value(value_int(0));
+}
+
+// string_builder_new() returns an empty builder; string_builder_append(builder, values...)
+// appends the text of each value and returns the builder; string_builder_finish(builder)
+// returns the built string and leaves the builder empty. Unlike the wrappers above these
+// get the builder itself rather than its text, so vm.c dispatches them here directly.
+int call_string_builder_builtin(const char *name, Value *args, int arg_count, Value *result) {
+    if (strncmp(name, "string_builder_", 15) != 0) return 0;
+    const char *op = name + 15;
+    if (strcmp(op, "new") == 0 && arg_count == 0) {
+        *result = value_string_builder();
+        return 1;
+    }
+    if (arg_count < 1 || args[0].type != VAL_STRING_BUILDER) return 0;
+    OuroStringBuilder *builder = args[0].as.builder;
+    if (strcmp(op, "append") == 0) {
+        for (int i = 1; i < arg_count; i++) {
+            if (args[i].type == VAL_STRING) {
+                OuroString *str = args[i].as.string;
+                string_builder_append(builder, ouro_string_chars(str), str->length);
+            } else {
+                Value text = value_to_string(args[i]);
+                string_builder_append(builder, ouro_string_chars(text.as.string), text.as.string->length);
+                value_release(text);
+            }
+        }
+        *result = value_copy(args[0]);
+        return 1;
+    }
+    if (strcmp(op, "finish") == 0 && arg_count == 1) {
+        *result = string_builder_finish(builder);
+        return 1;
+    }
+    return 0;
 }
 
 // OpenGL wrapper implementations
@@ -1184,9 +1211,7 @@ void wrapper_opengl_swap_buffers() {
 void wrapper_opengl_is_context_valid() {
     int valid = opengl_is_context_valid();
     // For the VM's return value system, we need to use vm.h's set_return_value
-    char result[32];
-    sprintf(result, "%d", valid);
-    set_return_value(result);
+    set_return_value(value_int(valid));
 }
 
 // Vulkan wrapper implementations
@@ -1261,9 +1286,7 @@ void wrapper_vulkan_create_command_buffers() {
 void wrapper_vulkan_draw_frame() {
     int result = vulkan_draw_frame();
     // Return value for Ouroboros VM
-    char result_str[32];
-    sprintf(result_str, "%d", result);
-    set_return_value(result_str);
+    set_return_value(value_int(result));
 }
 
 void wrapper_vulkan_cleanup() {
@@ -1,6 +1,8 @@
 #ifndef STDLIB_H
 #define STDLIB_H
 
+#include "value.h"
+
 // No direct ASTNode dependencies needed for the public API of stdlib itself.
 // The VM handles ASTNode evaluation before calling stdlib functions.
 
@@ -9,5 +11,7 @@ void register_stdlib_functions();
 // This is the function that stdlib.c implements and vm.c calls.
 int call_builtin_function_impl(const char *name, const char **args, int arg_count); 
 void set_call_args(const char **args, int count); // Used internally by stdlib.c wrappers
+// string_builder_* builtins, which take values rather than text. Returns 0 if name is not one of them.
+int call_string_builder_builtin(const char *name, Value *args, int arg_count, Value *result);
 
 #endif // STDLIB_H
\ No newline at end of file
@@ -0,0 +1,671 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <math.h>
+#include "value.h"
+#include "ast_types.h" // For function names
+
+#define MAX_ARRAY_TEXT_DEPTH 32 // Deeper (or self-containing) arrays and maps print as "[...]" / "{...}"
+#define MAP_INITIAL_CAPACITY 8
+#define MAP_SLOT_EMPTY   (-1)
+#define MAP_SLOT_REMOVED (-2)
+#define STRING_ROPE_MIN_LENGTH 256 // Shorter concatenations are copied flat
+
+// Text accumulator for array rendering. A fixed buffer stops at its capacity;
+// otherwise the buffer grows.
+typedef struct TextBuffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+    int fixed;
+    int truncated;
+} TextBuffer;
+
+static OuroString* ouro_string_alloc(size_t length) {
+    OuroString *str = (OuroString*)malloc(sizeof(OuroString) + length + 1);
+    if (!str) {
+        fprintf(stderr, "Error: Memory allocation failed for string of length %zu\n", length);
+        exit(EXIT_FAILURE);
+    }
+    str->refcount = 1;
+    str->hash = 0;
+    str->length = length;
+    str->chars = str->inline_chars;
+    str->left = str->right = NULL;
+    str->chars[length] = '\0';
+    return str;
+}
+
+// Drops a reference to str. Ropes are freed with an explicit stack rather than
+// recursion: a string built by a million appends is a rope a million levels deep.
+static void ouro_string_release(OuroString *str) {
+    if (--str->refcount > 0) return;
+    OuroString *inline_stack[32];
+    OuroString **stack = inline_stack;
+    size_t count = 0, capacity = 32;
+    for (;;) {
+        OuroString *halves[2] = { str->left, str->right };
+        if (str->chars != str->inline_chars) free(str->chars);
+        free(str);
+        for (int i = 0; i < 2; i++) {
+            if (!halves[i] || --halves[i]->refcount > 0) continue;
+            if (count == capacity) {
+                capacity *= 2;
+                OuroString **grown = (OuroString**)malloc(sizeof(OuroString*) * capacity);
+                if (!grown) {
+                    fprintf(stderr, "Error: Memory allocation failed releasing a rope\n");
+                    exit(EXIT_FAILURE);
+                }
+                memcpy(grown, stack, sizeof(OuroString*) * count);
+                if (stack != inline_stack) free(stack);
+                stack = grown;
+            }
+            stack[count++] = halves[i];
+        }
+        if (count == 0) break;
+        str = stack[--count];
+    }
+    if (stack != inline_stack) free(stack);
+}
+
+const char* ouro_string_chars(OuroString *str) {
+    if (str->chars) return str->chars;
+
+    // Copy the leaves right to left, so a left-leaning rope (the shape repeated
+    // appends build) never needs more than a couple of stack entries
+    char *chars = (char*)malloc(str->length + 1);
+    size_t capacity = 32, count = 0;
+    OuroString **stack = (OuroString**)malloc(sizeof(OuroString*) * capacity);
+    if (!chars || !stack) {
+        fprintf(stderr, "Error: Memory allocation failed flattening a string of length %zu\n", str->length);
+        exit(EXIT_FAILURE);
+    }
+    size_t end = str->length;
+    chars[end] = '\0';
+    stack[count++] = str;
+    while (count > 0) {
+        OuroString *node = stack[--count];
+        if (node->chars) {
+            end -= node->length;
+            memcpy(chars + end, node->chars, node->length);
+            continue;
+        }
+        if (count + 2 > capacity) {
+            capacity *= 2;
+            OuroString **grown = (OuroString**)realloc(stack, sizeof(OuroString*) * capacity);
+            if (!grown) {
+                fprintf(stderr, "Error: Memory allocation failed flattening a string of length %zu\n", str->length);
+                exit(EXIT_FAILURE);
+            }
+            stack = grown;
+        }
+        stack[count++] = node->left;
+        stack[count++] = node->right;
+    }
+    free(stack);
+
+    OuroString *left = str->left, *right = str->right;
+    str->chars = chars;
+    str->left = str->right = NULL;
+    ouro_string_release(left);
+    ouro_string_release(right);
+    return chars;
+}
+
+Value value_undefined(void) {
+    Value v;
+    v.type = VAL_UNDEFINED;
+    v.as.integer = 0;
+    return v;
+}
+
+Value value_bool(int b) {
+    Value v;
+    v.type = VAL_BOOL;
+    v.as.integer = 0;
+    v.as.boolean = b ? 1 : 0;
+    return v;
+}
+
+Value value_int(int64_t i) {
+    Value v;
+    v.type = VAL_INT;
+    v.as.integer = i;
+    return v;
+}
+
+Value value_double(double d) {
+    Value v;
+    v.type = VAL_DOUBLE;
+    v.as.number = d;
+    return v;
+}
+
+Value value_string_with_length(const char *s, size_t length) {
+    Value v;
+    v.type = VAL_STRING;
+    v.as.string = ouro_string_alloc(length);
+    if (length) memcpy(v.as.string->chars, s, length);
+    return v;
+}
+
+Value value_string(const char *s) {
+    if (!s) s = "";
+    return value_string_with_length(s, strlen(s));
+}
+
+Value value_string_concat(const char *a, size_t a_len, const char *b, size_t b_len) {
+    Value v;
+    v.type = VAL_STRING;
+    v.as.string = ouro_string_alloc(a_len + b_len);
+    if (a_len) memcpy(v.as.string->chars, a, a_len);
+    if (b_len) memcpy(v.as.string->chars + a_len, b, b_len);
+    return v;
+}
+
+Value value_string_join(OuroString *a, OuroString *b) {
+    Value v;
+    v.type = VAL_STRING;
+    if (b->length == 0 || a->length == 0) {
+        v.as.string = b->length == 0 ? a : b;
+        v.as.string->refcount++;
+        return v;
+    }
+    size_t length = a->length + b->length;
+    if (length < STRING_ROPE_MIN_LENGTH) {
+        return value_string_concat(ouro_string_chars(a), a->length, ouro_string_chars(b), b->length);
+    }
+    OuroString *rope = (OuroString*)malloc(sizeof(OuroString));
+    if (!rope) {
+        fprintf(stderr, "Error: Memory allocation failed for string of length %zu\n", length);
+        exit(EXIT_FAILURE);
+    }
+    rope->refcount = 1;
+    rope->hash = 0;
+    rope->length = length;
+    rope->chars = NULL;
+    rope->left = a;
+    rope->right = b;
+    a->refcount++;
+    b->refcount++;
+    v.as.string = rope;
+    return v;
+}
+
+Value value_object(int object_id, unsigned int generation) {
+    Value v;
+    v.type = VAL_OBJECT;
+    v.as.object.id = object_id;
+    v.as.object.generation = generation;
+    return v;
+}
+
+Value value_function(struct ASTNode *func_node) {
+    Value v;
+    v.type = VAL_FUNCTION;
+    v.as.function = func_node;
+    return v;
+}
+
+Value value_array(int capacity) {
+    OuroArray *array = (OuroArray*)calloc(1, sizeof(OuroArray));
+    if (!array) {
+        fprintf(stderr, "Error: Memory allocation failed for array\n");
+        exit(EXIT_FAILURE);
+    }
+    array->refcount = 1;
+    if (capacity > 0) {
+        array->items = (Value*)malloc(sizeof(Value) * capacity);
+        if (!array->items) {
+            fprintf(stderr, "Error: Memory allocation failed for array of %d items\n", capacity);
+            exit(EXIT_FAILURE);
+        }
+        array->capacity = capacity;
+    }
+    Value v;
+    v.type = VAL_ARRAY;
+    v.as.array = array;
+    return v;
+}
+
+void array_push(OuroArray *array, Value item) {
+    if (array->count == array->capacity) {
+        int new_capacity = array->capacity ? array->capacity * 2 : 8;
+        Value *grown = (Value*)realloc(array->items, sizeof(Value) * new_capacity);
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed growing array to %d items\n", new_capacity);
+            exit(EXIT_FAILURE);
+        }
+        array->items = grown;
+        array->capacity = new_capacity;
+    }
+    array->items[array->count++] = value_copy(item);
+}
+
+Value array_pop(OuroArray *array) {
+    if (array->count == 0) return value_undefined();
+    return array->items[--array->count];
+}
+
+const Value* array_get(const OuroArray *array, int64_t index) {
+    if (index < 0 || index >= array->count) return NULL;
+    return &array->items[index];
+}
+
+int array_set(OuroArray *array, int64_t index, Value item) {
+    if (index < 0 || index > array->count) return 0;
+    if (index == array->count) {
+        array_push(array, item);
+        return 1;
+    }
+    Value old_item = array->items[index];
+    array->items[index] = value_copy(item);
+    value_release(old_item);
+    return 1;
+}
+
+Value value_map(void) {
+    OuroMap *map = (OuroMap*)calloc(1, sizeof(OuroMap));
+    if (!map) {
+        fprintf(stderr, "Error: Memory allocation failed for map\n");
+        exit(EXIT_FAILURE);
+    }
+    map->refcount = 1;
+    Value v;
+    v.type = VAL_MAP;
+    v.as.map = map;
+    return v;
+}
+
+Value value_string_builder(void) {
+    OuroStringBuilder *builder = (OuroStringBuilder*)calloc(1, sizeof(OuroStringBuilder));
+    if (!builder) {
+        fprintf(stderr, "Error: Memory allocation failed for string builder\n");
+        exit(EXIT_FAILURE);
+    }
+    builder->refcount = 1;
+    Value v;
+    v.type = VAL_STRING_BUILDER;
+    v.as.builder = builder;
+    return v;
+}
+
+void string_builder_append(OuroStringBuilder *builder, const char *text, size_t length) {
+    if (builder->length + length + 1 > builder->capacity) {
+        size_t new_capacity = builder->capacity ? builder->capacity : 64;
+        while (builder->length + length + 1 > new_capacity) new_capacity *= 2;
+        char *grown = (char*)realloc(builder->chars, new_capacity);
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed growing string builder to %zu bytes\n", new_capacity);
+            exit(EXIT_FAILURE);
+        }
+        builder->chars = grown;
+        builder->capacity = new_capacity;
+    }
+    if (length) memcpy(builder->chars + builder->length, text, length);
+    builder->length += length;
+    builder->chars[builder->length] = '\0';
+}
+
+Value string_builder_finish(OuroStringBuilder *builder) {
+    if (!builder->chars) return value_string("");
+    // The string takes over the buffer; trim the unused tail if it is large
+    char *chars = builder->chars;
+    if (builder->capacity - builder->length > builder->length / 4 + 64) {
+        char *trimmed = (char*)realloc(chars, builder->length + 1);
+        if (trimmed) chars = trimmed;
+    }
+    OuroString *str = (OuroString*)malloc(sizeof(OuroString));
+    if (!str) {
+        fprintf(stderr, "Error: Memory allocation failed for string of length %zu\n", builder->length);
+        exit(EXIT_FAILURE);
+    }
+    str->refcount = 1;
+    str->hash = 0;
+    str->length = builder->length;
+    str->chars = chars;
+    str->left = str->right = NULL;
+    builder->chars = NULL;
+    builder->length = builder->capacity = 0;
+    Value v;
+    v.type = VAL_STRING;
+    v.as.string = str;
+    return v;
+}
+
+uint32_t string_hash(const char *chars, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)chars[i];
+        hash *= 16777619u;
+    }
+    return hash ? hash : 1; // 0 marks an OuroString whose hash is not computed yet
+}
+
+uint32_t ouro_string_hash(OuroString *str) {
+    if (!str->hash) str->hash = string_hash(ouro_string_chars(str), str->length);
+    return str->hash;
+}
+
+// Index slot holding key, or the empty slot where it would be inserted
+static int32_t* map_find_slot(const OuroMap *map, const char *key, size_t length, uint32_t hash) {
+    uint32_t mask = (uint32_t)map->entry_capacity * 2 - 1;
+    int32_t *insert_slot = NULL;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        int32_t *slot = &map->index[i];
+        if (*slot == MAP_SLOT_EMPTY) return insert_slot ? insert_slot : slot;
+        if (*slot == MAP_SLOT_REMOVED) {
+            if (!insert_slot) insert_slot = slot;
+            continue;
+        }
+        const OuroString *entry_key = map->entries[*slot].key;
+        if (entry_key->hash == hash && entry_key->length == length && memcmp(entry_key->chars, key, length) == 0) {
+            return slot;
+        }
+    }
+}
+
+static const Value* map_lookup(const OuroMap *map, const char *key, size_t length, uint32_t hash) {
+    if (map->count == 0) return NULL;
+    int32_t position = *map_find_slot(map, key, length, hash);
+    return position >= 0 ? &map->entries[position].value : NULL;
+}
+
+// Compacts removed entries away and rebuilds the index for entry_capacity entries
+static void map_rebuild(OuroMap *map, int entry_capacity) {
+    int live = 0;
+    for (int i = 0; i < map->entry_count; i++) {
+        if (map->entries[i].key) map->entries[live++] = map->entries[i];
+    }
+    MapEntry *entries = (MapEntry*)realloc(map->entries, sizeof(MapEntry) * entry_capacity);
+    int32_t *index = (int32_t*)malloc(sizeof(int32_t) * entry_capacity * 2);
+    if (!entries || !index) {
+        fprintf(stderr, "Error: Memory allocation failed growing map to %d entries\n", entry_capacity);
+        exit(EXIT_FAILURE);
+    }
+    memset(index, 0xff, sizeof(int32_t) * entry_capacity * 2); // MAP_SLOT_EMPTY
+    free(map->index);
+    map->entries = entries;
+    map->index = index;
+    map->entry_capacity = entry_capacity;
+    map->entry_count = live;
+    for (int i = 0; i < live; i++) {
+        const OuroString *key = entries[i].key;
+        *map_find_slot(map, key->chars, key->length, key->hash) = i;
+    }
+}
+
+const Value* map_get(const OuroMap *map, OuroString *key) {
+    uint32_t hash = ouro_string_hash(key); // Flattens a rope key before its chars are read
+    return map_lookup(map, key->chars, key->length, hash);
+}
+
+const Value* map_get_text(const OuroMap *map, const char *key) {
+    size_t length = strlen(key);
+    return map_lookup(map, key, length, string_hash(key, length));
+}
+
+void map_set(OuroMap *map, OuroString *key, Value value) {
+    uint32_t hash = ouro_string_hash(key);
+    if (map->entry_capacity == 0) map_rebuild(map, MAP_INITIAL_CAPACITY);
+    int32_t *slot = map_find_slot(map, key->chars, key->length, hash);
+    if (*slot >= 0) {
+        Value *stored = &map->entries[*slot].value;
+        Value old_value = *stored;
+        *stored = value_copy(value);
+        value_release(old_value);
+        return;
+    }
+    if (map->entry_count == map->entry_capacity) {
+        // Grow, or just compact when at least half of the entries were removed
+        map_rebuild(map, map->count >= map->entry_capacity / 2 ? map->entry_capacity * 2 : map->entry_capacity);
+        slot = map_find_slot(map, key->chars, key->length, hash);
+    }
+    MapEntry *entry = &map->entries[map->entry_count];
+    key->refcount++;
+    entry->key = key;
+    entry->value = value_copy(value);
+    *slot = map->entry_count++;
+    map->count++;
+}
+
+int map_remove(OuroMap *map, OuroString *key) {
+    if (map->count == 0) return 0;
+    uint32_t hash = ouro_string_hash(key);
+    int32_t *slot = map_find_slot(map, key->chars, key->length, hash);
+    if (*slot < 0) return 0;
+    MapEntry *entry = &map->entries[*slot];
+    ouro_string_release(entry->key);
+    value_release(entry->value);
+    entry->key = NULL;
+    entry->value = value_undefined();
+    *slot = MAP_SLOT_REMOVED;
+    map->count--;
+    return 1;
+}
+
+const MapEntry* map_next(const OuroMap *map, int *position) {
+    while (*position < map->entry_count) {
+        const MapEntry *entry = &map->entries[(*position)++];
+        if (entry->key) return entry;
+    }
+    return NULL;
+}
+
+Value value_copy(Value v) {
+    if (v.type == VAL_STRING && v.as.string) v.as.string->refcount++;
+    else if (v.type == VAL_ARRAY && v.as.array) v.as.array->refcount++;
+    else if (v.type == VAL_MAP && v.as.map) v.as.map->refcount++;
+    else if (v.type == VAL_STRING_BUILDER && v.as.builder) v.as.builder->refcount++;
+    return v;
+}
+
+void value_release(Value v) {
+    if (v.type == VAL_STRING && v.as.string) {
+        ouro_string_release(v.as.string);
+    } else if (v.type == VAL_ARRAY && v.as.array) {
+        OuroArray *array = v.as.array;
+        if (--array->refcount == 0) {
+            for (int i = 0; i < array->count; i++) value_release(array->items[i]);
+            free(array->items);
+            free(array);
+        }
+    } else if (v.type == VAL_MAP && v.as.map) {
+        OuroMap *map = v.as.map;
+        if (--map->refcount == 0) {
+            for (int i = 0; i < map->entry_count; i++) {
+                MapEntry *entry = &map->entries[i];
+                if (!entry->key) continue;
+                ouro_string_release(entry->key);
+                value_release(entry->value);
+            }
+            free(map->entries);
+            free(map->index);
+            free(map);
+        }
+    } else if (v.type == VAL_STRING_BUILDER && v.as.builder) {
+        OuroStringBuilder *builder = v.as.builder;
+        if (--builder->refcount == 0) {
+            free(builder->chars);
+            free(builder);
+        }
+    }
+}
+
+int value_is_truthy(Value v) {
+    switch (v.type) {
+        case VAL_UNDEFINED: return 0;
+        case VAL_BOOL:      return v.as.boolean;
+        case VAL_INT:       return v.as.integer != 0;
+        case VAL_DOUBLE:    return v.as.number != 0.0;
+        case VAL_STRING:    return v.as.string->length != 0;
+        case VAL_OBJECT:
+        case VAL_FUNCTION:
+        case VAL_ARRAY:
+        case VAL_MAP:
+        case VAL_STRING_BUILDER: return 1;
+    }
+    return 0;
+}
+
+int value_is_number(Value v) {
+    return v.type == VAL_INT || v.type == VAL_DOUBLE;
+}
+
+double value_as_double(Value v) {
+    switch (v.type) {
+        case VAL_INT:    return (double)v.as.integer;
+        case VAL_DOUBLE: return v.as.number;
+        case VAL_BOOL:   return v.as.boolean;
+        default:         return 0.0;
+    }
+}
+
+static void text_append(TextBuffer *tb, const char *text, size_t length) {
+    if (tb->length + length + 1 > tb->capacity) {
+        if (tb->fixed) {
+            length = tb->capacity > tb->length + 1 ? tb->capacity - tb->length - 1 : 0;
+            tb->truncated = 1;
+        } else {
+            size_t new_capacity = tb->capacity ? tb->capacity : 64;
+            while (tb->length + length + 1 > new_capacity) new_capacity *= 2;
+            char *grown = (char*)realloc(tb->data, new_capacity);
+            if (!grown) {
+                fprintf(stderr, "Error: Memory allocation failed for %zu bytes of text\n", new_capacity);
+                exit(EXIT_FAILURE);
+            }
+            tb->data = grown;
+            tb->capacity = new_capacity;
+        }
+    }
+    if (length) memcpy(tb->data + tb->length, text, length);
+    tb->length += length;
+    if (tb->capacity) tb->data[tb->length] = '\0';
+}
+
+// Arrays render as "[a,b,c]", the form the string-encoded arrays used, and maps
+// as "{key:value,...}" in insertion order
+static void append_value_text(TextBuffer *tb, Value v, int depth) {
+    if (v.type == VAL_ARRAY) {
+        if (depth >= MAX_ARRAY_TEXT_DEPTH) {
+            text_append(tb, "[...]", 5);
+            return;
+        }
+        text_append(tb, "[", 1);
+        for (int i = 0; i < v.as.array->count && !tb->truncated; i++) {
+            if (i > 0) text_append(tb, ",", 1);
+            append_value_text(tb, v.as.array->items[i], depth + 1);
+        }
+        text_append(tb, "]", 1);
+    } else if (v.type == VAL_MAP) {
+        if (depth >= MAX_ARRAY_TEXT_DEPTH) {
+            text_append(tb, "{...}", 5);
+            return;
+        }
+        text_append(tb, "{", 1);
+        int position = 0;
+        const MapEntry *entry;
+        for (int i = 0; (entry = map_next(v.as.map, &position)) != NULL && !tb->truncated; i++) {
+            if (i > 0) text_append(tb, ",", 1);
+            text_append(tb, entry->key->chars, entry->key->length);
+            text_append(tb, ":", 1);
+            append_value_text(tb, entry->value, depth + 1);
+        }
+        text_append(tb, "}", 1);
+    } else {
+        char text_buf[VALUE_TEXT_BUFFER_SIZE];
+        const char *text = value_to_text(v, text_buf, sizeof(text_buf));
+        text_append(tb, text, strlen(text));
+    }
+}
+
+const char* value_to_text(Value v, char *buf, size_t size) {
+    switch (v.type) {
+        case VAL_UNDEFINED: return "undefined";
+        case VAL_BOOL:      return v.as.boolean ? "true" : "false";
+        case VAL_INT:
+            snprintf(buf, size, "%" PRId64, v.as.integer);
+            return buf;
+        case VAL_DOUBLE:
+            if (isnan(v.as.number)) return "NaN";
+            if (isinf(v.as.number)) return v.as.number > 0 ? "Infinity" : "-Infinity";
+            snprintf(buf, size, "%g", v.as.number);
+            return buf;
+        case VAL_STRING:    return ouro_string_chars(v.as.string);
+        case VAL_STRING_BUILDER: return v.as.builder->chars ? v.as.builder->chars : "";
+        case VAL_OBJECT:
+            snprintf(buf, size, "obj:%d", v.as.object.id);
+            return buf;
+        case VAL_FUNCTION:
+            // Function values print as their registered name, the form the
+            // string-based runtime used as a function reference.
+            return v.as.function ? v.as.function->value : "undefined";
+        case VAL_ARRAY:
+        case VAL_MAP: {
+            TextBuffer tb = { buf, 0, size, 1, 0 };
+            if (size) buf[0] = '\0';
+            append_value_text(&tb, v, 0);
+            if (tb.truncated && size >= 4) memcpy(buf + size - 4, "...", 4);
+            return buf;
+        }
+    }
+    return "undefined";
+}
+
+Value value_to_string(Value v) {
+    if (v.type == VAL_STRING) return value_copy(v);
+    if (v.type != VAL_ARRAY && v.type != VAL_MAP) {
+        char text_buf[VALUE_TEXT_BUFFER_SIZE];
+        return value_string(value_to_text(v, text_buf, sizeof(text_buf)));
+    }
+    TextBuffer tb = { NULL, 0, 0, 0, 0 };
+    append_value_text(&tb, v, 0);
+    Value result = value_string_with_length(tb.data, tb.length);
+    free(tb.data);
+    return result;
+}
+
+Value value_from_text(const char *text) {
+    if (!text || strcmp(text, "undefined") == 0) return value_undefined();
+    if (strcmp(text, "true") == 0) return value_bool(1);
+    if (strcmp(text, "false") == 0) return value_bool(0);
+    if (strncmp(text, "obj:", 4) == 0 && text[4]) {
+        char *end = NULL;
+        long id = strtol(text + 4, &end, 10);
+        if (end && *end == '\0') return value_object((int)id, 0); // Generation is not part of the text form
+    }
+
+    // Only plain decimal numerals are treated as numbers; words such as "inf"
+    // or "nan" and hex forms stay strings.
+    const char *p = text;
+    if (*p == '-' || *p == '+') p++;
+    if ((*p >= '0' && *p <= '9') || (*p == '.' && p[1] >= '0' && p[1] <= '9')) {
+        char *end = NULL;
+        errno = 0;
+        long long i = strtoll(text, &end, 10);
+        if (end && *end == '\0' && errno == 0) return value_int((int64_t)i);
+        if (!(p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))) {
+            double d = strtod(text, &end);
+            if (end && *end == '\0' && isfinite(d)) return value_double(d);
+        }
+    }
+    return value_string(text);
+}
+
+const char* value_type_name(ValueType type) {
+    switch (type) {
+        case VAL_UNDEFINED: return "undefined";
+        case VAL_BOOL:      return "bool";
+        case VAL_INT:       return "int";
+        case VAL_DOUBLE:    return "float";
+        case VAL_STRING:    return "string";
+        case VAL_OBJECT:    return "object";
+        case VAL_FUNCTION:  return "function";
+        case VAL_ARRAY:     return "array";
+        case VAL_MAP:       return "map";
+        case VAL_STRING_BUILDER: return "string_builder";
+    }
+    return "unknown";
+}
@@ -0,0 +1,155 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct ASTNode; // Function values point at their declaration node
+
+// Runtime value tags
+typedef enum {
+    VAL_UNDEFINED,
+    VAL_BOOL,
+    VAL_INT,      // 64-bit signed integer
+    VAL_DOUBLE,
+    VAL_STRING,   // Reference to a shared, immutable OuroString
+    VAL_OBJECT,   // Reference to a VM object by handle ("obj:N")
+    VAL_FUNCTION, // Reference to a user function's AST node
+    VAL_ARRAY,    // Reference to a shared, mutable OuroArray
+    VAL_MAP,      // Reference to a shared, mutable OuroMap
+    VAL_STRING_BUILDER // Reference to a shared, mutable OuroStringBuilder
+} ValueType;
+
+// Heap string shared between values by reference count. Strings are never
+// mutated after creation, so copying a value only bumps the count.
+// Concatenating long strings makes a rope: a node that shares its two halves
+// instead of copying them. A rope is flattened into one buffer the first time
+// its text is read (ouro_string_chars), so a string built by repeated `+`
+// costs O(total length) rather than O(n^2).
+typedef struct OuroString {
+    int refcount;
+    uint32_t hash; // string_hash() of chars, computed on first use; 0 until then
+    size_t length;
+    char *chars;               // NUL-terminated text; NULL while the string is an unflattened rope
+    struct OuroString *left;   // Rope halves (owned): the text is left followed by right.
+    struct OuroString *right;  // Both NULL once flattened, and for strings created flat.
+    char inline_chars[];       // Text of strings created flat; chars points here
+} OuroString;
+
+// Growable text buffer for the string_builder_* builtins. Unlike strings,
+// builders are mutable: appends through any reference are seen by all of them.
+typedef struct OuroStringBuilder {
+    int refcount;
+    size_t length;
+    size_t capacity;
+    char *chars;           // NUL-terminated; NULL until the first append
+} OuroStringBuilder;
+
+// Growable array shared between values by reference count. Arrays are mutable:
+// every value referring to an array sees changes made through any of them.
+typedef struct OuroArray {
+    int refcount;
+    int count;
+    int capacity;
+    unsigned int gc_mark;  // Collection that last traced the array (vm.c)
+    struct Value *items;   // count owned values, contiguous
+} OuroArray;
+
+// Tagged runtime value (16 bytes). Values returned by evaluation functions are
+// owned by the caller and must be released with value_release(); lookups that
+// return `const Value*` lend a reference owned by the container.
+typedef struct Value {
+    ValueType type;
+    union {
+        int boolean;
+        int64_t integer;
+        double number;
+        OuroString *string;
+        OuroArray *array;
+        struct OuroMap *map;
+        OuroStringBuilder *builder;
+        struct {
+            int id;                  // Slot in the VM's object handle table
+            unsigned int generation; // Slot generation the reference was taken from; 0 matches any
+        } object;
+        struct ASTNode *function;
+    } as;
+} Value;
+
+// Map entry. Entries keep insertion order; a removed entry has a NULL key until
+// the next rebuild compacts it away.
+typedef struct MapEntry {
+    OuroString *key;       // Owned reference
+    Value value;           // Owned value
+} MapEntry;
+
+// Hash map from string keys to values, shared by reference count like OuroArray.
+// `index` is an open-addressed (linear probing) table of positions in `entries`,
+// never more than half full so probes stay short.
+typedef struct OuroMap {
+    int refcount;
+    int count;             // Live entries
+    int entry_count;       // Used entries, including removed ones
+    int entry_capacity;
+    unsigned int gc_mark;  // Collection that last traced the map (vm.c)
+    MapEntry *entries;
+    int32_t *index;        // 2 * entry_capacity slots: entry position, -1 empty, -2 removed
+} OuroMap;
+
+// Buffer size large enough for value_to_text() of any non-string value
+#define VALUE_TEXT_BUFFER_SIZE 64
+
+// Constructors
+Value value_undefined(void);
+Value value_bool(int b);
+Value value_int(int64_t i);
+Value value_double(double d);
+Value value_string(const char *s);                   // Copies s
+Value value_string_with_length(const char *s, size_t length);
+Value value_string_concat(const char *a, size_t a_len, const char *b, size_t b_len);
+Value value_string_join(OuroString *a, OuroString *b); // a followed by b; long results share a and b as a rope
+Value value_object(int object_id, unsigned int generation);
+Value value_function(struct ASTNode *func_node);
+Value value_array(int capacity);                     // New empty array with room for capacity items
+Value value_map(void);                               // New empty map
+Value value_string_builder(void);                    // New empty string builder
+
+// Strings
+const char* ouro_string_chars(OuroString *str);      // NUL-terminated text; flattens a rope in place
+
+// String builders. Appends are amortized O(length appended).
+void string_builder_append(OuroStringBuilder *builder, const char *text, size_t length);
+Value string_builder_finish(OuroStringBuilder *builder); // Owned string of the text; empties the builder without copying
+
+// Arrays. Indexes are bounds-checked; stored values are copied.
+void array_push(OuroArray *array, Value item);          // Amortized O(1)
+Value array_pop(OuroArray *array);                      // Owned last item, or undefined when empty
+const Value* array_get(const OuroArray *array, int64_t index); // Borrowed; NULL when out of range
+int array_set(OuroArray *array, int64_t index, Value item);    // Index == count appends; 0 when out of range
+
+// Maps. Keys are strings; a key's hash is computed once and cached on its OuroString.
+// Get, set and remove are amortized O(1); iteration follows insertion order.
+uint32_t string_hash(const char *chars, size_t length);  // FNV-1a, never 0
+uint32_t ouro_string_hash(OuroString *str);              // Cached string_hash of str
+const Value* map_get(const OuroMap *map, OuroString *key);             // Borrowed; NULL when missing
+const Value* map_get_text(const OuroMap *map, const char *key);        // Same for a C string key
+void map_set(OuroMap *map, OuroString *key, Value value);              // Stores copies of key and value
+int map_remove(OuroMap *map, OuroString *key);                         // 0 when missing
+const MapEntry* map_next(const OuroMap *map, int *position);           // Entry at or after *position, advancing it; NULL at end
+
+// Reference counting (no-ops for non-heap values)
+Value value_copy(Value v);   // Returns v with an extra reference
+void value_release(Value v);
+// Whether v holds a counted reference; hot paths skip value_copy/value_release for the rest
+#define VALUE_IS_REFCOUNTED(v) ((v).type == VAL_STRING || (v).type >= VAL_ARRAY)
+
+// Conversions
+int value_is_truthy(Value v);
+int value_is_number(Value v);
+double value_as_double(Value v);               // Numeric view of VAL_INT/VAL_DOUBLE/VAL_BOOL
+const char* value_to_text(Value v, char *buf, size_t size); // Text form; buf used for non-strings (arrays and maps are cut to fit)
+Value value_to_string(Value v);                // Owned string holding the full text form
+Value value_from_text(const char *text);       // Infers int/double/bool/object/undefined from legacy text
+const char* value_type_name(ValueType type);
+
+#endif // VALUE_H
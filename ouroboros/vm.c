@@ -2,12 +2,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h> // For isupper in identifier evaluation
+#include <time.h>  // For collector pause times
 #include "vm.h"
 #include "ast_types.h"
 #include "stack.h"
 #include "eval.h"    // For evaluate_expression
 #include "stdlib.h"  // For actual call_builtin_function, register_stdlib_functions
 #include "module.h"  // For Module types, if used for imports
+#include "ir.h"      // For the bytecode compiler
+#include "jit.h"     // Native code for hot chunks
+#include "aot.h"     // Chunks compiled ahead of time (-emit-c)
+#include "intern.h"  // Names are interned and compared by pointer
+#include "name_table.h"
+#include "optimize.h" // Declarations dead-code elimination found unreachable
 
 // Using AccessModifierEnum from vm.h; remove string macro definition
 
@@ -18,51 +25,277 @@ typedef struct FunctionEntry {
     struct FunctionEntry *next;
 } FunctionEntry;
 
+typedef enum { METHODS_UNBUILT, METHODS_BUILDING, METHODS_BUILT } MethodTableState;
+
 typedef struct ClassEntry {
-    char name[128];
-    char parent_name[128];
+    const char *name;        // Interned
+    const char *parent_name; // Interned; NULL without a parent class
     ASTNode *class_node; 
+    Object *static_object; // ClassName_static companion, created on first use
+    NameTable methods;     // Own and inherited methods by name; see class_method_table
+    MethodTableState methods_state;
     struct ClassEntry *next;
 } ClassEntry;
 
+// Object handle table: "obj:N" indexes object_handles[N] directly. Freeing an object
+// bumps its slot's generation and puts the slot on a free list, so references taken
+// before the slot was reused no longer resolve.
+typedef struct ObjectHandle {
+    Object *object;          // NULL while the slot is free
+    unsigned int generation;
+    int next_free;           // Next free slot while this one is free, -1 at the end
+} ObjectHandle;
+
+// Operand stack of an active run_bytecode call, scanned as a GC root. top is
+// synced before every instruction that can reach a safe point.
+typedef struct GcStackRoots {
+    const Value *base;
+    const Value *top;
+    struct GcStackRoots *prev;
+} GcStackRoots;
+
+#ifndef GC_INITIAL_THRESHOLD
+#define GC_INITIAL_THRESHOLD (1024 * 1024) // Object bytes allocated before the first collection
+#endif
+#ifndef JIT_CALL_THRESHOLD
+#define JIT_CALL_THRESHOLD 100   // Runs of a chunk before it is compiled to native code
+#endif
+#ifndef JIT_LOOP_THRESHOLD
+#define JIT_LOOP_THRESHOLD 1000  // Interpreted loop back-edges before a chunk is compiled
+#endif
+
 static StackFrame *global_frame = NULL;
-static char *return_value = NULL;
-static FunctionEntry *registered_functions = NULL;
+static Value return_value = { VAL_UNDEFINED, { 0 } };
+static FunctionEntry *registered_functions = NULL; // Every registration, for freeing bytecode
+static NameTable function_table = { NULL, 0, 0 };   // (name, class or NULL) -> latest ASTNode*
 static ClassEntry *registered_classes = NULL;
+static NameTable class_table = { NULL, 0, 0 };      // Class name -> ClassEntry*
 static ClassEntry *registered_classes_tail = NULL;
 
 char current_class[128] = {0}; // Global current class context for resolution
+const char *name_this = NULL;
 char g_super_target_class[128] = {0};
 Object *objects = NULL;
-static int next_object_id = 1;
-
-static int g_break_flag = 0;
-static int g_continue_flag = 0;
+static ObjectHandle *object_handles = NULL;
+static int object_handle_count = 1; // Slot 0 is never used, so obj:0 stays invalid
+static int object_handle_capacity = 0;
+static int free_object_handle = -1;
+static Shape *root_shape = NULL; // Empty shape every object starts from
+
+static StackFrame **active_frames = NULL; // Frames of calls in progress, innermost last
+static int active_frame_count = 0;
+static int active_frame_capacity = 0;
+static GcStackRoots *gc_stack_roots = NULL;
+static Value *gc_temp_roots = NULL;
+static int gc_temp_root_count = 0;
+static int gc_temp_root_capacity = 0;
+static Object **gc_mark_stack = NULL;
+static int gc_mark_stack_count = 0;
+static int gc_mark_stack_capacity = 0;
+static size_t gc_bytes_allocated = 0; // Bytes owned by live objects
+static size_t gc_next_collection = GC_INITIAL_THRESHOLD;
+static int gc_pending = 0;            // Threshold crossed; collect at the next safe point
+static unsigned int gc_epoch = 0;     // Number of the collection in progress, for array and map marks
+static int gc_stats_enabled = 0;
+static int gc_collections = 0;
+static size_t gc_objects_freed = 0;
+static size_t gc_bytes_freed = 0;
+static double gc_total_pause_ms = 0.0;
+static double gc_max_pause_ms = 0.0;
+
+static int use_bytecode = 1; // Execute through compiled bytecode (-bytecode) or walk the AST (-ast)
+static int use_jit = 1;      // Compile hot chunks to native code where jit.c supports it (-jit/-no-jit)
+static ASTNode *ast_running_function = NULL; // Innermost function run_vm_node is executing (-ast)
+
+#define INLINE_CACHE_SIZE 4 // Receivers a site remembers; past that, entries are replaced in turn
+
+// Inline cache of an AST_CALL or AST_MEMBER_ACCESS site. Call sites map the receiver's
+// ClassEntry to its method; member sites map an object's Shape to the slot of a public
+// instance property. Both keys are immutable until the registries and shape tree are
+// freed, which bumps inline_cache_epoch and so empties every cache.
+typedef struct InlineCacheEntry {
+    const void *key;  // ClassEntry* or Shape*
+    ASTNode *method;  // Call sites; NULL when the class has no such method
+    int slot;         // Member sites; -1 when the slow path must decide
+} InlineCacheEntry;
+
+typedef struct InlineCache {
+    unsigned int epoch;
+    int count;
+    int next_victim;
+    InlineCacheEntry entries[INLINE_CACHE_SIZE];
+} InlineCache;
+
+static unsigned int inline_cache_epoch = 1;
 
 static int is_class_registered(const char *name);
+static Value run_bytecode(BytecodeChunk *chunk, StackFrame *frame);
+static void gc_mark_values(const Value *values, int count);
 static ClassEntry* find_class_entry(const char *name);
 static void initialize_default_instance_fields(const char *class_name, Object *instance, StackFrame* frame_for_eval);
+static void initialize_class_fields(const char *class_name, Object *target_obj, StackFrame *frame_for_eval, int want_static);
 const char* get_parent_class_name(const char *class_name);
 ASTNode* find_class_method(const char *class_name, const char *method_name);
 
-const char* get_return_value() {
-    return return_value ? return_value : "0"; 
+Value get_return_value() {
+    return value_copy(return_value);
 }
 
-void set_return_value(const char* value) {
-    if (return_value) {
-        free(return_value);
-        return_value = NULL;
-    }
-    if (value) {
-        return_value = strdup(value);
-        if (!return_value) {
-            fprintf(stderr, "Error: Memory allocation failed for return value. Defaulting to \"0\".\n");
-            return_value = strdup("0"); 
-        }
+Value take_return_value() {
+    Value v = return_value;
+    return_value = value_undefined();
+    return v;
+}
+
+void set_return_value(Value value) {
+    value_release(return_value);
+    return_value = value;
+}
+
+Value object_ref_value(Object *obj) {
+    if (!obj) return value_undefined();
+    return value_object(obj->id, obj->generation);
+}
+
+static int allocate_object_handle(Object *obj) {
+    int id = free_object_handle;
+    if (id >= 0) {
+        free_object_handle = object_handles[id].next_free;
     } else {
-        return_value = strdup("0"); 
+        if (object_handle_count >= object_handle_capacity) {
+            int new_capacity = object_handle_capacity ? object_handle_capacity * 2 : 64;
+            ObjectHandle *grown = (ObjectHandle*)realloc(object_handles, sizeof(ObjectHandle) * new_capacity);
+            if (!grown) {
+                fprintf(stderr, "Error: Failed to grow object handle table to %d entries\n", new_capacity);
+                exit(EXIT_FAILURE);
+            }
+            memset(grown + object_handle_capacity, 0, sizeof(ObjectHandle) * (new_capacity - object_handle_capacity));
+            object_handles = grown;
+            object_handle_capacity = new_capacity;
+        }
+        id = object_handle_count++;
+        object_handles[id].generation = 1; // Generation 0 is the "any generation" wildcard
     }
+    object_handles[id].object = obj;
+    object_handles[id].next_free = -1;
+    obj->id = id;
+    obj->generation = object_handles[id].generation;
+    return id;
+}
+
+static void release_object_handle(Object *obj) {
+    if (obj->id <= 0 || obj->id >= object_handle_count || object_handles[obj->id].object != obj) return;
+    ObjectHandle *handle = &object_handles[obj->id];
+    handle->object = NULL;
+    if (++handle->generation == 0) handle->generation = 1;
+    handle->next_free = free_object_handle;
+    free_object_handle = obj->id;
+}
+
+static Shape* new_shape(Shape *parent, const char *name, AccessModifierEnum access, int is_static) {
+    Shape *shape = (Shape*)calloc(1, sizeof(Shape));
+    int count = parent ? parent->property_count + 1 : 0;
+    ShapeProperty *properties = count ? (ShapeProperty*)malloc(sizeof(ShapeProperty) * count) : NULL;
+    if (!shape || (count && !properties)) {
+        fprintf(stderr, "Error: Failed to allocate shape for property '%s'\n", name ? name : "");
+        exit(EXIT_FAILURE);
+    }
+    if (parent) {
+        if (parent->property_count) memcpy(properties, parent->properties, sizeof(ShapeProperty) * parent->property_count);
+        properties[count - 1].name = name;
+        properties[count - 1].access = access;
+        properties[count - 1].is_static = is_static;
+        shape->next_sibling = parent->first_child;
+        parent->first_child = shape;
+    }
+    shape->parent = parent;
+    shape->property_count = count;
+    shape->properties = properties;
+    shape->added_name = name;
+    return shape;
+}
+
+static Shape* get_root_shape(void) {
+    if (!root_shape) root_shape = new_shape(NULL, NULL, ACCESS_MODIFIER_PUBLIC, 0);
+    return root_shape;
+}
+
+static void free_shape_tree(Shape *shape) {
+    while (shape) {
+        Shape *next = shape->next_sibling;
+        free_shape_tree(shape->first_child);
+        free(shape->properties);
+        free(shape);
+        shape = next;
+    }
+}
+
+// Slot of the interned name in shape, or -1
+static int shape_find_property(const Shape *shape, const char *name) {
+    for (int i = shape->property_count - 1; i >= 0; i--) {
+        if (shape->properties[i].name == name) return i;
+    }
+    return -1;
+}
+
+// Child of shape that adds name with the given modifiers, created on first use
+static Shape* shape_add_property(Shape *shape, const char *name, AccessModifierEnum access, int is_static) {
+    for (Shape *child = shape->first_child; child; child = child->next_sibling) {
+        const ShapeProperty *added = &child->properties[child->property_count - 1];
+        if (added->access == access && added->is_static == is_static && added->name == name) return child;
+    }
+    return new_shape(shape, name, access, is_static);
+}
+
+// Shape with the same layout as shape except for the modifiers of slot index
+static Shape* shape_change_modifiers(Shape *shape, int index, AccessModifierEnum access, int is_static) {
+    Shape *result = get_root_shape();
+    for (int i = 0; i < shape->property_count; i++) {
+        const ShapeProperty *prop = &shape->properties[i];
+        if (i == index) result = shape_add_property(result, prop->name, access, is_static);
+        else result = shape_add_property(result, prop->name, prop->access, prop->is_static);
+    }
+    return result;
+}
+
+static size_t object_size(const Object *obj) {
+    return sizeof(Object) + sizeof(Value) * (size_t)obj->property_capacity;
+}
+
+static void gc_note_allocation(size_t bytes) {
+    gc_bytes_allocated += bytes;
+    if (gc_bytes_allocated >= gc_next_collection) gc_pending = 1;
+}
+
+// Frees every object and empties the handle table, restarting IDs at 1
+static void free_all_objects(void) {
+    Object *obj = objects;
+    while (obj) { Object *next = obj->next; free_object(obj); obj = next; }
+    objects = NULL;
+    gc_bytes_allocated = 0;
+    gc_next_collection = GC_INITIAL_THRESHOLD;
+    gc_pending = 0;
+    free_shape_tree(root_shape);
+    root_shape = NULL;
+    inline_cache_epoch++;
+    free(object_handles);
+    object_handles = NULL;
+    object_handle_count = 1;
+    object_handle_capacity = 0;
+    free_object_handle = -1;
+}
+
+// Class part of "ClassName#ID" (or "ClassName_static#ID") without "_static". Registered
+// classes return their entry's name; other objects are parsed into buf.
+static const char* object_base_class_name(Object *obj, char *buf, size_t size) {
+    if (obj->class_entry) return obj->class_entry->name;
+    size_t len = strcspn(obj->class_name, "#");
+    if (len >= size) len = size - 1;
+    memcpy(buf, obj->class_name, len);
+    buf[len] = '\0';
+    char *static_suffix = strstr(buf, "_static");
+    if (static_suffix) *static_suffix = '\0';
+    return buf;
 }
 
 Object* create_object(const char *class_name) {
@@ -71,135 +304,108 @@ Object* create_object(const char *class_name) {
         fprintf(stderr, "Error: Failed to allocate memory for object of class '%s'\n", class_name);
         return NULL;
     }
-    snprintf(obj->class_name, sizeof(obj->class_name), "%s#%d", class_name, next_object_id++);
+    allocate_object_handle(obj);
+    obj->shape = get_root_shape();
+    snprintf(obj->class_name, sizeof(obj->class_name), "%s#%d", class_name, obj->id);
+    size_t name_len = strlen(class_name);
+    if (name_len > 7 && strcmp(class_name + name_len - 7, "_static") == 0) {
+        char base_name[128];
+        snprintf(base_name, sizeof(base_name), "%.*s", (int)(name_len - 7), class_name);
+        obj->class_entry = find_class_entry(base_name);
+        obj->pinned = 1;
+    } else {
+        obj->class_entry = find_class_entry(class_name);
+    }
     obj->next = objects;
     objects = obj;
+    gc_note_allocation(sizeof(Object));
     // printf("[OBJECT] Created new object: %s (class: %s)\n", obj->class_name, class_name);
+    vm_gc_push_root(object_ref_value(obj)); // Field initializers may call functions
     initialize_default_instance_fields(class_name, obj, global_frame); 
+    vm_gc_pop_roots(1);
     return obj;
 }
 
-void set_object_property_with_access(Object *obj, const char *name, const char *value, AccessModifierEnum access, int is_static) {
+void set_object_property_with_access(Object *obj, const char *name, Value value, AccessModifierEnum access, int is_static) {
     if (!obj) { fprintf(stderr, "Error: Cannot set property '%s' on null object\n", name); return; }
-    if (!name || !value) { fprintf(stderr, "Error: Invalid parameters for setting object property (name or value is null)\n"); return; }
+    if (!name) { fprintf(stderr, "Error: Invalid parameters for setting object property (name is null)\n"); return; }
+    name = intern(name);
     
-    ObjectProperty *prop = obj->properties;
-    while (prop) {
-        if (strcmp(prop->name, name) == 0) {
-            strncpy(prop->value, value, sizeof(prop->value) - 1);
-            prop->value[sizeof(prop->value) - 1] = '\0';
-            prop->access = access;
-            prop->is_static = is_static;
-            return;
+    int index = shape_find_property(obj->shape, name);
+    if (index >= 0) {
+        const ShapeProperty *prop = &obj->shape->properties[index];
+        if (prop->access != access || prop->is_static != is_static) {
+            obj->shape = shape_change_modifiers(obj->shape, index, access, is_static);
         }
-        prop = prop->next;
+        Value old_value = obj->property_values[index];
+        obj->property_values[index] = value_copy(value);
+        value_release(old_value);
+        return;
     }
     
-    ObjectProperty *new_prop = (ObjectProperty*)calloc(1, sizeof(ObjectProperty)); // Use calloc
-    if (!new_prop) { fprintf(stderr, "Error: Failed to allocate memory for object property '%s'\n", name); return; }
-    
-    strncpy(new_prop->name, name, sizeof(new_prop->name) - 1);
-    new_prop->name[sizeof(new_prop->name) - 1] = '\0';
-    strncpy(new_prop->value, value, sizeof(new_prop->value) - 1);
-    new_prop->value[sizeof(new_prop->value) - 1] = '\0';
-    new_prop->access = access;
-    new_prop->is_static = is_static;
-    new_prop->next = obj->properties;
-    obj->properties = new_prop;
+    index = obj->shape->property_count;
+    if (index == obj->property_capacity) {
+        int new_capacity = obj->property_capacity ? obj->property_capacity * 2 : 4;
+        Value *grown = (Value*)realloc(obj->property_values, sizeof(Value) * new_capacity);
+        if (!grown) { fprintf(stderr, "Error: Failed to allocate memory for object property '%s'\n", name); return; }
+        gc_note_allocation(sizeof(Value) * (new_capacity - obj->property_capacity));
+        obj->property_values = grown;
+        obj->property_capacity = new_capacity;
+    }
+    obj->shape = shape_add_property(obj->shape, name, access, is_static);
+    obj->property_values[index] = value_copy(value);
 }
 
-const char* get_object_property(Object *obj, const char *name) {
+const Value* get_object_property(Object *obj, const char *name) {
     return get_object_property_with_access_check(obj, name, NULL); 
 }
 
-const char* get_object_property_with_access_check(Object *obj, const char *name, const char *accessing_class_context) {
+const Value* get_object_property_with_access_check(Object *obj, const char *name, const char *accessing_class_context) {
     if (!obj || !name) return NULL;
+    name = intern_lookup(name);
+    if (!name) return NULL; // Never used as a name, so no object has it
     
-    char obj_base_class_name[128] = {0};
-    char *hash_pos = strchr(obj->class_name, '#');
-    if (hash_pos) {
-        size_t len = hash_pos - obj->class_name;
-        if (len < sizeof(obj_base_class_name)) {
-            strncpy(obj_base_class_name, obj->class_name, len);
-            obj_base_class_name[len] = '\0';
-        } else {
-            strncpy(obj_base_class_name, obj->class_name, sizeof(obj_base_class_name) -1);
-            obj_base_class_name[sizeof(obj_base_class_name)-1] = '\0';
-        }
-    } else { 
-        strncpy(obj_base_class_name, obj->class_name, sizeof(obj_base_class_name) - 1);
-        obj_base_class_name[sizeof(obj_base_class_name)-1] = '\0';
-        if(strstr(obj_base_class_name, "_static")) { // "ClassName_static"
-             char * p = strstr(obj_base_class_name, "_static");
-             if(p) *p = '\0';
+    int index = shape_find_property(obj->shape, name);
+    if (index < 0) return NULL;
+    if (obj->shape->properties[index].access == ACCESS_MODIFIER_PRIVATE) {
+        char base_name_buf[128];
+        const char *obj_base_class_name = object_base_class_name(obj, base_name_buf, sizeof(base_name_buf));
+        if (accessing_class_context && strcmp(accessing_class_context, obj_base_class_name) == 0) {
+            return &obj->property_values[index];
         }
+        // fprintf(stderr, "Access Denied: Cannot access private property '%s.%s' from context '%s'.\n", 
+        //         obj_base_class_name, name, accessing_class_context ? accessing_class_context : "global/unknown");
+        return NULL; 
     }
-    
-    ObjectProperty *prop = obj->properties;
-    while (prop) {
-        if (strcmp(prop->name, name) == 0) {
-            if (prop->access == ACCESS_MODIFIER_PUBLIC) return prop->value;
-            if (prop->access == ACCESS_MODIFIER_PRIVATE) {
-                if (accessing_class_context && strcmp(accessing_class_context, obj_base_class_name) == 0) {
-                    return prop->value;
-                } else {
-                    // fprintf(stderr, "Access Denied: Cannot access private property '%s.%s' from context '%s'.\n", 
-                    //         obj_base_class_name, name, accessing_class_context ? accessing_class_context : "global/unknown");
-                    return NULL; 
-                }
-            }
-            return prop->value; 
-        }
-        prop = prop->next;
-    }
-    return NULL; 
+    return &obj->property_values[index]; 
 }
 
-const char* get_object_property_with_access(Object *obj, const char *property_name, const char *current_class_context_for_access_check) {
-    if (!obj) return "undefined";
-    const char* instance_prop_val = get_object_property_with_access_check(obj, property_name, current_class_context_for_access_check);
-    if (instance_prop_val) return instance_prop_val;
-
-    char obj_base_class_name[128] = {0};
-    char *hash_pos = strchr(obj->class_name, '#');
-    if (hash_pos) {
-        size_t len = hash_pos - obj->class_name;
-         if (len < sizeof(obj_base_class_name)) {
-            strncpy(obj_base_class_name, obj->class_name, len);
-            obj_base_class_name[len] = '\0';
-        } else {
-            strncpy(obj_base_class_name, obj->class_name, sizeof(obj_base_class_name)-1);
-            obj_base_class_name[sizeof(obj_base_class_name)-1] = '\0';
-        }
-        if(strstr(obj_base_class_name, "_static")) { // if "ClassName_static"
-             char * p = strstr(obj_base_class_name, "_static");
-             if(p) *p = '\0'; // Get "ClassName"
-        }
-
+Value get_object_property_with_access(Object *obj, const char *property_name, const char *current_class_context_for_access_check) {
+    if (!obj) return value_undefined();
+    const Value* instance_prop_val = get_object_property_with_access_check(obj, property_name, current_class_context_for_access_check);
+    if (instance_prop_val) return value_copy(*instance_prop_val);
 
+    if (obj->class_entry && (property_name = intern_lookup(property_name)) != NULL) {
+        const char *obj_base_class_name = obj->class_entry->name;
         Object *static_class_obj = find_static_class_object(obj_base_class_name);
-        if (static_class_obj) {
-            ObjectProperty *static_prop = static_class_obj->properties;
-            while(static_prop) {
-                if (strcmp(static_prop->name, property_name) == 0 && static_prop->is_static) {
-                    if (static_prop->access == ACCESS_MODIFIER_PUBLIC) return static_prop->value;
-                    if (static_prop->access == ACCESS_MODIFIER_PRIVATE && 
-                        current_class_context_for_access_check && 
-                        strcmp(current_class_context_for_access_check, obj_base_class_name) == 0) {
-                        return static_prop->value;
-                    }
-                    // fprintf(stderr, "Access Denied: Cannot access private static property '%s.%s' from context '%s'.\n",
-                    //          obj_base_class_name, property_name, current_class_context_for_access_check ? current_class_context_for_access_check : "global/unknown");
-                    return "undefined"; 
-                }
-                static_prop = static_prop->next;
+        int index = static_class_obj ? shape_find_property(static_class_obj->shape, property_name) : -1;
+        if (index >= 0 && static_class_obj->shape->properties[index].is_static) {
+            const ShapeProperty *static_prop = &static_class_obj->shape->properties[index];
+            if (static_prop->access == ACCESS_MODIFIER_PUBLIC) return value_copy(static_class_obj->property_values[index]);
+            if (static_prop->access == ACCESS_MODIFIER_PRIVATE && 
+                current_class_context_for_access_check && 
+                strcmp(current_class_context_for_access_check, obj_base_class_name) == 0) {
+                return value_copy(static_class_obj->property_values[index]);
             }
+            // fprintf(stderr, "Access Denied: Cannot access private static property '%s.%s' from context '%s'.\n",
+            //          obj_base_class_name, property_name, current_class_context_for_access_check ? current_class_context_for_access_check : "global/unknown");
+            return value_undefined(); 
         }
     }
-    return "undefined";
+    return value_undefined();
 }
 
-const char* get_static_property(const char *class_name, const char *prop_name) {
+const Value* get_static_property(const char *class_name, const char *prop_name) {
     if (!class_name || !prop_name) return NULL;
     Object *static_obj = find_static_class_object(class_name);
     if (static_obj) {
@@ -220,28 +426,44 @@ static void vm_register_class(ASTNode *class_node) {
         fprintf(stderr, "Error (L%d:%d): Failed to allocate memory for class entry '%s'\n", class_node->line, class_node->col, name);
         return;
     }
-    strncpy(entry->name, name, sizeof(entry->name) - 1);
-    entry->name[sizeof(entry->name) - 1] = '\0';
-
-    if (class_node->right && class_node->right->type == AST_IDENTIFIER) {
-        strncpy(entry->parent_name, class_node->right->value, sizeof(entry->parent_name)-1);
-        entry->parent_name[sizeof(entry->parent_name)-1] = '\0';
-    } else { entry->parent_name[0] = '\0'; }
+    entry->name = name;
+    if (class_node->right && class_node->right->type == AST_IDENTIFIER && class_node->right->value[0]) {
+        entry->parent_name = class_node->right->value;
+    }
 
     entry->class_node = class_node; 
     if (!registered_classes) registered_classes = registered_classes_tail = entry;
     else { registered_classes_tail->next = entry; registered_classes_tail = entry; }
+    name_table_set(&class_table, name, NULL, entry);
     // printf("[VM] Registered class: %s (from L%d:%d)\n", name, class_node->line, class_node->col);
 }
 
 static ClassEntry* find_class_entry(const char *name) {
-    if (!name) return NULL;
-    ClassEntry *entry = registered_classes;
-    while (entry) {
-        if (strcmp(entry->name, name) == 0) return entry;
-        entry = entry->next;
+    return (ClassEntry*)name_table_get(&class_table, intern_lookup(name), NULL);
+}
+
+// Flattened method table of a class: its parent's table copied in first, then its
+// own methods over the top, so resolving a method is one probe at any depth.
+// run_vm builds every table once all classes are registered.
+static const NameTable* class_method_table(ClassEntry *entry) {
+    if (entry->methods_state != METHODS_UNBUILT) return &entry->methods; // Built, or an inheritance cycle
+    entry->methods_state = METHODS_BUILDING;
+    ClassEntry *parent = (ClassEntry*)name_table_get(&class_table, entry->parent_name, NULL);
+    if (parent) {
+        const NameTable *inherited = class_method_table(parent);
+        for (size_t i = 0; i < inherited->capacity; i++) {
+            if (inherited->slots[i].name) name_table_set(&entry->methods, inherited->slots[i].name, NULL, inherited->slots[i].value);
+        }
     }
-    return NULL;
+    for (ASTNode *member = entry->class_node ? entry->class_node->left : NULL; member; member = member->next) {
+        // Treat function declarations inside classes as class methods
+        if (member->type != AST_CLASS_METHOD && member->type != AST_FUNCTION && member->type != AST_TYPED_FUNCTION) continue;
+        ASTNode *existing = (ASTNode*)name_table_get(&entry->methods, member->value, NULL);
+        if (existing && existing->parent_class_name == entry->name) continue; // The first declaration wins
+        name_table_set(&entry->methods, member->value, NULL, member);
+    }
+    entry->methods_state = METHODS_BUILT;
+    return &entry->methods;
 }
 
 static int is_class_registered(const char *name) {
@@ -250,55 +472,249 @@ static int is_class_registered(const char *name) {
 
 void free_object(Object *obj) {
     if (!obj) return;
-    ObjectProperty *prop = obj->properties;
-    while (prop) {
-        ObjectProperty *next_prop = prop->next;
-        free(prop);
-        prop = next_prop;
-    }
+    size_t size = object_size(obj);
+    gc_bytes_allocated = gc_bytes_allocated > size ? gc_bytes_allocated - size : 0;
+    release_object_handle(obj);
+    int property_count = obj->shape ? obj->shape->property_count : 0;
+    for (int i = 0; i < property_count; i++) value_release(obj->property_values[i]);
+    free(obj->property_values);
     free(obj);
 }
 
+void vm_set_bytecode_enabled(int enabled) {
+    use_bytecode = enabled;
+}
+
+void vm_set_jit_enabled(int enabled) {
+    use_jit = enabled && jit_available();
+}
+
+const int* vm_gc_pending_flag(void) {
+    return &gc_pending;
+}
+
+void vm_set_gc_stats_enabled(int enabled) {
+    gc_stats_enabled = enabled;
+}
+
+void vm_gc_push_root(Value value) {
+    if (gc_temp_root_count == gc_temp_root_capacity) {
+        int new_capacity = gc_temp_root_capacity ? gc_temp_root_capacity * 2 : 32;
+        Value *grown = (Value*)realloc(gc_temp_roots, sizeof(Value) * new_capacity);
+        if (!grown) {
+            fprintf(stderr, "Error: Failed to grow GC root stack to %d entries\n", new_capacity);
+            exit(EXIT_FAILURE);
+        }
+        gc_temp_roots = grown;
+        gc_temp_root_capacity = new_capacity;
+    }
+    gc_temp_roots[gc_temp_root_count++] = value; // Borrowed; only the object reference matters
+}
+
+void vm_gc_pop_roots(int count) {
+    gc_temp_root_count -= count;
+}
+
+static void push_active_frame(StackFrame *frame) {
+    if (active_frame_count == active_frame_capacity) {
+        int new_capacity = active_frame_capacity ? active_frame_capacity * 2 : 64;
+        StackFrame **grown = (StackFrame**)realloc(active_frames, sizeof(StackFrame*) * new_capacity);
+        if (!grown) {
+            fprintf(stderr, "Error: Failed to grow call stack to %d frames\n", new_capacity);
+            exit(EXIT_FAILURE);
+        }
+        active_frames = grown;
+        active_frame_capacity = new_capacity;
+    }
+    active_frames[active_frame_count++] = frame;
+}
+
+// Marked objects wait on an explicit stack for their properties to be traced, so deep
+// object graphs cannot overflow the C stack.
+static void gc_mark_object(Object *obj) {
+    if (!obj || obj->gc_marked) return;
+    obj->gc_marked = 1;
+    if (gc_mark_stack_count == gc_mark_stack_capacity) {
+        int new_capacity = gc_mark_stack_capacity ? gc_mark_stack_capacity * 2 : 256;
+        Object **grown = (Object**)realloc(gc_mark_stack, sizeof(Object*) * new_capacity);
+        if (!grown) {
+            fprintf(stderr, "Error: Failed to grow GC mark stack to %d entries\n", new_capacity);
+            exit(EXIT_FAILURE);
+        }
+        gc_mark_stack = grown;
+        gc_mark_stack_capacity = new_capacity;
+    }
+    gc_mark_stack[gc_mark_stack_count++] = obj;
+}
+
+static void gc_mark_value(Value value) {
+    if (value.type == VAL_OBJECT) {
+        gc_mark_object(find_object_by_ref(value));
+    } else if (value.type == VAL_ARRAY) {
+        // Arrays are refcounted but may hold objects; the mark keeps cycles from looping
+        OuroArray *array = value.as.array;
+        if (array->gc_mark == gc_epoch) return;
+        array->gc_mark = gc_epoch;
+        gc_mark_values(array->items, array->count);
+    } else if (value.type == VAL_MAP) {
+        OuroMap *map = value.as.map;
+        if (map->gc_mark == gc_epoch) return;
+        map->gc_mark = gc_epoch;
+        for (int i = 0; i < map->entry_count; i++) gc_mark_value(map->entries[i].value); // Removed entries are undefined
+    } else if (value.type == VAL_STRING) {
+        // Arrays are still "[obj:1,obj:2]" text, so references inside strings are
+        // marked conservatively
+        const char *p = ouro_string_chars(value.as.string);
+        while ((p = strstr(p, "obj:")) != NULL) {
+            p += 4;
+            if (*p >= '0' && *p <= '9') gc_mark_object(find_object_by_id(atoi(p)));
+        }
+    }
+}
+
+static void gc_mark_values(const Value *values, int count) {
+    for (int i = 0; i < count; i++) gc_mark_value(values[i]);
+}
+
+static void gc_mark_frame(const StackFrame *frame) {
+    gc_mark_values(frame->slots, frame->slot_count);
+    for (int i = 0; i < frame->var_count; i++) gc_mark_value(frame->variables[i].value);
+}
+
+static void gc_mark_roots(void) {
+    if (global_frame) gc_mark_frame(global_frame);
+    for (int i = 0; i < active_frame_count; i++) gc_mark_frame(active_frames[i]);
+    for (const GcStackRoots *roots = gc_stack_roots; roots; roots = roots->prev) {
+        gc_mark_values(roots->base, (int)(roots->top - roots->base));
+    }
+    gc_mark_values(gc_temp_roots, gc_temp_root_count);
+    gc_mark_value(return_value);
+    for (Object *obj = objects; obj; obj = obj->next) {
+        if (obj->pinned) gc_mark_object(obj);
+    }
+}
+
+static void collect_garbage(void) {
+    clock_t start = clock();
+    size_t bytes_before = gc_bytes_allocated;
+    size_t freed_objects = 0;
+
+    if (++gc_epoch == 0) gc_epoch = 1; // 0 is the mark of arrays and maps never traced
+    gc_mark_roots();
+    while (gc_mark_stack_count > 0) {
+        Object *obj = gc_mark_stack[--gc_mark_stack_count];
+        gc_mark_values(obj->property_values, obj->shape->property_count);
+    }
+
+    Object **link = &objects;
+    while (*link) {
+        Object *obj = *link;
+        if (obj->gc_marked) {
+            obj->gc_marked = 0;
+            link = &obj->next;
+        } else {
+            *link = obj->next;
+            free_object(obj);
+            freed_objects++;
+        }
+    }
+
+    double pause_ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+    gc_collections++;
+    gc_objects_freed += freed_objects;
+    gc_bytes_freed += bytes_before - gc_bytes_allocated;
+    gc_total_pause_ms += pause_ms;
+    if (pause_ms > gc_max_pause_ms) gc_max_pause_ms = pause_ms;
+    // Next collection once the heap has doubled relative to what survived
+    gc_next_collection = gc_bytes_allocated * 2 > GC_INITIAL_THRESHOLD ? gc_bytes_allocated * 2 : GC_INITIAL_THRESHOLD;
+    gc_pending = 0;
+}
+
+static void gc_safepoint(void) {
+    if (gc_pending) collect_garbage();
+}
+
+static void print_gc_stats(void) {
+    printf("\n==== GC Stats ====\n");
+    printf("Collections:    %d\n", gc_collections);
+    printf("Objects freed:  %zu\n", gc_objects_freed);
+    printf("Bytes freed:    %zu\n", gc_bytes_freed);
+    printf("Live bytes:     %zu\n", gc_bytes_allocated);
+    printf("Total pause:    %.3f ms\n", gc_total_pause_ms);
+    printf("Max pause:      %.3f ms\n", gc_max_pause_ms);
+    printf("Average pause:  %.3f ms\n", gc_collections ? gc_total_pause_ms / gc_collections : 0.0);
+}
+
+static void free_function_registry(void) {
+    FunctionEntry *entry = registered_functions;
+    while (entry) {
+        FunctionEntry *next = entry->next;
+        if (entry->func && entry->func->bytecode) {
+            ir_free_chunk(entry->func->bytecode);
+            entry->func->bytecode = NULL;
+        }
+        free(entry);
+        entry = next;
+    }
+    registered_functions = NULL;
+    name_table_free(&function_table);
+}
+
+static void free_class_registry(void) {
+    ClassEntry *entry = registered_classes;
+    while (entry) {
+        ClassEntry *next = entry->next;
+        name_table_free(&entry->methods);
+        free(entry);
+        entry = next;
+    }
+    registered_classes = NULL;
+    registered_classes_tail = NULL;
+    name_table_free(&class_table);
+    inline_cache_epoch++;
+}
+
 void vm_init() {
+    name_this = intern("this");
     if (global_frame) destroy_stack_frame(global_frame);
     global_frame = create_stack_frame("global", NULL);
     
-    if (return_value) free(return_value);
-    return_value = strdup("0"); 
+    set_return_value(value_undefined());
     
-    Object *obj = objects;
-    while (obj) { Object *next = obj->next; free_object(obj); obj = next; }
-    objects = NULL;
-    next_object_id = 1;
+    free_all_objects();
 
-    FunctionEntry *fn_entry = registered_functions;
-    while(fn_entry) { FunctionEntry* next = fn_entry->next; free(fn_entry); fn_entry = next; }
-    registered_functions = NULL;
-
-    ClassEntry *cls_entry = registered_classes;
-    while(cls_entry) { ClassEntry* next = cls_entry->next; free(cls_entry); cls_entry = next; }
-    registered_classes = NULL;
-    registered_classes_tail = NULL;
+    free_function_registry();
+    free_class_registry();
 
     current_class[0] = '\0';
+
+    gc_collections = 0;
+    gc_objects_freed = 0;
+    gc_bytes_freed = 0;
+    gc_total_pause_ms = 0.0;
+    gc_max_pause_ms = 0.0;
 }
 
 void vm_cleanup() {
-    if (return_value) { free(return_value); return_value = NULL; }
+    set_return_value(value_undefined());
     if (global_frame) { destroy_stack_frame(global_frame); global_frame = NULL; }
+    stack_frame_pool_clear();
     
-    FunctionEntry *entry = registered_functions;
-    while (entry) { FunctionEntry *next = entry->next; free(entry); entry = next; }
-    registered_functions = NULL;
-    
-    ClassEntry *class_entry = registered_classes;
-    while (class_entry) { ClassEntry *next_entry = class_entry->next; free(class_entry); class_entry = next_entry; }
-    registered_classes = NULL;
-    registered_classes_tail = NULL;
+    free_function_registry();
+    free_class_registry();
     
-    Object *obj = objects;
-    while (obj) { Object *next_obj = obj->next; free_object(obj); obj = next_obj; }
-    objects = NULL;
+    if (gc_stats_enabled) print_gc_stats();
+    free_all_objects();
+    free(active_frames);
+    active_frames = NULL;
+    active_frame_count = active_frame_capacity = 0;
+    free(gc_temp_roots);
+    gc_temp_roots = NULL;
+    gc_temp_root_count = gc_temp_root_capacity = 0;
+    free(gc_mark_stack);
+    gc_mark_stack = NULL;
+    gc_mark_stack_count = gc_mark_stack_capacity = 0;
+    jit_shutdown();
     // printf("[VM] Cleanup complete.\n");
 }
 
@@ -315,162 +731,634 @@ void register_user_function(ASTNode *func_node) {
     entry->func = func_node;
     entry->next = registered_functions;
     registered_functions = entry;
+    name_table_set(&function_table, func_node->value, func_node->parent_class_name, func_node); // A redefinition shadows
 }
 
 ASTNode* find_user_function(const char *name, const char* class_context_name) {
-    FunctionEntry *entry = registered_functions;
-    while (entry) {
-        if (entry->func && entry->func->value && strcmp(entry->func->value, name) == 0) {
-            if (class_context_name) { 
-                if (entry->func->parent_class_name && strcmp(entry->func->parent_class_name, class_context_name) == 0) {
-                    return entry->func;
-                }
-            } else { 
-                if (entry->func->parent_class_name == NULL) {
-                    return entry->func;
-                }
-            }
-        }
-        entry = entry->next;
-    }
-    /* Inheritance lookup */
-    if (class_context_name) {
-        const char *parent = get_parent_class_name(class_context_name);
-        while (parent) {
-            entry = registered_functions;
-            while (entry) {
-                if (entry->func && strcmp(entry->func->value, name) == 0) {
-                    if (entry->func->parent_class_name && strcmp(entry->func->parent_class_name, parent) == 0) {
-                        return entry->func;
-                    }
-                }
-                entry = entry->next;
-            }
-            parent = get_parent_class_name(parent);
-        }
-    }
-    return NULL;
+    name = intern_lookup(name);
+    if (!name) return NULL;
+    if (!class_context_name) return (ASTNode*)name_table_get(&function_table, name, NULL);
+    ClassEntry *entry = find_class_entry(class_context_name);
+    if (entry) return (ASTNode*)name_table_get(class_method_table(entry), name, NULL); // Inherited methods included
+    class_context_name = intern_lookup(class_context_name);
+    if (!class_context_name) return NULL; // Not a class name
+    return (ASTNode*)name_table_get(&function_table, name, class_context_name);
 }
 
-const char* execute_function_call(const char* qualified_name, ASTNode* args_ast_list, StackFrame *caller_frame) {
-    // Parse qualified name: obj:123.method or class.method
+// Resolves a call name ("fn", "ClassName.method" or "obj:N.method") to the user function it
+// names. *receiver is set to the object bound as 'this' and class_name to the class whose
+// method was found (empty for free functions). Returns NULL when no user function matches.
+static ASTNode* resolve_call_target(const char* qualified_name, StackFrame *caller_frame, Value *receiver, char *class_name, size_t class_name_size) {
     char obj_name[128] = "";
     char method_name[128] = "";
-    int is_class_method = 0;
     
-    // Check if it's a class method call (e.g., "class.method")
-    char* dot_pos = strchr(qualified_name, '.');
+    *receiver = value_undefined();
+    class_name[0] = '\0';
+    const char* dot_pos = strchr(qualified_name, '.');
     if (dot_pos) {
-        strncpy(obj_name, qualified_name, dot_pos - qualified_name);
-        obj_name[dot_pos - qualified_name] = '\0';
-        strcpy(method_name, dot_pos + 1);
-        
-        // Check if it's a class method (starts with class name)
-        ClassEntry* class_entry = find_class_entry(obj_name);
-        if (class_entry) {
-            is_class_method = 1;
-        }
+        size_t obj_len = (size_t)(dot_pos - qualified_name);
+        if (obj_len >= sizeof(obj_name)) obj_len = sizeof(obj_name) - 1;
+        strncpy(obj_name, qualified_name, obj_len);
+        obj_name[obj_len] = '\0';
+        strncpy(method_name, dot_pos + 1, sizeof(method_name) - 1);
     }
     
-    // Find the function/method
     ASTNode* func_node = NULL;
-    if (is_class_method) {
-        func_node = find_class_method(obj_name, method_name);
+    if (dot_pos && strncmp(obj_name, "obj:", 4) == 0) {
+        Object* inst = find_object_by_id(atoi(obj_name + 4));
+        if (inst) {
+            const char *inst_class = object_base_class_name(inst, class_name, class_name_size);
+            if (inst_class != class_name) {
+                strncpy(class_name, inst_class, class_name_size - 1);
+                class_name[class_name_size - 1] = '\0';
+            }
+            func_node = find_class_method(class_name, method_name);
+            if (func_node) {
+                *receiver = object_ref_value(inst);
+            } else {
+                // Object property holding a function
+                const Value* fn = get_object_property(inst, method_name);
+                if (fn && fn->type == VAL_FUNCTION) func_node = fn->as.function;
+                else if (fn && fn->type == VAL_STRING) func_node = find_user_function(ouro_string_chars(fn->as.string), NULL);
+                class_name[0] = '\0';
+            }
+        }
+    } else if (dot_pos && find_class_entry(obj_name)) {
+        strncpy(class_name, obj_name, class_name_size - 1);
+        class_name[class_name_size - 1] = '\0';
+        func_node = find_class_method(class_name, method_name);
+        if (func_node) *receiver = object_ref_value(find_static_class_object(class_name));
     } else {
         func_node = find_user_function(qualified_name, NULL);
-        // Check for object property holding a function
-        if (!func_node && strncmp(obj_name, "obj:", 4) == 0) {
-            Object* inst = find_object_by_id(atoi(obj_name + 4));
-            if (inst) {
-                const char* fn = get_object_property(inst, method_name);
-                if (fn && strcmp(fn, "undefined") != 0) {
-                    func_node = find_user_function(fn, NULL);
-                }
-            }
+        if (!func_node) {
+            // Variable holding a function value
+            const char *var_name = intern_lookup(qualified_name);
+            Value* fn = var_name ? get_variable(caller_frame, var_name) : NULL;
+            if (fn && fn->type == VAL_FUNCTION) func_node = fn->as.function;
         }
     }
+    return func_node;
+}
+
+Value execute_function_call(const char* qualified_name, ASTNode* args_ast_list, StackFrame *caller_frame) {
+    Value receiver;
+    char class_name[128];
+    ASTNode* func_node = resolve_call_target(qualified_name, caller_frame, &receiver, class_name, sizeof(class_name));
     
     if (!func_node) {
         // Attempt to call built-in function
-        const char* builtin_res = call_built_in_function(qualified_name, args_ast_list, caller_frame);
-        if (builtin_res && strcmp(builtin_res, "undefined") != 0) {
+        Value builtin_res;
+        if (call_built_in_function(qualified_name, args_ast_list, caller_frame, &builtin_res)) {
             return builtin_res;
         }
         fprintf(stderr, "Error: Function '%s' not found\n", qualified_name);
-        return "undefined";
+        return value_undefined();
+    }
+    
+    // Evaluate arguments in the caller's frame
+    Value arg_values_stack[8];
+    Value *arg_values = arg_values_stack;
+    int arg_count = 0;
+    for (ASTNode* arg = args_ast_list; arg; arg = arg->next) arg_count++;
+    if (arg_count > (int)(sizeof(arg_values_stack) / sizeof(arg_values_stack[0]))) {
+        arg_values = (Value*)malloc(sizeof(Value) * arg_count);
+        if (!arg_values) { fprintf(stderr, "Error: Out of memory evaluating arguments for '%s'\n", qualified_name); return value_undefined(); }
+    }
+    vm_gc_push_root(receiver);
+    int arg_index = 0;
+    for (ASTNode* arg = args_ast_list; arg; arg = arg->next) {
+        arg_values[arg_index] = evaluate_expression(arg, caller_frame);
+        vm_gc_push_root(arg_values[arg_index++]);
     }
     
+    Value result = vm_invoke_function(func_node, receiver, class_name[0] ? class_name : NULL, arg_values, arg_count, caller_frame);
+    vm_gc_pop_roots(arg_count + 1);
+    
+    for (int i = 0; i < arg_count; i++) value_release(arg_values[i]);
+    if (arg_values != arg_values_stack) free(arg_values);
+    return result;
+}
+
+Value vm_call_function_by_name(const char* qualified_name, Value *args, int arg_count, StackFrame *caller_frame) {
+    Value receiver;
+    char class_name[128];
+    ASTNode* func_node = resolve_call_target(qualified_name, caller_frame, &receiver, class_name, sizeof(class_name));
+    if (!func_node) {
+        Value builtin_res;
+        if (call_built_in_function_values(qualified_name, args, arg_count, &builtin_res)) {
+            return builtin_res;
+        }
+        fprintf(stderr, "Error: Function '%s' not found\n", qualified_name);
+        return value_undefined();
+    }
+    return vm_invoke_function(func_node, receiver, class_name[0] ? class_name : NULL, args, arg_count, caller_frame);
+}
+
+Value vm_call_value_method(ASTNode *call_node, Value *args, int arg_count, StackFrame *caller_frame) {
+    const char *method_name = call_node->value;
+    if (args[0].type == VAL_MAP) {
+        // m.f(args) calls a function stored under "f", with no 'this'
+        const Value *fn = map_get_text(args[0].as.map, method_name);
+        ASTNode *func_node = NULL;
+        if (fn && fn->type == VAL_FUNCTION) func_node = fn->as.function;
+        else if (fn && fn->type == VAL_STRING) func_node = find_user_function(ouro_string_chars(fn->as.string), NULL);
+        if (func_node) return vm_invoke_function(func_node, value_undefined(), NULL, args + 1, arg_count - 1, caller_frame);
+    }
+    Value result;
+    if (!call_built_in_function_values(method_name, args, arg_count, &result)) {
+        fprintf(stderr, "Error (L%d:%d): %s have no method '%s'.\n", call_node->line, call_node->col,
+                args[0].type == VAL_MAP ? "Maps" : "Arrays", method_name);
+        result = value_undefined();
+    }
+    return result;
+}
+
+// True when call_node, a plain call returned by func_node (directly or from a branch of
+// ?:), calls func_node itself. Only free functions qualify: they bind no 'this', so
+// their frame can simply be rebound. Other calls in tail position still nest, and
+// recurse on the C stack: this.m(...) and obj.m(...) calls, even of the running
+// method, and mutual recursion (f returning g(...) returning f(...)).
+static int is_self_tail_call(ASTNode *call_node, ASTNode *func_node, StackFrame *frame) {
+    if (!func_node || func_node->parent_class_name || call_node->value != func_node->value) return 0;
+    Value receiver;
+    char class_name[128];
+    return resolve_call_target(call_node->value, frame, &receiver, class_name, sizeof(class_name)) == func_node;
+}
+
+// Reuses frame for another run of func_node, the function it is executing, with args
+// (borrowed) bound to the parameters, instead of nesting a call
+static void rebind_tail_call_frame(StackFrame *frame, ASTNode *func_node, Value *args, int arg_count) {
+    stack_frame_clear(frame);
+    ASTNode *param = func_node->left;
+    for (int i = 0; param && i < arg_count; i++, param = param->next) {
+        store_variable(param, frame, args[i]);
+    }
+}
+
+Value vm_invoke_function(ASTNode *func_node, Value receiver, const char *class_context, Value *args, int arg_count, StackFrame *caller_frame) {
+    if (!func_node) return value_undefined();
+    
     // Create new stack frame for function execution
-    StackFrame* new_frame = create_stack_frame(qualified_name, caller_frame);
+    StackFrame* new_frame = create_stack_frame(func_node->value, caller_frame);
+    stack_frame_init_slots(new_frame, func_node->local_count, func_node->local_names);
     
-    // Optionally update global current class context for methods
-    char prev_class[128]; strncpy(prev_class, current_class, sizeof(prev_class)-1);
-    if (is_class_method) {
-        strncpy(current_class, obj_name, sizeof(current_class) - 1);
+    // Methods run with their class as the access-check context
+    if (!class_context) class_context = func_node->parent_class_name;
+    char prev_class[128];
+    strncpy(prev_class, current_class, sizeof(prev_class) - 1);
+    prev_class[sizeof(prev_class) - 1] = '\0';
+    if (class_context) {
+        strncpy(current_class, class_context, sizeof(current_class) - 1);
+        current_class[sizeof(current_class) - 1] = '\0';
     }
 
-    // Evaluate and set parameters as local variables
+    // Bind parameters as local variables
     ASTNode* param = func_node->left;
-    ASTNode* arg = args_ast_list;
-    
-    while (param && arg) {
-        const char* arg_value = evaluate_expression(arg, caller_frame);
-        if (arg_value) {
-            set_variable(new_frame, param->value, arg_value);
-            // Do not free arg_value, as it may not be heap allocated
-        }
-        param = param->next;
-        arg = arg->next;
+    for (int i = 0; param && i < arg_count; i++, param = param->next) {
+        store_variable(param, new_frame, args[i]);
     }
     
-    // If it's a class method, set 'this' parameter to instance or static class object
-    if (func_node->type == AST_CLASS_METHOD) {
-        Object* instance = is_class_method ? find_static_class_object(obj_name)
-                                            : find_object_by_id(atoi(obj_name));
-        if (instance) {
-            set_variable(new_frame, "this", instance->class_name);
-        }
+    // Bind 'this' to the instance or static class object the method was called on
+    if (receiver.type == VAL_OBJECT) {
+        set_variable(new_frame, name_this, receiver);
     }
+    push_active_frame(new_frame);
+    gc_safepoint();
     
     // Evaluate function body
-    run_vm_node(func_node->right, new_frame);
-    // Restore previous context
-    if (is_class_method) {
-        strncpy(current_class, prev_class, sizeof(current_class)-1);
+    Value result;
+    if (use_bytecode) {
+        if (!func_node->bytecode) {
+            func_node->bytecode = ir_compile_function(func_node);
+            aot_attach(func_node->bytecode, func_node);
+        }
+        result = run_bytecode(func_node->bytecode, new_frame);
+    } else {
+        ASTNode *prev_function = ast_running_function;
+        ast_running_function = func_node;
+        set_return_value(value_undefined());
+        while (run_vm_node(func_node->right, new_frame) == COMPLETION_TAIL_CALL) gc_safepoint();
+        result = take_return_value();
+        ast_running_function = prev_function;
     }
+    // Restore previous context
+    strncpy(current_class, prev_class, sizeof(current_class) - 1);
     // Destroy frame
+    active_frame_count--;
     destroy_stack_frame(new_frame);
-    return get_return_value();
+    return result;
+}
+
+// print statement output; arrays and maps are printed in full
+static void print_value(Value value) {
+    if (value.type == VAL_ARRAY || value.type == VAL_MAP) {
+        Value text = value_to_string(value);
+        printf("[OUTPUT] %s\n", ouro_string_chars(text.as.string));
+        value_release(text);
+    } else {
+        char text_buf[VALUE_TEXT_BUFFER_SIZE];
+        printf("[OUTPUT] %s\n", value_to_text(value, text_buf, sizeof(text_buf)));
+    }
+    fflush(stdout);
+}
+
+// Executes one instruction of a chunk on state: the dispatch loop's path for opcodes
+// and operand types it does not handle inline, and the slow path of JIT-compiled code
+ExecResult vm_execute_instruction(ExecState *state, const Instruction *ins) {
+    Value *sp = state->sp;
+    StackFrame *frame = state->frame;
+    ExecResult next = EXEC_NEXT;
+    state->roots->top = sp;
+    switch (ins->op) {
+        case OP_CONSTANT:
+            *sp++ = value_copy(state->chunk->constants[ins->operand]);
+            break;
+        case OP_POP:
+            value_release(*--sp);
+            break;
+        case OP_LOAD_LOCAL:
+        case OP_LOAD_GLOBAL:
+            *sp++ = value_copy(ins->op == OP_LOAD_LOCAL ? frame->slots[ins->operand] : frame->globals->slots[ins->operand]);
+            break;
+        case OP_STORE_LOCAL:
+        case OP_STORE_GLOBAL: {
+            Value *slot = ins->op == OP_STORE_LOCAL ? &frame->slots[ins->operand] : &frame->globals->slots[ins->operand];
+            Value old_value = *slot;
+            *slot = value_copy(sp[-1]);
+            value_release(old_value);
+            break;
+        }
+        case OP_INCREMENT_LOCAL:
+        case OP_INCREMENT_GLOBAL: {
+            // `i++` or `i += 4` whose value is unused: update the slot in place
+            if (ins->node->type == AST_BINARY_OP) {
+                value_release(evaluate_expression(ins->node, frame)); // += and -= keep their meaning for strings
+                break;
+            }
+            Value *slot = ins->op == OP_INCREMENT_LOCAL ? &frame->slots[ins->operand] : &frame->globals->slots[ins->operand];
+            int delta = ins->node->value[0] == '+' ? 1 : -1;
+            Value old_value = *slot;
+            Value new_value = evaluate_increment(ins->node, old_value, delta);
+            if (new_value.type == VAL_UNDEFINED) break; // Non-numeric operands are left unchanged
+            *slot = new_value;
+            value_release(old_value);
+            break;
+        }
+        case OP_LOAD_NAME: {
+            Value *var_value = get_variable(frame, ins->node->value);
+            // Members of 'this', static members and class names resolve through eval.c
+            *sp++ = var_value ? value_copy(*var_value) : evaluate_expression(ins->node, frame);
+            break;
+        }
+        case OP_STORE_NAME:
+            set_variable(frame, ins->node->value, sp[-1]);
+            break;
+        case OP_BINARY: {
+            Value right = *--sp;
+            Value left = sp[-1];
+            sp[-1] = evaluate_binary_operator((BinaryOperator)ins->operand, left, right);
+            value_release(left);
+            value_release(right);
+            break;
+        }
+        case OP_BINARY_INT:
+            --sp;
+            sp[-1] = evaluate_int_binary_operator((BinaryOperator)ins->operand, sp[-1].as.integer, sp->as.integer);
+            break;
+        case OP_BINARY_DOUBLE:
+            --sp;
+            sp[-1] = evaluate_double_binary_operator((BinaryOperator)ins->operand, value_as_double(sp[-1]), value_as_double(*sp));
+            break;
+        case OP_NEGATE: {
+            Value operand = sp[-1];
+            sp[-1] = evaluate_negate(ins->node, operand);
+            value_release(operand);
+            break;
+        }
+        case OP_NOT: {
+            int truthy = value_is_truthy(sp[-1]);
+            value_release(sp[-1]);
+            sp[-1] = value_bool(!truthy);
+            break;
+        }
+        case OP_TO_BOOL: {
+            int truthy = value_is_truthy(sp[-1]);
+            value_release(sp[-1]);
+            sp[-1] = value_bool(truthy);
+            break;
+        }
+        case OP_INCREMENT: {
+            Value operand = sp[-1];
+            sp[-1] = evaluate_increment(ins->node, operand, ins->operand);
+            value_release(operand);
+            break;
+        }
+        case OP_GET_INDEX: {
+            Value index = *--sp;
+            Value target = sp[-1];
+            sp[-1] = evaluate_index(ins->node, target, index);
+            value_release(target);
+            value_release(index);
+            break;
+        }
+        case OP_SET_INDEX: {
+            Value value = *--sp;
+            Value index = *--sp;
+            Value target = sp[-1];
+            assign_index(ins->node, target, index, value);
+            sp[-1] = value;
+            value_release(target);
+            value_release(index);
+            break;
+        }
+        case OP_JUMP:
+            if (ins->operand <= ins - state->chunk->code) gc_safepoint(); // Loop back-edge
+            next = EXEC_JUMP;
+            break;
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_TRUE: {
+            Value cond = *--sp;
+            int truthy = value_is_truthy(cond);
+            value_release(cond);
+            if (truthy == (ins->op == OP_JUMP_IF_TRUE)) next = EXEC_JUMP;
+            break;
+        }
+        case OP_JUMP_IF_FALSE_BOOL:
+        case OP_JUMP_IF_TRUE_BOOL:
+            --sp;
+            if (sp->as.boolean == (ins->op == OP_JUMP_IF_TRUE_BOOL)) next = EXEC_JUMP;
+            break;
+        case OP_CALL: {
+            int arg_count = ins->operand;
+            Value *args = sp - arg_count;
+            Value call_result = vm_call_function_by_name(ins->node->value, args, arg_count, frame);
+            while (sp > args) value_release(*--sp);
+            *sp++ = call_result;
+            break;
+        }
+        case OP_CALL_METHOD: {
+            int arg_count = ins->operand;
+            Value *args = sp - arg_count;
+            Value target = args[-1];
+            Value call_result;
+            Object *receiver;
+            ASTNode *method;
+            const char *class_context;
+            if (target.type == VAL_ARRAY || target.type == VAL_MAP) {
+                call_result = vm_call_value_method(ins->node, args - 1, arg_count + 1, frame);
+            } else if (target.type == VAL_OBJECT && (receiver = find_object_by_ref(target)) != NULL &&
+                       (method = vm_cached_method(ins->node, receiver, &class_context)) != NULL) {
+                call_result = vm_invoke_function(method, target, class_context, args, arg_count, frame);
+            } else {
+                char qualified_name[512];
+                char text_buf[VALUE_TEXT_BUFFER_SIZE];
+                // Same "obj:N.method" / "ClassName.method" protocol as eval.c's AST_CALL
+                snprintf(qualified_name, sizeof(qualified_name), "%s.%s",
+                         target.type == VAL_UNDEFINED ? "undefined_target" : value_to_text(target, text_buf, sizeof(text_buf)),
+                         ins->node->value);
+                call_result = vm_call_function_by_name(qualified_name, args, arg_count, frame);
+            }
+            while (sp > args - 1) value_release(*--sp);
+            *sp++ = call_result;
+            break;
+        }
+        case OP_TAIL_CALL: {
+            int arg_count = ins->operand;
+            Value *args = sp - arg_count;
+            BytecodeChunk *chunk = state->chunk;
+            if (is_self_tail_call(ins->node, chunk->function, frame)) {
+                // Rebind the parameters and restart the chunk: no C recursion, no new frame
+                rebind_tail_call_frame(frame, chunk->function, args, arg_count);
+                while (sp > state->stack) value_release(*--sp);
+                state->roots->top = sp;
+                gc_safepoint();
+                next = EXEC_RESTART;
+                break;
+            }
+            state->result = vm_call_function_by_name(ins->node->value, args, arg_count, frame);
+            next = EXEC_RETURN;
+            break;
+        }
+        case OP_EVAL_AST:
+            *sp++ = evaluate_expression(ins->node, frame);
+            break;
+        case OP_EXEC_AST:
+            if (run_vm_node(ins->node, frame) == COMPLETION_RETURN) {
+                state->result = take_return_value();
+                next = EXEC_RETURN;
+            }
+            break;
+        case OP_PRINT: {
+            Value value_to_print = *--sp;
+            print_value(value_to_print);
+            value_release(value_to_print);
+            break;
+        }
+        case OP_RETURN:
+            state->result = *--sp;
+            next = EXEC_RETURN;
+            break;
+        case OP_HALT:
+            next = EXEC_RETURN;
+            break;
+    }
+    state->sp = sp;
+    return next;
+}
+
+// Dispatch loop for compiled chunks. The operand stack holds owned Values. Hot chunks
+// are handed to the JIT (jit.c), on entry or at a loop back-edge; chunks of a program
+// compiled with -emit-c run their C function (aot.c) instead.
+static Value run_bytecode(BytecodeChunk *chunk, StackFrame *frame) {
+    Value stack_buf[32];
+    Value *stack = stack_buf;
+    if (chunk->max_stack > (int)(sizeof(stack_buf) / sizeof(stack_buf[0]))) {
+        stack = (Value*)malloc(sizeof(Value) * chunk->max_stack);
+        if (!stack) { fprintf(stderr, "VM Error: Out of memory for operand stack of '%s'.\n", chunk->name); return value_undefined(); }
+    }
+    Value *sp = stack;
+    const Instruction *code = chunk->code;
+    const Instruction *ip = code;
+    GcStackRoots roots = { stack, stack, gc_stack_roots };
+    gc_stack_roots = &roots;
+    ExecState state = { stack, stack, frame->slots, frame->globals->slots, frame, chunk, &roots, value_undefined() };
+
+    if (chunk->compiled) {
+        chunk->compiled(&state);
+        goto done;
+    }
+    if (use_jit && (chunk->native || (!chunk->jit_failed && ++chunk->call_count >= JIT_CALL_THRESHOLD && jit_compile(chunk)))) {
+        jit_execute(chunk, &state, 0);
+        goto done;
+    }
+
+    for (;;) {
+        const Instruction *ins = ip++;
+        // Common opcodes on unboxed values (numbers, bools) run inline and skip reference
+        // counting; everything else breaks out to vm_execute_instruction
+        switch (ins->op) {
+            case OP_CONSTANT: {
+                Value constant = chunk->constants[ins->operand];
+                if (VALUE_IS_REFCOUNTED(constant)) break;
+                *sp++ = constant;
+                continue;
+            }
+            case OP_POP:
+                if (VALUE_IS_REFCOUNTED(sp[-1])) break;
+                --sp;
+                continue;
+            case OP_LOAD_LOCAL:
+            case OP_LOAD_GLOBAL: {
+                Value local = ins->op == OP_LOAD_LOCAL ? frame->slots[ins->operand] : frame->globals->slots[ins->operand];
+                if (VALUE_IS_REFCOUNTED(local)) break;
+                *sp++ = local;
+                continue;
+            }
+            case OP_STORE_LOCAL:
+            case OP_STORE_GLOBAL: {
+                Value *slot = ins->op == OP_STORE_LOCAL ? &frame->slots[ins->operand] : &frame->globals->slots[ins->operand];
+                if (VALUE_IS_REFCOUNTED(*slot) || VALUE_IS_REFCOUNTED(sp[-1])) break;
+                *slot = sp[-1];
+                continue;
+            }
+            case OP_INCREMENT_LOCAL:
+            case OP_INCREMENT_GLOBAL: {
+                Value *slot = ins->op == OP_INCREMENT_LOCAL ? &frame->slots[ins->operand] : &frame->globals->slots[ins->operand];
+                if (slot->type != VAL_INT) break;
+                slot->as.integer = (int64_t)((uint64_t)slot->as.integer + (uint64_t)(int64_t)INCREMENT_DELTA(ins->node));
+                continue;
+            }
+            case OP_BINARY:
+                if (sp[-2].type != VAL_INT || sp[-1].type != VAL_INT) break;
+                sp[-2] = evaluate_int_binary_operator((BinaryOperator)ins->operand, sp[-2].as.integer, sp[-1].as.integer);
+                --sp;
+                continue;
+            case OP_BINARY_INT: // Operand types proven at compile time
+                sp[-2] = evaluate_int_binary_operator((BinaryOperator)ins->operand, sp[-2].as.integer, sp[-1].as.integer);
+                --sp;
+                continue;
+            case OP_BINARY_DOUBLE:
+                sp[-2] = evaluate_double_binary_operator((BinaryOperator)ins->operand,
+                                                         sp[-2].type == VAL_INT ? (double)sp[-2].as.integer : sp[-2].as.number,
+                                                         sp[-1].type == VAL_INT ? (double)sp[-1].as.integer : sp[-1].as.number);
+                --sp;
+                continue;
+            case OP_INCREMENT:
+                if (sp[-1].type != VAL_INT) break;
+                sp[-1].as.integer = (int64_t)((uint64_t)sp[-1].as.integer + (uint64_t)(int64_t)ins->operand);
+                continue;
+            case OP_JUMP:
+                if (ins->operand <= ins - code) { // Loop back-edge
+                    roots.top = sp;
+                    gc_safepoint();
+                    if (use_jit && (chunk->native || (!chunk->jit_failed && ++chunk->loop_count >= JIT_LOOP_THRESHOLD && jit_compile(chunk)))) {
+                        // Hot loop: carry on in compiled code from the loop header
+                        state.sp = sp;
+                        jit_execute(chunk, &state, ins->operand);
+                        goto done;
+                    }
+                }
+                ip = code + ins->operand;
+                continue;
+            case OP_JUMP_IF_FALSE:
+            case OP_JUMP_IF_TRUE:
+                if (sp[-1].type != VAL_BOOL) break; // Comparisons always produce bools
+                --sp;
+                if (sp->as.boolean == (ins->op == OP_JUMP_IF_TRUE)) ip = code + ins->operand;
+                continue;
+            case OP_JUMP_IF_FALSE_BOOL:
+            case OP_JUMP_IF_TRUE_BOOL:
+                --sp;
+                if (sp->as.boolean == (ins->op == OP_JUMP_IF_TRUE_BOOL)) ip = code + ins->operand;
+                continue;
+            case OP_RETURN:
+                state.result = *--sp;
+                state.sp = sp;
+                goto done;
+            case OP_HALT:
+                state.sp = sp;
+                goto done;
+            default:
+                break;
+        }
+        state.sp = sp;
+        ExecResult next = vm_execute_instruction(&state, ins);
+        sp = state.sp;
+        if (next == EXEC_JUMP) ip = code + ins->operand;
+        else if (next == EXEC_RESTART) ip = code;
+        else if (next == EXEC_RETURN) break;
+    }
+
+done:
+    gc_stack_roots = roots.prev;
+    while (state.sp > stack) value_release(*--state.sp);
+    if (stack != stack_buf) free(stack);
+    return state.result;
 }
 
 ASTNode* find_class_method(const char *class_name, const char *method_name) {
-    ClassEntry* entry = find_class_entry(class_name);
+    ClassEntry *entry = find_class_entry(class_name);
     if (!entry) return NULL;
-    
-    ASTNode* class_node = entry->class_node;
-    if (!class_node || !class_node->left) return NULL;
-    
-    ASTNode* member = class_node->left;
-    while (member) {
-        // Treat function declarations inside classes as class methods
-        if ((member->type == AST_CLASS_METHOD || member->type == AST_FUNCTION || member->type == AST_TYPED_FUNCTION)
-            && strcmp(member->value, method_name) == 0) {
-            return member;
-        }
-        member = member->next;
+    return (ASTNode*)name_table_get(class_method_table(entry), intern_lookup(method_name), NULL);
+}
+
+// Entry of site's cache for key, or NULL after adding a fresh entry for key to *fill
+static InlineCacheEntry* inline_cache_probe(ASTNode *site, const void *key, InlineCacheEntry **fill) {
+    InlineCache *cache = site->inline_cache;
+    if (!cache) {
+        cache = (InlineCache*)calloc(1, sizeof(InlineCache));
+        if (!cache) { *fill = NULL; return NULL; }
+        cache->epoch = inline_cache_epoch;
+        site->inline_cache = cache;
+    } else if (cache->epoch != inline_cache_epoch) {
+        cache->epoch = inline_cache_epoch;
+        cache->count = 0;
     }
-    
-    // Check parent class
-    const char* parent_name = get_parent_class_name(class_name);
-    if (parent_name && strlen(parent_name) > 0) {
-        return find_class_method(parent_name, method_name);
+    for (int i = 0; i < cache->count; i++) {
+        if (cache->entries[i].key == key) return &cache->entries[i];
     }
-    
+    *fill = cache->count < INLINE_CACHE_SIZE ? &cache->entries[cache->count++]
+                                             : &cache->entries[cache->next_victim++ % INLINE_CACHE_SIZE];
+    (*fill)->key = key;
     return NULL;
 }
 
-void run_vm_node(ASTNode *node, StackFrame *frame) {
-    if (!node) return;
+ASTNode* vm_cached_method(ASTNode *call_node, Object *receiver, const char **class_context) {
+    ClassEntry *entry = receiver->class_entry;
+    if (!entry) return NULL;
+    *class_context = entry->name;
+    InlineCacheEntry *fill;
+    InlineCacheEntry *hit = inline_cache_probe(call_node, entry, &fill);
+    if (hit) return hit->method;
+    ASTNode *method = (ASTNode*)name_table_get(class_method_table(entry), call_node->value, NULL);
+    if (fill) fill->method = method;
+    return method;
+}
+
+// Slot of member_node's property in obj when it is a public instance property, else -1
+static int cached_property_slot(ASTNode *member_node, Object *obj) {
+    InlineCacheEntry *fill;
+    InlineCacheEntry *hit = inline_cache_probe(member_node, obj->shape, &fill);
+    if (hit) return hit->slot;
+    int slot = shape_find_property(obj->shape, member_node->value);
+    if (slot >= 0 && (obj->shape->properties[slot].access != ACCESS_MODIFIER_PUBLIC || obj->shape->properties[slot].is_static)) slot = -1;
+    if (fill) fill->slot = slot;
+    return slot;
+}
+
+void vm_set_member_property(ASTNode *member_node, Object *obj, Value value) {
+    int slot = cached_property_slot(member_node, obj);
+    if (slot < 0) {
+        set_object_property_with_access(obj, member_node->value, value, ACCESS_MODIFIER_PUBLIC, 0);
+        return;
+    }
+    Value old_value = obj->property_values[slot];
+    obj->property_values[slot] = value_copy(value);
+    value_release(old_value);
+}
+
+Completion run_vm_node(ASTNode *node, StackFrame *frame) {
+    if (!node) return COMPLETION_NORMAL;
     
     // This current_class update is simplistic. execute_function_call is better placed to manage it.
     // if (frame && frame->function_name) {
@@ -489,43 +1377,42 @@ void run_vm_node(ASTNode *node, StackFrame *frame) {
     // }
 
     switch (node->type) {
-        case AST_PROGRAM: {
-            ASTNode *stmt = node->left;
-            while (stmt) { run_vm_node(stmt, frame); stmt = stmt->next; }
-            break;
-        }
-        case AST_FUNCTION: case AST_TYPED_FUNCTION: break; 
+        case AST_PROGRAM:
         case AST_BLOCK: {
-            ASTNode *stmt = node->left;
-            while (stmt) { run_vm_node(stmt, frame); stmt = stmt->next; }
+            for (ASTNode *stmt = node->left; stmt; stmt = stmt->next) {
+                Completion completion = run_vm_node(stmt, frame);
+                if (completion != COMPLETION_NORMAL) return completion;
+            }
             break;
         }
+        case AST_FUNCTION: case AST_TYPED_FUNCTION: break; 
         case AST_PRINT: {
-            const char *value_to_print = evaluate_expression(node->left, frame);
-            printf("[OUTPUT] %s\n", value_to_print ? value_to_print : "undefined");
-            fflush(stdout);
+            Value value_to_print = evaluate_expression(node->left, frame);
+            print_value(value_to_print);
+            value_release(value_to_print);
             break;
         }
         case AST_VAR_DECL: 
         case AST_TYPED_VAR_DECL: { 
-            const char *var_name = node->value; 
-            const char *initial_value_str = "undefined"; 
+            Value initial_value = value_undefined(); 
             if (node->right) { 
-                initial_value_str = evaluate_expression(node->right, frame);
+                initial_value = evaluate_expression(node->right, frame);
             } else if (node->type == AST_TYPED_VAR_DECL) { // Default init for typed vars if no explicit init
-                if(strcmp(node->data_type, "int")==0 || strcmp(node->data_type, "long")==0) initial_value_str = "0";
-                else if(strcmp(node->data_type, "float")==0 || strcmp(node->data_type, "double")==0) initial_value_str = "0.0";
-                else if(strcmp(node->data_type, "bool")==0) initial_value_str = "false";
-                else if(strcmp(node->data_type, "string")==0) initial_value_str = "";
+                if(strcmp(node->data_type, "int")==0 || strcmp(node->data_type, "long")==0) initial_value = value_int(0);
+                else if(strcmp(node->data_type, "float")==0 || strcmp(node->data_type, "double")==0) initial_value = value_double(0.0);
+                else if(strcmp(node->data_type, "bool")==0) initial_value = value_bool(0);
+                else if(strcmp(node->data_type, "string")==0) initial_value = value_string("");
                 // Object types default to null/undefined implicitly
             }
-            set_variable(frame, var_name, initial_value_str);
+            store_variable(node, frame, initial_value);
+            value_release(initial_value);
             break;
         }
         case AST_ASSIGN: { 
-            const char *value_to_assign = evaluate_expression(node->right, frame);
             if (node->left->type == AST_IDENTIFIER) {
-                set_variable(frame, node->left->value, value_to_assign);
+                Value value_to_assign = evaluate_expression(node->right, frame);
+                store_variable(node->left, frame, value_to_assign);
+                value_release(value_to_assign);
             } else if (node->left->type == AST_MEMBER_ACCESS) {
                 // This case should ideally be fully handled by AST_BINARY_OP with "="
                 // Forcing it here means re-evaluating parts of member access.
@@ -535,39 +1422,67 @@ void run_vm_node(ASTNode *node, StackFrame *frame) {
                 fprintf(stderr, "Warning L%d: AST_ASSIGN for member access is less robust, prefer BINARY_OP for assignment.\n", node->line);
                 // Quick attempt to make it work similarly to BINARY_OP's assignment logic
                 ASTNode temp_binary_op_assign_node; // Stack allocate a temporary node
+                memset(&temp_binary_op_assign_node, 0, sizeof(temp_binary_op_assign_node));
                 temp_binary_op_assign_node.type = AST_BINARY_OP;
-                strcpy(temp_binary_op_assign_node.value, "="); // Operator is "="
+                temp_binary_op_assign_node.value = intern("="); // Operator is "="
                 temp_binary_op_assign_node.left = node->left;   // Original LHS (e.g. member access node)
                 temp_binary_op_assign_node.right = node->right; // Original RHS (expression node for value)
                 temp_binary_op_assign_node.line = node->line;
                 temp_binary_op_assign_node.col = node->col;
-                evaluate_expression(&temp_binary_op_assign_node, frame); // Let eval handle it
+                value_release(evaluate_expression(&temp_binary_op_assign_node, frame)); // Let eval handle it
             } else {
                  fprintf(stderr, "Error (L%d:%d): Invalid left-hand side for AST_ASSIGN operation.\n", node->left->line, node->left->col);
             }
             break;
         }
         case AST_RETURN: {
-            const char *ret_val_str = node->left ? evaluate_expression(node->left, frame) : "0"; 
-            set_return_value(ret_val_str);
-            break;
+            ASTNode *call = node->left;
+            while (call && call->type == AST_TERNARY) {
+                // return c ? a : b returns from the branch taken, so a call there is a tail call too
+                Value cond_val = evaluate_expression(call->left, frame);
+                int truthy = value_is_truthy(cond_val);
+                value_release(cond_val);
+                call = truthy ? call->right : call->next;
+            }
+            if (call && call->type == AST_CALL && !call->right && is_self_tail_call(call, ast_running_function, frame)) {
+                int arg_count = 0;
+                for (ASTNode *arg = call->left; arg; arg = arg->next) arg_count++;
+                Value args_stack[8];
+                Value *args = arg_count <= 8 ? args_stack : (Value*)malloc(sizeof(Value) * arg_count);
+                if (args) {
+                    int i = 0;
+                    for (ASTNode *arg = call->left; arg; arg = arg->next) {
+                        args[i] = evaluate_expression(arg, frame);
+                        vm_gc_push_root(args[i++]);
+                    }
+                    vm_gc_pop_roots(arg_count);
+                    rebind_tail_call_frame(frame, ast_running_function, args, arg_count);
+                    for (i = 0; i < arg_count; i++) value_release(args[i]);
+                    if (args != args_stack) free(args);
+                    return COMPLETION_TAIL_CALL;
+                }
+            }
+            set_return_value(call ? evaluate_expression(call, frame) : value_undefined());
+            return COMPLETION_RETURN;
         }
         case AST_IF: {
-            const char *cond_val_str = evaluate_expression(node->left, frame); 
-            int truthy = cond_val_str && strcmp(cond_val_str, "0") != 0 && strcmp(cond_val_str, "false") != 0 && strcmp(cond_val_str, "") != 0;
-            if (truthy) run_vm_node(node->right, frame); 
-            else if (node->next && node->next->type == AST_ELSE) run_vm_node(node->next->left, frame); 
+            Value cond_val = evaluate_expression(node->left, frame); 
+            int truthy = value_is_truthy(cond_val);
+            value_release(cond_val);
+            if (truthy) return run_vm_node(node->right, frame); 
+            else if (node->next && node->next->type == AST_ELSE) return run_vm_node(node->next->left, frame); 
             break;
         }
         case AST_WHILE: {
             while(1) {
-                const char *cond_val_str = evaluate_expression(node->left, frame); 
-                int truthy = cond_val_str && strcmp(cond_val_str, "0") != 0 && strcmp(cond_val_str, "false") != 0 && strcmp(cond_val_str, "") != 0;
+                Value cond_val = evaluate_expression(node->left, frame); 
+                int truthy = value_is_truthy(cond_val);
+                value_release(cond_val);
                 if (!truthy) break;
-                g_continue_flag = 0; // reset at start of iteration
-                run_vm_node(node->right, frame);
-                if (g_break_flag) { g_break_flag = 0; break; }
-                if (g_continue_flag) { g_continue_flag = 0; continue; }
+                gc_safepoint();
+                Completion completion = run_vm_node(node->right, frame);
+                if (completion == COMPLETION_BREAK) break;
+                if (completion == COMPLETION_RETURN || completion == COMPLETION_TAIL_CALL) return completion;
             }
             break;
         }
@@ -580,63 +1495,70 @@ void run_vm_node(ASTNode *node, StackFrame *frame) {
 
             if (init_expr) {
                 if(init_expr->type == AST_VAR_DECL || init_expr->type == AST_TYPED_VAR_DECL) run_vm_node(init_expr, frame);
-                else evaluate_expression(init_expr, frame); 
+                else value_release(evaluate_expression(init_expr, frame)); 
             }
             while (1) {
                 int truthy = 1; 
                 if (cond_expr) {
-                    const char *cond_val_str = evaluate_expression(cond_expr, frame);
-                    truthy = cond_val_str && strcmp(cond_val_str, "0") != 0 && strcmp(cond_val_str, "false") != 0 && strcmp(cond_val_str, "") != 0;
+                    Value cond_val = evaluate_expression(cond_expr, frame);
+                    truthy = value_is_truthy(cond_val);
+                    value_release(cond_val);
                 }
                 if (!truthy) break; 
-                run_vm_node(node->right, frame); 
-                g_continue_flag = 0; // reset for each iteration
-                if (g_break_flag) { g_break_flag = 0; break; }
-                if (g_continue_flag) { g_continue_flag = 0; if (incr_expr) evaluate_expression(incr_expr, frame); continue; }
-                if (incr_expr) evaluate_expression(incr_expr, frame); 
+                gc_safepoint();
+                Completion completion = run_vm_node(node->right, frame);
+                if (completion == COMPLETION_BREAK) break;
+                if (completion == COMPLETION_RETURN || completion == COMPLETION_TAIL_CALL) return completion;
+                if (incr_expr) value_release(evaluate_expression(incr_expr, frame)); // Also after continue
             }
             break;
         }
-        case AST_CALL: {
-            // Reconstruct qualified name if method call stored as target->right, value->method_name
-            char qualified_name_buffer[512];
-            if (node->right) { // Method call (target in right, method name in value)
-                const char* target_eval_str = evaluate_expression(node->right, frame);
-                snprintf(qualified_name_buffer, sizeof(qualified_name_buffer), "%s.%s", target_eval_str ? target_eval_str : "undefined_target", node->value);
-            } else { // Plain function call
-                strncpy(qualified_name_buffer, node->value, sizeof(qualified_name_buffer)-1);
-                qualified_name_buffer[sizeof(qualified_name_buffer)-1] = '\0';
-            }
-            execute_function_call(qualified_name_buffer, node->left, frame);
-            break;
-        }
+        case AST_CALL: // Calls share evaluate_expression's method dispatch; the result is discarded
         case AST_BINARY_OP: case AST_UNARY_OP: case AST_LITERAL: 
         case AST_IDENTIFIER: case AST_MEMBER_ACCESS: case AST_NEW:
-            evaluate_expression(node, frame);
-            break;
-        case AST_BREAK: {
-            g_break_flag = 1;
+            value_release(evaluate_expression(node, frame));
             break;
-        }
-        case AST_CONTINUE: {
-            g_continue_flag = 1;
-            break;
-        }
+        case AST_BREAK:
+            return COMPLETION_BREAK;
+        case AST_CONTINUE:
+            return COMPLETION_CONTINUE;
         default:
             // fprintf(stderr, "Warning (L%d:%d): VM cannot run unknown AST node type %s (%d).\n", node->line, node->col, node_type_to_string(node->type), node->type);
             break;
     }
+    return COMPLETION_NORMAL;
+}
+
+// 1 unless dead-code elimination (optimize.c) found nothing that reaches the declaration
+static int is_reachable_declaration(ASTNode *decl) {
+    if (optimize_declaration_reachable(decl)) return 1;
+    printf("[OPT] Skipped unreachable %s %s\n", decl->type == AST_CLASS ? "class" : decl->type == AST_STRUCT ? "struct" : "function", decl->value);
+    return 0;
 }
 
 void run_vm(ASTNode *root_ast_node) {
     if (!root_ast_node) { fprintf(stderr, "[VM] Error: Cannot run VM on NULL AST.\n"); return; }
     vm_init(); 
+    stack_frame_init_slots(global_frame, root_ast_node->local_count, root_ast_node->local_names);
     
     // printf("\n==== Program Output (VM Run) ====\n");
     
     if (root_ast_node->type == AST_PROGRAM) {
+        int prune_imports = optimize_prunes_imports();
+        if (prune_imports) {
+            // Every module is loaded before anything is registered, so what they reach is known
+            for (ASTNode *node = root_ast_node->left; node; node = node->next) {
+                if (node->type != AST_IMPORT) continue;
+                Module *mod = module_load(node->value);
+                if (mod && mod->ast && mod->ast->type == AST_PROGRAM) optimize_reach_module(mod->ast);
+            }
+        }
         ASTNode *node = root_ast_node->left;
         while (node) {
+            if (!is_reachable_declaration(node)) {
+                node = node->next;
+                continue;
+            }
             if (node->type == AST_FUNCTION || node->type == AST_TYPED_FUNCTION) {
                 register_user_function(node);
             } else if (node->type == AST_CLASS || node->type == AST_STRUCT) {
@@ -644,8 +1566,7 @@ void run_vm(ASTNode *root_ast_node) {
                 ASTNode *class_member = node->left; 
                 while (class_member) {
                     if (class_member->type == AST_FUNCTION || class_member->type == AST_TYPED_FUNCTION || class_member->type == AST_CLASS_METHOD) {
-                        if (class_member->parent_class_name) free(class_member->parent_class_name);
-                        class_member->parent_class_name = strdup(node->value); 
+                        class_member->parent_class_name = node->value; 
                         register_user_function(class_member);
                     }
                     class_member = class_member->next;
@@ -653,10 +1574,14 @@ void run_vm(ASTNode *root_ast_node) {
             } else if (node->type == AST_IMPORT) {
                 // Handle module import and register its functions and classes
                 {
-                    Module *mod = module_load(node->value);
+                    Module *mod = prune_imports ? module_find(node->value) : module_load(node->value);
                     if (mod && mod->ast && mod->ast->type == AST_PROGRAM) {
                         ASTNode *imp_node = mod->ast->left;
                         while (imp_node) {
+                            if (!is_reachable_declaration(imp_node)) {
+                                imp_node = imp_node->next;
+                                continue;
+                            }
                             if (imp_node->type == AST_FUNCTION || imp_node->type == AST_TYPED_FUNCTION) {
                                 register_user_function(imp_node);
                             } else if (imp_node->type == AST_CLASS || imp_node->type == AST_STRUCT) {
@@ -664,8 +1589,7 @@ void run_vm(ASTNode *root_ast_node) {
                                 ASTNode *cm = imp_node->left;
                                 while (cm) {
                                     if (cm->type == AST_FUNCTION || cm->type == AST_TYPED_FUNCTION || cm->type == AST_CLASS_METHOD) {
-                                        if (cm->parent_class_name) free(cm->parent_class_name);
-                                        cm->parent_class_name = strdup(imp_node->value);
+                                        cm->parent_class_name = imp_node->value;
                                         register_user_function(cm);
                                     }
                                     cm = cm->next;
@@ -679,6 +1603,7 @@ void run_vm(ASTNode *root_ast_node) {
             node = node->next;
         }
     }
+    for (ClassEntry *entry = registered_classes; entry; entry = entry->next) class_method_table(entry);
     
     typedef struct LifecycleInstance {
         char obj_ref_str[32]; 
@@ -694,8 +1619,7 @@ void run_vm(ASTNode *root_ast_node) {
         find_static_class_object(cls_iter->name); 
         Object *instance_obj = create_object(cls_iter->name); 
         if (instance_obj) {
-            int obj_id_val = 0;
-            sscanf(instance_obj->class_name, "%*[^#]#%d", &obj_id_val); 
+            int obj_id_val = instance_obj->id;
             LifecycleInstance *inst_entry = (LifecycleInstance*)calloc(1, sizeof(LifecycleInstance)); // Use calloc
             if (!inst_entry) { fprintf(stderr, "Mem alloc failed for lifecycle entry\n"); break;}
             snprintf(inst_entry->obj_ref_str, sizeof(inst_entry->obj_ref_str), "obj:%d", obj_id_val);
@@ -718,7 +1642,7 @@ void run_vm(ASTNode *root_ast_node) {
                     }
                 }
                 if (has_static_singleton_field) {
-                    set_object_property_with_access(static_obj_for_class, "singleton", inst_entry->obj_ref_str, ACCESS_MODIFIER_PUBLIC, 1);
+                    set_object_property_with_access(static_obj_for_class, "singleton", object_ref_value(instance_obj), ACCESS_MODIFIER_PUBLIC, 1);
                 }
             }
         }
@@ -769,7 +1693,14 @@ void run_vm(ASTNode *root_ast_node) {
 #endif  // end disable lifecycle loops
 
     // Fallback: execute top-level statements for scripts without main
-    run_vm_node(root_ast_node, global_frame);
+    if (use_bytecode) {
+        BytecodeChunk *program_chunk = ir_compile_program(root_ast_node);
+        aot_attach(program_chunk, root_ast_node);
+        value_release(run_bytecode(program_chunk, global_frame));
+        ir_free_chunk(program_chunk);
+    } else {
+        run_vm_node(root_ast_node, global_frame);
+    }
 
     // Call main() if it exists
     ASTNode* main_func = find_user_function("main", NULL);
@@ -778,7 +1709,7 @@ void run_vm(ASTNode *root_ast_node) {
         printf("==== EXECUTING MAIN() ====\n");
         printf("=========================\n\n");
         fflush(stdout);
-        execute_function_call(main_func->value, main_func->left, global_frame);
+        value_release(execute_function_call(main_func->value, NULL, global_frame));
         printf("\n\n===========================\n");
         printf("==== EXECUTION COMPLETE ====\n");
         printf("===========================\n\n");
@@ -793,127 +1724,114 @@ void run_vm(ASTNode *root_ast_node) {
     // vm_cleanup called by main
 }
 
-void set_object_property(Object *obj, const char *name, const char *value) {
+void set_object_property(Object *obj, const char *name, Value value) {
     set_object_property_with_access(obj, name, value, ACCESS_MODIFIER_PUBLIC, 0); 
 }
 
-const char* evaluate_member_access(ASTNode *member_access_expr_node, StackFrame *frame) {
+Value evaluate_member_access(ASTNode *member_access_expr_node, StackFrame *frame) {
     if (!member_access_expr_node || member_access_expr_node->type != AST_MEMBER_ACCESS || 
         !member_access_expr_node->left || !member_access_expr_node->value[0]) {
         // fprintf(stderr, "Error (L%d:%d): Invalid member access expression.\n", member_access_expr_node ? member_access_expr_node->line: 0, member_access_expr_node ? member_access_expr_node->col : 0);
-        return "undefined";
+        return value_undefined();
     }
     
-    const char *object_or_class_ref_str;
+    Value target;
     ASTNode *target_expr_node = member_access_expr_node->left; 
     const char *property_name_str = member_access_expr_node->value; 
 
     if (target_expr_node->type == AST_THIS) {
-        object_or_class_ref_str = get_variable(frame, "this");
-        if (!object_or_class_ref_str) {
+        Value *this_val = get_variable(frame, name_this);
+        if (!this_val) {
             fprintf(stderr, "Error (L%d:%d): 'this' is undefined in current context for member access '%s'.\n", target_expr_node->line, target_expr_node->col, property_name_str);
-            return "undefined";
+            return value_undefined();
         }
+        target = value_copy(*this_val);
     } else {
-        object_or_class_ref_str = evaluate_expression(target_expr_node, frame);
+        target = evaluate_expression(target_expr_node, frame);
     }
     
-    // Early universal .length support for plain strings and pseudo array literals
-    if (object_or_class_ref_str && strcmp(property_name_str, "length") == 0) {
-        if (object_or_class_ref_str[0] == '[') {
-            /* Count only top-level elements: keep track of nested bracket depth so that
-               commas inside sub-arrays are ignored.  This prevents exaggerated length
-               values for multidimensional literals like [[1,2],[3,4]]. */
-            int depth = 0;
-            int elem_count = 0;
-            int in_elem = 0;
-
-            for (const char *p = object_or_class_ref_str + 1; *p && !(depth == 0 && *p == ']'); ++p) {
-                char ch = *p;
-                if (ch == '[') {
-                    depth++;
-                    in_elem = 1;
-                }
-                else if (ch == ']') {
-                    if (depth > 0) depth--; /* close nested */
-                    in_elem = 1;
-                }
-                else if (ch == ',' && depth == 0) {
-                    /* End of a top-level element */
-                    elem_count++;
-                    in_elem = 0;
-                }
-                else if (!isspace((unsigned char)ch)) {
-                    in_elem = 1; /* non-space char inside current element */
-                }
-            }
-            if (in_elem) elem_count++; /* account for final element if any */
+    if (target.type == VAL_ARRAY && strcmp(property_name_str, "length") == 0) {
+        int64_t length = target.as.array->count;
+        value_release(target);
+        return value_int(length);
+    }
+    if (target.type == VAL_MAP) {
+        const Value *entry_value = map_get_text(target.as.map, property_name_str);
+        Value result = entry_value ? value_copy(*entry_value) : value_undefined();
+        value_release(target);
+        return result;
+    }
 
-            static char len_buf[32];
-            snprintf(len_buf, sizeof(len_buf), "%d", elem_count);
-            return len_buf;
-        } else {
-            static char len_buf[32];
-            snprintf(len_buf, sizeof(len_buf), "%zu", strlen(object_or_class_ref_str));
-            return len_buf;
-        }
+    if (target.type == VAL_STRING && strcmp(property_name_str, "length") == 0) {
+        int64_t length = (int64_t)target.as.string->length;
+        value_release(target);
+        return value_int(length);
     }
     
-    if (!object_or_class_ref_str || strcmp(object_or_class_ref_str, "undefined") == 0) {
+    if (target.type == VAL_UNDEFINED) {
         // Semantic analysis should catch most of these if target_expr_node->value is an undeclared identifier
         // This error might still occur if evaluate_expression for target_expr_node results in "undefined" at runtime
         // printf("[VM EVAL_MEMBER_ACCESS] Error: Cannot access property '%s' of undefined or unresolved target '%s' (L%d).\n", 
         //        property_name_str, target_expr_node->value, member_access_expr_node->line);
-        return "undefined";
+        return value_undefined();
     }
 
-    if (strncmp(object_or_class_ref_str, "obj:", 4) == 0) { 
-        int obj_id = atoi(object_or_class_ref_str + 4);
-        Object *target_obj = find_object_by_id(obj_id);
+    if (target.type == VAL_OBJECT) { 
+        Object *target_obj = find_object_by_ref(target);
         if (target_obj) {
+            int slot = cached_property_slot(member_access_expr_node, target_obj);
+            if (slot >= 0) return value_copy(target_obj->property_values[slot]);
             return get_object_property_with_access(target_obj, property_name_str, current_class);
         } else {
-            fprintf(stderr, "Error (L%d:%d): Object %s not found for property access '%s'.\n", member_access_expr_node->line, member_access_expr_node->col, object_or_class_ref_str, property_name_str);
-            return "undefined";
+            fprintf(stderr, "Error (L%d:%d): Object obj:%d not found for property access '%s'.\n", member_access_expr_node->line, member_access_expr_node->col, target.as.object.id, property_name_str);
+            return value_undefined();
         }
-    } else { 
-        const char* class_name_str = object_or_class_ref_str;
+    } else if (target.type == VAL_STRING) { 
+        const char* class_name_str = ouro_string_chars(target.as.string);
         ClassEntry* ce = find_class_entry(class_name_str); // Check if it's a known class
+        Value result = value_undefined();
         if (!ce) { // If not a registered class, it might be some other non-object string
              fprintf(stderr, "Error (L%d:%d): Target '%s' for member access '%s' is not a known class or object instance.\n", 
                 target_expr_node->line, target_expr_node->col, class_name_str, property_name_str);
-            return "undefined";
-        }
-        Object *static_obj = find_static_class_object(class_name_str); 
-        if (static_obj) {
-            return get_object_property_with_access(static_obj, property_name_str, current_class);
         } else {
-             fprintf(stderr, "Error (L%d:%d): Could not find/create static object for class '%s' to access '%s'.\n", 
-                target_expr_node->line, target_expr_node->col, class_name_str, property_name_str);
-            return "undefined";
+            Object *static_obj = find_static_class_object(class_name_str); 
+            if (static_obj) {
+                result = get_object_property_with_access(static_obj, property_name_str, current_class);
+            } else {
+                 fprintf(stderr, "Error (L%d:%d): Could not find/create static object for class '%s' to access '%s'.\n", 
+                    target_expr_node->line, target_expr_node->col, class_name_str, property_name_str);
+            }
         }
+        value_release(target);
+        return result;
     }
+    char text_buf[VALUE_TEXT_BUFFER_SIZE];
+    fprintf(stderr, "Error (L%d:%d): Target '%s' for member access '%s' is not a known class or object instance.\n", 
+        target_expr_node->line, target_expr_node->col, value_to_text(target, text_buf, sizeof(text_buf)), property_name_str);
+    return value_undefined();
 }
 
 Object* find_object_by_id(int id) {
-    Object *obj_iter = objects;
-    while (obj_iter) {
-        int current_obj_id = 0;
-        char *hash_pos = strchr(obj_iter->class_name, '#');
-        if (hash_pos) {
-            current_obj_id = atoi(hash_pos + 1);
-            if (current_obj_id == id) return obj_iter;
-        }
-        obj_iter = obj_iter->next;
-    }
-    return NULL;
+    if (id <= 0 || id >= object_handle_count) return NULL;
+    return object_handles[id].object;
+}
+
+Object* find_object_by_ref(Value ref) {
+    if (ref.type != VAL_OBJECT) return NULL;
+    Object *obj = find_object_by_id(ref.as.object.id);
+    if (obj && ref.as.object.generation != 0 && ref.as.object.generation != obj->generation) return NULL;
+    return obj;
 }
 
 Object* find_static_class_object(const char *class_name) {
+    ClassEntry *entry = find_class_entry(class_name);
+    if (entry && entry->static_object) return entry->static_object;
+
     char static_obj_prefix[128 + 8]; 
     snprintf(static_obj_prefix, sizeof(static_obj_prefix), "%s_static", class_name); 
 
-    Object *obj_iter = objects;
+    // Registered classes cache their companion; other names are searched for
+    Object *obj_iter = entry ? NULL : objects;
     while (obj_iter) {
         if (strncmp(obj_iter->class_name, static_obj_prefix, strlen(static_obj_prefix)) == 0) {
              char char_after_prefix = obj_iter->class_name[strlen(static_obj_prefix)];
@@ -921,92 +1839,204 @@ Object* find_static_class_object(const char *class_name) {
         }
         obj_iter = obj_iter->next;
     }
-    return create_object(static_obj_prefix); 
+    Object *static_obj = create_object(static_obj_prefix);
+    if (static_obj && entry) entry->static_object = static_obj;
+    if (static_obj) initialize_class_fields(class_name, static_obj, global_frame, 1);
+    return static_obj;
+}
+
+static void set_object_property_text(Object *obj, const char *name, const char *text, AccessModifierEnum access, int is_static) {
+    Value v = value_string(text);
+    set_object_property_with_access(obj, name, v, access, is_static);
+    value_release(v);
 }
 
 void initialize_test_class(Object *obj) {
     if (!obj || strstr(obj->class_name, "TestClass") == NULL) return; 
     if (strstr(obj->class_name, "_static") != NULL) { 
-        set_object_property_with_access(obj, "static_prop", "Static Property Value", ACCESS_MODIFIER_PUBLIC, 1);
+        set_object_property_text(obj, "static_prop", "Static Property Value", ACCESS_MODIFIER_PUBLIC, 1);
     } else { 
-        set_object_property_with_access(obj, "public_prop", "Public Property Value", ACCESS_MODIFIER_PUBLIC, 0);
-        set_object_property_with_access(obj, "private_prop", "Private Property Value", ACCESS_MODIFIER_PRIVATE, 0);
+        set_object_property_text(obj, "public_prop", "Public Property Value", ACCESS_MODIFIER_PUBLIC, 0);
+        set_object_property_text(obj, "private_prop", "Private Property Value", ACCESS_MODIFIER_PRIVATE, 0);
         Object* static_companion = find_static_class_object("TestClass");
         if(static_companion && get_object_property_with_access_check(static_companion, "static_prop", "TestClass") == NULL) {
-             set_object_property_with_access(static_companion, "static_prop", "Static Property Value", ACCESS_MODIFIER_PUBLIC, 1);
+             set_object_property_text(static_companion, "static_prop", "Static Property Value", ACCESS_MODIFIER_PUBLIC, 1);
         }
     }
 }
 
 /// Bridge to stdlib.c's call_builtin_function
-const char* call_built_in_function(const char* func_name_to_call, ASTNode* args_ast_list, StackFrame* frame_for_evaluating_args) {
-    if (!func_name_to_call) return "undefined";
+int call_built_in_function(const char* func_name_to_call, ASTNode* args_ast_list, StackFrame* frame_for_evaluating_args, Value *result) {
+    if (!func_name_to_call) return 0;
 
     int arg_count = 0;
     ASTNode *iter = args_ast_list;
     while (iter) { arg_count++; iter = iter->next; }
 
-    const char **arg_values_evaluated = NULL; // Array of C-string pointers
-    if (arg_count > 0) {
-        arg_values_evaluated = (const char**)calloc(arg_count, sizeof(char*)); // Use calloc
-        if (!arg_values_evaluated) {
+    Value arg_values_stack[8];
+    Value *arg_values = arg_values_stack;
+    if (arg_count > (int)(sizeof(arg_values_stack) / sizeof(arg_values_stack[0]))) {
+        arg_values = (Value*)malloc(sizeof(Value) * arg_count);
+        if (!arg_values) {
             fprintf(stderr, "VM Error (L%d): Out of memory marshalling args for builtin '%s'.\n", args_ast_list ? args_ast_list->line : 0, func_name_to_call);
-            return "undefined";
-        }
-        iter = args_ast_list;
-        for (int i = 0; i < arg_count; ++i) {
-            arg_values_evaluated[i] = evaluate_expression(iter, frame_for_evaluating_args);
-            iter = iter->next;
+            return 0;
         }
     }
-    
-    // Corrected function call
-    int was_found_and_called = call_builtin_function_impl(func_name_to_call, arg_values_evaluated, arg_count);
+    iter = args_ast_list;
+    for (int i = 0; i < arg_count; ++i) {
+        arg_values[i] = evaluate_expression(iter, frame_for_evaluating_args);
+        vm_gc_push_root(arg_values[i]);
+        iter = iter->next;
+    }
 
-    if (arg_values_evaluated) free((void*)arg_values_evaluated);
+    int was_found_and_called = call_built_in_function_values(func_name_to_call, arg_values, arg_count, result);
+    vm_gc_pop_roots(arg_count);
 
-    if (was_found_and_called) {
-        return get_return_value(); 
-    }
-    return "undefined"; 
+    for (int i = 0; i < arg_count; ++i) value_release(arg_values[i]);
+    if (arg_values != arg_values_stack) free(arg_values);
+    return was_found_and_called;
 }
 
-static void initialize_default_instance_fields(const char *class_name_param, Object *instance_obj, StackFrame *frame_for_eval) {
-    // Initialize fields from this class
-    ClassEntry* class_entry = find_class_entry(class_name_param);
-    if (class_entry) {
-        ASTNode* class_node = class_entry->class_node;
-        if (class_node && class_node->left) {
-            ASTNode* member = class_node->left;
-            while (member) {
-                if (member->type == AST_CLASS_FIELD) {
-                    // Initialize field with default value or expression
-                    if (member->left) {
-                        // Prepare buffer for field value
-                        char value[256] = "";
-                        const char* result = evaluate_expression(member->left, frame_for_eval);
-                        if (result) {
-                            strncpy(value, result, sizeof(value) - 1);
-                        }
-                        set_object_property_with_access(instance_obj, member->value, value, ACCESS_MODIFIER_PUBLIC, 0);
-                    }
+/// Map builtins: keys(map) and values(map) return arrays in insertion order,
+/// has(map, key) and remove(map, key) test and delete a key, size(map) counts entries.
+static int call_map_builtin(const char* func_name_to_call, Value *args, int arg_count, Value *result) {
+    OuroMap *map = args[0].as.map;
+    if (arg_count == 1) {
+        int want_keys = strcmp(func_name_to_call, "keys") == 0;
+        if (want_keys || strcmp(func_name_to_call, "values") == 0) {
+            Value list = value_array(map->count);
+            int position = 0;
+            const MapEntry *entry;
+            while ((entry = map_next(map, &position)) != NULL) {
+                if (want_keys) {
+                    Value key;
+                    key.type = VAL_STRING;
+                    key.as.string = entry->key;
+                    array_push(list.as.array, key);
+                } else {
+                    array_push(list.as.array, entry->value);
                 }
-                member = member->next;
+            }
+            *result = list;
+            return 1;
+        }
+        if (strcmp(func_name_to_call, "size") == 0) {
+            *result = value_int(map->count);
+            return 1;
+        }
+    } else if (arg_count == 2) {
+        int want_has = strcmp(func_name_to_call, "has") == 0;
+        if (want_has || strcmp(func_name_to_call, "remove") == 0) {
+            Value key = value_to_string(args[1]);
+            *result = value_bool(want_has ? map_get(map, key.as.string) != NULL : map_remove(map, key.as.string));
+            value_release(key);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/// Builtins that operate on values rather than text: push(array, items...) appends and
+/// returns the new length, pop(array) removes and returns the last item. Map builtins and
+/// the string_builder_* family (stdlib.c) are dispatched from here too.
+static int call_value_builtin(const char* func_name_to_call, Value *args, int arg_count, Value *result) {
+    if (call_string_builder_builtin(func_name_to_call, args, arg_count, result)) return 1;
+    if (arg_count >= 1 && args[0].type == VAL_MAP) return call_map_builtin(func_name_to_call, args, arg_count, result);
+    if (arg_count < 1 || args[0].type != VAL_ARRAY) return 0;
+    OuroArray *array = args[0].as.array;
+    if (strcmp(func_name_to_call, "push") == 0) {
+        for (int i = 1; i < arg_count; i++) array_push(array, args[i]);
+        *result = value_int(array->count);
+        return 1;
+    }
+    if (strcmp(func_name_to_call, "pop") == 0 && arg_count == 1) {
+        *result = array_pop(array);
+        return 1;
+    }
+    return 0;
+}
+
+/// Calls a stdlib builtin with already-evaluated arguments. Builtins take their
+/// arguments as text, so each value is rendered once before the call.
+int call_built_in_function_values(const char* func_name_to_call, Value *args, int arg_count, Value *result) {
+    if (!func_name_to_call) return 0;
+
+    Value value_result;
+    if (call_value_builtin(func_name_to_call, args, arg_count, &value_result)) {
+        if (result) *result = value_result;
+        else value_release(value_result);
+        return 1;
+    }
+
+    const char **arg_texts = NULL; // Array of C-string pointers
+    char (*text_bufs)[VALUE_TEXT_BUFFER_SIZE] = NULL;
+    Value *array_texts = NULL; // Full text of array and map arguments, which do not fit text_bufs
+    if (arg_count > 0) {
+        arg_texts = (const char**)calloc(arg_count, sizeof(char*)); // Use calloc
+        text_bufs = (char (*)[VALUE_TEXT_BUFFER_SIZE])malloc((size_t)arg_count * VALUE_TEXT_BUFFER_SIZE);
+        array_texts = (Value*)calloc(arg_count, sizeof(Value)); // Zeroed values are VAL_UNDEFINED
+        if (!arg_texts || !text_bufs || !array_texts) {
+            fprintf(stderr, "VM Error: Out of memory marshalling args for builtin '%s'.\n", func_name_to_call);
+            free((void*)arg_texts); free(text_bufs); free(array_texts);
+            return 0;
+        }
+        for (int i = 0; i < arg_count; ++i) {
+            if (args[i].type == VAL_ARRAY || args[i].type == VAL_MAP) {
+                array_texts[i] = value_to_string(args[i]);
+                arg_texts[i] = ouro_string_chars(array_texts[i].as.string);
+            } else {
+                arg_texts[i] = value_to_text(args[i], text_bufs[i], VALUE_TEXT_BUFFER_SIZE);
             }
         }
     }
+    
+    set_return_value(value_undefined());
+    int was_found_and_called = call_builtin_function_impl(func_name_to_call, arg_texts, arg_count);
+
+    for (int i = 0; i < arg_count; ++i) value_release(array_texts[i]);
+    free((void*)arg_texts);
+    free(text_bufs);
+    free(array_texts);
+
+    if (was_found_and_called) {
+        if (result) *result = take_return_value();
+        return 1;
+    }
+    return 0; 
+}
 
-    // Initialize parent class fields if any
+static void initialize_class_fields(const char *class_name_param, Object *target_obj, StackFrame *frame_for_eval, int want_static) {
+    // Initialize parent class fields first so subclasses can override defaults
     const char* parent_name = get_parent_class_name(class_name_param);
     if (parent_name && strlen(parent_name) > 0) {
-        initialize_default_instance_fields(parent_name, instance_obj, frame_for_eval);
+        initialize_class_fields(parent_name, target_obj, frame_for_eval, want_static);
+    }
+
+    ClassEntry* class_entry = find_class_entry(class_name_param);
+    if (!class_entry || !class_entry->class_node) return;
+    for (ASTNode* member = class_entry->class_node->left; member; member = member->next) {
+        ASTNode* initializer;
+        if (member->type == AST_CLASS_FIELD) initializer = member->left;
+        else if (member->type == AST_VAR_DECL || member->type == AST_TYPED_VAR_DECL) initializer = member->right;
+        else continue;
+
+        int is_static = strcmp(member->access_modifier, "static") == 0;
+        if (is_static != want_static) continue;
+        AccessModifierEnum access = strcmp(member->access_modifier, "private") == 0 ? ACCESS_MODIFIER_PRIVATE : ACCESS_MODIFIER_PUBLIC;
+
+        Value field_value = initializer ? evaluate_expression(initializer, frame_for_eval) : value_undefined();
+        set_object_property_with_access(target_obj, member->value, field_value, access, is_static);
+        value_release(field_value);
     }
 }
 
+static void initialize_default_instance_fields(const char *class_name_param, Object *instance_obj, StackFrame *frame_for_eval) {
+    initialize_class_fields(class_name_param, instance_obj, frame_for_eval, 0);
+}
+
 const char* get_parent_class_name(const char *class_name) {
     ClassEntry *entry = find_class_entry(class_name);
-    if (entry && entry->parent_name[0]) return entry->parent_name;
-    return NULL;
+    return entry ? entry->parent_name : NULL;
 }
 
 #if 0  // disable stub frame and local functions
@@ -11,19 +11,38 @@ typedef enum {
     ACCESS_MODIFIER_PROTECTED
 } AccessModifierEnum;
 
-// Object property structure
-typedef struct ObjectProperty {
-    char name[128];
-    char value[1024]; // Consider dynamic allocation for larger values
+// Property descriptor within a shape
+typedef struct ShapeProperty {
+    const char *name;          // Interned, so properties are found by pointer
     AccessModifierEnum access; // e.g. ACCESS_PUBLIC, ACCESS_PRIVATE
-    int is_static;          // 0 for instance, 1 for static
-    struct ObjectProperty *next;
-} ObjectProperty;
+    int is_static;             // 0 for instance, 1 for static
+} ShapeProperty;
+
+// Hidden class: the property layout shared by every object that gained the same
+// properties, with the same modifiers, in the same order. Adding a property moves
+// an object to a child shape; shapes are created once and shared.
+typedef struct Shape {
+    struct Shape *parent;        // NULL for the empty root shape
+    int property_count;
+    ShapeProperty *properties;   // properties[i] is stored in Object.property_values[i]
+    const char *added_name;      // Name of the last property (interned)
+    struct Shape *first_child;   // Transitions to shapes with one more property
+    struct Shape *next_sibling;
+} Shape;
+
+struct ClassEntry; // Registered class (vm.c)
 
 // Object structure
 typedef struct Object {
     char class_name[128]; // Format: "ClassName#InstanceID" or "ClassName_static#ID"
-    ObjectProperty *properties;
+    int id;               // Slot in the handle table; the N of "obj:N"
+    unsigned int generation; // Generation of that slot when the object was created
+    struct ClassEntry *class_entry; // Registered class, or NULL for objects of unregistered classes
+    Shape *shape;
+    Value *property_values; // shape->property_count values, owned
+    int property_capacity;
+    int pinned;           // Static class companions are never collected
+    int gc_marked;        // Set while a collection is marking
     struct Object *next; // For linked list of all objects
 } Object;
 
@@ -33,10 +52,22 @@ typedef void (*CFunction)();
 // External globals (if needed by other modules, e.g., for debugging)
 extern Object *objects;
 extern char current_class[128]; // Current class context for access checks
+extern const char *name_this;   // Interned "this", the variable methods bind their receiver to
 
 // VM initialization and cleanup
 void vm_init();
 void vm_cleanup();
+void vm_set_bytecode_enabled(int enabled); // 1: compile functions to bytecode (default), 0: walk the AST
+void vm_set_jit_enabled(int enabled);      // 1: compile hot bytecode to native code where supported (default), 0: interpret only
+void vm_set_gc_stats_enabled(int enabled); // Print collector statistics from vm_cleanup (-gc-stats)
+
+// Garbage collection. Objects are reclaimed by a mark-and-sweep collector that runs at
+// safe points (function entry, loop back-edges) once enough object memory has been
+// allocated. Roots are the global frame, active call frames, the return value, operand
+// stacks, static class companions and the temporary roots below. Code holding an object
+// reference in a C local across anything that may run user code must register it.
+void vm_gc_push_root(Value value); // Keeps value's object alive until the matching pop
+void vm_gc_pop_roots(int count);
 
 // Function registration (user-defined from AST)
 void register_user_function(ASTNode *func_node); // Takes ASTNode
@@ -44,33 +75,64 @@ ASTNode* find_user_function(const char *name, const char* class_context_name); /
 
 // Object operations
 Object* create_object(const char* class_name); // class_name is base name e.g. "MyClass"
-void set_object_property(Object *obj, const char *name, const char *value); // Basic public setter
-void set_object_property_with_access(Object *obj, const char *name, const char *value, AccessModifierEnum access, int is_static);
-const char* get_object_property(Object *obj, const char *name); // Basic public getter
-const char* get_object_property_with_access_check(Object *obj, const char *name, const char *accessing_class_context);
-const char* get_static_property(const char *class_name, const char *prop_name); // Gets from ClassName_static object
+void set_object_property(Object *obj, const char *name, Value value); // Basic public setter; stores a copy
+void set_object_property_with_access(Object *obj, const char *name, Value value, AccessModifierEnum access, int is_static);
+const Value* get_object_property(Object *obj, const char *name); // Basic public getter; NULL if missing
+const Value* get_object_property_with_access_check(Object *obj, const char *name, const char *accessing_class_context);
+const Value* get_static_property(const char *class_name, const char *prop_name); // Gets from ClassName_static object
 void free_object(Object *obj);
-Object* find_object_by_id(int id);
+Object* find_object_by_id(int id); // Live object in handle slot id, or NULL
+Object* find_object_by_ref(Value ref); // Same for a VAL_OBJECT value; NULL if stale or not an object
 Object* find_static_class_object(const char *class_name); // Finds/creates ClassName_static object
 void initialize_test_class(Object *obj); // Specific initializer, maybe remove/generalize
-const char* get_object_property_with_access(Object *obj, const char *property_name, const char *current_class_context_for_access_check);
+Value get_object_property_with_access(Object *obj, const char *property_name, const char *current_class_context_for_access_check); // Owned copy; undefined if missing or denied
+Value object_ref_value(Object *obj); // obj:N reference to obj
 
 
 // VM execution
-const char* execute_function_call(const char* qualified_name, ASTNode* args_ast_list, StackFrame* caller_frame);
-void run_vm_node(ASTNode *node, StackFrame *frame);
+// Values returned by the execution functions below are owned by the caller.
+Value execute_function_call(const char* qualified_name, ASTNode* args_ast_list, StackFrame* caller_frame);
+// Invokes func_node with already-evaluated arguments. `receiver` becomes `this` (pass undefined for
+// free functions) and class_context the class used for access checks; args are borrowed.
+Value vm_invoke_function(ASTNode *func_node, Value receiver, const char *class_context, Value *args, int arg_count, StackFrame *caller_frame);
+// Same name resolution as execute_function_call, with already-evaluated (borrowed) arguments.
+Value vm_call_function_by_name(const char* qualified_name, Value *args, int arg_count, StackFrame *caller_frame);
+// target.method(args) on an array or map; args[0] is the target. Map entries holding
+// functions are called with the remaining args, anything else runs the builtin method(args).
+Value vm_call_value_method(ASTNode *call_node, Value *args, int arg_count, StackFrame *caller_frame);
+// How a statement run by run_vm_node finished: normally, or unwinding to the
+// enclosing loop (break, continue) or function (return; the value is in the return value)
+typedef enum {
+    COMPLETION_NORMAL,
+    COMPLETION_RETURN,
+    COMPLETION_BREAK,
+    COMPLETION_CONTINUE,
+    COMPLETION_TAIL_CALL // return f(...) of the running function: its frame is rebound, run the body again
+} Completion;
+Completion run_vm_node(ASTNode *node, StackFrame *frame);
 void run_vm(ASTNode *root_ast_node);
 
 // Return value handling
-const char* get_return_value();
-void set_return_value(const char* value);
+Value get_return_value(); // Returns a copy of the current return value
+Value take_return_value(); // Moves the return value out, leaving undefined
+void set_return_value(Value value); // Takes ownership of value
 
 // Class method resolution
 ASTNode* find_class_method(const char *class_name, const char *method_name);
 
+// Inline caches on AST_CALL and AST_MEMBER_ACCESS nodes, keyed by the receiver's class
+// or shape, so repeated executions of a site skip name formatting and registry lookups.
+// Method of receiver's class named by call_node, or NULL to fall back to
+// execute_function_call; *class_context is set to the class to run it in.
+ASTNode* vm_cached_method(ASTNode *call_node, Object *receiver, const char **class_context);
+// obj.<member_node->value> = value as a public instance property
+void vm_set_member_property(ASTNode *member_node, Object *obj, Value value);
+
 // Bridge to stdlib built-in functions (defined in stdlib.c)
 // Arguments: func_name, list of ASTNodes for args, frame to evaluate args in.
-const char* call_built_in_function(const char* func_name_to_call, ASTNode* args_ast_list, StackFrame* frame_for_evaluating_args);
+// Returns 1 and stores the builtin's result in *result when func_name_to_call is a registered builtin.
+int call_built_in_function(const char* func_name_to_call, ASTNode* args_ast_list, StackFrame* frame_for_evaluating_args, Value *result);
+int call_built_in_function_values(const char* func_name_to_call, Value *args, int arg_count, Value *result);
 
 // Add prototype for get_parent_class_name
 const char* get_parent_class_name(const char *class_name);